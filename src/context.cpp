@@ -30,18 +30,42 @@ namespace lint {
     assert(context.changed_files.empty() && "given context already has changed files");
 
     assert(!context.repo_path.empty() && "repo_path of context is empty()");
-    assert(!context.target.empty() && "target of context is empty()");
+    assert((context.scan_all || !context.target.empty()) && "target of context is empty()");
     assert(!context.source.empty() && "source of context is empty()");
 
     context.repo          = git::repo::open(context.repo_path);
-    context.target_commit = git::revparse::commit(*context.repo, context.target);
     context.source_commit = git::revparse::commit(*context.repo, context.source);
+
+    // Files are enumerated from the tree of source while scanning.
+    if (context.scan_all) {
+      return;
+    }
+    context.target_commit = git::revparse::commit(*context.repo, context.target);
     auto diff       = git::diff::get(*context.repo, *context.target_commit, *context.source_commit);
     context.patches = git::patch::create_from_diff(*diff);
     context.deltas  = git::diff::deltas(*diff);
     context.changed_files = git::patch::changed_files(context.patches);
   }
 
+  void fill_staged_info(runtime_context &context) {
+    spdlog::trace("Enter fill_staged_info");
+    assert(context.repo == nullptr && "given context already has a repository");
+    assert(context.changed_files.empty() && "given context already has changed files");
+    assert(!context.repo_path.empty() && "repo_path of context is empty()");
+
+    context.repo          = git::repo::open(context.repo_path);
+    context.target_commit = git::repo::head_commit(*context.repo);
+
+    auto head_tree = context.target_commit == nullptr ? git::tree_ptr{nullptr, ::git_tree_free}
+                                                      : git::commit::tree(*context.target_commit);
+    auto index     = git::repo::index(*context.repo);
+    auto diff      = git::diff::tree_to_index(
+      *context.repo, head_tree.get(), *index, git::diff::init_option());
+    context.patches       = git::patch::create_from_diff(*diff);
+    context.deltas        = git::diff::deltas(*diff);
+    context.changed_files = git::patch::changed_files(context.patches);
+  }
+
   void print_context(const runtime_context &ctx) {
     spdlog::debug("Runtime Context:");
     spdlog::debug("--------------------------------------------------");
@@ -49,6 +73,24 @@ namespace lint {
     spdlog::debug("enable comment on issue: {}", ctx.enable_comment_on_issue);
     spdlog::debug("enable pull request review: {}", ctx.enable_pull_request_review);
     spdlog::debug("enable action output: {}", ctx.enable_action_output);
+    spdlog::debug("enable fail fast: {}", ctx.enable_fail_fast);
+    spdlog::debug("jobs: {}", ctx.jobs);
+    spdlog::debug("memory budget: {} MiB", ctx.memory_budget);
+    spdlog::debug("history file: {}", ctx.history_file);
+    spdlog::debug("github cache file: {}", ctx.github_cache_file);
+    spdlog::debug("progress interval: {}s", ctx.progress_interval.count());
+    spdlog::debug("shard: {}/{} by {}",
+                  ctx.shard_index,
+                  ctx.shard_count,
+                  magic_enum::enum_name(ctx.shard_strategy));
+    spdlog::debug("shard bundle: {}", ctx.shard_bundle);
+    spdlog::debug("bundles: {}", concat(ctx.bundles, ','));
+    spdlog::debug("remote workers: {}", concat(ctx.remote_workers, ','));
+    spdlog::debug("daemon socket: {}", ctx.daemon_socket);
+    spdlog::debug("watch debounce: {}ms", ctx.watch_debounce.count());
+    spdlog::debug("staged: {}", ctx.staged);
+    spdlog::debug("scan all: {}", ctx.scan_all);
+    spdlog::debug("fix: {} into {}", magic_enum::enum_name(ctx.fix_mode), ctx.fix_patch);
     spdlog::debug("repository path: {}", ctx.repo_path);
     spdlog::debug("repository: {}", ctx.repo_pair);
     spdlog::debug("repository token: {}", ctx.token.empty() ? "" : "***");
@@ -56,8 +98,10 @@ namespace lint {
     spdlog::debug("repository target: {}", ctx.target);
     spdlog::debug("repository source: {}", ctx.source);
     spdlog::debug("repository pull-request number: {}", ctx.pr_number);
-    spdlog::debug("repository target commit: {}", git::commit::id_str(*ctx.target_commit));
-    spdlog::debug("repository source commit: {}", git::commit::id_str(*ctx.source_commit));
+    spdlog::debug("repository target commit: {}",
+                  ctx.target_commit ? git::commit::id_str(*ctx.target_commit) : "");
+    spdlog::debug("repository source commit: {}",
+                  ctx.source_commit ? git::commit::id_str(*ctx.source_commit) : "");
     spdlog::debug("{} changed files:", ctx.changed_files.size());
     for (const auto &file: ctx.changed_files) {
       spdlog::debug("{}", file);
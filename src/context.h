@@ -15,14 +15,34 @@
  */
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <git2/repository.h>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "utils/git_utils.h"
 
+namespace lint::remote {
+  class coordinator;
+} // namespace lint::remote
+
 namespace lint {
+  /// How to split tasks between shards.
+  enum class shard_strategy_t : std::uint8_t {
+    hash, // By a stable hash of tool and file, doesn't need any history.
+    cost, // By the predicted wall time so that shards finish at the same time.
+  };
+
+  /// What to do with the fixes of tools.
+  enum class fix_mode_t : std::uint8_t {
+    none,   // Fixes aren't collected.
+    patch,  // Write the fixes into a patch file.
+    commit, // Apply the fixes to worktree and commit them onto HEAD.
+  };
+
   /// The runtime context for all tools.
   struct runtime_context {
     // Theses will be filled by [ program_options::fill_context() ]
@@ -30,6 +50,60 @@ namespace lint {
     bool enable_comment_on_issue    = false;
     bool enable_pull_request_review = false;
     bool enable_action_output       = false;
+    bool enable_fail_fast           = false;
+
+    // The number of concurrent jobs. 0 means decided by the available resources.
+    std::size_t jobs = 0;
+
+    // The memory budget in MiB of concurrent jobs. 0 means decided by the
+    // available memory.
+    std::uint64_t memory_budget = 0;
+
+    // The file which records statistics of previous runs. Empty means the
+    // default one in the git directory.
+    std::string history_file;
+
+    // The file which caches the pages fetched from Github to be revalidated
+    // by their ETags. Empty means the default one in the git directory.
+    std::string github_cache_file;
+
+    // The running comment and review are updated at most once within this
+    // interval while tools run. 0 means only the final result is reported.
+    std::chrono::seconds progress_interval{30};
+
+    // Only the tasks of this shard are run and the results are written into
+    // shard_bundle instead of Github when shard_count is greater than 1.
+    std::size_t shard_index         = 0;
+    std::size_t shard_count         = 1;
+    shard_strategy_t shard_strategy = shard_strategy_t::hash;
+    std::string shard_bundle;
+
+    // The bundles written by shards which are merged by merge subcommand.
+    std::vector<std::string> bundles;
+
+    // The host:port of workers which clang-tidy checks are farmed out to.
+    std::vector<std::string> remote_workers;
+
+    // The Unix domain socket which daemon serves on. Empty means the default
+    // one in the git directory.
+    std::string daemon_socket;
+
+    // Changed files are linted by watch subcommand once nothing is changed
+    // within this duration.
+    std::chrono::milliseconds watch_debounce{200};
+
+    // Lint the contents staged in index against HEAD instead of the source
+    // commit against target. It's set by pre-commit subcommand.
+    bool staged = false;
+
+    // Lint every file of the source commit instead of the changes against
+    // target, and no diff is built.
+    bool scan_all = false;
+
+    // The fixes of all tools are merged and applied once all files are
+    // checked. The patch is written into fix_patch.
+    fix_mode_t fix_mode = fix_mode_t::none;
+    std::string fix_patch;
 
     // Theses will be filled by [ github::fill_context() ]
     std::string repo_path;
@@ -49,9 +123,17 @@ namespace lint {
     std::unordered_map<std::string, git::patch_ptr> patches;
     std::unordered_map<std::string, git_diff_delta> deltas;
     std::vector<std::string> changed_files;
+
+    // The connections to remote_workers. Null if there are no workers.
+    std::shared_ptr<remote::coordinator> remote;
   };
 
   void fill_git_info(runtime_context &context);
 
+  /// Fill the repository and the changes staged in its index against HEAD.
+  /// The target commit is HEAD, which is null before the initial commit, and
+  /// there's no source commit.
+  void fill_staged_info(runtime_context &context);
+
   void print_context(const runtime_context &ctx);
 } // namespace lint
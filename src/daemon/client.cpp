@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "daemon/client.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+#include <spdlog/spdlog.h>
+
+#include "utils/common.h"
+#include "utils/error.h"
+#include "utils/git_utils.h"
+
+namespace lint::daemon {
+  auto request_lint(const std::string &socket_path,
+                    const request &files,
+                    const report_callback &on_report) -> summary {
+    spdlog::trace("Enter request_lint");
+    auto io     = boost::asio::io_context{};
+    auto socket = local::socket{io};
+    socket.connect(local::endpoint{socket_path});
+    write_message(socket, files);
+
+    auto buffer = boost::asio::streambuf{};
+    while (true) {
+      auto message = read_message(socket, buffer);
+      if (message.contains("summary")) {
+        return message["summary"].get<summary>();
+      }
+      on_report(message.at("report").get<report>());
+    }
+  }
+
+  auto default_client_socket(const std::string &directory) -> std::string {
+    git::setup();
+    auto socket = default_socket(*git::repo::discover(directory));
+    git::shutdown();
+    return socket;
+  }
+
+  auto run_client(int argc, char **argv) -> int {
+    namespace po = boost::program_options;
+
+    using po::value;
+    using std::string;
+
+    const auto *level = value<string>()->value_name("level")->default_value("info");
+    const auto *path  = value<string>()->value_name("path");
+    const auto *files = value<std::vector<string>>()->value_name("file")->composing();
+
+    auto desc = po::options_description{"cpp-lint-action client options"};
+    // clang-format off
+    desc.add_options()
+      ("help",                            "Display help message")
+      ("log-level",      level,           "Set the log verbose level of client. "
+                                          "Supports: [trace, debug, info, error]")
+      ("daemon-socket",  path,            "Set the Unix domain socket which daemon serves on. "
+                                          "Defaults to the one of repository containing the current "
+                                          "directory")
+      ("file",           files,           "Set the files to be linted, relative to the root of "
+                                          "repository. Positional arguments are also treated as files")
+    ;
+    // clang-format on
+
+    auto positional = po::positional_options_description{};
+    positional.add("file", -1);
+
+    auto variables = po::variables_map{};
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(),
+              variables);
+    po::notify(variables);
+    if (variables.contains("help")) {
+      std::cout << desc << "\n";
+      return 0;
+    }
+    set_log_level(variables["log-level"].as<std::string>());
+
+    auto files_to_lint = request{};
+    if (variables.contains("file")) {
+      files_to_lint.files = variables["file"].as<std::vector<std::string>>();
+    }
+
+    auto print_report = [](const report &file) {
+      if (file.passed) {
+        spdlog::info("{}: {} passed", file.tool, file.file);
+        return;
+      }
+      spdlog::error("{}: {} failed", file.tool, file.file);
+      if (file.result.is_object()) {
+        std::cout << file.result.value("tool_stdout", std::string{}) << std::flush;
+      }
+    };
+    auto socket = variables.contains("daemon-socket")
+                  ? variables["daemon-socket"].as<std::string>()
+                  : default_client_socket(std::filesystem::current_path().string());
+    auto result = request_lint(socket, files_to_lint, print_report);
+    throw_unless(result.error.empty(), result.error);
+    spdlog::info("{} checks on {} files, all passes: {}",
+                 result.checked,
+                 files_to_lint.files.size(),
+                 result.passed);
+    return result.passed ? 0 : 1;
+  }
+} // namespace lint::daemon
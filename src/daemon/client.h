@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+
+#include "daemon/protocol.h"
+#include "daemon/server.h"
+
+namespace lint::daemon {
+  /// The default socket of client, which is the default one of daemon for the
+  /// repository containing the given directory.
+  auto default_client_socket(const std::string &directory) -> std::string;
+
+  /// Send a request to the daemon listening on socket_path. Reports are passed
+  /// to on_report as soon as they arrive. Throws if the daemon isn't reachable.
+  auto request_lint(const std::string &socket_path,
+                    const request &files,
+                    const report_callback &on_report) -> summary;
+
+  /// The main of `cpp-lint-action client`, which asks the daemon to lint the
+  /// files given by command line and prints the diagnostics of failed ones.
+  /// Returns 0 if all files passed.
+  auto run_client(int argc, char **argv) -> int;
+} // namespace lint::daemon
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/asio/local/stream_protocol.hpp>
+#include <nlohmann/json.hpp>
+
+#include "remote/protocol.h"
+
+/// Thin clients ask the daemon to lint files over a Unix domain socket. Each
+/// message is a JSON object in one line as the same as remote workers. The
+/// client sends a request, then the daemon sends a report for each file as
+/// soon as it's checked, and a summary once all files are checked.
+namespace lint::daemon {
+  using local = boost::asio::local::stream_protocol;
+
+  using remote::read_message;
+  using remote::write_message;
+
+  /// Lint the given files of worktree.
+  struct request {
+    std::vector<std::string> files; // Relative to the root of repository.
+  };
+
+  /// The result of applying a tool to a file. It's sent as {"report": ...}.
+  struct report {
+    std::string tool;
+    std::string file;
+    bool passed = false;
+    nlohmann::json result; // The per file result of tool.
+  };
+
+  /// The end of a request. It's sent as {"summary": ...}. Files aren't
+  /// checked when error isn't empty.
+  struct summary {
+    bool passed         = true;
+    std::size_t checked = 0;
+    std::string error;
+  };
+
+  // clang-format off
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(request, files)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(report, tool, file, passed, result)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(summary, passed, checked, error)
+  // clang-format on
+} // namespace lint::daemon
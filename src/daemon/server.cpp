@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "daemon/server.h"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "tools/scheduler.h"
+#include "utils/error.h"
+#include "utils/git_utils.h"
+
+namespace lint::daemon {
+  namespace {
+    // The file must be inside of repository.
+    auto is_inside(const std::filesystem::path &file) -> bool {
+      return !file.empty() && file.is_relative()
+          && std::none_of(file.begin(), file.end(), [](const auto &part) { return part == ".."; });
+    }
+
+    // Whether another daemon is serving on the given socket.
+    auto is_serving(boost::asio::io_context &io, const std::string &socket_path) -> bool {
+      auto socket = local::socket{io};
+      auto ec     = boost::system::error_code{};
+      socket.connect(local::endpoint{socket_path}, ec);
+      return !ec;
+    }
+  } // namespace
+
+  server::server(std::string socket_path,
+                 const std::vector<tool::tool_base_ptr> &tools,
+                 runtime_context &context,
+                 worker::pool &pool,
+                 tool::history &records,
+                 std::string history_file)
+    : socket_path_(std::move(socket_path))
+    , tools_(tools)
+    , context_(context)
+    , pool_(pool)
+    , records_(records)
+    , history_file_(std::move(history_file))
+    , acceptor_(io_) {
+    auto path = std::filesystem::path{socket_path_};
+    if (std::filesystem::exists(path)) {
+      throw_if(is_serving(io_, socket_path_),
+               fmt::format("another daemon is serving on {}", socket_path_));
+      std::filesystem::remove(path);
+    }
+    if (path.has_parent_path()) {
+      std::filesystem::create_directories(path.parent_path());
+    }
+
+    auto endpoint = local::endpoint{socket_path_};
+    acceptor_.open(endpoint.protocol());
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+  }
+
+  server::~server() {
+    stop();
+    sessions_.clear();
+    auto ec = std::error_code{};
+    std::filesystem::remove(socket_path_, ec);
+  }
+
+  void server::run() {
+    spdlog::trace("Enter server::run");
+    while (!stopping_) {
+      auto socket = std::make_shared<local::socket>(io_);
+      auto ec     = boost::system::error_code{};
+      acceptor_.accept(*socket, ec);
+      if (stopping_) {
+        break;
+      }
+      if (ec) {
+        spdlog::warn("failed to accept client: {}", ec.message());
+        continue;
+      }
+      spdlog::debug("client connected");
+
+      // Editors and hooks connect once per save, so finished sessions are
+      // reaped rather than kept until the daemon stops.
+      auto lock = std::lock_guard{mutex_};
+      reap();
+      auto &entry  = sessions_.emplace_back(std::move(socket));
+      entry.thread = std::jthread{[this, &entry] {
+        serve(entry.socket);
+        entry.done = true;
+      }};
+    }
+  }
+
+  void server::stop() {
+    if (stopping_.exchange(true)) {
+      return;
+    }
+
+    // Wake up the blocking accept by connecting to ourselves.
+    is_serving(io_, socket_path_);
+
+    auto ec   = boost::system::error_code{};
+    auto lock = std::lock_guard{mutex_};
+    for (const auto &entry: sessions_) {
+      entry.socket->shutdown(local::socket::shutdown_both, ec);
+    }
+  }
+
+  auto server::sessions() -> std::size_t {
+    auto lock = std::lock_guard{mutex_};
+    return sessions_.size();
+  }
+
+  void server::reap() {
+    // A session is done once it no longer touches the server, so joining it
+    // under the mutex doesn't block.
+    std::erase_if(sessions_, [](const session &entry) { return entry.done.load(); });
+  }
+
+  auto server::lint(const std::vector<std::string> &files, const report_callback &on_report)
+    -> summary {
+    spdlog::trace("Enter server::lint");
+    auto lock = std::lock_guard{lint_mutex_};
+
+    // Tools collect files from the changes of context, so the given files are
+    // made up as changes. Patches aren't needed since nothing is reported to
+    // Github.
+    context_.changed_files.clear();
+    context_.deltas.clear();
+    context_.patches.clear();
+    for (const auto &file: files) {
+      auto path = std::filesystem::path{file}.lexically_normal();
+      if (!is_inside(path)) {
+        return summary{.passed = false, .error = fmt::format("{} is outside of repository", file)};
+      }
+      auto delta   = git_diff_delta{};
+      delta.status = std::filesystem::exists(std::filesystem::path{context_.repo_path} / path)
+                     ? GIT_DELTA_MODIFIED
+                     : GIT_DELTA_DELETED;
+      if (context_.deltas.emplace(path.string(), delta).second) {
+        context_.changed_files.push_back(path.string());
+      }
+    }
+    // Only what tools cache about the requested files is dropped, so the
+    // rest stays warm for the next request.
+    for (const auto &tool: tools_) {
+      tool->reset_result();
+      tool->drop_caches(context_.changed_files);
+    }
+
+    auto result      = summary{};
+    auto mutex       = std::mutex{};
+    auto report_file = [&](const tool::task &job, const tool::file_outcome &outcome) {
+      auto message = report{.tool   = std::string{job.tool->name()},
+                            .file   = job.file,
+                            .passed = outcome.passed,
+                            .result = job.tool->dump_result(job.file)};
+
+      auto guard    = std::lock_guard{mutex};
+      result.passed = result.passed && outcome.passed;
+      ++result.checked;
+      on_report(message);
+    };
+    tool::run_tools(tools_, context_, pool_, records_, report_file);
+    records_.save(history_file_);
+    return result;
+  }
+
+  void server::serve(const std::shared_ptr<local::socket> &socket) {
+    try {
+      auto buffer = boost::asio::streambuf{};
+      while (!stopping_) {
+        auto files = read_message(*socket, buffer).get<request>();
+
+        auto result = summary{};
+        try {
+          result = lint(files.files, [&socket](const report &file) {
+            auto message      = nlohmann::json::object();
+            message["report"] = file;
+            write_message(*socket, message);
+          });
+        } catch (const boost::system::system_error &) {
+          throw;
+        } catch (const std::exception &err) {
+          result.passed = false;
+          result.error  = err.what();
+        }
+
+        auto message       = nlohmann::json::object();
+        message["summary"] = result;
+        write_message(*socket, message);
+      }
+    } catch (const boost::system::system_error &err) {
+      spdlog::debug("client disconnected: {}", err.what());
+    } catch (const std::exception &err) {
+      spdlog::warn("drop client since it sent a bad message: {}", err.what());
+    }
+  }
+
+  auto default_socket(git_repository &repo) -> std::string {
+    auto path = std::filesystem::path{git::repo::path(repo)} / "cpp-lint-action" / "daemon.sock";
+    return path.string();
+  }
+} // namespace lint::daemon
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <git2/repository.h>
+
+#include "context.h"
+#include "daemon/protocol.h"
+#include "tools/base_tool.h"
+#include "tools/history.h"
+#include "utils/worker_pool.h"
+
+namespace lint::daemon {
+  /// Called for each checked file. Calls are serialized.
+  using report_callback = std::function<void(const report &)>;
+
+  /// Serves lint requests on a Unix domain socket. The tools, repository,
+  /// history and worker pool are created once and kept warm between requests,
+  /// so a request only pays for checking its files. Each client is served by
+  /// a thread, but requests are run one by one since they share the results of
+  /// tools.
+  class server {
+  public:
+    /// Listen on the given socket. A stale socket file left by a dead daemon
+    /// is removed, but it throws if another daemon is still serving on it.
+    server(std::string socket_path,
+           const std::vector<tool::tool_base_ptr> &tools,
+           runtime_context &context,
+           worker::pool &pool,
+           tool::history &records,
+           std::string history_file);
+    ~server();
+
+    server(const server &)            = delete;
+    server &operator=(const server &) = delete;
+    server(server &&)                 = delete;
+    server &operator=(server &&)      = delete;
+
+    /// Accept clients until stop() is called.
+    void run();
+
+    /// Stop accepting and disconnect all clients. Thread safe.
+    void stop();
+
+    /// The number of sessions kept, finished ones are reaped once the next
+    /// client is accepted.
+    [[nodiscard]] auto sessions() -> std::size_t;
+
+    /// Lint the given files of worktree as if they're modified, files which
+    /// don't exist are treated as deleted.
+    auto lint(const std::vector<std::string> &files, const report_callback &on_report) -> summary;
+
+  private:
+    /// A client connected, which is served by a thread of its own.
+    struct session {
+      explicit session(std::shared_ptr<local::socket> connected)
+        : socket(std::move(connected)) {
+      }
+
+      std::shared_ptr<local::socket> socket;
+      std::atomic<bool> done = false;
+      std::jthread thread;
+    };
+
+    void serve(const std::shared_ptr<local::socket> &socket);
+
+    /// Join and remove the finished sessions. Requires mutex_.
+    void reap();
+
+    std::string socket_path_;
+    const std::vector<tool::tool_base_ptr> &tools_;
+    runtime_context &context_;
+    worker::pool &pool_;
+    tool::history &records_;
+    std::string history_file_;
+
+    boost::asio::io_context io_;
+    local::acceptor acceptor_;
+    std::atomic<bool> stopping_{false};
+
+    std::mutex lint_mutex_;
+    std::mutex mutex_;
+    std::list<session> sessions_;
+  };
+
+  /// The default socket of daemon, which is in the git directory.
+  auto default_socket(git_repository &repo) -> std::string;
+} // namespace lint::daemon
@@ -15,8 +15,12 @@
  */
 #pragma once
 
+#include <chrono>
 #include <cstdlib>
+#include <exception>
+#include <optional>
 #include <string>
+#include <unordered_set>
 #include <sys/types.h>
 
 #include <httplib.h>
@@ -24,6 +28,10 @@
 #include <spdlog/spdlog.h>
 
 #include "common.h"
+#include "marker.h"
+#include "page_cache.h"
+#include "rate_limit.h"
+#include "review_comment.h"
 #include "context.h"
 #include "utils/error.h"
 
@@ -32,7 +40,15 @@ namespace lint::github {
 
   class client {
   public:
+    client() {
+      // All requests of a run share one connection, so that DNS, TCP and TLS
+      // setup is only paid once.
+      http_.set_keep_alive(true);
+    }
+
     static void check_http_response(const httplib::Result &response) {
+      throw_unless(static_cast<bool>(response),
+                   fmt::format("http request error: {}", httplib::to_string(response.error())));
       auto code          = response->status / 100;
       const auto &reason = response->reason;
       throw_unless(code == 1 || code == 2,
@@ -47,7 +63,17 @@ namespace lint::github {
       spdlog::trace("port: {}", request.port());
     }
 
+    static auto string_of(const nlohmann::json &item, const char *key) -> std::string {
+      if (!item.contains(key) || !item[key].is_string()) {
+        return {};
+      }
+      return item[key].get<std::string>();
+    }
+
     static auto is_our_comment(const nlohmann::json &comment) -> bool {
+      if (!marker_of(string_of(comment, "body")).empty()) {
+        return true;
+      }
       if (!comment.contains("/user/login"_json_pointer)) {
         return true;
       }
@@ -56,45 +82,64 @@ namespace lint::github {
       return name == our_name;
     }
 
-    void get_issue_comment_id(const runtime_context &ctx) {
-      spdlog::debug("Start to get issue comment id for pull request: {}.", ctx.pr_number);
-      assert(ranges::contains(github_events_support_comments, ctx.event_name));
-
-      auto path    = fmt::format("/repos/{}/issues/{}/comments", ctx.repo_pair, ctx.pr_number);
-      auto headers = httplib::Headers{
+    /// Connect to Github ahead of the first report, e.g. while tools run. It
+    /// also learns the budget of rate limit, which isn't consumed by this.
+    /// Failures are left to the real requests.
+    void warm_up(const runtime_context &ctx) {
+      spdlog::trace("Enter client::warm_up");
+      const auto headers = httplib::Headers{
         {"Accept", "application/vnd.github+json"},
         {"Authorization", fmt::format("token {}", ctx.token)}
       };
-      spdlog::info("Http request path: {}", path);
-
-      auto response = client.Get(path, headers);
+      try {
+        send(request_priority::critical, "/rate_limit", [&] {
+          return http_.Get("/rate_limit", headers);
+        });
+      } catch (const std::exception &err) {
+        spdlog::debug("Warm up github client failed: {}", err.what());
+      }
+    }
 
-      check_http_response(response);
-      spdlog::trace("Get github response body: {}", response->body);
+    /// Find our comment in the pull request, which is the first one of ours.
+    /// Pages are fetched until it's found.
+    void get_issue_comment_id(const runtime_context &ctx) {
+      spdlog::debug("Start to get issue comment id for pull request: {}.", ctx.pr_number);
+      assert(ranges::contains(github_events_support_comments, ctx.event_name));
 
-      // data type check
-      auto comments = nlohmann::json::parse(response->body);
-      if (comments.is_null()) {
-        spdlog::info("The pull request number {} doesn't have any comments yet", ctx.pr_number);
-        return;
-      }
-      throw_unless(comments.is_array(), "issue comments are not an array");
-      if (comments.empty()) {
-        spdlog::info("The pull request number {} doesn't have any comments yet", ctx.pr_number);
-        return;
-      }
+      comment_id_   = -1;
+      comment_hash_ = {};
+      auto path =
+        fmt::format("/repos/{}/issues/{}/comments?per_page=100", ctx.repo_pair, ctx.pr_number);
+      visit_pages(ctx, request_priority::critical, path, [&](const nlohmann::json &comments) {
+        auto comment = ranges::find_if(comments, is_our_comment);
+        if (comment == comments.end()) {
+          return false;
+        }
+        (*comment)["id"].get_to(comment_id_);
+        comment_hash_ = marker_of(string_of(*comment, "body"));
+        return true;
+      });
 
-      auto comment = ranges::find_if(comments, is_our_comment);
-      if (comment == comments.end()) {
+      if (comment_id_ == -1) {
         spdlog::info("The cpp-lint doesn't comments on pull request number {} yet", ctx.pr_number);
         return;
       }
-
-      (*comment)["id"].get_to(comment_id_);
       spdlog::info("Successfully got comment id {} of pr {}", comment_id_, ctx.pr_number);
     }
 
-    void add_issue_comment(const runtime_context &ctx, const std::string &body) {
+    /// Same as get_issue_comment_id() but the comment which has been found or
+    /// added by this client is reused, e.g. when it's updated many times.
+    void find_issue_comment(const runtime_context &ctx) {
+      if (comment_id_ == -1) {
+        get_issue_comment_id(ctx);
+      }
+    }
+
+    /// Return false if the comment is skipped to save rate limit, which only
+    /// happens to optional requests.
+    auto add_issue_comment(const runtime_context &ctx,
+                           const std::string &body,
+                           request_priority priority = request_priority::critical) -> bool {
       spdlog::info("Start to add issue comment for pr {}", ctx.pr_number);
 
       const auto path = fmt::format("/repos/{}/issues/{}/comments", ctx.repo_pair, ctx.pr_number);
@@ -108,11 +153,15 @@ namespace lint::github {
       json_body["body"] = body;
       spdlog::trace("Http request body:\n{}", json_body.dump());
 
-      auto response = client.Post(path, headers, json_body.dump(), "text/plain");
-      spdlog::trace("Get github response body: {}", response->body);
-      check_http_response(response);
+      auto response = post(priority, path, headers, json_body.dump());
+      if (!response) {
+        spdlog::warn("Skip adding comment of pr {} to save rate limit", ctx.pr_number);
+        return false;
+      }
+      check_http_response(*response);
+      spdlog::trace("Get github response body: {}", (*response)->body);
 
-      auto comment = nlohmann::json::parse(response->body);
+      auto comment = nlohmann::json::parse((*response)->body);
       throw_unless(comment.is_object(), "comment isn't object");
 
       comment["id"].get_to(comment_id_);
@@ -120,9 +169,12 @@ namespace lint::github {
                    "added comment id is {}",
                    ctx.pr_number,
                    comment_id_);
+      return true;
     }
 
-    void update_issue_comment(const runtime_context &ctx, const std::string &body) {
+    auto update_issue_comment(const runtime_context &ctx,
+                              const std::string &body,
+                              request_priority priority = request_priority::critical) -> bool {
       throw_if(comment_id_ == -1, "the client doesn't have comment_id yet");
       throw_if(ctx.pr_number == -1, "the context doesn't have pr-number yet");
       spdlog::info("Start to update issue comment");
@@ -138,23 +190,74 @@ namespace lint::github {
       json_body["body"] = body;
       spdlog::trace("Http request body:\n{}", json_body.dump());
 
-      auto response = client.Post(path, headers, json_body.dump(), "text/plain");
-      spdlog::trace("Get github response body: {}", response->body);
-      check_http_response(response);
+      auto response = post(priority, path, headers, json_body.dump());
+      if (!response) {
+        spdlog::warn("Skip updating comment {} to save rate limit", comment_id_);
+        return false;
+      }
+      check_http_response(*response);
+      spdlog::trace("Get github response body: {}", (*response)->body);
       spdlog::info("Successfully updated comment {} of pr {}", comment_id_, ctx.pr_number);
+      return true;
     }
 
-    void add_or_update_issue_comment(const runtime_context &ctx, const std::string &body) {
-      if (comment_id_ == -1) {
-        add_issue_comment(ctx, body);
-      } else {
-        update_issue_comment(ctx, body);
+    /// The comment is marked by the hash of body, and it isn't written again
+    /// if the body is unchanged. Progress updates are sent as optional
+    /// requests, which are dropped rather than eating the reserve of rate limit.
+    void add_or_update_issue_comment(const runtime_context &ctx,
+                                     const std::string &body,
+                                     request_priority priority = request_priority::critical) {
+      auto hash = content_hash(body);
+      if (comment_id_ != -1 && hash == comment_hash_) {
+        spdlog::info("Skip updating comment {} of pr {} since it's unchanged",
+                     comment_id_,
+                     ctx.pr_number);
+        return;
+      }
+      auto written = comment_id_ == -1 ? add_issue_comment(ctx, with_marker(body), priority)
+                                       : update_issue_comment(ctx, with_marker(body), priority);
+      if (written) {
+        comment_hash_ = std::move(hash);
       }
     }
 
-    void post_pull_request_review(const runtime_context &ctx, const std::string &body) {
+    /// Post the comments as a review. Comments which have been posted by
+    /// previous runs on the same lines are skipped, since the marker of a
+    /// review comment hashes its path and position with the body.
+    void post_pull_request_review(const runtime_context &ctx, review_comments comments) {
       spdlog::info("Start to post pull request review for pr number {}", ctx.pr_number);
 
+      // Review comments are also summarized by the issue comment.
+      auto posted = std::unordered_set<std::string>{};
+      auto listed = visit_pages(
+        ctx,
+        request_priority::optional,
+        fmt::format("/repos/{}/pulls/{}/comments?per_page=100", ctx.repo_pair, ctx.pr_number),
+        [&](const nlohmann::json &items) {
+          for (const auto &item: items) {
+            auto hash = marker_of(string_of(item, "body"));
+            if (!hash.empty()) {
+              posted.insert(std::move(hash));
+            }
+          }
+          return false;
+        });
+      if (!listed) {
+        spdlog::warn("Skip pull request review for pr {} to save rate limit", ctx.pr_number);
+        return;
+      }
+      auto duplicates = std::erase_if(comments, [&](const review_comment &comment) {
+        return posted.contains(review_comment_hash(comment));
+      });
+      if (duplicates != 0) {
+        spdlog::info("Skip {} review comments which have been posted", duplicates);
+      }
+      if (comments.empty()) {
+        spdlog::info("No new review comment for pr {}", ctx.pr_number);
+        return;
+      }
+      auto body = make_review_str(comments);
+
       const auto path    = fmt::format("/repos/{}/pulls/{}/reviews", ctx.repo_pair, ctx.pr_number);
       const auto headers = httplib::Headers{
         {"Accept", "application/vnd.github.use_diff"},
@@ -163,9 +266,13 @@ namespace lint::github {
       spdlog::info("Http request path: {}", path);
       spdlog::trace("Http request body:\n{}", body);
 
-      auto response = client.Post(path, headers, body, "text/plain");
-      spdlog::trace("Get github response body: {}", response->body);
-      check_http_response(response);
+      auto response = post(request_priority::optional, path, headers, body);
+      if (!response) {
+        spdlog::warn("Skip pull request review for pr {} to save rate limit", ctx.pr_number);
+        return;
+      }
+      check_http_response(*response);
+      spdlog::trace("Get github response body: {}", (*response)->body);
 
       spdlog::info("Successfully post pull_request_review for pull-request {}", ctx.pr_number);
     }
@@ -211,7 +318,129 @@ namespace lint::github {
     // }
 
   private:
+    static constexpr auto status_not_modified = 304;
+
+    // Visit the pages of a list from the path until the visitor returns true.
+    // Returns false if a page is dropped to save rate limit.
+    auto visit_pages(const runtime_context &ctx,
+                     request_priority priority,
+                     std::string path,
+                     const auto &visit) -> bool {
+      if (!cache_loaded_ && !ctx.github_cache_file.empty()) {
+        cache_.load(ctx.github_cache_file);
+        cache_loaded_ = true;
+      }
+      auto completed = true;
+      while (!path.empty()) {
+        auto page = fetch_page(ctx, priority, path);
+        if (!page) {
+          completed = false;
+          break;
+        }
+        auto items = nlohmann::json::parse(page->body);
+        throw_unless(items.is_null() || items.is_array(), fmt::format("{} isn't an array", path));
+        if (visit(items)) {
+          break;
+        }
+        path = std::move(page->next);
+      }
+      if (!ctx.github_cache_file.empty()) {
+        cache_.save(ctx.github_cache_file);
+      }
+      return completed;
+    }
+
+    // Get a page of a list, which is revalidated by its ETag if it's cached.
+    auto fetch_page(const runtime_context &ctx, request_priority priority, const std::string &path)
+      -> std::optional<cached_page> {
+      auto headers = httplib::Headers{
+        {"Accept", "application/vnd.github+json"},
+        {"Authorization", fmt::format("token {}", ctx.token)}
+      };
+      const auto *cached = cache_.find(path);
+      if (cached != nullptr) {
+        headers.emplace("If-None-Match", cached->etag);
+      }
+      spdlog::info("Http request path: {}", path);
+
+      auto response = send(priority, path, [&] { return http_.Get(path, headers); });
+      if (!response) {
+        return std::nullopt;
+      }
+      if (cached != nullptr && *response && (*response)->status == status_not_modified) {
+        spdlog::debug("Github page {} isn't modified", path);
+        return *cached;
+      }
+      check_http_response(*response);
+      spdlog::trace("Get github response body: {}", (*response)->body);
+
+      auto page = cached_page{.etag = (*response)->get_header_value("ETag"),
+                              .next = parse_next_link((*response)->get_header_value("Link")),
+                              .body = (*response)->body};
+      if (!page.etag.empty()) {
+        cache_.store(path, page);
+      }
+      return page;
+    }
+
+    // Send the request when rate limit allows, and retry it once Github
+    // refuses it or fails. Returns nullopt if an optional request is dropped.
+    auto send(request_priority priority,
+              std::string_view path,
+              const auto &request,
+              bool idempotent = true) -> std::optional<httplib::Result> {
+      for (auto retries = std::size_t{0};; ++retries) {
+        if (!scheduler_.acquire(priority)) {
+          return std::nullopt;
+        }
+        auto start    = std::chrono::steady_clock::now();
+        auto response = request();
+        auto status   = response ? response->status : 0;
+        auto elapsed  = std::chrono::steady_clock::now() - start;
+        spdlog::debug("Github request {} got status {} in {}ms",
+                      path,
+                      status,
+                      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+        auto headers  = rate_limit_headers{};
+        if (response) {
+          headers = parse_rate_limit(response->get_header_value("x-ratelimit-remaining"),
+                                     response->get_header_value("x-ratelimit-reset"),
+                                     response->get_header_value("retry-after"));
+        }
+        auto delay = scheduler_.settle(status, headers, retries, idempotent);
+        if (!delay) {
+          return response;
+        }
+        spdlog::warn("Github request got status {}, retry after {}ms", status, delay->count());
+        scheduler_.wait(*delay);
+      }
+    }
+
+    // A POST may have been handled though it fails, e.g. a comment is added
+    // twice if it's retried, so it's only retried when refused by rate limit.
+    auto post(request_priority priority,
+              const std::string &path,
+              const httplib::Headers &headers,
+              const std::string &body) -> std::optional<httplib::Result> {
+      return send(
+        priority,
+        path,
+        [&] { return http_.Post(path, headers, body, "text/plain"); },
+        false);
+    }
+
     std::uint32_t comment_id_ = -1;
-    httplib::Client client{github_api};
+    std::string comment_hash_;
+    httplib::Client http_{github_api};
+    request_scheduler scheduler_;
+    page_cache cache_;
+    bool cache_loaded_ = false;
   };
+
+  /// The client shared by all reporters of the process, so that they reuse
+  /// its connection.
+  inline auto shared_client() -> client & {
+    static auto instance = client{};
+    return instance;
+  }
 } // namespace lint::github
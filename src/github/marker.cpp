@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "marker.h"
+
+#include <fmt/format.h>
+
+#include "utils/hash.h"
+
+namespace lint::github {
+  auto content_hash(std::string_view content) -> std::string {
+    return fmt::format("{:016x}", stable_hash(content));
+  }
+
+  auto with_marker(std::string_view body) -> std::string {
+    return with_marker(body, content_hash(body));
+  }
+
+  auto with_marker(std::string_view body, std::string_view hash) -> std::string {
+    return fmt::format("{}\n\n{}{}{}", body, marker_prefix, hash, marker_suffix);
+  }
+
+  auto marker_of(std::string_view body) -> std::string {
+    auto begin = body.rfind(marker_prefix);
+    if (begin == std::string_view::npos) {
+      return {};
+    }
+    auto hash = body.substr(begin + marker_prefix.size());
+    auto end  = hash.find(marker_suffix);
+    if (end == std::string_view::npos) {
+      return {};
+    }
+    return std::string{hash.substr(0, end)};
+  }
+} // namespace lint::github
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace lint::github {
+  /// The hidden marker which ends the bodies written by us. It carries a hash
+  /// of the body, so that an unchanged body isn't written again.
+  constexpr auto marker_prefix = std::string_view{"<!-- cpp-lint-action:"};
+  constexpr auto marker_suffix = std::string_view{" -->"};
+
+  /// A hash of the content in hex which is stable across runs.
+  auto content_hash(std::string_view content) -> std::string;
+
+  /// Append the marker of the body to it.
+  auto with_marker(std::string_view body) -> std::string;
+
+  /// Append a marker carrying the given hash to the body.
+  auto with_marker(std::string_view body, std::string_view hash) -> std::string;
+
+  /// Get the hash in the marker of the body, empty if it isn't written by us.
+  auto marker_of(std::string_view body) -> std::string;
+} // namespace lint::github
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "page_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "common.h"
+
+namespace lint::github {
+  namespace {
+    // Enough for the comments of a few busy pull requests.
+    constexpr auto max_pages = std::size_t{64};
+  } // namespace
+
+  void page_cache::load(const std::string &path) {
+    spdlog::trace("Enter page_cache::load");
+    auto file = std::ifstream{path};
+    if (!file.is_open()) {
+      spdlog::debug("No github cache found at {}", path);
+      return;
+    }
+    auto json = nlohmann::json::parse(file, nullptr, false);
+    if (!json.is_object()) {
+      spdlog::debug("Ignore broken github cache {}", path);
+      return;
+    }
+    try {
+      pages_ = json.get<std::unordered_map<std::string, cached_page>>();
+    } catch (const nlohmann::json::exception &err) {
+      spdlog::debug("Ignore broken github cache {}: {}", path, err.what());
+      pages_.clear();
+    }
+    for (const auto &[_, page]: pages_) {
+      clock_ = std::max(clock_, page.used);
+    }
+    spdlog::debug("Loaded {} github pages from {}", pages_.size(), path);
+  }
+
+  void page_cache::save(const std::string &path) const {
+    spdlog::trace("Enter page_cache::save");
+    auto recent = std::vector<std::pair<std::string, cached_page>>{pages_.begin(), pages_.end()};
+    std::ranges::sort(recent, std::greater{}, [](const auto &entry) { return entry.second.used; });
+    recent.resize(std::min(recent.size(), max_pages));
+    auto json = nlohmann::json::object();
+    for (auto &[page_path, page]: recent) {
+      json[page_path] = std::move(page);
+    }
+
+    auto target = std::filesystem::path{path};
+    auto error  = std::error_code{};
+    if (target.has_parent_path()) {
+      std::filesystem::create_directories(target.parent_path(), error);
+    }
+    // Shards and parallel runs sharing a cache may save at the same time, so
+    // each process writes its own temporary file and rename is atomic.
+    auto temp  = target;
+    temp      += fmt::format(".{}.tmp", ::getpid());
+    {
+      auto file = std::ofstream{temp, std::ios::trunc};
+      if (!file.is_open()) {
+        spdlog::warn("Failed to open github cache {} to write", temp.string());
+        return;
+      }
+      file << json.dump();
+    }
+    std::filesystem::rename(temp, target, error);
+    if (error) {
+      spdlog::warn("Failed to save github cache {}: {}", path, error.message());
+      std::filesystem::remove(temp, error);
+    }
+  }
+
+  auto page_cache::find(const std::string &path) -> const cached_page * {
+    auto iter = pages_.find(path);
+    if (iter == pages_.end()) {
+      return nullptr;
+    }
+    iter->second.used = ++clock_;
+    return &iter->second;
+  }
+
+  void page_cache::store(const std::string &path, cached_page page) {
+    page.used    = ++clock_;
+    pages_[path] = std::move(page);
+  }
+
+  auto parse_next_link(std::string_view link) -> std::string {
+    // <https://api.github.com/...?page=2>; rel="next", <...>; rel="last"
+    while (!link.empty()) {
+      auto comma = link.find(',');
+      auto part  = link.substr(0, comma);
+      link       = comma == std::string_view::npos ? std::string_view{} : link.substr(comma + 1);
+
+      auto begin = part.find('<');
+      auto end   = part.find('>', begin);
+      if (begin == std::string_view::npos || end == std::string_view::npos) {
+        continue;
+      }
+      if (part.find(R"(rel="next")", end) == std::string_view::npos) {
+        continue;
+      }
+      auto url = part.substr(begin + 1, end - begin - 1);
+      if (url.starts_with(github_api)) {
+        url.remove_prefix(std::string_view{github_api}.size());
+      }
+      return std::string{url};
+    }
+    return {};
+  }
+} // namespace lint::github
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+namespace lint::github {
+  /// A page of a Github list, kept to be revalidated by its ETag.
+  struct cached_page {
+    std::string etag;
+
+    /// The path of next page, empty if it's the last one.
+    std::string next;
+
+    std::string body;
+
+    /// Pages used earlier are evicted first.
+    std::uint64_t used = 0;
+  };
+
+  /// The pages fetched by previous runs. Github answers a request whose
+  /// If-None-Match matches the page with 304, which isn't counted against the
+  /// rate limit, and the cached page is used instead.
+  class page_cache {
+  public:
+    /// Load pages from the given file. A missing or broken file results in an
+    /// empty cache since it's only an optimization.
+    void load(const std::string &path);
+
+    /// Atomically save the most recently used pages. Failures are only logged.
+    void save(const std::string &path) const;
+
+    /// Find the page of the path and mark it used, null if it isn't cached.
+    auto find(const std::string &path) -> const cached_page *;
+
+    /// Cache the page of the path.
+    void store(const std::string &path, cached_page page);
+
+    [[nodiscard]] auto size() const -> std::size_t {
+      return pages_.size();
+    }
+
+  private:
+    std::unordered_map<std::string, cached_page> pages_;
+    std::uint64_t clock_ = 0;
+  };
+
+  /// Get the path of rel="next" in the Link header of a Github response,
+  /// relative to the Github API. Empty if there is no next page.
+  auto parse_next_link(std::string_view link) -> std::string;
+
+  // clang-format off
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(cached_page, etag, next, body, used)
+  // clang-format on
+} // namespace lint::github
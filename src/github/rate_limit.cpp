@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "rate_limit.h"
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace lint::github {
+  namespace {
+    constexpr auto status_forbidden         = 403;
+    constexpr auto status_too_many_requests = 429;
+    constexpr auto status_server_error      = 500;
+
+    auto to_size(std::string_view value) -> std::size_t {
+      while (value.starts_with(' ')) {
+        value.remove_prefix(1);
+      }
+      auto size = std::size_t{0};
+      std::from_chars(value.data(), value.data() + value.size(), size);
+      return size;
+    }
+  } // namespace
+
+  auto parse_rate_limit(std::string_view remaining,
+                        std::string_view reset,
+                        std::string_view retry_after) -> rate_limit_headers {
+    auto headers      = rate_limit_headers{};
+    headers.remaining = to_size(remaining);
+    headers.reset     = to_size(reset);
+    headers.retry     = to_size(retry_after);
+    return headers;
+  }
+
+  auto is_rate_limited(int status, const rate_limit_headers &headers) -> bool {
+    if (status == status_too_many_requests) {
+      return true;
+    }
+    // Github also refuses with 403 when the limit is exceeded.
+    return status == status_forbidden
+        && (headers.retry != 0 || (headers.reset != 0 && headers.remaining == 0));
+  }
+
+  request_scheduler::request_scheduler()
+    : request_scheduler(option_t{}) {
+  }
+
+  request_scheduler::request_scheduler(option_t option)
+    : option_(std::move(option))
+    , tokens_(static_cast<double>(option_.burst))
+    , refilled_(option_.now()) {
+  }
+
+  auto request_scheduler::acquire(request_priority priority) -> bool {
+    auto lock = std::unique_lock{mutex_};
+    while (true) {
+      auto now = option_.now();
+      refill(now);
+
+      // Critical requests may use up the budget, but optional ones leave the
+      // reserve to them.
+      auto until     = std::max(now, blocked_until_);
+      auto reset     = clock::time_point{std::chrono::seconds{reset_}};
+      auto reserved  = priority == request_priority::optional ? option_.reserve : 0;
+      auto exhausted = reset_ != 0 && reset > now && remaining_ <= reserved;
+      if (exhausted) {
+        until = std::max(until, reset);
+      }
+      auto time = std::chrono::ceil<duration>(until - now);
+      if (time > option_.max_wait && priority == request_priority::optional) {
+        spdlog::warn("Drop an optional Github request since rate limit resets in {}s",
+                     std::chrono::ceil<std::chrono::seconds>(time).count());
+        return false;
+      }
+      // A critical request is sent anyway rather than waiting too long, and
+      // it's up to Github.
+      if (time > duration::zero() && time <= option_.max_wait) {
+        spdlog::debug("Wait {}ms for Github rate limit", time.count());
+        lock.unlock();
+        wait(time);
+        lock.lock();
+        continue;
+      }
+
+      if (tokens_ < 1) {
+        auto refill_time = std::chrono::ceil<duration>((1 - tokens_) * option_.refill_interval);
+        lock.unlock();
+        wait(refill_time);
+        lock.lock();
+        continue;
+      }
+      tokens_ -= 1;
+      if (remaining_ > 0) {
+        --remaining_;
+      }
+      return true;
+    }
+  }
+
+  auto request_scheduler::settle(int status,
+                                 const rate_limit_headers &headers,
+                                 std::size_t retries,
+                                 bool idempotent) -> std::optional<duration> {
+    auto lock = std::lock_guard{mutex_};
+    auto now  = option_.now();
+    if (headers.reset != 0) {
+      remaining_ = headers.remaining;
+      reset_     = static_cast<std::int64_t>(headers.reset);
+    }
+
+    auto delay = std::optional<duration>{};
+    if (is_rate_limited(status, headers)) {
+      if (headers.retry != 0) {
+        delay = std::chrono::seconds{headers.retry};
+      } else if (headers.reset != 0 && headers.remaining == 0) {
+        // One more second since reset is truncated to seconds.
+        auto reset = clock::time_point{std::chrono::seconds{reset_}} + std::chrono::seconds{1};
+        delay      = std::max(duration::zero(), std::chrono::ceil<duration>(reset - now));
+      } else {
+        delay = backoff(retries);
+      }
+      // Other requests shouldn't be sent either.
+      blocked_until_ = std::max(blocked_until_, now + *delay);
+    } else if (idempotent && (status == 0 || status >= status_server_error)) {
+      delay = backoff(retries);
+    }
+
+    if (!delay || retries >= option_.max_retries || *delay > option_.max_wait) {
+      return std::nullopt;
+    }
+    return delay;
+  }
+
+  void request_scheduler::wait(duration time) {
+    option_.sleep(time);
+  }
+
+  void request_scheduler::refill(clock::time_point now) {
+    if (now <= refilled_) {
+      return;
+    }
+    auto elapsed = std::chrono::duration<double>(now - refilled_) / option_.refill_interval;
+    tokens_      = std::min(static_cast<double>(option_.burst), tokens_ + elapsed);
+    refilled_    = now;
+  }
+
+  auto request_scheduler::backoff(std::size_t retries) -> duration {
+    // Full jitter spreads the retries of many jobs.
+    constexpr auto max_shift = std::size_t{20};
+    auto ceiling = option_.backoff_base * (std::int64_t{1} << std::min(retries, max_shift));
+    ceiling      = std::min(ceiling, option_.backoff_cap);
+    auto jitter  = std::uniform_int_distribution<duration::rep>{0, ceiling.count()};
+    return duration{jitter(random_)};
+  }
+} // namespace lint::github
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <thread>
+
+#include "common.h"
+
+namespace lint::github {
+  /// Critical requests are needed to report the result, while optional ones
+  /// only make it nicer and give way to critical ones when budget is low.
+  enum class request_priority : std::uint8_t {
+    critical,
+    optional,
+  };
+
+  /// Parse the rate limit headers of a Github response. Absent or invalid
+  /// headers are parsed as 0, and retry-after is only supported in seconds,
+  /// which is what Github sends.
+  auto parse_rate_limit(std::string_view remaining,
+                        std::string_view reset,
+                        std::string_view retry_after) -> rate_limit_headers;
+
+  /// Whether the response is refused by the primary or secondary rate limit
+  /// of Github, rather than by a lack of permission.
+  auto is_rate_limited(int status, const rate_limit_headers &headers) -> bool;
+
+  /// Paces the requests sent to Github. A token bucket keeps bursts below the
+  /// secondary rate limit, and the budget reported by responses holds back
+  /// optional requests before it's exhausted. Refused or failed requests are
+  /// retried after the time given by Github or an exponential backoff with
+  /// full jitter. It's safe to be shared by threads.
+  class request_scheduler {
+  public:
+    using clock    = std::chrono::system_clock;
+    using duration = std::chrono::milliseconds;
+
+    struct option_t {
+      /// The requests could be sent at once, and how fast they're refilled.
+      std::size_t burst        = 10;
+      duration refill_interval = std::chrono::seconds{1};
+
+      /// Optional requests wait for reset once the remaining budget is no
+      /// more than this.
+      std::size_t reserve = 10;
+
+      /// Retries of a request, and the bounds of backoff.
+      std::size_t max_retries = 5;
+      duration backoff_base   = std::chrono::seconds{1};
+      duration backoff_cap    = std::chrono::seconds{60};
+
+      /// Longer waits aren't worth it, and the request is given up instead.
+      duration max_wait = std::chrono::minutes{5};
+
+      /// Replaceable in tests.
+      std::function<clock::time_point()> now = [] { return clock::now(); };
+      std::function<void(duration)> sleep    = [](duration time) {
+        std::this_thread::sleep_for(time);
+      };
+    };
+
+    request_scheduler();
+
+    explicit request_scheduler(option_t option);
+
+    /// Wait until a request of the priority could be sent. Returns false if
+    /// an optional request should be dropped since budget won't be enough
+    /// within max_wait.
+    auto acquire(request_priority priority) -> bool;
+
+    /// Record the response of a request which has been retried `retries`
+    /// times, status 0 means no response. Returns how long to wait before
+    /// retrying, or nullopt if the response should be taken as it is. A
+    /// request which isn't idempotent is only retried when it's refused by
+    /// rate limit, since it may have been handled otherwise.
+    auto settle(int status,
+                const rate_limit_headers &headers,
+                std::size_t retries,
+                bool idempotent = true) -> std::optional<duration>;
+
+    /// Block the caller for the duration.
+    void wait(duration time);
+
+  private:
+    // Refill the bucket by the elapsed time. The caller holds mutex_.
+    void refill(clock::time_point now);
+
+    auto backoff(std::size_t retries) -> duration;
+
+    option_t option_;
+
+    std::mutex mutex_;
+    double tokens_ = 0;
+    clock::time_point refilled_;
+
+    /// The budget of primary rate limit reported by the last response, reset
+    /// is 0 if it's unknown.
+    std::size_t remaining_ = 0;
+    std::int64_t reset_    = 0;
+
+    /// Nothing is sent before this since Github asked us to wait.
+    clock::time_point blocked_until_;
+
+    std::mt19937_64 random_{std::random_device{}()};
+  };
+} // namespace lint::github
@@ -15,17 +15,30 @@
  */
 #include "review_comment.h"
 
+#include <fmt/format.h>
+
+#include "marker.h"
+
 namespace lint::github {
   using namespace std::string_view_literals;
 
   constexpr auto review_event_comment         = "COMMENT"sv;
   constexpr auto review_event_request_changes = "REQUEST_CHANGES"sv;
 
+  auto review_comment_hash(const review_comment &comment) -> std::string {
+    return content_hash(fmt::format("{}\n{}\n{}", comment.path, comment.position, comment.body));
+  }
+
   auto make_review_str(const review_comments &comments) -> std::string {
+    // Comments are marked so that they aren't posted again by later runs.
+    auto marked = comments;
+    for (auto &comment: marked) {
+      comment.body = with_marker(comment.body, review_comment_hash(comment));
+    }
     auto res        = nlohmann::json{};
-    res["body"]     = "cpp-lint-action suggestion";
+    res["body"]     = with_marker("cpp-lint-action suggestion");
     res["event"]    = review_event_comment; // TODO:DEBUG
-    res["comments"] = comments;
+    res["comments"] = marked;
     return res.dump();
   }
 
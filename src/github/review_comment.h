@@ -46,5 +46,9 @@ namespace lint::github {
 
   using review_comments = std::vector<review_comment>;
 
+  /// The hash in the marker of a review comment. It covers where the comment
+  /// is, so that the same suggestion on another line is still posted.
+  auto review_comment_hash(const review_comment &comment) -> std::string;
+
   auto make_review_str(const review_comments &comments) -> std::string;
 } // namespace lint::github
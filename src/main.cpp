@@ -14,8 +14,13 @@
  * limitations under the License.
  */
 #include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <git2/oid.h>
@@ -25,16 +30,31 @@
 
 #include "configs/version.h"
 #include "context.h"
+#include "daemon/client.h"
+#include "daemon/server.h"
+#include "github/client.h"
 #include "github/common.h"
 #include "program_options.h"
+#include "remote/coordinator.h"
+#include "remote/worker.h"
+#include "staged.h"
 #include "tools/base_creator.h"
 #include "tools/base_reporter.h"
 #include "tools/base_tool.h"
+#include "tools/bundle.h"
 #include "tools/clang_format/clang_format.h"
 #include "tools/clang_tidy/clang_tidy.h"
+#include "tools/history.h"
+#include "tools/progress.h"
+#include "tools/scheduler.h"
 #include "utils/error.h"
 #include "utils/git_utils.h"
 #include "utils/common.h"
+#include "utils/env_manager.h"
+#include "utils/resource.h"
+#include "utils/worker_pool.h"
+#include "watch/inotify.h"
+#include "watch/session.h"
 
 using namespace lint; // NOLINT
 using namespace std::string_literals;
@@ -88,6 +108,184 @@ namespace {
     }
   }
 
+  void print_resource_info(const resource::cgroup_limits &limits, const worker::pool &pool) {
+    spdlog::info("cgroup cpu quota: {}, memory limit: {} bytes, {} workers with {} concurrent jobs",
+                 limits.cpu_quota == 0 ? "unlimited" : fmt::format("{:.2f}", limits.cpu_quota),
+                 limits.memory_max == 0 ? "unlimited" : std::to_string(limits.memory_max),
+                 pool.workers(),
+                 pool.concurrency());
+    if (pool.remote_workers() != 0) {
+      spdlog::info("{} workers wait for remote slots", pool.remote_workers());
+    }
+    spdlog::info("memory budget of concurrent jobs: {}",
+                 pool.memory_budget() == 0 ? "unlimited"
+                                           : fmt::format("{} bytes", pool.memory_budget()));
+  }
+
+  // The worker pool and the controller which adjusts its concurrency.
+  struct workers {
+    std::unique_ptr<worker::pool> pool;
+    std::unique_ptr<worker::controller> controller;
+  };
+
+  auto create_workers(const runtime_context &context) -> workers {
+    // Create worker pool by the resources we are allowed to use. When user
+    // doesn't specify jobs, the concurrency is adjusted during the run. Tasks
+    // are admitted by their peak memory learned from previous runs.
+    auto limits = resource::read_cgroup_limits();
+    auto cpus   = resource::available_cpus(limits);
+    auto local  = context.jobs != 0 ? context.jobs : cpus;
+
+    // Tasks sent to remote workers only wait for them, so they have a worker
+    // for each remote slot besides the local ones. The concurrency and memory
+    // budget only admit tasks running locally.
+    auto remote = context.remote ? context.remote->slots() : 0;
+    auto ret    = workers{.pool = std::make_unique<worker::pool>(local, remote)};
+    if (context.jobs == 0) {
+      ret.controller = std::make_unique<worker::controller>(*ret.pool, cpus);
+    }
+    auto budget = context.memory_budget != 0
+                  ? context.memory_budget << 20U
+                  : resource::default_memory_budget(limits, resource::available_memory());
+    ret.pool->set_memory_budget(budget);
+    print_resource_info(limits, *ret.pool);
+    return ret;
+  }
+
+  auto history_file_of(const runtime_context &context) -> std::string {
+    return context.history_file.empty() ? tool::default_history_file(*context.repo)
+                                        : context.history_file;
+  }
+
+  auto github_cache_file_of(const runtime_context &context) -> std::string {
+    if (!context.github_cache_file.empty()) {
+      return context.github_cache_file;
+    }
+    auto path = std::filesystem::path{git::repo::path(*context.repo)} / "cpp-lint-action";
+    return (path / "github-cache").string();
+  }
+
+  auto run_locally(const std::vector<tool::tool_base_ptr> &tools,
+                   const runtime_context &context,
+                   const tool::task_callback &on_finished = {})
+    -> std::vector<tool::reporter_base_ptr> {
+    spdlog::trace("Enter run_locally");
+    auto [pool, controller] = create_workers(context);
+
+    auto history_file = history_file_of(context);
+    auto history      = tool::history{};
+    history.load(history_file);
+
+    // Run tools within the given context and get reporters.
+    auto reporters = tool::run_tools(tools, context, *pool, history, on_finished);
+    controller.reset();
+    history.save(history_file);
+    return reporters;
+  }
+
+  // Lint every file of the source commit. Files are enumerated from its tree
+  // while being linted. Returns the reporters and the number of files.
+  auto scan_repository(const std::vector<tool::tool_base_ptr> &tools,
+                       const runtime_context &context,
+                       const tool::task_callback &on_finished = {})
+    -> std::tuple<std::vector<tool::reporter_base_ptr>, std::size_t> {
+    spdlog::trace("Enter scan_repository");
+    auto [pool, controller] = create_workers(context);
+
+    auto history_file = history_file_of(context);
+    auto history      = tool::history{};
+    history.load(history_file);
+
+    auto tree  = git::commit::tree(*context.source_commit);
+    auto total = std::size_t{0};
+    auto files = [&](const std::function<void(const std::string &)> &visit) {
+      git::tree::walk_files(*tree, [&](const std::string &file) {
+        ++total;
+        visit(file);
+      });
+    };
+    auto reporters = tool::scan_tools(tools, context, *pool, history, files, on_finished);
+    controller.reset();
+    history.save(history_file);
+    return {std::move(reporters), total};
+  }
+
+  // Keep tools, repository, history and workers warm and lint files for
+  // clients until being killed.
+  void serve_daemon(const std::vector<tool::tool_base_ptr> &tools, runtime_context &context) {
+    spdlog::trace("Enter serve_daemon");
+    auto [pool, controller] = create_workers(context);
+
+    auto history_file = history_file_of(context);
+    auto history      = tool::history{};
+    history.load(history_file);
+
+    auto socket = context.daemon_socket.empty() ? daemon::default_socket(*context.repo)
+                                                : context.daemon_socket;
+    auto server = daemon::server{socket, tools, context, *pool, history, history_file};
+    spdlog::info("daemon serves on {}", socket);
+    server.run();
+  }
+
+  // Lint the changes against target first, then lint files again once they're
+  // saved until being killed.
+  void watch_worktree(const std::vector<tool::tool_base_ptr> &tools,
+                      const runtime_context &context) {
+    spdlog::trace("Enter watch_worktree");
+    auto [pool, controller] = create_workers(context);
+
+    // Start watching before the first lint so that no saves are missed.
+    auto skip = [&context](const std::string &path) {
+      return path == ".git" || git::repo::is_ignored(*context.repo, path);
+    };
+    auto watcher = watch::inotify_watcher{context.repo_path, skip};
+    auto checks  = watch::session{tools, context, *pool, std::cout};
+    checks.changed(context.changed_files);
+
+    spdlog::info("watching {} for changes", context.repo_path);
+    while (true) {
+      checks.changed(watcher.wait(context.watch_debounce));
+    }
+  }
+
+  auto merge_bundles(const std::vector<tool::tool_base_ptr> &tools, const runtime_context &context)
+    -> std::vector<tool::reporter_base_ptr> {
+    spdlog::trace("Enter merge_bundles");
+    throw_if(context.bundles.empty(), "merge subcommand requires at least one bundle");
+
+    // Collect files by ourselves to know how many files should be checked.
+    auto expected = std::vector<std::size_t>{};
+    for (const auto &tool: tools) {
+      expected.push_back(tool->collect_files(context).size());
+    }
+    auto summaries = std::vector<tool::bundle_summary>{};
+    for (const auto &bundle: context.bundles) {
+      summaries.push_back(tool::read_bundle(bundle, context, tools));
+    }
+    tool::check_shards(summaries);
+
+    // Files cancelled by fail fast are neither passed nor failed.
+    auto reporters = std::vector<tool::reporter_base_ptr>{};
+    for (std::size_t i = 0; i < tools.size(); ++i) {
+      auto name      = std::string{tools[i]->name()};
+      auto cancelled = std::size_t{0};
+      for (const auto &summary: summaries) {
+        auto iter  = summary.cancelled.find(name);
+        cancelled += iter == summary.cancelled.end() ? 0 : iter->second;
+      }
+      auto reporter                = tools[i]->get_reporter();
+      auto [_, passed, failed, __] = reporter->get_brief_result();
+      throw_unless(passed + failed + cancelled == expected[i],
+                   fmt::format("{} has results of {} files and {} cancelled but {} are expected",
+                               reporter->tool_name(),
+                               passed + failed,
+                               cancelled,
+                               expected[i]));
+      reporters.push_back(std::move(reporter));
+    }
+    return reporters;
+  }
+
   void print_brief_result(const std::vector<tool::reporter_base_ptr> &reporters,
                           std::size_t total_files) {
     for (const auto &reporter: reporters) {
@@ -105,10 +303,76 @@ namespace {
     }
   }
 
+  // Merge the fixes of all tools and apply them once, so that fixes of a
+  // header reported by many units don't fight with each other.
+  void fix_files(const std::vector<tool::tool_base_ptr> &tools, const runtime_context &context) {
+    spdlog::trace("Enter fix_files");
+    auto fixes = tool::replacements{};
+    for (const auto &tool: tools) {
+      auto suggested = tool->fixes(context);
+      fixes.insert(fixes.end(), suggested.begin(), suggested.end());
+    }
+    tool::write_fixes(context, tool::merge_fixes(std::move(fixes)));
+  }
+
+  // Lint the staged contents of changed files. Results are printed since there's
+  // no Github to report to.
+  auto lint_staged(const std::vector<tool::tool_base_ptr> &tools, runtime_context &context)
+    -> bool {
+    spdlog::trace("Enter lint_staged");
+    if (context.changed_files.empty()) {
+      spdlog::info("Nothing is staged");
+      return true;
+    }
+
+    auto reporters = std::vector<tool::reporter_base_ptr>{};
+    {
+      auto staged = staged_tree{context};
+      reporters   = run_locally(tools, context);
+    }
+    print_brief_result(reporters, context.changed_files.size());
 
+    for (const auto &tool: tools) {
+      for (const auto &file: context.changed_files) {
+        auto result = tool->dump_result(file);
+        if (result.is_object() && !result.value("passed", true)) {
+          std::cout << result.value("tool_stdout", std::string{});
+        }
+      }
+    }
+    std::cout << std::flush;
+    return all_passed(reporters);
+  }
 } // namespace
 
 auto main(int argc, char **argv) -> int {
+  // `cpp-lint-action worker [options]` runs checks for remote coordinators.
+  if (argc > 1 && std::string_view{argv[1]} == "worker") {
+    argv[1] = argv[0];
+    return remote::run_worker(argc - 1, argv + 1);
+  }
+
+  // `cpp-lint-action client [options] <file>...` asks the daemon to lint files.
+  if (argc > 1 && std::string_view{argv[1]} == "client") {
+    argv[1] = argv[0];
+    return daemon::run_client(argc - 1, argv + 1);
+  }
+
+  // `cpp-lint-action merge [options] <bundle>...` merges the bundles written by
+  // shards instead of running tools. `cpp-lint-action daemon [options]` serves
+  // clients with the same options as running tools, `cpp-lint-action watch
+  // [options]` lints files of worktree once they're saved, and `cpp-lint-action
+  // pre-commit [options]` lints the changes staged for commit.
+  auto merging       = argc > 1 && std::string_view{argv[1]} == "merge";
+  auto serving       = argc > 1 && std::string_view{argv[1]} == "daemon";
+  auto watching      = argc > 1 && std::string_view{argv[1]} == "watch";
+  auto precommitting = argc > 1 && std::string_view{argv[1]} == "pre-commit";
+  if (merging || serving || watching || precommitting) {
+    argv[1] = argv[0];
+    --argc;
+    ++argv;
+  }
+
   auto tool_creators = collect_tool_creators();
 
   // Handle program options.
@@ -129,26 +393,133 @@ auto main(int argc, char **argv) -> int {
   print_tools_info(tools);
 
   // Create runtime context.
-  auto context = runtime_context{};
+  auto context   = runtime_context{};
+  context.staged = precommitting;
 
   // Fill runtime context by program options.
   program_options::fill_context(user_options, context);
 
-  // Fill runtime context by environment variables.
-  auto env = github::read_env();
-  github::fill_context(env, context);
+  // Fill runtime context by environment variables. Git runs hooks in the root
+  // of worktree, and there's no Github for them.
+  if (context.staged) {
+    context.repo_path = std::filesystem::current_path().string();
+  } else {
+    auto env = github::read_env();
+    github::fill_context(env, context);
+  }
 
   // Fill runtime context by git repositofy informations.
   git::setup();
-  fill_git_info(context);
+  if (context.staged) {
+    fill_staged_info(context);
+  } else {
+    fill_git_info(context);
+  }
 
   print_context(context);
-  check_repo_is_on_source(context);
 
-  // Run tools within the given context and get reporters.
-  auto reporters = tool::run_tools(tools, context);
-  print_brief_result(reporters, context.changed_files.size());
+  // Only merge subcommand takes bundles, a stray positional argument is most
+  // likely a mistyped option.
+  throw_if(!merging && !context.bundles.empty(),
+           fmt::format("unexpected argument {}, bundles are only taken by merge subcommand",
+                       context.bundles.front()));
 
+  // Daemon and watch lint the worktree which moves away from the source commit.
+  if (!serving && !watching && !context.staged) {
+    check_repo_is_on_source(context);
+  }
+
+  // Workers lint their own checkouts, which don't have the staged contents.
+  if (!merging && !context.staged && !context.remote_workers.empty()) {
+    context.remote =
+      std::make_shared<remote::coordinator>(context.remote_workers, env::get(remote::secret_env));
+  }
+
+  if (serving) {
+    serve_daemon(tools, context);
+    git::shutdown();
+    return 0;
+  }
+  if (watching) {
+    watch_worktree(tools, context);
+    git::shutdown();
+    return 0;
+  }
+  if (precommitting) {
+    auto passed = lint_staged(tools, context);
+    git::shutdown();
+    return passed ? 0 : 1;
+  }
+
+  context.github_cache_file = github_cache_file_of(context);
+
+  // Connect to Github while tools run. Only the merge job reports when tasks
+  // are sharded.
+  auto commenting = context.enable_comment_on_issue || context.enable_pull_request_review;
+  auto warming    = std::shared_future<void>{};
+  if (commenting && (merging || context.shard_count <= 1)) {
+    warming = std::async(std::launch::async, [&context] {
+                github::shared_client().warm_up(context);
+              }).share();
+  }
+
+  // Report the results checked so far while tools run, so that they show up
+  // before the slowest files finish. The step summary is only shown once the
+  // step ends, so it's written by the final report alone.
+  auto progress = std::unique_ptr<tool::progress_reporter>{};
+  if (warming.valid() && !merging && context.progress_interval.count() != 0) {
+    auto comment = tool::progress_sink{};
+    auto review  = tool::progress_sink{};
+    if (context.enable_comment_on_issue) {
+      comment = [&context, warming](const auto &reporters, const std::string &status) {
+        warming.wait();
+        comment_on_github_issue(context, reporters, status);
+      };
+    }
+    if (context.enable_pull_request_review) {
+      review = [&context, warming](const auto &reporters, const std::string & /*status*/) {
+        warming.wait();
+        comment_on_github_pull_request_review(context, reporters);
+      };
+    }
+    auto interval = std::chrono::milliseconds{context.progress_interval};
+    progress      = std::make_unique<tool::progress_reporter>(
+      tools,
+      tool::progress_reporter::option_t{.comment_interval = interval, .review_interval = interval},
+      std::move(comment),
+      std::move(review));
+  }
+  auto on_finished = progress ? progress->callback() : tool::task_callback{};
+
+  // Run tools within the given context, scan all files or merge the results of
+  // shards, and get reporters.
+  auto reporters   = std::vector<tool::reporter_base_ptr>{};
+  auto total_files = context.changed_files.size();
+  if (merging) {
+    reporters = merge_bundles(tools, context);
+  } else if (context.scan_all) {
+    std::tie(reporters, total_files) = scan_repository(tools, context, on_finished);
+  } else {
+    reporters = run_locally(tools, context, on_finished);
+  }
+  if (progress) {
+    progress->stop();
+  }
+  print_brief_result(reporters, total_files);
+
+  // Only the merge job talks to Github when tasks are sharded.
+  if (!merging && context.shard_count > 1) {
+    tool::write_bundle(context.shard_bundle, context, tools);
+    git::shutdown();
+    return 0;
+  }
+
+  if (context.fix_mode != fix_mode_t::none) {
+    fix_files(tools, context);
+  }
+  if (warming.valid()) {
+    warming.get();
+  }
   if (context.enable_action_output) {
     write_to_github_action_output(context, reporters);
   }
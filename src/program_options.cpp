@@ -19,9 +19,12 @@
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+#include <magic_enum/magic_enum.hpp>
 #include <spdlog/spdlog.h>
 
 #include "context.h"
+#include "utils/common.h"
 #include "utils/error.h"
 
 namespace lint::program_options {
@@ -34,6 +37,23 @@ namespace lint::program_options {
     constexpr auto enable_comment_on_issue    = "enable-comment-on-issue";
     constexpr auto enable_pull_request_review = "enable-pull-request-review";
     constexpr auto enable_action_output       = "enable-action-output";
+    constexpr auto enable_fail_fast           = "enable-fail-fast";
+    constexpr auto scan_all                   = "scan-all";
+    constexpr auto jobs                       = "jobs";
+    constexpr auto memory_budget              = "memory-budget";
+    constexpr auto history_file               = "history-file";
+    constexpr auto github_cache_file          = "github-cache-file";
+    constexpr auto progress_interval          = "progress-interval";
+    constexpr auto shard_index                = "shard-index";
+    constexpr auto shard_count                = "shard-count";
+    constexpr auto shard_strategy             = "shard-strategy";
+    constexpr auto shard_bundle               = "shard-bundle";
+    constexpr auto bundle                     = "bundle";
+    constexpr auto remote_workers             = "remote-workers";
+    constexpr auto daemon_socket              = "daemon-socket";
+    constexpr auto watch_debounce             = "watch-debounce";
+    constexpr auto fix                        = "fix";
+    constexpr auto fix_patch                  = "fix-patch";
   } // namespace
 
   using std::string;
@@ -44,6 +64,21 @@ namespace lint::program_options {
 
     const auto *level    = value<string>()->value_name("level")->default_value("info");
     const auto *revision = value<string>()->value_name("revision");
+    const auto *number   = value<std::size_t>()->value_name("number")->default_value(0);
+    const auto *mebibyte = value<std::uint64_t>()->value_name("MiB")->default_value(0);
+    const auto *path     = value<string>()->value_name("path")->default_value("");
+    const auto *output   = value<string>()->value_name("path")->default_value("");
+    const auto *index    = value<std::size_t>()->value_name("index")->default_value(0);
+    const auto *count    = value<std::size_t>()->value_name("count")->default_value(1);
+    const auto *strategy = value<string>()->value_name("strategy")->default_value("hash");
+    const auto *files    = value<std::vector<string>>()->value_name("file")->composing();
+    const auto *workers  = value<string>()->value_name("host:port,...")->default_value("");
+    const auto *socket   = value<string>()->value_name("path")->default_value("");
+    const auto *quiet    = value<std::size_t>()->value_name("ms")->default_value(200);
+    const auto *mode     = value<string>()->value_name("mode")->default_value("none");
+    const auto *patch    = value<string>()->value_name("path")->default_value("");
+    const auto *cache    = value<string>()->value_name("path")->default_value("");
+    const auto *every    = value<std::size_t>()->value_name("seconds")->default_value(30);
 
     auto boolean = [](bool def) {
       return value<bool>()->value_name("bool")->default_value(def);
@@ -61,6 +96,49 @@ namespace lint::program_options {
       (enable_pull_request_review,  boolean(false),  "Whether enable Github pull-request reivew comment")
       (enable_step_summary,         boolean(true),   "Whether enable write step summary to Github action")
       (enable_action_output,        boolean(true),   "Whether enable write output to Github action")
+      (enable_fail_fast,            boolean(false),  "Whether run the cheapest checks and previously failed files "
+                                                     "first, and cancel all running checks of all tools once one "
+                                                     "fails")
+      (scan_all,                    boolean(false),  "Whether lint every file of the source revision instead of the "
+                                                     "changes against target. Files are linted while being "
+                                                     "enumerated and no diff is built")
+      (jobs,                        number,          "Set the number of concurrent lint processes. "
+                                                     "0 means it's decided by the cgroup limits and "
+                                                     "adjusted by the system pressure during the run")
+      (memory_budget,               mebibyte,        "Set the total memory in MiB that concurrent lint processes "
+                                                     "are allowed to use. 0 means 90% of the cgroup memory limit "
+                                                     "or the available memory")
+      (history_file,                path,            "Set the file which records the peak memory and wall time of "
+                                                     "previous runs. Empty means a file in the git directory of "
+                                                     "repository")
+      (github_cache_file,           cache,           "Set the file which caches the pages fetched from Github, so "
+                                                     "that unchanged ones are revalidated for free. Empty means a "
+                                                     "file in the git directory of repository")
+      (progress_interval,           every,           "Set the minimal seconds between two updates of the running "
+                                                     "comment and review while tools run. 0 means only the final "
+                                                     "result is reported")
+      (shard_index,                 index,           "Set the index of current shard, starts from 0")
+      (shard_count,                 count,           "Set the number of shards. Each shard only runs its part of "
+                                                     "tasks and writes results into shard bundle instead of Github")
+      (shard_strategy,              strategy,        "Set how to split tasks between shards. Supports: [hash, cost]. "
+                                                     "cost requires all shards to use the same history file")
+      (shard_bundle,                output,          "Set the bundle file which results of current shard are "
+                                                     "written into. Empty means cpp-lint-action-shard-<index>.json")
+      (bundle,                      files,           "Set the shard bundles to be merged by merge subcommand. "
+                                                     "Positional arguments are also treated as bundles")
+      (remote_workers,              workers,         "Set the comma separated workers which clang-tidy checks are "
+                                                     "farmed out to. Workers are started by worker subcommand on "
+                                                     "the same checkout. Empty means checking locally")
+      (daemon_socket,               socket,          "Set the Unix domain socket which daemon subcommand serves "
+                                                     "lint requests on. Empty means a file in the git directory "
+                                                     "of repository")
+      (watch_debounce,              quiet,           "Set the milliseconds without any change that watch subcommand "
+                                                     "waits for before linting a burst of changed files")
+      (fix,                         mode,            "Set what to do with the fixes of tools, which are merged and "
+                                                     "applied once all files are checked. Supports: [none, patch, "
+                                                     "commit]. commit applies them to worktree and commits onto HEAD")
+      (fix_patch,                   patch,           "Set the patch file which fixes are written into. Empty means "
+                                                     "cpp-lint-action-fixes.patch")
     ;
     // clang-format on
 
@@ -69,8 +147,15 @@ namespace lint::program_options {
 
   auto parse(int argc, char **argv, const options_description &desc) -> variables_map {
     spdlog::trace("Enter parse");
+    auto positional = boost::program_options::positional_options_description{};
+    positional.add(bundle, -1);
+
     auto variables = variables_map{};
-    store(parse_command_line(argc, argv, desc), variables);
+    store(boost::program_options::command_line_parser(argc, argv)
+            .options(desc)
+            .positional(positional)
+            .run(),
+          variables);
     notify(variables);
     return variables;
   }
@@ -111,9 +196,21 @@ namespace lint::program_options {
   void fill_context(const variables_map &variables, runtime_context &ctx) {
     spdlog::debug("Start to check program options and fill context by it");
 
-    auto must_specify_option = {target};
-    must_specify("using CppLintAction", variables, must_specify_option);
-    ctx.target = variables[target].as<std::string>();
+    if (variables.contains(scan_all)) {
+      ctx.scan_all = variables[scan_all].as<bool>();
+    }
+
+    // Staged changes are always linted against HEAD, and scanning doesn't
+    // compare with anything.
+    if (ctx.staged) {
+      must_not_specify("linting staged changes", variables, {target});
+    } else if (ctx.scan_all) {
+      must_not_specify("scanning all files", variables, {target});
+    } else {
+      auto must_specify_option = {target};
+      must_specify("using CppLintAction", variables, must_specify_option);
+      ctx.target = variables[target].as<std::string>();
+    }
 
     if (variables.contains(enable_step_summary)) {
       ctx.enable_step_summary = variables[enable_step_summary].as<bool>();
@@ -127,6 +224,90 @@ namespace lint::program_options {
     if (variables.contains(enable_action_output)) {
       ctx.enable_action_output = variables[enable_action_output].as<bool>();
     }
+    if (variables.contains(enable_fail_fast)) {
+      ctx.enable_fail_fast = variables[enable_fail_fast].as<bool>();
+    }
+    if (variables.contains(jobs)) {
+      ctx.jobs = variables[jobs].as<std::size_t>();
+    }
+    if (variables.contains(memory_budget)) {
+      ctx.memory_budget = variables[memory_budget].as<std::uint64_t>();
+    }
+    if (variables.contains(history_file)) {
+      ctx.history_file = variables[history_file].as<string>();
+    }
+    if (variables.contains(github_cache_file)) {
+      ctx.github_cache_file = variables[github_cache_file].as<string>();
+    }
+    if (variables.contains(progress_interval)) {
+      ctx.progress_interval = std::chrono::seconds{variables[progress_interval].as<std::size_t>()};
+    }
+    if (variables.contains(shard_index)) {
+      ctx.shard_index = variables[shard_index].as<std::size_t>();
+    }
+    if (variables.contains(shard_count)) {
+      ctx.shard_count = variables[shard_count].as<std::size_t>();
+    }
+    throw_unless(ctx.shard_count >= 1 && ctx.shard_index < ctx.shard_count,
+                 fmt::format("invalid shard {}/{}", ctx.shard_index, ctx.shard_count));
+    if (variables.contains(shard_strategy)) {
+      auto name     = variables[shard_strategy].as<string>();
+      auto strategy = magic_enum::enum_cast<shard_strategy_t>(name);
+      throw_unless(strategy.has_value(), fmt::format("unsupported shard strategy: {}", name));
+      ctx.shard_strategy = *strategy;
+    }
+    if (variables.contains(shard_bundle)) {
+      ctx.shard_bundle = variables[shard_bundle].as<string>();
+    }
+    if (ctx.shard_bundle.empty()) {
+      ctx.shard_bundle = fmt::format("cpp-lint-action-shard-{}.json", ctx.shard_index);
+    }
+    if (variables.contains(bundle)) {
+      // Blank arguments may be passed by shell scripts, skip them.
+      for (const auto &file: variables[bundle].as<std::vector<string>>()) {
+        if (!trim(file).empty()) {
+          ctx.bundles.push_back(file);
+        }
+      }
+    }
+    if (variables.contains(remote_workers)) {
+      auto endpoints = variables[remote_workers].as<string>();
+      for (auto part: ranges::views::split(endpoints, ',')) {
+        auto worker = ranges::to<std::string>(part);
+        if (!trim(worker).empty()) {
+          ctx.remote_workers.emplace_back(trim(worker));
+        }
+      }
+    }
+    if (variables.contains(daemon_socket)) {
+      ctx.daemon_socket = variables[daemon_socket].as<string>();
+    }
+    if (variables.contains(watch_debounce)) {
+      ctx.watch_debounce = std::chrono::milliseconds{variables[watch_debounce].as<std::size_t>()};
+    }
+    if (variables.contains(fix)) {
+      auto name = variables[fix].as<string>();
+      auto mode = magic_enum::enum_cast<fix_mode_t>(name);
+      throw_unless(mode.has_value(), fmt::format("unsupported fix mode: {}", name));
+      ctx.fix_mode = *mode;
+    }
+    if (variables.contains(fix_patch)) {
+      ctx.fix_patch = variables[fix_patch].as<string>();
+    }
+    if (ctx.fix_patch.empty()) {
+      ctx.fix_patch = "cpp-lint-action-fixes.patch";
+    }
+
+    // Review comments are positioned in the diff, which isn't built by
+    // scanning. Cost sharding needs all tasks before running.
+    throw_if(ctx.scan_all && ctx.enable_pull_request_review,
+             "pull request review can't be enabled when scanning all files");
+    throw_if(ctx.scan_all && ctx.shard_count > 1 && ctx.shard_strategy != shard_strategy_t::hash,
+             "only hash strategy could shard tasks when scanning all files");
+
+    // Fixes are exported by local tools, and staged contents aren't in worktree.
+    throw_if(ctx.fix_mode != fix_mode_t::none && (ctx.staged || !ctx.remote_workers.empty()),
+             "fixes can't be applied when linting staged changes or on remote workers");
   }
 
 } // namespace lint::program_options
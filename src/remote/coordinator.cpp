@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "remote/coordinator.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include <boost/asio/connect.hpp>
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+#include "utils/worker_pool.h"
+
+namespace lint::remote {
+  namespace {
+    auto read_file(const std::string &path) -> std::optional<std::string> {
+      auto file = std::ifstream{path, std::ios::binary};
+      if (!file.is_open()) {
+        return std::nullopt;
+      }
+      return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+  } // namespace
+
+  coordinator::coordinator(const std::vector<std::string> &endpoints, std::string secret)
+    : endpoints_(endpoints)
+    , secret_(std::move(secret)) {
+    spdlog::trace("Enter coordinator::coordinator");
+    for (std::size_t i = 0; i < endpoints_.size(); ++i) {
+      try {
+        connect(i, endpoints_[i]);
+      } catch (const std::exception &err) {
+        spdlog::warn("skip worker {} since it's unreachable or refuses us: {}",
+                     endpoints_[i],
+                     err.what());
+      }
+    }
+    for (auto &conn: connections_) {
+      threads_.emplace_back([this, &conn = *conn](const std::stop_token &token) {
+        serve(conn, token);
+      });
+    }
+  }
+
+  coordinator::~coordinator() {
+    for (auto &thread: threads_) {
+      thread.request_stop();
+    }
+    {
+      auto lock = std::lock_guard{mutex_};
+      for (auto &conn: connections_) {
+        auto ec = boost::system::error_code{};
+        conn->socket.shutdown(tcp::socket::shutdown_both, ec);
+      }
+    }
+    threads_.clear();
+  }
+
+  void coordinator::connect(std::size_t worker, const std::string &endpoint) {
+    auto [host, port] = parse_endpoint(endpoint);
+    auto resolver     = tcp::resolver{io_};
+    auto addresses    = resolver.resolve(host, std::to_string(port));
+
+    // The worker tells us how many slots it has in the greeting of first
+    // connection, then we make a connection for each of the others.
+    auto slots = std::size_t{1};
+    for (std::size_t i = 0; i < slots; ++i) {
+      auto conn    = std::make_unique<connection>(io_);
+      conn->worker = worker;
+      boost::asio::connect(conn->socket, addresses);
+      conn->socket.set_option(boost::asio::socket_base::keep_alive(true));
+
+      // The worker closes the connection if the secret is wrong.
+      write_message(conn->socket, auth{.secret = secret_});
+      auto greeting = read_message(conn->socket, conn->buffer).get<hello>();
+      throw_unless(greeting.version == protocol_version,
+                   fmt::format("unsupported protocol version {}", greeting.version));
+      if (i == 0) {
+        slots = std::max<std::size_t>(greeting.slots, 1);
+      }
+      connections_.push_back(std::move(conn));
+    }
+    spdlog::info("connected to worker {} with {} slots", endpoint, slots);
+  }
+
+  auto coordinator::slots() const -> std::size_t {
+    return connections_.size();
+  }
+
+  auto coordinator::take(connection &conn) -> pending_ptr {
+    if (!conn.queue.empty()) {
+      auto job = std::move(conn.queue.front());
+      conn.queue.pop_front();
+      return job;
+    }
+
+    // Steal from the back of the longest queue, where the jobs are the latest
+    // ones and the owner will reach them last.
+    auto *victim = static_cast<connection *>(nullptr);
+    auto stolen  = std::deque<pending_ptr>::iterator{};
+    for (auto &other: connections_) {
+      if (victim != nullptr && other->queue.size() <= victim->queue.size()) {
+        continue;
+      }
+      auto iter = std::find_if(other->queue.rbegin(), other->queue.rend(), [&](const auto &job) {
+        return !ranges::contains(job->tried, conn.worker);
+      });
+      if (iter != other->queue.rend()) {
+        victim = other.get();
+        stolen = std::next(iter).base();
+      }
+    }
+    if (victim == nullptr) {
+      return nullptr;
+    }
+    auto job = std::move(*stolen);
+    victim->queue.erase(stolen);
+    spdlog::debug("worker {} steals job {}", endpoints_[conn.worker], job->request.id);
+    return job;
+  }
+
+  void coordinator::dispatch(const pending_ptr &job) {
+    auto *target = static_cast<connection *>(nullptr);
+    auto load    = [](const connection &conn) {
+      return conn.queue.size() + (conn.busy ? 1 : 0);
+    };
+    for (auto &conn: connections_) {
+      if (!conn->alive || ranges::contains(job->tried, conn->worker)) {
+        continue;
+      }
+      if (target == nullptr || load(*conn) < load(*target)) {
+        target = conn.get();
+      }
+    }
+
+    if (target == nullptr) {
+      job->promise.set_value(std::nullopt);
+      return;
+    }
+    target->queue.push_back(job);
+    cv_.notify_all();
+  }
+
+  void coordinator::cancel(const pending_ptr &job) {
+    for (auto &conn: connections_) {
+      auto iter = ranges::find(conn->queue, job);
+      if (iter != conn->queue.end()) {
+        conn->queue.erase(iter);
+        job->promise.set_value(
+          shell::result{.exit_code = -1, .std_err = "cancelled", .killed = true});
+        return;
+      }
+    }
+  }
+
+  void coordinator::serve(connection &conn, const std::stop_token &token) {
+    const auto &endpoint = endpoints_[conn.worker];
+    while (true) {
+      auto job  = pending_ptr{};
+      auto lock = std::unique_lock{mutex_};
+      cv_.wait(lock, token, [&] {
+        job = take(conn);
+        return job != nullptr;
+      });
+      if (job == nullptr) {
+        return;
+      }
+      conn.busy = true;
+      lock.unlock();
+
+      // Only this thread uses the socket, so it's safe to talk without lock.
+      auto answer = std::optional<reply>{};
+      try {
+        write_message(conn.socket, job->request);
+        answer = read_message(conn.socket, conn.buffer).get<reply>();
+      } catch (const std::exception &err) {
+        spdlog::warn("lost connection to worker {}: {}", endpoint, err.what());
+      }
+
+      lock.lock();
+      conn.busy = false;
+      if (!answer) {
+        // Retry the job and move the queued ones to others.
+        conn.alive = false;
+        job->tried.push_back(conn.worker);
+        dispatch(job);
+        auto queued = std::move(conn.queue);
+        for (const auto &other: queued) {
+          dispatch(other);
+        }
+        return;
+      }
+      if (!answer->error.empty()) {
+        spdlog::warn("worker {} refused job {}: {}", endpoint, job->request.id, answer->error);
+        job->tried.push_back(conn.worker);
+        dispatch(job);
+        continue;
+      }
+
+      auto result     = shell::result{.exit_code = answer->exit_code};
+      result.std_out  = std::move(answer->std_out);
+      result.std_err  = std::move(answer->std_err);
+      result.peak_rss = answer->peak_rss;
+      job->promise.set_value(std::move(result));
+    }
+  }
+
+  auto coordinator::execute(const shell::options &opts,
+                            const std::string &root,
+                            const std::string &file,
+                            const std::stop_token &token) -> std::optional<shell::result> {
+    spdlog::trace("Enter coordinator::execute");
+    // Workers lint their own checkouts, the content is sent to make sure that
+    // they are the same as ours.
+    auto content = read_file(fmt::format("{}/{}", root, file));
+    if (!content) {
+      return std::nullopt;
+    }
+
+    auto job             = std::make_shared<pending>();
+    job->request.args    = opts;
+    job->request.file    = file;
+    job->request.content = std::move(*content);
+    auto future          = job->promise.get_future();
+    {
+      auto lock       = std::lock_guard{mutex_};
+      job->request.id = next_id_++;
+      dispatch(job);
+    }
+
+    auto drop = [&] {
+      auto lock = std::lock_guard{mutex_};
+      cancel(job);
+    };
+    auto on_stop = std::stop_callback{token, drop};
+    return future.get();
+  }
+
+  auto execute(const runtime_context &context,
+               std::string_view command,
+               const shell::options &opts,
+               const std::string &root,
+               const std::string &file,
+               const std::stop_token &token) -> shell::result {
+    if (context.remote) {
+      if (auto res = context.remote->execute(opts, root, file, token); res) {
+        return std::move(*res);
+      }
+      spdlog::debug("no worker is able to check {}, check it locally", file);
+    }
+
+    // A task waiting for workers doesn't take a local slot until it's here.
+    auto admission = worker::local_admission{};
+    return shell::execute(command, opts, root, token);
+  }
+} // namespace lint::remote
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "context.h"
+#include "remote/protocol.h"
+#include "utils/shell.h"
+
+namespace lint::remote {
+  /// Farms commands out to workers. Each slot of workers has a connection with
+  /// its own queue of jobs. A job is queued to the least loaded connection and
+  /// an idle connection steals the last job of the most loaded one. Jobs of a
+  /// dead connection are moved to others. A worker runs a job at most once, and
+  /// a job which no worker is able to run is left to run locally.
+  class coordinator {
+  public:
+    /// Connect to all slots of the given workers and authenticate with the
+    /// secret. Unreachable workers and those refusing the secret are skipped.
+    explicit coordinator(const std::vector<std::string> &endpoints, std::string secret = {});
+    ~coordinator();
+
+    coordinator(const coordinator &)            = delete;
+    coordinator &operator=(const coordinator &) = delete;
+    coordinator(coordinator &&)                 = delete;
+    coordinator &operator=(coordinator &&)      = delete;
+
+    /// The number of connected slots.
+    [[nodiscard]] auto slots() const -> std::size_t;
+
+    /// Run clang-tidy of workers on the given file of root and wait for the
+    /// result. Returns std::nullopt if no worker is able to run it. Once a stop
+    /// is requested, the job is dropped if it hasn't been sent.
+    auto execute(const shell::options &opts,
+                 const std::string &root,
+                 const std::string &file,
+                 const std::stop_token &token = {}) -> std::optional<shell::result>;
+
+  private:
+    struct pending {
+      job request;
+      std::promise<std::optional<shell::result>> promise;
+      std::vector<std::size_t> tried; // The workers which failed to run it.
+    };
+
+    using pending_ptr = std::shared_ptr<pending>;
+
+    struct connection {
+      explicit connection(boost::asio::io_context &io)
+        : socket(io) {
+      }
+
+      std::size_t worker = 0;
+      tcp::socket socket;
+      boost::asio::streambuf buffer;
+      std::deque<pending_ptr> queue;
+      bool alive = true;
+      bool busy  = false;
+    };
+
+    void connect(std::size_t worker, const std::string &endpoint);
+
+    void serve(connection &conn, const std::stop_token &token);
+
+    /// Take the next job of the connection, steal one if its queue is empty.
+    /// Must be called with mutex_ held.
+    auto take(connection &conn) -> pending_ptr;
+
+    /// Queue the job to the least loaded connection whose worker hasn't tried
+    /// it, or resolve it with std::nullopt if there isn't any. Must be called
+    /// with mutex_ held.
+    void dispatch(const pending_ptr &job);
+
+    /// Drop the job if it's still queued. Must be called with mutex_ held.
+    void cancel(const pending_ptr &job);
+
+    boost::asio::io_context io_;
+    std::vector<std::string> endpoints_;
+    std::string secret_;
+    std::vector<std::unique_ptr<connection>> connections_;
+    mutable std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::uint64_t next_id_ = 0;
+    std::vector<std::jthread> threads_;
+  };
+
+  /// Run clang-tidy by the workers of context if there are, otherwise or if
+  /// no worker is able to run it, run the command locally.
+  auto execute(const runtime_context &context,
+               std::string_view command,
+               const shell::options &opts,
+               const std::string &root,
+               const std::string &file,
+               const std::stop_token &token = {}) -> shell::result;
+} // namespace lint::remote
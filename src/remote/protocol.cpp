@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "remote/protocol.h"
+
+#include <charconv>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+
+namespace lint::remote {
+  auto parse_endpoint(std::string_view endpoint) -> std::pair<std::string, std::uint16_t> {
+    auto colon = endpoint.rfind(':');
+    throw_if(colon == std::string_view::npos || colon == 0,
+             fmt::format("invalid endpoint: {}, expects host:port", endpoint));
+    auto port_str   = endpoint.substr(colon + 1);
+    auto port       = std::uint16_t{0};
+    auto [ptr, ec] = std::from_chars(port_str.data(), port_str.data() + port_str.size(), port);
+    throw_if(ec != std::errc{} || ptr != port_str.data() + port_str.size(),
+             fmt::format("invalid port of endpoint: {}", endpoint));
+    return {std::string{endpoint.substr(0, colon)}, port};
+  }
+} // namespace lint::remote
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+/// Workers run clang-tidy checks for a coordinator over TCP. Each message is a
+/// JSON object in one line. The coordinator authenticates with the shared
+/// secret once connected, and the worker greets with a hello if the secret is
+/// right, otherwise it closes the connection. Then the coordinator sends jobs
+/// one by one and the worker answers each with a reply.
+namespace lint::remote {
+  using tcp = boost::asio::ip::tcp;
+
+  constexpr auto protocol_version = 2;
+
+  // Both of coordinator and worker read the shared secret from it.
+  constexpr auto secret_env = "CPP_LINT_ACTION_REMOTE_SECRET";
+
+  /// The first message sent by coordinator.
+  struct auth {
+    int version = protocol_version;
+    std::string secret;
+  };
+
+  /// The first message sent by worker.
+  struct hello {
+    int version       = protocol_version;
+    std::size_t slots = 1; // How many jobs the worker is able to run concurrently.
+  };
+
+  /// Run the worker's clang-tidy on the given file of its checkout.
+  struct job {
+    std::uint64_t id = 0;
+    std::vector<std::string> args;
+    std::string file;    // Relative to the root of checkout.
+    std::string content; // The content of file seen by coordinator.
+  };
+
+  /// The result of a job. The command isn't run when error isn't empty.
+  struct reply {
+    std::uint64_t id = 0;
+    std::string error;
+    int exit_code = 0;
+    std::string std_out;
+    std::string std_err;
+    std::uint64_t peak_rss = 0;
+  };
+
+  // clang-format off
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(auth, version, secret)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(hello, version, slots)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(job, id, args, file, content)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(reply, id, error, exit_code, std_out, std_err, peak_rss)
+  // clang-format on
+
+  /// Split "host:port" into host and port.
+  auto parse_endpoint(std::string_view endpoint) -> std::pair<std::string, std::uint16_t>;
+
+  /// Write one message. Throws boost::system::system_error on failure. Any
+  /// stream socket could be used, e.g. the Unix domain socket of daemon.
+  template <class Socket>
+  void write_message(Socket &socket, const nlohmann::json &message) {
+    // Control characters are always escaped by dump(), so a message never
+    // contains a newline.
+    auto line = message.dump();
+    line.push_back('\n');
+    boost::asio::write(socket, boost::asio::buffer(line));
+  }
+
+  /// Read one message. The buffer keeps the bytes after the message, so the
+  /// same buffer must be used for the same socket. Throws
+  /// boost::system::system_error once the peer is gone.
+  template <class Socket>
+  auto read_message(Socket &socket, boost::asio::streambuf &buffer) -> nlohmann::json {
+    boost::asio::read_until(socket, buffer, '\n');
+    auto stream = std::istream{&buffer};
+    auto line   = std::string{};
+    std::getline(stream, line);
+    spdlog::trace("Received message of {} bytes", line.size());
+    return nlohmann::json::parse(line);
+  }
+} // namespace lint::remote
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "remote/worker.h"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+
+#include <boost/asio/connect.hpp>
+#include <boost/program_options.hpp>
+#include <spdlog/spdlog.h>
+
+#include "utils/common.h"
+#include "utils/env_manager.h"
+#include "utils/error.h"
+#include "utils/resource.h"
+#include "utils/shell.h"
+#include "utils/std.h"
+
+namespace lint::remote {
+  namespace {
+    // The flags which coordinators check files with. Others, such as --load
+    // and --export-fixes, are refused since they load plugins or write files.
+    // A flag ending with '=' takes a value.
+    constexpr auto allowed_flags = std::array<std::string_view, 6>{
+      "-checks=",
+      "--allow-no-checks",
+      "--config=",
+      "--enable-check-profile",
+      "--header-filter=",
+      "--line-filter=",
+    };
+
+    // The flags whose value is a path, which must be inside of checkout.
+    constexpr auto path_flags = std::array<std::string_view, 2>{"-p=", "--config-file="};
+
+    // The file must be inside of checkout.
+    auto is_inside(const std::filesystem::path &file) -> bool {
+      return file.is_relative()
+          && std::none_of(file.begin(), file.end(), [](const auto &part) { return part == ".."; });
+    }
+
+    // The only positional argument must be the file of job.
+    auto is_allowed(const job &request) -> bool {
+      auto files = 0;
+      for (const auto &arg: request.args) {
+        if (!arg.starts_with('-')) {
+          ++files;
+          if (arg != request.file) {
+            return false;
+          }
+          continue;
+        }
+
+        auto path_flag =
+          ranges::find_if(path_flags, [&](auto flag) { return arg.starts_with(flag); });
+        if (path_flag != path_flags.end()) {
+          if (!is_inside(arg.substr(path_flag->size()))) {
+            return false;
+          }
+          continue;
+        }
+
+        auto allowed = ranges::any_of(allowed_flags, [&](auto flag) {
+          return flag.ends_with('=') ? arg.starts_with(flag) : arg == flag;
+        });
+        if (!allowed) {
+          return false;
+        }
+      }
+      return files == 1;
+    }
+
+    // Compare in constant time, so that the secret couldn't be guessed by timing.
+    auto is_same_secret(std::string_view lhs, std::string_view rhs) -> bool {
+      auto diff = lhs.size() ^ rhs.size();
+      for (std::size_t i = 0; i < lhs.size(); ++i) {
+        auto other = i < rhs.size() ? rhs[i] : '\0';
+        diff |= static_cast<unsigned char>(lhs[i]) ^ static_cast<unsigned char>(other);
+      }
+      return diff == 0;
+    }
+
+    auto read_file(const std::filesystem::path &path) -> std::optional<std::string> {
+      auto file = std::ifstream{path, std::ios::binary};
+      if (!file.is_open()) {
+        return std::nullopt;
+      }
+      return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+  } // namespace
+
+  auto run_job(const worker_options &options, const job &request) -> reply {
+    spdlog::trace("Enter run_job");
+    auto answer = reply{.id = request.id};
+    if (!is_inside(request.file)) {
+      answer.error = fmt::format("file {} is outside of checkout", request.file);
+      return answer;
+    }
+    if (!is_allowed(request)) {
+      answer.error = fmt::format("arguments {} aren't allowed", concat(request.args, ' '));
+      return answer;
+    }
+
+    // We lint our own copy of file, so it must be the one seen by coordinator.
+    auto content = read_file(std::filesystem::path{options.root} / request.file);
+    if (content != request.content) {
+      answer.error = fmt::format("file {} differs from the coordinator's one", request.file);
+      return answer;
+    }
+
+    spdlog::info("Running command: {} {}", options.binary, concat(request.args, ' '));
+    auto res         = shell::execute(options.binary, request.args, options.root);
+    answer.exit_code = res.exit_code;
+    answer.std_out   = std::move(res.std_out);
+    answer.std_err   = std::move(res.std_err);
+    answer.peak_rss  = res.peak_rss;
+    return answer;
+  }
+
+  server::server(worker_options options)
+    : options_(std::move(options))
+    , acceptor_(io_)
+    , slots_(static_cast<std::ptrdiff_t>(std::max<std::size_t>(options_.slots, 1))) {
+    auto endpoint =
+      tcp::endpoint{boost::asio::ip::make_address(options_.host), options_.port};
+    throw_if(options_.secret.empty() && !endpoint.address().is_loopback(),
+             fmt::format("a secret must be given by {} to listen on {}",
+                         secret_env,
+                         options_.host));
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(tcp::acceptor::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+  }
+
+  server::~server() {
+    stop();
+    sessions_.clear();
+  }
+
+  auto server::port() const -> std::uint16_t {
+    return acceptor_.local_endpoint().port();
+  }
+
+  void server::run() {
+    spdlog::trace("Enter server::run");
+    while (!stopping_) {
+      auto socket = std::make_shared<tcp::socket>(io_);
+      auto ec     = boost::system::error_code{};
+      acceptor_.accept(*socket, ec);
+      if (stopping_) {
+        break;
+      }
+      if (ec) {
+        spdlog::warn("failed to accept coordinator: {}", ec.message());
+        continue;
+      }
+      spdlog::info("coordinator {} connected", socket->remote_endpoint(ec).address().to_string());
+
+      // A coordinator connects again on every retry and run, so finished
+      // sessions are reaped rather than kept until the worker stops.
+      auto lock = std::lock_guard{mutex_};
+      reap();
+      auto &entry  = sessions_.emplace_back(std::move(socket));
+      entry.thread = std::jthread{[this, &entry] {
+        serve(entry.socket);
+        entry.done = true;
+      }};
+    }
+  }
+
+  void server::stop() {
+    if (stopping_.exchange(true)) {
+      return;
+    }
+
+    // Wake up the blocking accept by connecting to ourselves.
+    auto ec       = boost::system::error_code{};
+    auto endpoint = acceptor_.local_endpoint(ec);
+    if (!ec) {
+      if (endpoint.address().is_unspecified()) {
+        endpoint.address(boost::asio::ip::address_v4::loopback());
+      }
+      auto waker = tcp::socket{io_};
+      waker.connect(endpoint, ec);
+    }
+
+    auto lock = std::lock_guard{mutex_};
+    for (const auto &entry: sessions_) {
+      entry.socket->shutdown(tcp::socket::shutdown_both, ec);
+    }
+  }
+
+  auto server::sessions() -> std::size_t {
+    auto lock = std::lock_guard{mutex_};
+    return sessions_.size();
+  }
+
+  void server::reap() {
+    // A session is done once it no longer touches the server, so joining it
+    // under the mutex doesn't block.
+    std::erase_if(sessions_, [](const session &entry) { return entry.done.load(); });
+  }
+
+  void server::serve(const std::shared_ptr<tcp::socket> &socket) {
+    try {
+      auto buffer   = boost::asio::streambuf{};
+      auto identity = read_message(*socket, buffer).get<auth>();
+      throw_unless(identity.version == protocol_version,
+                   fmt::format("unsupported protocol version {}", identity.version));
+      throw_unless(is_same_secret(identity.secret, options_.secret), "wrong secret");
+
+      write_message(*socket, hello{.slots = std::max<std::size_t>(options_.slots, 1)});
+      while (!stopping_) {
+        auto request = read_message(*socket, buffer).get<job>();
+
+        slots_.acquire();
+        auto answer = reply{.id = request.id};
+        try {
+          answer = run_job(options_, request);
+        } catch (const std::exception &err) {
+          answer.error = err.what();
+        }
+        slots_.release();
+
+        write_message(*socket, answer);
+      }
+    } catch (const boost::system::system_error &err) {
+      spdlog::debug("coordinator disconnected: {}", err.what());
+    } catch (const std::exception &err) {
+      spdlog::warn("drop coordinator since it sent a bad message: {}", err.what());
+    }
+
+    // The socket is kept until the session is reaped, so the coordinator only
+    // knows it's dropped by a shutdown.
+    auto lock = std::lock_guard{mutex_};
+    auto ec   = boost::system::error_code{};
+    socket->shutdown(tcp::socket::shutdown_both, ec);
+  }
+
+  auto run_worker(int argc, char **argv) -> int {
+    namespace po = boost::program_options;
+
+    using po::value;
+    using std::string;
+
+    const auto *level   = value<string>()->value_name("level")->default_value("info");
+    const auto *address = value<string>()->value_name("host:port")->default_value("127.0.0.1:7800");
+    const auto *path    = value<string>()->value_name("path")->default_value(".");
+    const auto *number  = value<std::size_t>()->value_name("number")->default_value(0);
+    const auto *binary  = value<string>()->value_name("path")->default_value("clang-tidy");
+
+    auto desc = po::options_description{"cpp-lint-action worker options"};
+    // clang-format off
+    desc.add_options()
+      ("help",                            "Display help message")
+      ("log-level",      level,           "Set the log verbose level of worker. "
+                                          "Supports: [trace, debug, info, error]")
+      ("listen",         address,         "Set the address to accept coordinators on. Addresses "
+                                          "other than loopback require the secret given by "
+                                          "CPP_LINT_ACTION_REMOTE_SECRET")
+      ("root",           path,            "Set the checkout of repository which commands are run in")
+      ("slots",          number,          "Set the number of concurrent jobs. 0 means the number of "
+                                          "available cpus")
+      ("binary",         binary,          "Set the clang-tidy which checks are run by")
+    ;
+    // clang-format on
+
+    auto variables = po::variables_map{};
+    po::store(po::parse_command_line(argc, argv, desc), variables);
+    po::notify(variables);
+    if (variables.contains("help")) {
+      std::cout << desc << "\n";
+      return 0;
+    }
+    set_log_level(variables["log-level"].as<std::string>());
+
+    auto options      = worker_options{};
+    auto [host, port] = parse_endpoint(variables["listen"].as<std::string>());
+    options.host      = host;
+    options.port      = port;
+    options.root      = variables["root"].as<std::string>();
+    options.slots     = variables["slots"].as<std::size_t>();
+    options.binary    = variables["binary"].as<std::string>();
+    options.secret    = env::get(secret_env);
+    if (options.slots == 0) {
+      options.slots = resource::available_cpus(resource::read_cgroup_limits());
+    }
+
+    auto worker = server{options};
+    spdlog::info("worker listens on {}:{} with {} slots, runs commands in {}",
+                 options.host,
+                 worker.port(),
+                 options.slots,
+                 options.root);
+    worker.run();
+    return 0;
+  }
+} // namespace lint::remote
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "remote/protocol.h"
+
+namespace lint::remote {
+  struct worker_options {
+    // Only loopback is listened on by default. Other addresses require a
+    // secret, since anyone who is able to connect could make us run checks.
+    std::string host   = "127.0.0.1";
+    std::uint16_t port = 0; // 0 means any free port.
+
+    // The secret which coordinators must authenticate with. Empty means any
+    // coordinator is accepted.
+    std::string secret;
+
+    // The checkout of repository which commands are run in. It must be on the
+    // same revision and have the same compilation database as the
+    // coordinator's one.
+    std::string root = ".";
+
+    // The number of jobs run concurrently. Jobs of all coordinators share them.
+    std::size_t slots = 1;
+
+    // The clang-tidy which jobs are run by. Coordinators couldn't choose it,
+    // so that the worker couldn't be used to run arbitrary programs.
+    std::string binary = "clang-tidy";
+  };
+
+  /// Run a job in the checkout. The job isn't run if any of its arguments isn't
+  /// allowed, or the file of checkout differs from the one seen by coordinator.
+  auto run_job(const worker_options &options, const job &request) -> reply;
+
+  /// A worker daemon which accepts coordinators and runs their jobs.
+  class server {
+  public:
+    /// Bind to the address given by options. Throws on failure, or if the
+    /// address isn't loopback but there is no secret.
+    explicit server(worker_options options);
+    ~server();
+
+    server(const server &)            = delete;
+    server &operator=(const server &) = delete;
+    server(server &&)                 = delete;
+    server &operator=(server &&)      = delete;
+
+    /// The bound port.
+    [[nodiscard]] auto port() const -> std::uint16_t;
+
+    /// Accept coordinators until stop() is called.
+    void run();
+
+    /// Stop accepting and disconnect all coordinators.
+    void stop();
+
+    /// The number of sessions kept, finished ones are reaped once the next
+    /// coordinator is accepted.
+    [[nodiscard]] auto sessions() -> std::size_t;
+
+  private:
+    /// A coordinator connected, which is served by a thread of its own.
+    struct session {
+      explicit session(std::shared_ptr<tcp::socket> connected)
+        : socket(std::move(connected)) {
+      }
+
+      std::shared_ptr<tcp::socket> socket;
+      std::atomic<bool> done = false;
+      std::jthread thread;
+    };
+
+    void serve(const std::shared_ptr<tcp::socket> &socket);
+
+    /// Join and remove the finished sessions. Requires mutex_.
+    void reap();
+
+    worker_options options_;
+    boost::asio::io_context io_;
+    tcp::acceptor acceptor_;
+    std::counting_semaphore<> slots_;
+    std::atomic<bool> stopping_ = false;
+    std::mutex mutex_;
+    std::list<session> sessions_;
+  };
+
+  /// The entry of worker subcommand.
+  auto run_worker(int argc, char **argv) -> int;
+} // namespace lint::remote
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "staged.h"
+
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstdint>
+#include <fstream>
+#include <set>
+#include <string_view>
+#include <system_error>
+
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+#include "utils/git_utils.h"
+
+namespace lint {
+  namespace {
+    // Trees are named by the pid of their runs.
+    constexpr auto tree_prefix = "staged-";
+
+    // A staged file which differs from the worktree.
+    struct unstaged_file {
+      std::string path;
+      git_oid id;
+      std::uint16_t mode = 0;
+    };
+
+    auto is_blob(std::uint16_t mode) -> bool {
+      return mode == GIT_FILEMODE_BLOB || mode == GIT_FILEMODE_BLOB_EXECUTABLE;
+    }
+
+    // Find the staged files which differ from the worktree. Unchanged files are
+    // skipped by their stat data in index without being read.
+    auto unstaged_files(git_repository &repo, const runtime_context &context)
+      -> std::vector<unstaged_file> {
+      auto paths = std::vector<char *>{};
+      for (const auto &file: context.changed_files) {
+        if (context.deltas.at(file).status != GIT_DELTA_DELETED) {
+          paths.push_back(const_cast<char *>(file.c_str())); // NOLINT
+        }
+      }
+      if (paths.empty()) {
+        return {};
+      }
+
+      auto opts              = git::diff::init_option();
+      opts.flags            |= GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+      opts.pathspec.strings  = paths.data();
+      opts.pathspec.count    = paths.size();
+
+      // The old side is the index.
+      auto index = git::repo::index(repo);
+      auto diff  = git::diff::index_to_workdir(repo, *index, opts);
+      auto files = std::vector<unstaged_file>{};
+      for (std::size_t i = 0; i < git::diff::num_deltas(*diff); ++i) {
+        const auto *delta = git::diff::get_delta(*diff, i);
+        if (is_blob(delta->old_file.mode)) {
+          files.push_back({delta->old_file.path, delta->old_file.id, delta->old_file.mode});
+        }
+      }
+      return files;
+    }
+
+    // Remove the trees whose runs are gone, e.g. killed ones. Trees of running
+    // ones are kept.
+    void remove_stale_trees(const std::filesystem::path &parent) {
+      auto error = std::error_code{};
+      for (const auto &entry: std::filesystem::directory_iterator{parent, error}) {
+        auto name = entry.path().filename().string();
+        if (!name.starts_with(tree_prefix)) {
+          continue;
+        }
+        auto pid           = pid_t{0};
+        const auto *first  = name.data() + std::string_view{tree_prefix}.size();
+        const auto *last   = name.data() + name.size();
+        auto [end, parsed] = std::from_chars(first, last, pid);
+        if (parsed != std::errc{} || end != last || pid <= 0) {
+          continue;
+        }
+        if (::kill(pid, 0) != 0 && errno == ESRCH) {
+          spdlog::debug("remove {} left by a killed run", entry.path().string());
+          std::filesystem::remove_all(entry.path(), error);
+        }
+      }
+    }
+
+    // Link the entries of dir in worktree into the tree. Directories on the way
+    // to written files are created instead and linked recursively.
+    void link_entries(const std::filesystem::path &worktree,
+                      const std::filesystem::path &tree,
+                      const std::string &dir,
+                      const std::set<std::string> &written,
+                      const std::set<std::string> &parents) {
+      std::filesystem::create_directories(tree / dir);
+      if (!std::filesystem::is_directory(worktree / dir)) {
+        return;
+      }
+      for (const auto &entry: std::filesystem::directory_iterator{worktree / dir}) {
+        auto path = (std::filesystem::path{dir} / entry.path().filename()).generic_string();
+        if (path == ".git" || written.contains(path)) {
+          continue;
+        }
+        if (parents.contains(path)) {
+          link_entries(worktree, tree, path, written, parents);
+          continue;
+        }
+        std::filesystem::create_symlink(entry.path(), tree / path);
+      }
+    }
+  } // namespace
+
+  staged_tree::staged_tree(runtime_context &context)
+    : context_(context)
+    , worktree_(context.repo_path) {
+    spdlog::trace("Enter staged_tree::staged_tree");
+    auto parent = std::filesystem::path{git::repo::path(*context.repo)} / "cpp-lint-action";
+    remove_stale_trees(parent);
+
+    auto unstaged = unstaged_files(*context.repo, context);
+    if (unstaged.empty()) {
+      return;
+    }
+    root_ = parent / fmt::format("{}{}", tree_prefix, ::getpid());
+    std::filesystem::remove_all(root_);
+
+    try {
+      auto written = std::set<std::string>{};
+      auto parents = std::set<std::string>{};
+      for (const auto &unstaged_file: unstaged) {
+        written.insert(unstaged_file.path);
+        auto dir = std::filesystem::path{unstaged_file.path}.parent_path();
+        for (; !dir.empty(); dir = dir.parent_path()) {
+          parents.insert(dir.generic_string());
+        }
+      }
+      link_entries(std::filesystem::absolute(worktree_), root_, "", written, parents);
+
+      for (const auto &[file, id, mode]: unstaged) {
+        auto path = root_ / file;
+        std::filesystem::create_directories(path.parent_path());
+        auto blob   = git::blob::lookup(*context.repo, id);
+        auto output = std::ofstream{path, std::ios::binary | std::ios::trunc};
+        throw_unless(output.is_open(), fmt::format("can't write {}", path.string()));
+        output << git::blob::get_raw_content(*blob);
+        output.close();
+        if (mode == GIT_FILEMODE_BLOB_EXECUTABLE) {
+          std::filesystem::permissions(path,
+                                       std::filesystem::perms::owner_exec,
+                                       std::filesystem::perm_options::add);
+        }
+        files_.push_back(file);
+        spdlog::debug("put the staged content of {} into {}", file, root_.string());
+      }
+    } catch (...) {
+      auto error = std::error_code{};
+      std::filesystem::remove_all(root_, error);
+      throw;
+    }
+    context.repo_path = root_.string();
+  }
+
+  staged_tree::~staged_tree() {
+    if (root_.empty()) {
+      return;
+    }
+    context_.repo_path = worktree_;
+    auto error         = std::error_code{};
+    std::filesystem::remove_all(root_, error);
+    if (error) {
+      spdlog::error("failed to remove {}: {}", root_.string(), error.message());
+    }
+  }
+
+  auto staged_tree::files() const -> const std::vector<std::string> & {
+    return files_;
+  }
+
+  auto staged_tree::root() const -> const std::filesystem::path & {
+    return root_;
+  }
+} // namespace lint
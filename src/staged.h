@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "context.h"
+
+namespace lint {
+  /// Writes the staged contents of changed files into a private tree in the git
+  /// directory and points the context at it during its lifetime, so that tools
+  /// lint what is about to be committed while the worktree isn't touched. Other
+  /// entries of worktree are linked into the tree, so that headers, configs and
+  /// compilation databases are still found. Only the files which differ from
+  /// the index are written, and they're found by the stat cache of index
+  /// without reading unchanged files. Each run has its own tree, and the trees
+  /// of killed runs are removed when the next one starts.
+  class staged_tree {
+  public:
+    explicit staged_tree(runtime_context &context);
+    ~staged_tree();
+
+    staged_tree(const staged_tree &)            = delete;
+    staged_tree &operator=(const staged_tree &) = delete;
+    staged_tree(staged_tree &&)                 = delete;
+    staged_tree &operator=(staged_tree &&)      = delete;
+
+    /// The files whose staged contents are written into the tree.
+    [[nodiscard]] auto files() const -> const std::vector<std::string> &;
+
+    /// The root of tree, or empty if the worktree has the staged contents.
+    [[nodiscard]] auto root() const -> const std::filesystem::path &;
+
+  private:
+    runtime_context &context_;
+    std::string worktree_;
+    std::filesystem::path root_;
+    std::vector<std::string> files_;
+  };
+} // namespace lint
@@ -19,6 +19,7 @@
 #include <vector>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include "context.h"
 #include "github/client.h"
@@ -90,9 +91,10 @@ namespace lint::tool {
   }
 
   void comment_on_github_issue(const runtime_context &context,
-                               const std::vector<reporter_base_ptr> &reporters) {
-    auto github_client = github::client{};
-    github_client.get_issue_comment_id(context);
+                               const std::vector<reporter_base_ptr> &reporters,
+                               const std::string &progress) {
+    auto &github_client = github::shared_client();
+    github_client.find_issue_comment(context);
 
     constexpr auto website = "";
     constexpr auto header =
@@ -103,6 +105,8 @@ namespace lint::tool {
     constexpr auto summary_fmt =
       "<summary>:mag_right: Click here to see the details of <strong>{}</strong> failed {} reported by <strong>{}</strong></summary>\n\n"sv;
     constexpr auto details_fmt = "<details>\n{}\n</details>\n"sv;
+    constexpr auto running_fmt =
+      ":hourglass_flowing_sand: Still running, {}. This comment is updated until all checks finish.\n\n"sv;
 
     auto table_rows = ""s;
     auto details    = ""s;
@@ -125,20 +129,22 @@ namespace lint::tool {
       details += fmt::format(details_fmt, usage_summary + make_reproduce_spec(reporters));
     }
 
-    auto final_content =
-      fmt::format("{}{}{}{}{}", header, table_header, table_sep_line, table_rows, details);
-    github_client.add_or_update_issue_comment(context, final_content);
+    auto running  = progress.empty() ? ""s : fmt::format(running_fmt, progress);
+    auto priority = progress.empty() ? github::request_priority::critical
+                                     : github::request_priority::optional;
+    auto final_content = fmt::format(
+      "{}{}{}{}{}{}", header, running, table_header, table_sep_line, table_rows, details);
+    github_client.add_or_update_issue_comment(context, final_content, priority);
   }
 
   void comment_on_github_pull_request_review(const runtime_context &context,
                                              const std::vector<reporter_base_ptr> &reporters) {
-    auto github_client = github::client{};
-    auto comments      = github::review_comments{};
+    auto &github_client = github::shared_client();
+    auto comments       = github::review_comments{};
     for (const auto &reporter: reporters) {
       auto ret = reporter->make_review_comment(context);
       comments.insert(comments.end(), ret.begin(), ret.end());
     }
-    auto body = github::make_review_str(comments);
-    github_client.post_pull_request_review(context, body);
+    github_client.post_pull_request_review(context, std::move(comments));
   }
 } // namespace lint::tool
@@ -51,8 +51,11 @@ namespace lint::tool {
   void write_to_github_step_summary(const runtime_context &context,
                                     const std::vector<reporter_base_ptr> &reporters);
 
+  /// Add or update the comment of pull request. A non-empty `progress` marks
+  /// the comment as running, which is updated again once checks finish.
   void comment_on_github_issue(const runtime_context &context,
-                               const std::vector<reporter_base_ptr> &reporters);
+                               const std::vector<reporter_base_ptr> &reporters,
+                               const std::string &progress = {});
 
   void comment_on_github_pull_request_review(const runtime_context &context,
                                              const std::vector<reporter_base_ptr> &reporters);
@@ -15,11 +15,15 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <nlohmann/json.hpp>
+#include <range/v3/algorithm/contains.hpp>
+
 namespace lint::tool {
 
   struct per_file_result_base {
@@ -28,6 +32,13 @@ namespace lint::tool {
     std::string tool_stdout;
     std::string tool_stderr;
     std::string file_option;
+
+    /// The peak resident set size of the tool process in bytes. Zero if unknown.
+    std::uint64_t peak_rss = 0;
+
+    /// Whether the tool process was terminated by a stop request, so that the
+    /// output is incomplete. It isn't serialized.
+    bool killed = false;
   };
 
   using per_file_result_base_ptr = std::unique_ptr<per_file_result_base>;
@@ -42,6 +53,65 @@ namespace lint::tool {
     std::unordered_map<std::string, PerFileResult> fails;
 
     std::vector<std::string> failed_commands;
+
+    /// Files which aren't checked since the tool is cancelled, e.g. by fail
+    /// fast. They're neither passed nor failed.
+    std::vector<std::string> cancelled;
   };
 
+  // Results are serialized so that they could be passed between processes,
+  // e.g. merged from the bundles of shards.
+  template <class PerFileResult>
+  void to_json(nlohmann::json &json, const multi_files_result_base<PerFileResult> &result) {
+    json["final_passed"]    = result.final_passed;
+    json["fastly_exited"]   = result.fastly_exited;
+    json["ignored"]         = result.ignored;
+    json["passes"]          = result.passes;
+    json["fails"]           = result.fails;
+    json["failed_commands"] = result.failed_commands;
+    json["cancelled"]       = result.cancelled;
+  }
+
+  template <class PerFileResult>
+  void from_json(const nlohmann::json &json, multi_files_result_base<PerFileResult> &result) {
+    json.at("final_passed").get_to(result.final_passed);
+    json.at("fastly_exited").get_to(result.fastly_exited);
+    json.at("ignored").get_to(result.ignored);
+    json.at("passes").get_to(result.passes);
+    json.at("fails").get_to(result.fails);
+    json.at("failed_commands").get_to(result.failed_commands);
+    json.at("cancelled").get_to(result.cancelled);
+  }
+
+  /// Merge the result of another part of files into the given one.
+  template <class PerFileResult>
+  void merge_result(multi_files_result_base<PerFileResult> &into,
+                    multi_files_result_base<PerFileResult> from) {
+    into.final_passed  = into.final_passed && from.final_passed;
+    into.fastly_exited = into.fastly_exited || from.fastly_exited;
+    for (auto &file: from.ignored) {
+      if (!ranges::contains(into.ignored, file)) {
+        into.ignored.push_back(std::move(file));
+      }
+    }
+    into.passes.merge(std::move(from.passes));
+    into.fails.merge(std::move(from.fails));
+    for (auto &command: from.failed_commands) {
+      into.failed_commands.push_back(std::move(command));
+    }
+    for (auto &file: from.cancelled) {
+      if (!ranges::contains(into.cancelled, file)) {
+        into.cancelled.push_back(std::move(file));
+      }
+    }
+  }
+
+  /// Record a file which isn't checked since the tool is cancelled.
+  template <class PerFileResult>
+  void mark_cancelled(multi_files_result_base<PerFileResult> &result, const std::string &file) {
+    if (!ranges::contains(result.cancelled, file)) {
+      result.cancelled.push_back(file);
+    }
+  }
+
 } // namespace lint::tool
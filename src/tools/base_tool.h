@@ -15,11 +15,31 @@
  */
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
 #include "context.h"
 #include "tools/base_reporter.h"
+#include "tools/fixes.h"
+#include "tools/history.h"
 #include "utils/platform.h"
 
 namespace lint::tool {
+  /// The brief outcome of applying a tool to a single file.
+  struct file_outcome {
+    bool passed            = false;
+    std::uint64_t peak_rss = 0;
+
+    /// Whether the tool didn't actually run on the file or its run was
+    /// cancelled, e.g. it fastly exited.
+    bool skipped = false;
+  };
+
   /// This is a base class represents lint tools. All specified tools should be
   /// derived from this.
   struct tool_base {
@@ -37,9 +57,71 @@ namespace lint::tool {
     /// Return binary path of this tool.
     virtual auto binary() -> std::string_view = 0;
 
-    /// Apply this tool to a single file.
+    /// Give the statistics of previous runs before files are collected, so that
+    /// this tool could choose the cheaper work. They outlive the checks.
+    virtual void use_history(const history & /*records*/) {
+    }
+
+    /// Collect the files which should be checked by this tool from the given
+    /// context. Files ignored by this tool are recorded into its result.
+    virtual auto collect_files(const runtime_context &context) -> std::vector<std::string> = 0;
+
+    /// Whether this tool checks the given file, which exists in worktree.
+    /// Unlike collect_files(), nothing is recorded for files which aren't
+    /// accepted, so it could be asked for every file of repository.
+    virtual auto accepts(const std::string &file) -> bool = 0;
+
+    /// Whether files are checked by the remote workers of context, so that
+    /// their tasks only wait for the workers.
+    virtual auto runs_remotely(const runtime_context & /*context*/) -> bool {
+      return false;
+    }
+
+    /// Apply this tool to a single file and record the result. This may be
+    /// called concurrently for different files. The file is skipped once a
+    /// stop is requested on `cancel`, and the running process is terminated.
+    /// The tool requests a stop by itself when it fastly exits.
+    virtual auto check_file(const runtime_context &context,
+                            const std::string &file,
+                            std::stop_source cancel) -> file_outcome = 0;
+
+    /// Estimate the peak memory in bytes needed to check a file of the given
+    /// size. It's used when there is no history of the file.
+    virtual auto estimate_memory(std::uintmax_t file_size) -> std::uint64_t = 0;
+
+    /// Estimate the wall time needed to check a file of the given size. It's
+    /// used to order files when there is no history of the file.
+    virtual auto estimate_duration(std::uintmax_t file_size) -> std::chrono::milliseconds = 0;
+
+    /// Apply this tool to all collected files one by one.
     virtual void check(const runtime_context &context) = 0;
 
+    /// Serialize the result of checked files.
+    virtual auto dump_result() -> nlohmann::json = 0;
+
+    /// Serialize the result of a single checked file. Null if the file hasn't
+    /// been checked.
+    virtual auto dump_result(const std::string &file) -> nlohmann::json = 0;
+
+    /// Forget the results of all checked files, so that files could be checked
+    /// again from scratch, e.g. by the daemon for each request.
+    virtual void reset_result() = 0;
+
+    /// Forget what is cached about the given files across checks, since they
+    /// have changed on disk, e.g. by the daemon and watch modes before checking
+    /// them again. What is cached about other files is kept.
+    virtual void drop_caches([[maybe_unused]] const std::vector<std::string> &files) {
+    }
+
+    /// Merge a result serialized by dump_result() into the current result.
+    virtual void load_result(const nlohmann::json &json) = 0;
+
+    /// Return the fixes suggested for the checked files, which are merged with
+    /// those of other tools and applied once all checks are done.
+    virtual auto fixes(const runtime_context & /*context*/) -> replacements {
+      return {};
+    }
+
     /// Return the result reporter. To get the result, you must first call check().
     virtual auto get_reporter() -> reporter_base_ptr = 0;
   };
@@ -47,15 +129,4 @@ namespace lint::tool {
   /// An unique pointer for base tool.
   using tool_base_ptr = std::unique_ptr<tool_base>;
 
-  /// Run the given tools one by one and return the reporter of each tool in order.
-  inline auto run_tools(const std::vector<tool_base_ptr> &tools, const runtime_context &context)
-    -> std::vector<reporter_base_ptr> {
-    auto ret = std::vector<reporter_base_ptr>{};
-    for (const auto &tool: tools) {
-      tool->check(context);
-      ret.emplace_back(tool->get_reporter());
-    }
-    return ret;
-  }
-
 } // namespace lint::tool
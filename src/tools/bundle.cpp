@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/bundle.h"
+
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+
+namespace lint::tool {
+  namespace {
+    // Increase this when the layout of bundle is changed incompatibly.
+    constexpr auto bundle_version = 3;
+  } // namespace
+
+  auto make_bundle(const runtime_context &context, const std::vector<tool_base_ptr> &tools)
+    -> nlohmann::json {
+    spdlog::trace("Enter make_bundle");
+    auto bundle           = nlohmann::json{};
+    bundle["version"]     = bundle_version;
+    bundle["source"]      = context.source;
+    bundle["shard_index"] = context.shard_index;
+    bundle["shard_count"] = context.shard_count;
+    for (const auto &tool: tools) {
+      bundle["tools"][std::string{tool->name()}] = tool->dump_result();
+    }
+    return bundle;
+  }
+
+  auto merge_bundle(const runtime_context &context,
+                    const std::vector<tool_base_ptr> &tools,
+                    const nlohmann::json &bundle) -> bundle_summary {
+    spdlog::trace("Enter merge_bundle");
+    auto version = bundle.at("version").get<int>();
+    throw_unless(version == bundle_version,
+                 fmt::format("unsupported bundle version: {} != {}", version, bundle_version));
+    auto source = bundle.at("source").get<std::string>();
+    throw_unless(
+      source == context.source,
+      fmt::format("bundle is made on another revision: {} != {}", source, context.source));
+
+    auto summary        = bundle_summary{};
+    summary.shard_index = bundle.at("shard_index").get<std::size_t>();
+    summary.shard_count = bundle.at("shard_count").get<std::size_t>();
+
+    const auto &results = bundle.at("tools");
+    for (const auto &tool: tools) {
+      auto name = std::string{tool->name()};
+      if (!results.contains(name)) {
+        spdlog::warn("Bundle of shard {} has no result of {}", summary.shard_index, name);
+        continue;
+      }
+      const auto &result      = results.at(name);
+      summary.cancelled[name] = result.at("cancelled").size();
+      tool->load_result(result);
+    }
+    return summary;
+  }
+
+  void write_bundle(const std::string &path,
+                    const runtime_context &context,
+                    const std::vector<tool_base_ptr> &tools) {
+    spdlog::trace("Enter write_bundle");
+    auto file = std::ofstream{path, std::ios::trunc};
+    throw_unless(file.is_open(), fmt::format("failed to open bundle {} to write", path));
+    file << make_bundle(context, tools).dump();
+    throw_if(file.fail(), fmt::format("failed to write bundle {}", path));
+    spdlog::info("Results of shard {}/{} are written into {}",
+                 context.shard_index,
+                 context.shard_count,
+                 path);
+  }
+
+  auto read_bundle(const std::string &path,
+                   const runtime_context &context,
+                   const std::vector<tool_base_ptr> &tools) -> bundle_summary {
+    spdlog::trace("Enter read_bundle");
+    auto file = std::ifstream{path};
+    throw_unless(file.is_open(), fmt::format("failed to open bundle {}", path));
+    auto summary = merge_bundle(context, tools, nlohmann::json::parse(file));
+    spdlog::info("Merged bundle {} of shard {}/{}", path, summary.shard_index, summary.shard_count);
+    return summary;
+  }
+
+  void check_shards(const std::vector<bundle_summary> &bundles) {
+    spdlog::trace("Enter check_shards");
+    throw_if(bundles.empty(), "no bundle to merge");
+    auto count = bundles.front().shard_count;
+    auto seen  = std::vector<bool>(count, false);
+    for (const auto &bundle: bundles) {
+      throw_unless(bundle.shard_count == count,
+                   fmt::format("bundles are written by different shard counts: {} != {}",
+                               bundle.shard_count,
+                               count));
+      throw_unless(bundle.shard_index < count,
+                   fmt::format("shard index {} is out of {} shards", bundle.shard_index, count));
+      throw_if(seen[bundle.shard_index],
+               fmt::format("bundle of shard {} is merged twice", bundle.shard_index));
+      seen[bundle.shard_index] = true;
+    }
+    for (std::size_t index = 0; index < count; ++index) {
+      throw_unless(seen[index], fmt::format("bundle of shard {}/{} is missing", index, count));
+    }
+  }
+} // namespace lint::tool
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "context.h"
+#include "tools/base_tool.h"
+
+/// A bundle holds the results of all tools run by a shard. Bundles of all
+/// shards are merged into the normal results by merge subcommand.
+namespace lint::tool {
+  /// What a merged bundle tells besides the results.
+  struct bundle_summary {
+    std::size_t shard_index = 0;
+    std::size_t shard_count = 1;
+
+    /// The number of files each tool didn't check since it was cancelled.
+    std::unordered_map<std::string, std::size_t> cancelled;
+  };
+
+  /// Serialize the results of all tools into a bundle.
+  auto make_bundle(const runtime_context &context, const std::vector<tool_base_ptr> &tools)
+    -> nlohmann::json;
+
+  /// Merge a bundle into the results of tools. The bundle must be made on the
+  /// same source revision.
+  auto merge_bundle(const runtime_context &context,
+                    const std::vector<tool_base_ptr> &tools,
+                    const nlohmann::json &bundle) -> bundle_summary;
+
+  /// Write the results of all tools into the bundle file.
+  void write_bundle(const std::string &path,
+                    const runtime_context &context,
+                    const std::vector<tool_base_ptr> &tools);
+
+  /// Read the bundle file and merge it into the results of tools.
+  auto read_bundle(const std::string &path,
+                   const runtime_context &context,
+                   const std::vector<tool_base_ptr> &tools) -> bundle_summary;
+
+  /// Check that the bundles are written by all shards of the same run, each
+  /// exactly once, so that no results are missing or merged twice.
+  void check_shards(const std::vector<bundle_summary> &bundles);
+} // namespace lint::tool
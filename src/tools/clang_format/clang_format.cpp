@@ -15,9 +15,12 @@
  */
 #include "tools/clang_format/clang_format.h"
 
+#include <magic_enum/magic_enum.hpp>
+
 #include "program_options.h"
 #include "tools/base_tool.h"
 #include "tools/clang_format/general/impl.h"
+#include "tools/clang_format/libformat/impl.h"
 #include "tools/clang_format/version/v18.h"
 #include "tools/util.h"
 
@@ -30,13 +33,14 @@ namespace lint::tool::clang_format {
     constexpr auto version            = "clang-format-version";
     constexpr auto binary             = "clang-format-binary";
     constexpr auto file_iregex        = "clang-format-file-iregex";
+    constexpr auto backend            = "clang-format-backend";
 
   } // namespace
 
   // Get version from clang-format output.
   // Example: Ubuntu clang-format version 18.1.3 (1ubuntu1)
   auto get_version(const std::string &binary) -> std::string {
-    auto [ec, std_out, std_err] = shell::execute(binary, {"--version"});
+    auto [ec, std_out, std_err, peak_rss, killed] = shell::execute(binary, {"--version"});
     if (ec != 0) {
       return "";
     }
@@ -56,6 +60,7 @@ namespace lint::tool::clang_format {
     const auto *bin    = value<string>()->value_name("path");
     const auto *iregex = value<string>()->value_name("iregex")->default_value(
       option.file_filter_iregex);
+    const auto *kind   = value<string>()->value_name("backend")->default_value("binary");
 
     auto boolean = [](bool def) {
       return value<bool>()->value_name("bool")->default_value(def);
@@ -75,6 +80,9 @@ namespace lint::tool::clang_format {
                                            "Don't spefify both this option and the clang-format-version "
                                            "option to avoid ambigous")
     (file_iregex,         iregex,          "Set the source file filter for clang-format.")
+    (backend,             kind,            "Set how files are formatted. Supports: [binary, libformat]. "
+                                           "libformat formats files in process without spawning "
+                                           "clang-format and requires building with ENABLE_LIBFORMAT")
   ;
     // clang-format on
   }
@@ -94,6 +102,21 @@ namespace lint::tool::clang_format {
       option.file_filter_iregex = variables[file_iregex].as<std::string>();
     }
 
+    if (variables.contains(backend)) {
+      auto name = variables[backend].as<std::string>();
+      auto kind = magic_enum::enum_cast<backend_t>(name);
+      throw_unless(kind.has_value(), fmt::format("unsupported clang-format backend: {}", name));
+      option.backend = *kind;
+    }
+
+    // libFormat is linked into us, so there's no binary to find.
+    if (option.backend == backend_t::libformat) {
+      program_options::must_not_specify("use libformat backend", variables, {version, binary});
+      option.binary  = "libFormat";
+      option.version = libformat_version();
+      return;
+    }
+
     // Get clang-format-binary
     if (variables.contains(version)) {
       program_options::must_not_specify("specify clang-format-version", variables, {binary});
@@ -104,11 +127,11 @@ namespace lint::tool::clang_format {
     } else if (variables.contains(binary)) {
       program_options::must_not_specify("specify clang-format-binary", variables, {version});
 
-      option.binary               = variables[binary].as<std::string>();
-      auto [ec, std_out, std_err] = shell::which(option.binary);
+      option.binary                                 = variables[binary].as<std::string>();
+      auto [ec, std_out, std_err, peak_rss, killed] = shell::which(option.binary);
       throw_unless(ec == 0, fmt::format("Can't find given clang-format binary: {}", option.binary));
     } else {
-      auto [ec, std_out, std_err] = shell::which("clang-format");
+      auto [ec, std_out, std_err, peak_rss, killed] = shell::which("clang-format");
       throw_unless(ec == 0, "can't find clang-format");
       option.binary = std_out;
     }
@@ -126,7 +149,9 @@ namespace lint::tool::clang_format {
 
     auto version = option.version;
     auto tool    = tool_base_ptr{};
-    if (version == version_18_1_3) {
+    if (option.backend == backend_t::libformat) {
+      tool = make_libformat_tool(option);
+    } else if (version == version_18_1_3) {
       tool = std::make_unique<clang_format_v18_1_3>(option);
     } else if (version == version_18_1_0) {
       tool = std::make_unique<clang_format_v18_1_0>(option);
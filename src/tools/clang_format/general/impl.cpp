@@ -50,22 +50,6 @@ namespace lint::tool::clang_format {
       return lines;
     }
 
-    // offset starts from 0 while row/col starts from 1
-    auto get_position(const std::vector<uint32_t> &lens, int offset)
-      -> std::tuple<int32_t, int32_t> {
-      spdlog::trace("Enter clang_format::get_position()");
-
-      auto cur_offset = uint32_t{0};
-      for (int i = 0; i < lens.size(); ++i) {
-        auto len = lens[i];
-        if (offset >= cur_offset && offset < cur_offset + len) {
-          return {i + 1, offset - cur_offset + 1};
-        }
-        cur_offset += len;
-      }
-      return {-1, -1};
-    }
-
     inline auto xml_error(tinyxml2::XMLError err) -> std::string_view {
       spdlog::trace("Enter clang_format::xml_error() with err:{}", static_cast<int>(err));
       return tinyxml2::XMLDocument::ErrorIDToName(err);
@@ -136,30 +120,51 @@ namespace lint::tool::clang_format {
       return tool_opt;
     }
 
-    auto execute(const option_t &opt, std::string_view repo, std::string_view file)
-      -> std::tuple<shell::result, std::string> {
+    auto execute(const option_t &opt,
+                 std::string_view repo,
+                 std::string_view file,
+                 const std::stop_token &token) -> std::tuple<shell::result, std::string> {
       spdlog::trace("Enter clang_format_general::execute()");
       auto tool_opt     = make_replacements_options(file);
       auto tool_opt_str = concat(tool_opt, ' ');
       spdlog::info("Running command: {} {}", opt.binary, tool_opt_str);
 
-      return {shell::execute(opt.binary, tool_opt, repo), tool_opt_str};
+      return {shell::execute(opt.binary, tool_opt, repo, token), tool_opt_str};
     }
 
   } // namespace
 
+  // offset starts from 0 while row/col starts from 1
+  auto get_position(const std::vector<uint32_t> &lens, int offset)
+    -> std::tuple<int32_t, int32_t> {
+    spdlog::trace("Enter clang_format::get_position()");
+
+    auto cur_offset = uint32_t{0};
+    for (int i = 0; i < lens.size(); ++i) {
+      auto len = lens[i];
+      if (offset >= cur_offset && offset < cur_offset + len) {
+        return {i + 1, offset - cur_offset + 1};
+      }
+      cur_offset += len;
+    }
+    return {-1, -1};
+  }
+
   auto clang_format_general::check_single_file(
     const runtime_context &context,
     const std::string &root_dir,
-    const std::string &file) const -> per_file_result {
+    const std::string &file,
+    const std::stop_token &token) const -> per_file_result {
     spdlog::trace("Enter clang_format_general::check_single_file()");
 
-    auto [xml_res, file_opt] = execute(option, root_dir, file);
+    auto [xml_res, file_opt] = execute(option, root_dir, file, token);
     auto result              = per_file_result{};
     result.file_path         = file;
     result.tool_stdout       = xml_res.std_out;
     result.tool_stderr       = xml_res.std_err;
     result.file_option       = file_opt;
+    result.peak_rss          = xml_res.peak_rss;
+    result.killed            = xml_res.killed;
     if (xml_res.exit_code != 0) {
       result.passed = false;
       return result;
@@ -171,47 +176,147 @@ namespace lint::tool::clang_format {
     return result;
   }
 
-  void clang_format_general::check(const runtime_context &context) {
+  auto clang_format_general::collect_files(const runtime_context &context)
+    -> std::vector<std::string> {
+    spdlog::trace("Enter clang_format_general::collect_files");
     assert(!option.binary.empty() && "clang-format binary is empty");
     assert(!context.repo_path.empty() && "the repo_path of context is empty");
 
-    const auto root_dir = context.repo_path;
-    const auto files    = context.changed_files;
-    for (const auto &file: files) {
+    auto lock           = std::lock_guard{result_mutex};
+    result.final_passed = true;
+
+    auto files = std::vector<std::string>{};
+    for (const auto &file: context.changed_files) {
       const auto &delta = context.deltas.at(file);
       if (delta.status == GIT_DELTA_DELETED) {
         continue;
       }
-      if (filter_file(option.file_filter_iregex, file)) {
-        result.ignored.push_back(file);
+      if (!accepts(file)) {
+        // Files are collected again for each request of the daemon.
+        if (!ranges::contains(result.ignored, file)) {
+          result.ignored.push_back(file);
+        }
         spdlog::debug("file {} is ignored by {}", file, option.binary);
         continue;
       }
+      files.push_back(file);
+    }
+    return files;
+  }
 
-      auto per_file_result = check_single_file(context, root_dir, file);
-      if (per_file_result.passed) {
-        spdlog::info("file: {} passes {} check.", file, option.binary);
-        result.passes[file] = std::move(per_file_result);
-        continue;
-      }
+  auto clang_format_general::accepts(const std::string &file) -> bool {
+    return !filter_file(option.file_filter_iregex, file);
+  }
+
+  auto clang_format_general::check_file(const runtime_context &context,
+                                        const std::string &file,
+                                        std::stop_source cancel) -> file_outcome {
+    if (cancel.stop_requested()) {
+      spdlog::debug("file {} is skipped since {} is cancelled", file, option.binary);
+      auto lock = std::lock_guard{result_mutex};
+      mark_cancelled(result, file);
+      return {.skipped = true};
+    }
+
+    auto per_file_result = check_single_file(context, context.repo_path, file, cancel.get_token());
+    if (per_file_result.killed) {
+      // The process is terminated halfway, so the result is meaningless.
+      spdlog::debug("file {} is cancelled by {}", file, option.binary);
+      auto lock = std::lock_guard{result_mutex};
+      mark_cancelled(result, file);
+      return {.skipped = true};
+    }
+
+    auto outcome =
+      file_outcome{.passed = per_file_result.passed, .peak_rss = per_file_result.peak_rss};
 
-      spdlog::error("file: {} doesn't pass {} check.", file, option.binary);
-      result.failed_commands.emplace_back(
-        std::format("clang-format {}", per_file_result.file_option));
-      result.fails[file] = std::move(per_file_result);
+    auto lock = std::lock_guard{result_mutex};
+    std::erase(result.cancelled, file);
 
-      if (option.enabled_fastly_exit) {
-        spdlog::info("{} fastly exit since check failed", option.binary);
-        result.final_passed  = false;
-        result.fastly_exited = true;
+    // A file checked again replaces its failed command of last time.
+    if (auto iter = result.fails.find(file); iter != result.fails.end()) {
+      std::erase(result.failed_commands, std::format("clang-format {}", iter->second.file_option));
+    }
+    if (per_file_result.passed) {
+      spdlog::info("file: {} passes {} check.", file, option.binary);
+      // A file checked again may have failed last time.
+      result.fails.erase(file);
+      result.passes[file] = std::move(per_file_result);
+      return outcome;
+    }
+
+    spdlog::error("file: {} doesn't pass {} check.", file, option.binary);
+    result.failed_commands.emplace_back(
+      std::format("clang-format {}", per_file_result.file_option));
+    result.passes.erase(file);
+    result.fails[file]  = std::move(per_file_result);
+    result.final_passed = false;
+
+    if (option.enabled_fastly_exit && !result.fastly_exited) {
+      spdlog::info("{} fastly exit since check failed", option.binary);
+      result.fastly_exited = true;
+      cancel.request_stop();
+    }
+    return outcome;
+  }
+
+  void clang_format_general::check(const runtime_context &context) {
+    auto cancel = std::stop_source{};
+    for (const auto &file: collect_files(context)) {
+      check_file(context, file, cancel);
+      if (cancel.stop_requested()) {
         return;
       }
     }
+  }
+
+  auto clang_format_general::dump_result() -> nlohmann::json {
+    auto lock = std::lock_guard{result_mutex};
+    return result;
+  }
+
+  auto clang_format_general::dump_result(const std::string &file) -> nlohmann::json {
+    auto lock = std::lock_guard{result_mutex};
+    if (result.passes.contains(file)) {
+      return result.passes.at(file);
+    }
+    if (result.fails.contains(file)) {
+      return result.fails.at(file);
+    }
+    return nullptr;
+  }
+
+  void clang_format_general::reset_result() {
+    auto lock = std::lock_guard{result_mutex};
+    result    = result_t{};
+  }
 
-    result.final_passed = result.fails.empty();
+  void clang_format_general::load_result(const nlohmann::json &json) {
+    auto other = json.get<result_t>();
+    auto lock  = std::lock_guard{result_mutex};
+    merge_result(result, std::move(other));
+  }
+
+  auto clang_format_general::fixes(const runtime_context & /*context*/) -> replacements {
+    spdlog::trace("Enter clang_format_general::fixes");
+    auto lock  = std::lock_guard{result_mutex};
+    auto fixes = replacements{};
+    for (const auto &[file, per_file]: result.fails) {
+      for (const auto &[_, row]: per_file.replacements) {
+        for (const auto &change: row) {
+          fixes.push_back({.file   = file,
+                           .offset = static_cast<std::size_t>(change.offset),
+                           .length = static_cast<std::size_t>(change.length),
+                           .text   = change.data});
+        }
+      }
+    }
+    return fixes;
   }
 
   auto clang_format_general::get_reporter() -> reporter_base_ptr {
+    // It may be called while files are still being checked.
+    auto lock = std::lock_guard{result_mutex};
     return std::make_unique<reporter_t>(option, result);
   }
 
@@ -15,8 +15,14 @@
  */
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
 #include <string>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "tools/base_reporter.h"
 #include "tools/base_tool.h"
@@ -46,16 +52,56 @@ namespace lint::tool::clang_format {
       return option.binary;
     }
 
-    auto check_single_file(const runtime_context &context,
-                           const std::string &root_dir,
-                           const std::string &file) const -> per_file_result;
+    virtual auto check_single_file(const runtime_context &context,
+                                   const std::string &root_dir,
+                                   const std::string &file,
+                                   const std::stop_token &token = {}) const -> per_file_result;
+
+    auto collect_files(const runtime_context &context) -> std::vector<std::string> override;
+
+    auto accepts(const std::string &file) -> bool override;
+
+    auto check_file(const runtime_context &context,
+                    const std::string &file,
+                    std::stop_source cancel) -> file_outcome override;
+
+    /// clang-format only keeps the file and its tokens in memory.
+    auto estimate_memory(std::uintmax_t file_size) -> std::uint64_t override {
+      constexpr auto baseline = std::uint64_t{32} << 20U;
+      constexpr auto per_byte = std::uint64_t{16};
+      return baseline + (per_byte * file_size);
+    }
+
+    auto estimate_duration(std::uintmax_t file_size) -> std::chrono::milliseconds override {
+      constexpr auto baseline       = std::chrono::milliseconds{20};
+      constexpr auto bytes_per_tick = std::uintmax_t{10000};
+      return baseline + std::chrono::milliseconds{file_size / bytes_per_tick};
+    }
 
     void check(const runtime_context &context) override;
 
+    auto dump_result() -> nlohmann::json override;
+
+    auto dump_result(const std::string &file) -> nlohmann::json override;
+
+    void reset_result() override;
+
+    void load_result(const nlohmann::json &json) override;
+
+    /// The replacements of failed files, which format them as a whole.
+    auto fixes(const runtime_context &context) -> replacements override;
+
     auto get_reporter() -> reporter_base_ptr override;
 
     option_t option;
     result_t result;
+
+    /// Protects result since files may be checked concurrently.
+    std::mutex result_mutex;
   };
 
+  /// Get the row and column which start from 1 of the offset which starts from
+  /// 0 by the length of each line. Returns {-1, -1} if it's out of range.
+  auto get_position(const std::vector<uint32_t> &lens, int offset) -> std::tuple<int32_t, int32_t>;
+
 } // namespace lint::tool::clang_format
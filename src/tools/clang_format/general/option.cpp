@@ -15,6 +15,7 @@
  */
 #include "tools/clang_format/general/option.h"
 
+#include <magic_enum/magic_enum.hpp>
 #include <spdlog/spdlog.h>
 
 namespace lint::tool::clang_format {
@@ -27,6 +28,7 @@ namespace lint::tool::clang_format {
     spdlog::debug("binary: {}", option.binary);
     spdlog::debug("file-filter-iregex: {}", option.file_filter_iregex);
     spdlog::debug("enable-warning-as-error: {}", option.enable_warning_as_error);
+    spdlog::debug("backend: {}", magic_enum::enum_name(option.backend));
     spdlog::debug("");
   }
 
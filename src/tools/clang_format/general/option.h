@@ -15,11 +15,20 @@
  */
 #pragma once
 
+#include <cstdint>
+
 #include "tools/base_option.h"
 
 namespace lint::tool::clang_format {
+  /// How files are formatted.
+  enum class backend_t : std::uint8_t {
+    binary,    // Run clang-format executable for each file.
+    libformat, // Call clang's libFormat in process. Requires ENABLE_LIBFORMAT.
+  };
+
   struct option_t : option_base {
     bool enable_warning_as_error = false;
+    backend_t backend            = backend_t::binary;
   };
 
   void print_option(const option_t& option);
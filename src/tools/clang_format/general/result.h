@@ -39,4 +39,10 @@ namespace lint::tool::clang_format {
   };
 
   using result_t = multi_files_result_base<per_file_result>;
+
+  // clang-format off
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(replacement_t, offset, length, data, row, col)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(per_file_result, passed, file_path, tool_stdout, tool_stderr,
+                                     file_option, peak_rss, replacements, formatted_source_code)
+  // clang-format on
 } // namespace lint::tool::clang_format
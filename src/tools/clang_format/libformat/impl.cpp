@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/clang_format/libformat/impl.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+
+#ifdef CPP_LINT_ACTION_WITH_LIBFORMAT
+#include <clang/Basic/Version.h>
+#include <clang/Format/Format.h>
+#include <clang/Tooling/Core/Replacement.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#endif
+
+namespace lint::tool::clang_format {
+#ifdef CPP_LINT_ACTION_WITH_LIBFORMAT
+  namespace {
+    // Same as the executable, use .clang-format file and fallback to LLVM.
+    constexpr auto default_style  = "file";
+    constexpr auto fallback_style = "LLVM";
+
+    auto get_line_lens(llvm::StringRef code) -> std::vector<uint32_t> {
+      auto lines = std::vector<uint32_t>{};
+      while (!code.empty()) {
+        auto [line, rest] = code.split('\n');
+        lines.emplace_back(line.size() + 1);
+        code = rest;
+      }
+      return lines;
+    }
+
+    // Same as clang-format executable: sort includes first, then format the
+    // sorted code and merge both changes.
+    auto sort_and_format(const clang::format::FormatStyle &style,
+                         llvm::StringRef code,
+                         llvm::StringRef path) -> llvm::Expected<clang::tooling::Replacements> {
+      auto ranges   = std::vector<clang::tooling::Range>{{0, static_cast<unsigned>(code.size())}};
+      auto cursor   = 0U;
+      auto includes = clang::format::sortIncludes(style, code, ranges, path, &cursor);
+      auto sorted   = clang::tooling::applyAllReplacements(code, includes);
+      if (!sorted) {
+        return sorted.takeError();
+      }
+      auto sorted_ranges = clang::tooling::calculateRangesAfterReplacements(includes, ranges);
+      auto formats       = clang::format::reformat(style, *sorted, sorted_ranges, path);
+      return includes.merge(formats);
+    }
+  } // namespace
+
+  auto clang_format_libformat::check_single_file(
+    [[maybe_unused]] const runtime_context &context,
+    const std::string &root_dir,
+    const std::string &file,
+    [[maybe_unused]] const std::stop_token &token) const -> per_file_result {
+    spdlog::trace("Enter clang_format_libformat::check_single_file()");
+
+    auto result        = per_file_result{};
+    result.file_path   = file;
+    result.file_option = file;
+
+    auto path   = fmt::format("{}/{}", root_dir, file);
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+      result.tool_stderr = buffer.getError().message();
+      return result;
+    }
+    auto code = (*buffer)->getBuffer();
+
+    auto format_style = clang::format::getStyle(default_style, path, fallback_style, code);
+    if (!format_style) {
+      result.tool_stderr = llvm::toString(format_style.takeError());
+      return result;
+    }
+    auto changes = sort_and_format(*format_style, code, path);
+    if (!changes) {
+      result.tool_stderr = llvm::toString(changes.takeError());
+      return result;
+    }
+
+    const auto lens = get_line_lens(code);
+    for (const auto &change: *changes) {
+      auto replacement   = replacement_t{};
+      replacement.offset = static_cast<int>(change.getOffset());
+      replacement.length = static_cast<int>(change.getLength());
+      replacement.data   = change.getReplacementText().str();
+
+      auto [row, col] = get_position(lens, replacement.offset);
+      replacement.row = row;
+      replacement.col = col;
+      result.replacements[row].emplace_back(std::move(replacement));
+    }
+    result.passed = result.replacements.empty();
+    return result;
+  }
+
+  auto libformat_version() -> std::string {
+    return CLANG_VERSION_STRING;
+  }
+
+  auto make_libformat_tool(option_t option) -> tool_base_ptr {
+    return std::make_unique<clang_format_libformat>(std::move(option));
+  }
+#else
+  namespace {
+    constexpr auto disabled = "cpp-lint-action isn't built with ENABLE_LIBFORMAT";
+  } // namespace
+
+  auto libformat_version() -> std::string {
+    throw std::runtime_error{disabled};
+  }
+
+  auto make_libformat_tool([[maybe_unused]] option_t option) -> tool_base_ptr {
+    throw std::runtime_error{disabled};
+  }
+#endif
+} // namespace lint::tool::clang_format
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "tools/clang_format/general/impl.h"
+
+namespace lint::tool::clang_format {
+  /// Formats files by clang's libFormat in process rather than spawning
+  /// clang-format for each file. Replacements are got from libFormat directly
+  /// without the XML round trip.
+  struct clang_format_libformat : clang_format_general {
+    explicit clang_format_libformat(option_t opt)
+      : clang_format_general(std::move(opt)) {
+    }
+
+    auto check_single_file(const runtime_context &context,
+                           const std::string &root_dir,
+                           const std::string &file,
+                           const std::stop_token &token = {}) const -> per_file_result override;
+
+    /// No process is spawned, only the file and its tokens are kept in memory.
+    auto estimate_memory(std::uintmax_t file_size) -> std::uint64_t override {
+      constexpr auto per_byte = std::uint64_t{16};
+      return per_byte * file_size;
+    }
+
+    auto estimate_duration(std::uintmax_t file_size) -> std::chrono::milliseconds override {
+      constexpr auto bytes_per_tick = std::uintmax_t{10000};
+      return std::chrono::milliseconds{file_size / bytes_per_tick};
+    }
+  };
+
+  /// The version of clang which libFormat comes from. Throws if
+  /// cpp-lint-action isn't built with ENABLE_LIBFORMAT.
+  auto libformat_version() -> std::string;
+
+  /// Create clang-format which uses libFormat. Throws if cpp-lint-action isn't
+  /// built with ENABLE_LIBFORMAT.
+  auto make_libformat_tool(option_t option) -> tool_base_ptr;
+} // namespace lint::tool::clang_format
@@ -17,8 +17,11 @@
 #include "tools/clang_tidy/clang_tidy.h"
 
 #include <boost/program_options.hpp>
+#include <magic_enum/magic_enum.hpp>
 
+#include "tools/clang_tidy/clangd/impl.h"
 #include "tools/clang_tidy/general/option.h"
+#include "tools/clang_tidy/libtidy/impl.h"
 #include "tools/clang_tidy/version/v18.h"
 #include "tools/util.h"
 
@@ -30,6 +33,9 @@ namespace lint::tool::clang_tidy {
     constexpr auto binary               = "clang-tidy-binary";
     constexpr auto file_iregex          = "clang-tidy-file-iregex";
     constexpr auto database             = "clang-tidy-database";
+    constexpr auto slice_database       = "clang-tidy-slice-database";
+    constexpr auto strip_flags          = "clang-tidy-strip-flags";
+    constexpr auto resolve_headers      = "clang-tidy-resolve-headers";
     constexpr auto allow_no_checks      = "clang-tidy-allow-no-checks";
     constexpr auto enable_check_profile = "clang-tidy-enable-check-profile";
     constexpr auto checks               = "clang-tidy-checks";
@@ -37,12 +43,14 @@ namespace lint::tool::clang_tidy {
     constexpr auto config_file          = "clang-tidy-config-file";
     constexpr auto header_filter        = "clang-tidy-header-filter";
     constexpr auto line_filter          = "clang-tidy-line-filter";
+    constexpr auto backend              = "clang-tidy-backend";
+    constexpr auto clangd_timeout       = "clang-tidy-clangd-timeout";
   } // namespace
 
   // Get version from clang-tidy output.
   // Example: Ubuntu LLVM version 18.1.3
   auto get_version(const std::string &binary) -> std::string {
-    auto [ec, std_out, std_err] = shell::execute(binary, {"--version"});
+    auto [ec, std_out, std_err, peak_rss, killed] = shell::execute(binary, {"--version"});
     if (ec != 0) {
       return "";
     }
@@ -61,7 +69,13 @@ namespace lint::tool::clang_tidy {
     const auto *bin    = value<std::string>()->value_name("path");
     const auto *iregex = value<std::string>()->value_name("iregex")->default_value(
       option.file_filter_iregex);
-    const auto *db = value<std::string>()->value_name("path")->default_value("build");
+    const auto *db   = value<std::vector<std::string>>()
+                       ->value_name("path")
+                       ->default_value(std::vector<std::string>{"build"}, "build")
+                       ->composing();
+    const auto *kind = value<std::string>()->value_name("backend")->default_value("binary");
+    const auto *secs = value<std::uint32_t>()->value_name("seconds")->default_value(
+      option.clangd_timeout);
 
     auto boolean = [](bool def) {
       return value<bool>()->value_name("bool")->default_value(def);
@@ -86,7 +100,19 @@ namespace lint::tool::clang_tidy {
                                                "Don't spefify both this option and the clang-format-version "
                                                "option to avoid ambigous")
       (file_iregex,           iregex,          "Set the source file filter for clang-format.")
-      (database,              db,              "Same as clang-tidy -p option")
+      (database,              db,              "Same as clang-tidy -p option. Could be specified many "
+                                               "times, then each file is checked with the database "
+                                               "having its command, or else the one having commands "
+                                               "nearest to it")
+      (slice_database,        boolean(true),   "Pass clang-tidy a compilation database which only holds "
+                                               "the commands of files being checked, so that loading it "
+                                               "doesn't slow down with the size of repository")
+      (strip_flags,           boolean(false),  "Drop the flags which don't affect analysis from the sliced "
+                                               "database, such as optimization, debug info, LTO, "
+                                               "sanitizers and profiling")
+      (resolve_headers,       boolean(false),  "Check a changed header through the cheapest translation "
+                                               "unit including it, which is found by the dependency "
+                                               "files (.d) under the database directory")
       (allow_no_checks,       boolean(false),  "Enabel clang-tidy allow_no_check option")
       (enable_check_profile,  boolean(false),  "Enabel clang-tidy enable_check_profile option")
       (checks,                str(),           "Same as clang-tidy checks option")
@@ -94,6 +120,14 @@ namespace lint::tool::clang_tidy {
       (config_file,           str(),           "Same as clang-tidy config-file option")
       (header_filter,         str(),           "Same as clang-tidy header-filter option")
       (line_filter,           str(),           "Same as clang-tidy line-filter option")
+      (backend,               kind,            "Set how files are checked. Supports: [binary, libtidy, "
+                                               "clangd]. libtidy checks files in process and shares "
+                                               "parsed files between them, requires building with "
+                                               "ENABLE_LIBTIDY. clangd keeps preambles of files between "
+                                               "checks, clang-tidy-version and clang-tidy-binary select "
+                                               "clangd then")
+      (clangd_timeout,        secs,            "Set how long clangd backend waits for the diagnostics of "
+                                               "a file, which fails once it's exceeded")
     ;
     // clang-format on
   }
@@ -110,32 +144,62 @@ namespace lint::tool::clang_tidy {
       option.enabled_fastly_exit = variables[enable_fastly_exit].as<bool>();
     }
 
-    // Get clang-tidy-binary
-    if (variables.contains(version)) {
-      program_options::must_not_specify("specify clang-tidy-version", variables, {binary});
-      auto user_input_version = variables[version].as<std::string>();
-      spdlog::debug("user inputs clang-tidy version: {}", user_input_version);
-
-      option.binary = find_clang_tool("clang-tidy", user_input_version);
-    } else if (variables.contains(binary)) {
-      program_options::must_not_specify("specify clang-tidy-binary", variables, {version});
+    if (variables.contains(backend)) {
+      auto name = variables[backend].as<std::string>();
+      auto kind = magic_enum::enum_cast<backend_t>(name);
+      throw_unless(kind.has_value(), fmt::format("unsupported clang-tidy backend: {}", name));
+      option.backend = *kind;
+    }
+    if (variables.contains(clangd_timeout)) {
+      option.clangd_timeout = variables[clangd_timeout].as<std::uint32_t>();
+    }
 
-      option.binary               = variables[binary].as<std::string>();
-      auto [ec, std_out, std_err] = shell::which(option.binary);
-      throw_unless(ec == 0, fmt::format("Can't find given clang-tidy binary: {}", option.binary));
+    if (option.backend == backend_t::libtidy) {
+      // clang-tidy is linked into us, so there's no binary to find.
+      program_options::must_not_specify("use libtidy backend", variables, {version, binary});
+      option.binary  = "libclang-tidy";
+      option.version = libtidy_version();
     } else {
-      auto [ec, std_out, std_err] = shell::which("clang-tidy");
-      throw_unless(ec == 0, "can't find clang-tidy");
-      option.binary = std_out;
-    }
+      // clangd runs clang-tidy checks by itself, so the binary is clangd.
+      const auto *tool_name = option.backend == backend_t::clangd ? "clangd" : "clang-tidy";
 
-    option.version = get_version(option.binary);
+      // Get clang-tidy-binary
+      if (variables.contains(version)) {
+        program_options::must_not_specify("specify clang-tidy-version", variables, {binary});
+        auto user_input_version = variables[version].as<std::string>();
+        spdlog::debug("user inputs clang-tidy version: {}", user_input_version);
+
+        option.binary = find_clang_tool(tool_name, user_input_version);
+      } else if (variables.contains(binary)) {
+        program_options::must_not_specify("specify clang-tidy-binary", variables, {version});
+
+        option.binary                                 = variables[binary].as<std::string>();
+        auto [ec, std_out, std_err, peak_rss, killed] = shell::which(option.binary);
+        throw_unless(ec == 0,
+                     fmt::format("Can't find given {} binary: {}", tool_name, option.binary));
+      } else {
+        auto [ec, std_out, std_err, peak_rss, killed] = shell::which(tool_name);
+        throw_unless(ec == 0, fmt::format("can't find {}", tool_name));
+        option.binary = std_out;
+      }
+
+      option.version = get_version(option.binary);
+    }
 
     if (variables.contains(file_iregex)) {
       option.file_filter_iregex = variables[file_iregex].as<std::string>();
     }
     if (variables.contains(database)) {
-      option.database = variables[database].as<std::string>();
+      option.databases = variables[database].as<std::vector<std::string>>();
+    }
+    if (variables.contains(slice_database)) {
+      option.slice_database = variables[slice_database].as<bool>();
+    }
+    if (variables.contains(strip_flags)) {
+      option.strip_flags = variables[strip_flags].as<bool>();
+    }
+    if (variables.contains(resolve_headers)) {
+      option.resolve_headers = variables[resolve_headers].as<bool>();
     }
     if (variables.contains(allow_no_checks)) {
       option.allow_no_checks = variables[allow_no_checks].as<bool>();
@@ -158,6 +222,23 @@ namespace lint::tool::clang_tidy {
     if (variables.contains(line_filter)) {
       option.line_filter = variables[line_filter].as<std::string>();
     }
+
+    // Flags are only stripped while slicing database for the executable.
+    throw_if(option.strip_flags && (!option.slice_database || option.backend != backend_t::binary),
+             "clang-tidy-strip-flags requires clang-tidy-slice-database and binary backend");
+    throw_if(option.resolve_headers && option.backend != backend_t::binary,
+             "clang-tidy-resolve-headers requires binary backend");
+
+    // clangd serves files with only one database.
+    throw_if(option.backend == backend_t::clangd && option.databases.size() > 1,
+             "clangd backend only supports one clang-tidy-database");
+
+    // clangd reads checks from .clang-tidy files and can't be told others.
+    if (option.backend == backend_t::clangd) {
+      throw_unless(option.checks.empty() && option.config.empty() && option.config_file.empty()
+                     && option.header_filter.empty() && option.line_filter.empty(),
+                   "clangd backend only supports checks configured by .clang-tidy files");
+    }
   }
 
   auto creator::create_tool(const program_options::variables_map &variables) -> tool_base_ptr {
@@ -170,7 +251,11 @@ namespace lint::tool::clang_tidy {
 
     auto version = option.version;
     auto tool    = tool_base_ptr{};
-    if (version == version_18_1_3) {
+    if (option.backend == backend_t::libtidy) {
+      tool = make_libtidy_tool(option);
+    } else if (option.backend == backend_t::clangd) {
+      tool = make_clangd_tool(option);
+    } else if (version == version_18_1_3) {
       tool = std::make_unique<clang_tidy_v18_1_3>(option);
     } else if (version == version_18_1_0) {
       tool = std::make_unique<clang_tidy_v18_1_0>(option);
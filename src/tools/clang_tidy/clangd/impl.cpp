@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/clang_tidy/clangd/impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+#include "utils/std.h"
+
+namespace lint::tool::clang_tidy {
+  namespace {
+    // See DiagnosticSeverity of LSP.
+    auto severity(int level) -> std::string {
+      switch (level) {
+      case 1 : return "error";
+      case 2 : return "warning";
+      case 3 : return "note";
+      default: return "remark";
+      }
+    }
+
+    // clangd names compiler warnings by their flags such as -Wunused, while
+    // clang-tidy executable names them clang-diagnostic-unused.
+    auto diagnostic_name(const nlohmann::json &diag) -> std::string {
+      auto code = diag.contains("code") && diag["code"].is_string()
+                  ? diag["code"].get<std::string>()
+                  : std::string{};
+      if (code.starts_with("-W")) {
+        return "clang-diagnostic-" + code.substr(2);
+      }
+      if (code.empty() && diag.value("severity", 0) == 1) {
+        return "clang-diagnostic-error";
+      }
+      return code;
+    }
+
+    auto read_file(const std::filesystem::path &path) -> std::string {
+      auto file = std::ifstream{path, std::ios::binary};
+      throw_unless(file.is_open(), fmt::format("open {} failed", path.string()));
+      return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+  } // namespace
+
+  clang_tidy_clangd::clang_tidy_clangd(option_t opt)
+    : clang_tidy_general(std::move(opt)) {
+  }
+
+  auto clang_tidy_clangd::check_single_file([[maybe_unused]] const runtime_context &context,
+                                            const std::string &root_dir,
+                                            const std::string &file,
+                                            [[maybe_unused]] const std::stop_token &token) const
+    -> per_file_result {
+    spdlog::trace("Enter clang_tidy_clangd::check_single_file");
+
+    std::call_once(started_, [&] {
+      auto database = std::filesystem::path{root_dir} / source_database_of(file);
+      auto args     = std::vector<std::string>{
+        "--clang-tidy",
+        fmt::format("--compile-commands-dir={}", database.string()),
+        fmt::format("-j={}", std::max(std::thread::hardware_concurrency(), 1U)),
+        "--background-index=false",
+        "--pch-storage=memory",
+        "--log=error"};
+      spdlog::info("Starting clangd: {} {}", option.binary, concat(args, ' '));
+      session_ = std::make_unique<clangd_session>(option.binary, args, root_dir);
+    });
+
+    auto path        = std::filesystem::path{root_dir} / file;
+    auto timeout     = std::chrono::seconds{option.clangd_timeout};
+    auto diagnostics = session_->diagnose(path.string(), read_file(path), timeout);
+    if (!diagnostics) {
+      // A worker shouldn't be blocked forever by a file which clangd skips.
+      auto result        = per_file_result{};
+      result.passed      = false;
+      result.file_path   = file;
+      result.file_option = file;
+      result.tool_stderr = fmt::format("clangd didn't publish diagnostics of {} within {}s",
+                                       file,
+                                       option.clangd_timeout);
+      spdlog::error(result.tool_stderr);
+      return result;
+    }
+    return make_result(file, *diagnostics);
+  }
+
+  auto make_result(const std::string &file, const nlohmann::json &diagnostics) -> per_file_result {
+    auto result        = per_file_result{};
+    result.passed      = true;
+    result.file_path   = file;
+    result.file_option = file;
+    for (const auto &published: diagnostics) {
+      // LSP counts rows and columns from 0.
+      const auto &start = published["range"]["start"];
+      auto level        = published.value("severity", 1);
+      auto name         = diagnostic_name(published);
+
+      // Notes are appended to message by clangd after the first line.
+      auto message = published.value("message", std::string{});
+      auto brief   = std::string_view{message}.substr(0, message.find('\n'));
+
+      auto diag                   = diagnostic{};
+      diag.header.file_name       = file;
+      diag.header.row_idx         = std::to_string(start.value("line", 0) + 1);
+      diag.header.col_idx         = std::to_string(start.value("character", 0) + 1);
+      diag.header.serverity       = severity(level);
+      diag.header.brief           = fmt::format(" {} ", brief);
+      diag.header.diagnostic_type = name.empty() ? "" : fmt::format("[{}]", name);
+      if (brief.size() < message.size()) {
+        diag.details = message.substr(brief.size() + 1) + "\n";
+      }
+
+      // Keep the same output as clang-tidy executable for reporters.
+      result.tool_stdout += fmt::format("{}:{}:{}: {}:{}{}\n{}",
+                                        diag.header.file_name,
+                                        diag.header.row_idx,
+                                        diag.header.col_idx,
+                                        diag.header.serverity,
+                                        diag.header.brief,
+                                        diag.header.diagnostic_type,
+                                        diag.details);
+
+      if (level == 1) {
+        ++result.stat.errors;
+        result.passed = false;
+      } else if (level == 2) {
+        ++result.stat.warnings;
+      }
+      result.diags.push_back(std::move(diag));
+    }
+    return result;
+  }
+
+  auto make_clangd_tool(option_t option) -> tool_base_ptr {
+    return std::make_unique<clang_tidy_clangd>(std::move(option));
+  }
+} // namespace lint::tool::clang_tidy
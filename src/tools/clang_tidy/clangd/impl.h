@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "tools/clang_tidy/clangd/session.h"
+#include "tools/clang_tidy/general/impl.h"
+
+namespace lint::tool::clang_tidy {
+  /// Runs clang-tidy checks by a clangd which is started at the first check
+  /// and lives as long as this tool. clangd keeps the preambles of recently
+  /// checked files, so checking a file again after editing it only re-parses
+  /// the file itself rather than all its headers. clangd reads checks from
+  /// .clang-tidy files, so the check options of clang-tidy aren't supported.
+  struct clang_tidy_clangd : clang_tidy_general {
+    explicit clang_tidy_clangd(option_t opt);
+
+    auto check_single_file(const runtime_context &context,
+                           const std::string &root_dir,
+                           const std::string &file,
+                           const std::stop_token &token = {}) const -> per_file_result override;
+
+    /// Most memory is taken by the clangd process rather than each check.
+    auto estimate_memory(std::uintmax_t file_size) -> std::uint64_t override {
+      constexpr auto baseline = std::uint64_t{64} << 20U;
+      constexpr auto per_byte = std::uint64_t{256};
+      return baseline + (per_byte * file_size);
+    }
+
+  private:
+    mutable std::once_flag started_;
+    mutable std::unique_ptr<clangd_session> session_;
+  };
+
+  /// Convert diagnostics published by clangd for file into the result.
+  auto make_result(const std::string &file, const nlohmann::json &diagnostics) -> per_file_result;
+
+  /// Create clang-tidy which is run by clangd.
+  auto make_clangd_tool(option_t option) -> tool_base_ptr;
+} // namespace lint::tool::clang_tidy
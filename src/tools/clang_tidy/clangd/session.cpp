@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/clang_tidy/clangd/session.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <csignal>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#define BOOST_PROCESS_V2_SEPARATE_COMPILATION
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/readable_pipe.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/writable_pipe.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/process/v2.hpp>
+#include <boost/process/v2/start_dir.hpp>
+
+#include "utils/error.h"
+
+namespace lint::tool::clang_tidy {
+  namespace bp = boost::process::v2;
+
+  namespace {
+    constexpr auto header_end     = std::string_view{"\r\n\r\n"};
+    constexpr auto length_field   = std::string_view{"Content-Length:"};
+    constexpr auto shutdown_reply = std::chrono::seconds{5};
+
+    auto notification(const std::string &method, nlohmann::json params) -> nlohmann::json {
+      auto message       = nlohmann::json::object();
+      message["jsonrpc"] = "2.0";
+      message["method"]  = method;
+      message["params"]  = std::move(params);
+      return message;
+    }
+
+    auto language_of(std::string_view path) -> std::string {
+      return path.ends_with(".c") ? "c" : "cpp";
+    }
+  } // namespace
+
+  auto frame(const nlohmann::json &message) -> std::string {
+    auto content = message.dump();
+    return fmt::format("Content-Length: {}\r\n\r\n{}", content.size(), content);
+  }
+
+  auto content_length(std::string_view header) -> std::size_t {
+    auto pos = header.find(length_field);
+    if (pos == std::string_view::npos) {
+      return 0;
+    }
+    auto value = header.substr(pos + length_field.size());
+    while (value.starts_with(' ')) {
+      value.remove_prefix(1);
+    }
+    auto length = std::size_t{0};
+    std::from_chars(value.data(), value.data() + value.size(), length);
+    return length;
+  }
+
+  auto to_uri(std::string_view path) -> std::string {
+    // Only the characters which are reserved by uri are escaped.
+    auto uri = std::string{"file://"};
+    for (auto c: path) {
+      auto u = static_cast<unsigned char>(c);
+      if (std::isalnum(u) != 0 || std::string_view{"/-._~+"}.find(c) != std::string_view::npos) {
+        uri += c;
+      } else {
+        uri += fmt::format("%{:02X}", u);
+      }
+    }
+    return uri;
+  }
+
+  struct clangd_session::process {
+    process(const std::string &binary,
+            const std::vector<std::string> &args,
+            const std::string &root)
+      : in(io)
+      , out(io)
+      , proc(io,
+             binary,
+             args,
+             bp::process_stdio{.in = in, .out = out, .err = nullptr},
+             bp::process_start_dir{root}) {
+    }
+
+    boost::asio::io_context io;
+    boost::asio::writable_pipe in;
+    boost::asio::readable_pipe out;
+    bp::process proc;
+  };
+
+  clangd_session::clangd_session(const std::string &binary,
+                                 const std::vector<std::string> &args,
+                                 const std::string &root,
+                                 std::size_t max_open_files)
+    : process_(std::make_unique<process>(binary, args, root))
+    , max_open_files_(std::max<std::size_t>(max_open_files, 1)) {
+    spdlog::trace("Enter clangd_session::clangd_session");
+    reader_ = std::thread{[this] { read_loop(); }};
+    writer_ = std::thread{[this] { write_loop(); }};
+
+    // Diagnostics are only waited for the version of content we sent, and
+    // columns are counted by bytes as the same as clang-tidy.
+    auto capabilities = nlohmann::json::object();
+
+    capabilities["textDocument"]["publishDiagnostics"]["versionSupport"] = true;
+    capabilities["general"]["positionEncodings"]                         = {"utf-8"};
+    capabilities["offsetEncoding"]                                       = {"utf-8"};
+
+    auto params            = nlohmann::json::object();
+    params["processId"]    = ::getpid();
+    params["rootUri"]      = to_uri(root);
+    params["capabilities"] = std::move(capabilities);
+    try {
+      request("initialize", std::move(params)).get();
+    } catch (...) {
+      close();
+      throw;
+    }
+    send(notification("initialized", nlohmann::json::object()));
+  }
+
+  clangd_session::~clangd_session() {
+    spdlog::trace("Enter clangd_session::~clangd_session");
+    try {
+      auto reply = request("shutdown", nullptr);
+      if (reply.wait_for(shutdown_reply) == std::future_status::ready) {
+        send(notification("exit", nullptr));
+      }
+    } catch (const std::exception &err) {
+      spdlog::debug("shutdown clangd failed: {}", err.what());
+    }
+
+    close();
+  }
+
+  void clangd_session::close() {
+    {
+      auto lock = std::lock_guard{mutex_};
+      closing_  = true;
+    }
+    posted_.notify_one();
+
+    // clangd exits once its stdin is closed by writer, which also stops reader.
+    writer_.join();
+    reader_.join();
+    auto ec = boost::system::error_code{};
+    process_->proc.wait(ec);
+  }
+
+  auto clangd_session::diagnose(const std::string &path,
+                                const std::string &content,
+                                std::chrono::milliseconds timeout)
+    -> std::optional<nlohmann::json> {
+    spdlog::trace("Enter clangd_session::diagnose");
+    auto uri     = to_uri(path);
+    auto future  = std::future<nlohmann::json>{};
+    auto version = std::int64_t{0};
+    {
+      auto lock = std::lock_guard{mutex_};
+      throw_if(exited_, "clangd exited");
+
+      auto [it, opened] = versions_.try_emplace(uri, 0);
+      version           = ++it->second;
+      auto &waiting     = waiters_[uri];
+      waiting.version   = version;
+      waiting.promise   = std::promise<nlohmann::json>{};
+      future            = waiting.promise.get_future();
+
+      auto params                       = nlohmann::json::object();
+      params["textDocument"]["uri"]     = uri;
+      params["textDocument"]["version"] = version;
+      if (opened) {
+        params["textDocument"]["languageId"] = language_of(path);
+        params["textDocument"]["text"]       = content;
+        post(notification("textDocument/didOpen", std::move(params)));
+      } else {
+        // clangd keeps the preamble if the includes of content aren't changed.
+        params["contentChanges"] = nlohmann::json::array({{{"text", content}}});
+        post(notification("textDocument/didChange", std::move(params)));
+        recent_.remove(uri);
+      }
+      recent_.push_front(uri);
+
+      // Close the least recently checked files which aren't being diagnosed.
+      auto iter = recent_.end();
+      while (recent_.size() > max_open_files_ && iter != recent_.begin()) {
+        --iter;
+        if (waiters_.contains(*iter)) {
+          continue;
+        }
+        auto params                   = nlohmann::json::object();
+        params["textDocument"]["uri"] = *iter;
+        post(notification("textDocument/didClose", std::move(params)));
+        versions_.erase(*iter);
+        iter = recent_.erase(iter);
+      }
+    }
+
+    if (future.wait_for(timeout) != std::future_status::ready) {
+      // The diagnostics may be published right after the wait, then they're
+      // taken rather than dropped.
+      auto lock = std::lock_guard{mutex_};
+      auto it   = waiters_.find(uri);
+      if (it != waiters_.end() && it->second.version == version) {
+        waiters_.erase(it);
+        return std::nullopt;
+      }
+    }
+    return future.get();
+  }
+
+  void clangd_session::post(const nlohmann::json &message) {
+    outgoing_.push_back(frame(message));
+    posted_.notify_one();
+  }
+
+  void clangd_session::send(const nlohmann::json &message) {
+    auto lock = std::lock_guard{mutex_};
+    post(message);
+  }
+
+  auto clangd_session::request(const std::string &method, nlohmann::json params)
+    -> std::future<nlohmann::json> {
+    auto lock = std::lock_guard{mutex_};
+    throw_if(exited_, "clangd exited");
+    auto message  = notification(method, std::move(params));
+    message["id"] = next_id_;
+    post(message);
+    return responses_[next_id_++].get_future();
+  }
+
+  void clangd_session::read_loop() {
+    auto buffer = boost::asio::streambuf{};
+    try {
+      while (true) {
+        auto header_size = boost::asio::read_until(process_->out, buffer, header_end);
+        auto header      = std::string{boost::asio::buffers_begin(buffer.data()),
+                                  boost::asio::buffers_begin(buffer.data()) + header_size};
+        buffer.consume(header_size);
+
+        auto length = content_length(header);
+        if (buffer.size() < length) {
+          boost::asio::read(
+            process_->out, buffer, boost::asio::transfer_exactly(length - buffer.size()));
+        }
+        auto content = std::string{boost::asio::buffers_begin(buffer.data()),
+                                   boost::asio::buffers_begin(buffer.data()) + length};
+        buffer.consume(length);
+        dispatch(nlohmann::json::parse(content));
+      }
+    } catch (const std::exception &err) {
+      spdlog::debug("stop reading clangd: {}", err.what());
+    }
+
+    // Nothing would be published any more, wake up all waiters.
+    auto lock   = std::lock_guard{mutex_};
+    exited_     = true;
+    auto exited = std::make_exception_ptr(std::runtime_error{"clangd exited"});
+    for (auto &[_, waiting]: waiters_) {
+      waiting.promise.set_exception(exited);
+    }
+    for (auto &[_, promise]: responses_) {
+      promise.set_exception(exited);
+    }
+    waiters_.clear();
+    responses_.clear();
+  }
+
+  void clangd_session::write_loop() {
+    // Writing to an exited clangd should fail rather than kill us.
+    auto signals = sigset_t{};
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+      while (true) {
+        auto lock = std::unique_lock{mutex_};
+        posted_.wait(lock, [this] { return closing_ || !outgoing_.empty(); });
+        if (outgoing_.empty()) {
+          break;
+        }
+        auto data = std::move(outgoing_.front());
+        outgoing_.pop_front();
+        lock.unlock();
+        boost::asio::write(process_->in, boost::asio::buffer(data));
+      }
+    } catch (const std::exception &err) {
+      spdlog::debug("stop writing clangd: {}", err.what());
+    }
+    auto ec = boost::system::error_code{};
+    process_->in.close(ec);
+  }
+
+  void clangd_session::dispatch(const nlohmann::json &message) {
+    auto method = message.value("method", std::string{});
+    if (method.empty()) {
+      // A response of our request.
+      auto id   = message.value("id", std::int64_t{-1});
+      auto lock = std::lock_guard{mutex_};
+      auto it   = responses_.find(id);
+      if (it == responses_.end()) {
+        return;
+      }
+      if (message.contains("error")) {
+        auto error = message["error"].value("message", std::string{"unknown error"});
+        it->second.set_exception(std::make_exception_ptr(std::runtime_error{error}));
+      } else {
+        it->second.set_value(message.value("result", nlohmann::json{}));
+      }
+      responses_.erase(it);
+      return;
+    }
+
+    if (message.contains("id")) {
+      // clangd asks us something such as workDoneProgress/create. We don't
+      // support any of them, but reply so that it doesn't wait.
+      auto reply       = nlohmann::json::object();
+      reply["jsonrpc"] = "2.0";
+      reply["id"]      = message["id"];
+      reply["result"]  = nullptr;
+      send(reply);
+      return;
+    }
+
+    if (method != "textDocument/publishDiagnostics") {
+      return;
+    }
+    const auto &params = message["params"];
+    auto uri           = params.value("uri", std::string{});
+    auto lock          = std::lock_guard{mutex_};
+    auto it            = waiters_.find(uri);
+    if (it == waiters_.end()) {
+      return;
+    }
+    // Diagnostics of an older content may come after we sent the newer one.
+    if (params.value("version", it->second.version) < it->second.version) {
+      return;
+    }
+    it->second.promise.set_value(params.value("diagnostics", nlohmann::json::array()));
+    waiters_.erase(it);
+  }
+} // namespace lint::tool::clang_tidy
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace lint::tool::clang_tidy {
+  /// Frame a message by the base protocol of LSP.
+  auto frame(const nlohmann::json &message) -> std::string;
+
+  /// Get the Content-Length of the header part of a message. Returns 0 if
+  /// there isn't.
+  auto content_length(std::string_view header) -> std::size_t;
+
+  /// Convert an absolute path to the uri used by LSP.
+  auto to_uri(std::string_view path) -> std::string;
+
+  /// A clangd process which we talk with by LSP over its stdio. Files are kept
+  /// open in clangd after being checked, so their preambles are reused when
+  /// they are checked again during the lifetime of session. Only the recently
+  /// checked files are kept open to bound the memory of clangd.
+  class clangd_session {
+  public:
+    /// Start clangd in root and initialize it. Throws on failure.
+    clangd_session(const std::string &binary,
+                   const std::vector<std::string> &args,
+                   const std::string &root,
+                   std::size_t max_open_files = 64);
+    ~clangd_session();
+
+    clangd_session(const clangd_session &)            = delete;
+    clangd_session &operator=(const clangd_session &) = delete;
+    clangd_session(clangd_session &&)                 = delete;
+    clangd_session &operator=(clangd_session &&)      = delete;
+
+    /// Send the content of file to clangd and wait for the diagnostics it
+    /// publishes for this content. Files could be diagnosed concurrently, but
+    /// the same file couldn't. Returns nullopt if clangd doesn't publish them
+    /// within timeout, e.g. it skips the file. Throws if clangd exits.
+    auto diagnose(const std::string &path,
+                  const std::string &content,
+                  std::chrono::milliseconds timeout) -> std::optional<nlohmann::json>;
+
+  private:
+    struct process;
+
+    struct waiter {
+      std::int64_t version = 0;
+      std::promise<nlohmann::json> promise;
+    };
+
+    /// Queue message to be written by writer. mutex_ must be held, so that
+    /// messages are written in the order they are decided.
+    void post(const nlohmann::json &message);
+
+    void send(const nlohmann::json &message);
+
+    auto request(const std::string &method, nlohmann::json params) -> std::future<nlohmann::json>;
+
+    void read_loop();
+
+    void write_loop();
+
+    void close();
+
+    void dispatch(const nlohmann::json &message);
+
+    std::unique_ptr<process> process_;
+    std::size_t max_open_files_;
+
+    std::mutex mutex_;
+    std::condition_variable posted_;
+    std::deque<std::string> outgoing_;
+    bool closing_ = false;
+    std::int64_t next_id_ = 0;
+    std::unordered_map<std::int64_t, std::promise<nlohmann::json>> responses_;
+    std::unordered_map<std::string, waiter> waiters_;
+    std::unordered_map<std::string, std::int64_t> versions_; // Open files.
+    std::list<std::string> recent_;                          // Open files, the latest first.
+    bool exited_ = false;
+
+    // Nobody else blocks on the pipes of clangd, so a full pipe never blocks
+    // the other direction.
+    std::thread reader_;
+    std::thread writer_;
+  };
+} // namespace lint::tool::clang_tidy
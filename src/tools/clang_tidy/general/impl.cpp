@@ -15,19 +15,29 @@
  */
 #include "tools/clang_tidy/general/impl.h"
 
+#include <atomic>
 #include <cctype>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iterator>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <unordered_set>
 #include <vector>
 
+#include <unistd.h>
+
 #include <boost/regex.hpp>
 #include <spdlog/spdlog.h>
 #include <tinyxml2.h>
 
+#include "remote/coordinator.h"
 #include "tools/clang_tidy/general/reporter.h"
 #include "utils/common.h"
+#include "utils/hash.h"
 #include "utils/shell.h"
 
 namespace lint::tool::clang_tidy {
@@ -80,13 +90,20 @@ namespace lint::tool::clang_tidy {
       return header;
     }
 
-    auto execute(const option_t &option, std::string_view repo, std::string_view file)
-      -> std::tuple<shell::result, std::string> {
+    auto execute(const runtime_context &context,
+                 const option_t &option,
+                 const std::string &source,
+                 const std::string &database,
+                 const std::string &repo,
+                 const std::string &file,
+                 const std::string &header_filter,
+                 const std::string &fixes_file,
+                 const std::stop_token &token) -> std::tuple<shell::result, std::string> {
       spdlog::trace("Enter execute()");
 
       auto opts = std::vector<std::string>{};
-      if (!option.database.empty()) {
-        opts.emplace_back(fmt::format("-p={}", option.database));
+      if (!source.empty()) {
+        opts.emplace_back(fmt::format("-p={}", source));
       }
       if (!option.checks.empty()) {
         opts.emplace_back(fmt::format("-checks={}", option.checks));
@@ -103,8 +120,8 @@ namespace lint::tool::clang_tidy {
       if (option.enable_check_profile) {
         opts.emplace_back("--enable-check-profile");
       }
-      if (!option.header_filter.empty()) {
-        opts.emplace_back(fmt::format("--header-filter={}", option.header_filter));
+      if (!header_filter.empty()) {
+        opts.emplace_back(fmt::format("--header-filter={}", header_filter));
       }
       if (!option.line_filter.empty()) {
         opts.emplace_back(fmt::format("--line-filter={}", option.line_filter));
@@ -112,10 +129,85 @@ namespace lint::tool::clang_tidy {
 
       opts.emplace_back(file);
 
+      // A sliced database is temporary, so the command is shown with the
+      // whole one to be reproducible.
       auto arg_str = concat(opts, ' ');
-      spdlog::info("Running command: {} {}", option.binary, arg_str);
+      if (!fixes_file.empty()) {
+        opts.insert(opts.end() - 1, fmt::format("--export-fixes={}", fixes_file));
+      }
+      if (database != source) {
+        opts.front() = fmt::format("-p={}", database);
+      }
+      spdlog::info("Running command: {} {}", option.binary, concat(opts, ' '));
+
+      return {remote::execute(context, option.binary, opts, repo, file, token), arg_str};
+    }
+
+    auto escape_regex(std::string_view str) -> std::string {
+      auto escaped = std::string{};
+      for (auto c: str) {
+        if (std::string_view{R"(\^$.|?*+()[]{})"}.find(c) != std::string_view::npos) {
+          escaped += '\\';
+        }
+        escaped += c;
+      }
+      return escaped;
+    }
+
+    // Keep the diagnostics of clang-tidy output in the files accepted by the
+    // predicate, with their details.
+    auto filter_stdout(std::string_view std_out, const auto &accepts) -> std::string {
+      auto filtered = std::string{};
+      auto keeping  = false;
+      for (auto part: ranges::views::split(std_out, '\n')) {
+        auto line = ranges::to<std::string>(part);
+        if (auto header = parse_diagnostic_header(line); header) {
+          keeping = accepts(header->file_name);
+        }
+        if (keeping) {
+          filtered += line;
+          filtered += '\n';
+        }
+      }
+      return filtered;
+    }
 
-      return {shell::execute(option.binary, opts, repo), arg_str};
+    // Identify a diagnostic by its location, check and message, so that the
+    // same finding in a header reported by many units is recognized.
+    auto fingerprint(const diagnostic &diag) -> std::uint64_t {
+      const auto &header = diag.header;
+      auto file = std::filesystem::path{header.file_name}.lexically_normal().string();
+      return stable_hash(fmt::format("{}\n{}\n{}\n{}\n{}",
+                                     file,
+                                     header.row_idx,
+                                     header.col_idx,
+                                     header.diagnostic_type,
+                                     header.brief));
+    }
+
+    // Read and remove the fixes exported by clang-tidy. Files inside the
+    // root are made relative to it like the checked files.
+    auto take_fixes(const std::string &fixes_file, const std::filesystem::path &root)
+      -> replacements {
+      auto file = std::ifstream{fixes_file, std::ios::binary};
+      if (!file.is_open()) {
+        // Nothing is exported if there is no diagnostic.
+        return {};
+      }
+      auto yaml = std::string{std::istreambuf_iterator<char>{file}, {}};
+      file.close();
+      auto ec = std::error_code{};
+      std::filesystem::remove(fixes_file, ec);
+
+      auto fixes = parse_exported_fixes(yaml);
+      for (auto &fix: fixes) {
+        auto path = std::filesystem::path{fix.file}.lexically_normal();
+        auto rel  = path.lexically_relative(root);
+        if (!rel.empty() && *rel.begin() != "..") {
+          fix.file = rel.string();
+        }
+      }
+      return fixes;
     }
 
     auto parse_stdout(std::string_view std_out) -> diagnostics {
@@ -229,66 +321,574 @@ namespace lint::tool::clang_tidy {
   } // namespace
 
   auto clang_tidy_general::check_single_file(
-    [[maybe_unused]] const runtime_context &context,
+    const runtime_context &context,
     const std::string &root_dir,
-    const std::string &file) const -> per_file_result {
+    const std::string &file,
+    const std::stop_token &token) const -> per_file_result {
     spdlog::trace("Enter clang_tidy_general::check_single_file");
 
-    auto [res, failed_command] = execute(option, root_dir, file);
+    // A header is checked through a unit including it, and only diagnostics
+    // in the header are reported.
+    auto unit   = unit_of(file);
+    auto filter = unit.empty() ? option.header_filter : fmt::format("(^|/){}$", escape_regex(file));
+    auto fixes_file = context.fix_mode == fix_mode_t::none ? std::string{} : fixes_file_of(file);
+    auto [res, failed_command] = execute(context,
+                                         option,
+                                         source_database_of(file),
+                                         database_of(file),
+                                         root_dir,
+                                         unit.empty() ? file : unit,
+                                         filter,
+                                         fixes_file,
+                                         token);
 
     auto result        = per_file_result{};
     result.passed      = res.exit_code == 0;
     result.diags       = parse_stdout(res.std_out);
     result.tool_stdout = res.std_out;
+    if (!unit.empty()) {
+      auto header        = (std::filesystem::path{root_dir} / file).lexically_normal();
+      result.tool_stdout = filter_stdout(res.std_out, [&](std::string_view name) {
+        return (std::filesystem::path{root_dir} / name).lexically_normal() == header;
+      });
+      result.diags       = parse_stdout(result.tool_stdout);
+      result.passed      = res.exit_code == 0 || result.diags.empty();
+    }
     result.tool_stderr = res.std_err;
     result.file_path   = file;
     result.file_option = failed_command;
+    result.peak_rss    = res.peak_rss;
+    result.killed      = res.killed;
+    if (!fixes_file.empty()) {
+      auto root    = std::filesystem::path{root_dir}.lexically_normal();
+      result.fixes = take_fixes(fixes_file, root);
+      if (!unit.empty()) {
+        // The unit itself is checked by its own.
+        std::erase_if(result.fixes, [&](const replacement &fix) { return fix.file != file; });
+      }
+    }
     return result;
   }
 
-  void clang_tidy_general::check(const runtime_context &context) {
-    spdlog::trace("Enter clang_tidy_general::check");
+  auto clang_tidy_general::collect_files(const runtime_context &context)
+    -> std::vector<std::string> {
+    spdlog::trace("Enter clang_tidy_general::collect_files");
     assert(!option.binary.empty() && "clang-tidy binary is empty");
     assert(!context.repo_path.empty() && "the repo_path of context is empty");
 
-    const auto root_dir = context.repo_path;
-    const auto files    = context.changed_files;
+    auto files = std::vector<std::string>{};
+    {
+      auto lock           = std::lock_guard{result_mutex};
+      result.final_passed = true;
+
+      for (const auto &file: context.changed_files) {
+        const auto &delta = context.deltas.at(file);
+        if (delta.status == GIT_DELTA_DELETED) {
+          continue;
+        }
+        if (!accepts(file)) {
+          // Files are collected again for each request of the daemon.
+          if (!ranges::contains(result.ignored, file)) {
+            result.ignored.push_back(file);
+          }
+          spdlog::debug("file {} is ignored by {}", file, option.binary);
+          continue;
+        }
+        files.push_back(file);
+      }
+    }
+
+    prepare_database(context, files);
+    auto lock       = std::lock_guard{slice_mutex};
+    collected_files = {files.begin(), files.end()};
+    return files;
+  }
+
+  void clang_tidy_general::use_history(const history &records) {
+    auto lock    = std::lock_guard{slice_mutex};
+    cost_records = &records;
+  }
+
+  void clang_tidy_general::prepare_database(const runtime_context &context,
+                                            const std::vector<std::string> &files) {
+    spdlog::trace("Enter clang_tidy_general::prepare_database");
+    // Only the executable loads database for each file, and remote workers
+    // can't see our temporary directory.
+    auto binary    = option.backend == backend_t::binary;
+    auto routing   = option.databases.size() > 1;
+    auto slicing   = option.slice_database && binary && !context.remote;
+    auto resolving = option.resolve_headers && binary;
+    if (option.databases.empty() || files.empty() || (!routing && !slicing && !resolving)) {
+      return;
+    }
+
+    auto root = std::filesystem::path{context.repo_path};
+    auto lock = std::lock_guard{slice_mutex};
+    try {
+      // Every file of repository is prepared right before being checked when
+      // scanning, so files are routed on the fly instead of being recorded,
+      // and nothing is resolved or sliced, which would be kept for all files.
+      if (context.scan_all) {
+        if (routing) {
+          open_databases(root);
+        }
+        return;
+      }
+      open_databases(root);
+      route_files(root, files);
+      if (resolving) {
+        resolve_headers(root, files);
+      }
+      if (slicing) {
+        slice_database(root, files);
+      }
+    } catch (const std::exception &err) {
+      spdlog::warn("Failed to prepare compilation database: {}", err.what());
+    }
+  }
+
+  void clang_tidy_general::open_databases(const std::filesystem::path &root) {
+    database_root = root;
+    database_indexes.resize(option.databases.size());
+    for (auto idx = std::size_t{0}; idx < option.databases.size(); ++idx) {
+      // The daemon and watch modes keep databases across runs, which may be
+      // regenerated meanwhile.
+      auto json   = (root / option.databases[idx] / "compile_commands.json").lexically_normal();
+      auto &index = database_indexes[idx];
+      if (!index || index->json_file() != json.string() || index->stale()) {
+        index = std::make_unique<compile_db>(json.string());
+      }
+    }
+  }
+
+  auto clang_tidy_general::route(const std::filesystem::path &path) const -> std::size_t {
+    for (auto idx = std::size_t{0}; idx < database_indexes.size(); ++idx) {
+      if (database_indexes[idx]->contains(path.string())) {
+        return idx;
+      }
+    }
+
+    // A file without command, such as a header, belongs to the database
+    // having commands in its nearest directory.
+    for (auto directory = path.parent_path(); !directory.empty();
+         directory      = directory.parent_path()) {
+      for (auto idx = std::size_t{0}; idx < database_indexes.size(); ++idx) {
+        if (database_indexes[idx]->contains_directory(directory.string())) {
+          return idx;
+        }
+      }
+      if (directory == directory.root_path()) {
+        break;
+      }
+    }
+    return 0;
+  }
+
+  void clang_tidy_general::route_files(const std::filesystem::path &root,
+                                       const std::vector<std::string> &files) {
+    auto routed = std::vector<std::size_t>(option.databases.size(), 0);
     for (const auto &file: files) {
-      const auto &delta = context.deltas.at(file);
-      if (delta.status == GIT_DELTA_DELETED) {
+      auto idx           = route((root / file).lexically_normal());
+      database_ids[file] = idx;
+      ++routed[idx];
+    }
+    // A single file is prepared for each check when watching.
+    auto level = files.size() > 1 ? spdlog::level::info : spdlog::level::debug;
+    for (auto idx = std::size_t{0}; idx < routed.size(); ++idx) {
+      spdlog::log(level, "{} files are routed to {}", routed[idx], option.databases[idx]);
+    }
+  }
+
+  void clang_tidy_general::resolve_headers(const std::filesystem::path &root,
+                                           const std::vector<std::string> &files) {
+    auto cost_of = [&](const std::string &unit) {
+      auto relative = std::filesystem::path{unit}.lexically_relative(root).string();
+      if (auto entry = cost_records ? cost_records->find(name(), relative) : std::nullopt; entry) {
+        return entry->duration;
+      }
+      auto error = std::error_code{};
+      auto size  = std::filesystem::file_size(unit, error);
+      return estimate_duration(error ? 0 : size);
+    };
+
+    for (const auto &file: files) {
+      auto path = (root / file).lexically_normal();
+      header_units.erase(file);
+      if (database_indexes[database_ids[file]]->contains(path.string())) {
         continue;
       }
-      if (filter_file(option.file_filter_iregex, file)) {
-        result.ignored.push_back(file);
-        spdlog::debug("file {} is ignored by {}", file, option.binary);
+      if (!includes) {
+        includes = std::make_unique<include_graph>();
+        for (const auto &database: option.databases) {
+          includes->load((root / database).string());
+        }
+      }
+
+      // The header is checked through the cheapest unit which includes it.
+      auto unit = std::string{};
+      auto id   = std::size_t{0};
+      auto cost = std::chrono::milliseconds::max();
+      for (const auto &candidate: includes->units_of(path.string())) {
+        auto candidate_id = route(candidate);
+        if (!database_indexes[candidate_id]->contains(candidate)
+            || !std::filesystem::exists(candidate)) {
+          continue;
+        }
+        if (auto candidate_cost = cost_of(candidate); candidate_cost < cost) {
+          unit = candidate;
+          id   = candidate_id;
+          cost = candidate_cost;
+        }
+      }
+      if (unit.empty()) {
+        spdlog::debug("No translation unit including {} is found", file);
         continue;
       }
 
-      auto per_file_result = check_single_file(context, root_dir, file);
-      if (per_file_result.passed) {
-        spdlog::info("file: {} passes {} check.", file, option.binary);
-        result.passes[file] = std::move(per_file_result);
+      // Units inside of repository are named relatively like other files.
+      auto relative = std::filesystem::path{unit}.lexically_relative(root);
+      if (!relative.empty() && *relative.begin() != "..") {
+        unit = relative.string();
+      }
+      spdlog::info("{} is checked through {}", file, unit);
+      header_units[file] = std::move(unit);
+      database_ids[file] = id;
+    }
+  }
+
+  void clang_tidy_general::slice_database(const std::filesystem::path &root,
+                                          const std::vector<std::string> &files) {
+    // Files are sliced from the database they are routed to.
+    auto commands = std::vector<std::vector<compile_command>>(database_indexes.size());
+    auto sliced   = std::vector<std::vector<std::string>>(database_indexes.size());
+    auto stripped = std::size_t{0};
+    for (const auto &file: files) {
+      auto idx     = database_ids[file];
+      auto unit    = header_units.contains(file) ? header_units.at(file) : file;
+      auto command = database_indexes[idx]->find((root / unit).string());
+      if (!command) {
+        continue;
+      }
+      if (option.strip_flags) {
+        auto arguments      = strip_irrelevant_flags(command->arguments);
+        stripped           += command->arguments.size() - arguments.size();
+        command->arguments  = std::move(arguments);
+      }
+      commands[idx].push_back(std::move(*command));
+      sliced[idx].push_back(file);
+    }
+    if (option.strip_flags) {
+      spdlog::debug("Stripped {} flags irrelevant to analysis", stripped);
+    }
+
+    for (auto idx = std::size_t{0}; idx < database_indexes.size(); ++idx) {
+      if (commands[idx].empty()) {
         continue;
       }
 
-      spdlog::error("file: {} doesn't pass {} check.", file, option.binary);
-      result.failed_commands.emplace_back(
-        std::format("clang-tidy {}", per_file_result.file_option));
-      result.fails[file] = std::move(per_file_result);
+      // A slice is named by its files and commands and never rewritten, since
+      // clang-tidy may be reading it while files are collected again. Headers
+      // share the command with their units.
+      std::ranges::sort(commands[idx], {}, &compile_command::file);
+      auto duplicated = std::ranges::unique(commands[idx], {}, &compile_command::file);
+      commands[idx].erase(duplicated.begin(), duplicated.end());
+      if (slice_root.empty()) {
+        auto temp  = std::filesystem::temp_directory_path();
+        slice_root = (temp / fmt::format("cpp-lint-action-{}", ::getpid()) / "clang-tidy").string();
+      }
+      auto key = concat(sliced[idx]);
+      for (const auto &command: commands[idx]) {
+        key += fmt::format(
+          "\n{}\n{}\n{}", command.directory, command.file, concat(command.arguments));
+      }
+      auto directory =
+        std::filesystem::path{slice_root} / fmt::format("{:016x}", stable_hash(key));
+      if (!std::filesystem::exists(directory / "compile_commands.json")) {
+        write_compile_db(directory.string(), commands[idx]);
+      }
+      for (const auto &file: sliced[idx]) {
+        sliced_databases[file] = directory.string();
+      }
+      spdlog::log(files.size() > 1 ? spdlog::level::info : spdlog::level::debug,
+                  "Sliced {} of {} commands from {} into {}",
+                  commands[idx].size(),
+                  database_indexes[idx]->size(),
+                  database_indexes[idx]->json_file(),
+                  directory.string());
+    }
+  }
+
+  auto clang_tidy_general::unit_of(const std::string &file) const -> std::string {
+    auto lock = std::lock_guard{slice_mutex};
+    auto iter = header_units.find(file);
+    return iter == header_units.end() ? std::string{} : iter->second;
+  }
+
+  auto clang_tidy_general::database_of(const std::string &file) const -> std::string {
+    auto lock = std::lock_guard{slice_mutex};
+    auto iter = sliced_databases.find(file);
+    return iter == sliced_databases.end() ? routed_database_of(file) : iter->second;
+  }
+
+  auto clang_tidy_general::source_database_of(const std::string &file) const -> std::string {
+    auto lock = std::lock_guard{slice_mutex};
+    return routed_database_of(file);
+  }
+
+  auto clang_tidy_general::routed_database_of(const std::string &file) const -> std::string {
+    if (option.databases.empty()) {
+      return {};
+    }
+    if (auto iter = database_ids.find(file); iter != database_ids.end()) {
+      return option.databases[iter->second];
+    }
+    // Files aren't recorded when scanning.
+    if (!database_indexes.empty()) {
+      return option.databases[route((database_root / file).lexically_normal())];
+    }
+    return option.databases.front();
+  }
+
+  clang_tidy_general::clang_tidy_general(option_t opt)
+    : option(std::move(opt)) {
+    // Each tool has its own directory, so that it's removed with the tool.
+    static auto tools = std::atomic<std::size_t>{0};
+    auto temp         = std::filesystem::temp_directory_path();
+    auto name         = fmt::format("clang-tidy-fixes-{}", tools.fetch_add(1));
+    fixes_root        = (temp / fmt::format("cpp-lint-action-{}", ::getpid()) / name).string();
+  }
+
+  clang_tidy_general::~clang_tidy_general() {
+    auto error = std::error_code{};
+    std::filesystem::remove_all(fixes_root, error);
+    if (!slice_root.empty()) {
+      std::filesystem::remove_all(slice_root, error);
+    }
+    // The parent is shared with other tools and removed by the last one.
+    std::filesystem::remove(std::filesystem::path{fixes_root}.parent_path(), error);
+  }
+
+  auto clang_tidy_general::fixes_file_of(const std::string &file) const -> std::string {
+    // Each check exports its fixes into a file of its own.
+    static auto exported = std::atomic<std::size_t>{0};
+    std::filesystem::create_directories(fixes_root);
+    auto name = fmt::format("{:016x}-{}.yaml", stable_hash(file), exported.fetch_add(1));
+    return (std::filesystem::path{fixes_root} / name).string();
+  }
+
+  auto clang_tidy_general::accepts(const std::string &file) -> bool {
+    return !filter_file(option.file_filter_iregex, file);
+  }
+
+  auto clang_tidy_general::runs_remotely(const runtime_context &context) -> bool {
+    // Other backends check files in this process.
+    return option.backend == backend_t::binary && context.remote && context.remote->slots() > 0;
+  }
+
+  auto clang_tidy_general::check_file(const runtime_context &context,
+                                      const std::string &file,
+                                      std::stop_source cancel) -> file_outcome {
+    if (cancel.stop_requested()) {
+      spdlog::debug("file {} is skipped since {} is cancelled", file, option.binary);
+      auto lock = std::lock_guard{result_mutex};
+      mark_cancelled(result, file);
+      return {.skipped = true};
+    }
+
+    // Files which aren't collected ahead, e.g. when scanning or watching, are
+    // routed, resolved and sliced right before being checked.
+    auto collected = [&] {
+      auto lock = std::lock_guard{slice_mutex};
+      return collected_files.erase(file) != 0;
+    }();
+    if (!collected) {
+      prepare_database(context, {file});
+    }
+
+    auto per_file_result = check_single_file(context, context.repo_path, file, cancel.get_token());
+    if (per_file_result.killed) {
+      // The process is terminated halfway, so the result is meaningless.
+      spdlog::debug("file {} is cancelled by {}", file, option.binary);
+      auto lock = std::lock_guard{result_mutex};
+      mark_cancelled(result, file);
+      return {.skipped = true};
+    }
+
+    auto outcome =
+      file_outcome{.passed = per_file_result.passed, .peak_rss = per_file_result.peak_rss};
+
+    auto lock = std::lock_guard{result_mutex};
+    collapse_duplicates(file, per_file_result);
+    std::erase(result.cancelled, file);
+
+    // A file checked again replaces its failed command of last time.
+    if (auto iter = result.fails.find(file); iter != result.fails.end()) {
+      std::erase(result.failed_commands, std::format("clang-tidy {}", iter->second.file_option));
+    }
+    if (per_file_result.passed) {
+      spdlog::info("file: {} passes {} check.", file, option.binary);
+      // A file checked again may have failed last time.
+      result.fails.erase(file);
+      result.passes[file] = std::move(per_file_result);
+      return outcome;
+    }
+
+    spdlog::error("file: {} doesn't pass {} check.", file, option.binary);
+    result.failed_commands.emplace_back(
+      std::format("clang-tidy {}", per_file_result.file_option));
+    result.passes.erase(file);
+    result.fails[file]  = std::move(per_file_result);
+    result.final_passed = false;
+
+    if (option.enabled_fastly_exit && !result.fastly_exited) {
+      spdlog::info("{} fastly exit since check failed", option.binary);
+      result.fastly_exited = true;
+      cancel.request_stop();
+    }
+    return outcome;
+  }
 
-      if (option.enabled_fastly_exit) {
-        spdlog::info("{} fastly exit since check failed", option.binary);
-        result.final_passed  = false;
-        result.fastly_exited = true;
+  void clang_tidy_general::check(const runtime_context &context) {
+    spdlog::trace("Enter clang_tidy_general::check");
+    auto cancel = std::stop_source{};
+    for (const auto &file: collect_files(context)) {
+      check_file(context, file, cancel);
+      if (cancel.stop_requested()) {
         return;
       }
     }
+  }
+
+  auto clang_tidy_general::dump_result() -> nlohmann::json {
+    auto lock = std::lock_guard{result_mutex};
+    return restored_result(false);
+  }
+
+  auto clang_tidy_general::dump_result(const std::string &file) -> nlohmann::json {
+    auto lock = std::lock_guard{result_mutex};
+    for (const auto *results: {&result.passes, &result.fails}) {
+      if (auto iter = results->find(file); iter != results->end()) {
+        auto restored  = iter->second;
+        restored.diags = diagnostics_of(file, false);
+        return restored;
+      }
+    }
+    return nullptr;
+  }
+
+  void clang_tidy_general::reset_result() {
+    auto lock = std::lock_guard{result_mutex};
+    result    = result_t{};
+    held_diagnostics.clear();
+    diagnostic_refs.clear();
+  }
+
+  void clang_tidy_general::load_result(const nlohmann::json &json) {
+    auto other = json.get<result_t>();
+    auto lock  = std::lock_guard{result_mutex};
+    for (auto *results: {&other.passes, &other.fails}) {
+      for (auto &[file, per_file_result]: *results) {
+        collapse_duplicates(file, per_file_result);
+      }
+    }
+    merge_result(result, std::move(other));
+  }
 
-    result.final_passed = result.fails.empty();
+  void clang_tidy_general::collapse_duplicates(const std::string &file,
+                                               per_file_result &checked) {
+    // The diagnostics of last check of file are replaced by this one.
+    if (auto last = diagnostic_refs.find(file); last != diagnostic_refs.end()) {
+      for (auto hash: last->second) {
+        auto held = held_diagnostics.find(hash);
+        if (held == held_diagnostics.end()) {
+          continue;
+        }
+        held->second.holders.erase(file);
+        if (held->second.holders.empty()) {
+          held_diagnostics.erase(held);
+        }
+      }
+      diagnostic_refs.erase(last);
+    }
+
+    auto refs      = std::vector<std::uint64_t>{};
+    auto seen      = std::unordered_set<std::uint64_t>{};
+    auto collapsed = std::size_t{0};
+    for (auto &diag: checked.diags) {
+      auto hash = fingerprint(diag);
+      if (!seen.insert(hash).second) {
+        ++collapsed;
+        continue;
+      }
+      refs.push_back(hash);
+      auto &held = held_diagnostics[hash];
+      if (held.holders.empty()) {
+        held.diag = std::move(diag);
+      }
+      held.holders.insert(file);
+    }
+    checked.diags.clear();
+    if (collapsed != 0) {
+      spdlog::debug("Collapsed {} diagnostics repeated by {}", collapsed, file);
+    }
+    if (!refs.empty()) {
+      diagnostic_refs[file] = std::move(refs);
+    }
+  }
+
+  auto clang_tidy_general::diagnostics_of(const std::string &file, bool owned) const
+    -> diagnostics {
+    auto refs = diagnostic_refs.find(file);
+    if (refs == diagnostic_refs.end()) {
+      return {};
+    }
+    auto diags = diagnostics{};
+    for (auto hash: refs->second) {
+      const auto &held = held_diagnostics.at(hash);
+      if (!owned || *held.holders.begin() == file) {
+        diags.push_back(held.diag);
+      }
+    }
+    if (owned && diags.size() != refs->second.size()) {
+      spdlog::debug("Collapsed {} diagnostics of {} reported by other files",
+                    refs->second.size() - diags.size(),
+                    file);
+    }
+    return diags;
+  }
+
+  auto clang_tidy_general::restored_result(bool owned) const -> result_t {
+    auto restored = result;
+    for (auto *results: {&restored.passes, &restored.fails}) {
+      for (auto &[file, per_file_result]: *results) {
+        per_file_result.diags = diagnostics_of(file, owned);
+      }
+    }
+    return restored;
+  }
+
+  auto clang_tidy_general::collapsed_result() const -> result_t {
+    // The next holder reports a diagnostic once its owner is checked again
+    // without it.
+    return restored_result(true);
+  }
+
+  auto clang_tidy_general::fixes(const runtime_context & /*context*/) -> replacements {
+    spdlog::trace("Enter clang_tidy_general::fixes");
+    auto lock  = std::lock_guard{result_mutex};
+    auto fixes = replacements{};
+    for (const auto *results: {&result.passes, &result.fails}) {
+      for (const auto &[_, per_file_result]: *results) {
+        fixes.insert(fixes.end(), per_file_result.fixes.begin(), per_file_result.fixes.end());
+      }
+    }
+    return fixes;
   }
 
   auto clang_tidy_general::get_reporter() -> reporter_base_ptr {
-    return std::make_unique<reporter_t>(option, result);
+    // It may be called while files are still being checked.
+    auto lock = std::lock_guard{result_mutex};
+    return std::make_unique<reporter_t>(option, collapsed_result());
   }
 
 } // namespace lint::tool::clang_tidy
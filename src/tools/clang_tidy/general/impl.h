@@ -15,7 +15,16 @@
  */
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stop_token>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 #include <spdlog/spdlog.h>
@@ -23,13 +32,17 @@
 #include "tools/base_tool.h"
 #include "tools/clang_tidy/general/option.h"
 #include "tools/clang_tidy/general/result.h"
+#include "tools/compile_db.h"
+#include "tools/include_graph.h"
 
 namespace lint::tool::clang_tidy {
   /// The general implementation of clang-tidy.
   struct clang_tidy_general : tool_base {
-    explicit clang_tidy_general(option_t opt)
-      : option(std::move(opt)) {
-    }
+    explicit clang_tidy_general(option_t opt);
+
+    clang_tidy_general(const clang_tidy_general &)                     = delete;
+    auto operator=(const clang_tidy_general &) -> clang_tidy_general & = delete;
+    ~clang_tidy_general() override;
 
     bool is_supported(operating_system_t system, arch_t arch) override {
       return system == operating_system_t::ubuntu && arch == arch_t::x86_64;
@@ -47,16 +60,164 @@ namespace lint::tool::clang_tidy {
       return option.binary;
     }
 
-    auto check_single_file(const runtime_context &context,
-                           const std::string &root_dir,
-                           const std::string &file) const -> per_file_result;
+    virtual auto check_single_file(const runtime_context &context,
+                                   const std::string &root_dir,
+                                   const std::string &file,
+                                   const std::stop_token &token = {}) const -> per_file_result;
+
+    auto collect_files(const runtime_context &context) -> std::vector<std::string> override;
+
+    auto accepts(const std::string &file) -> bool override;
+
+    auto runs_remotely(const runtime_context &context) -> bool override;
+
+    auto check_file(const runtime_context &context,
+                    const std::string &file,
+                    std::stop_source cancel) -> file_outcome override;
+
+    /// clang-tidy builds the whole AST of translation unit which is dominated by
+    /// the included headers rather than the file itself.
+    auto estimate_memory(std::uintmax_t file_size) -> std::uint64_t override {
+      constexpr auto baseline = std::uint64_t{512} << 20U;
+      constexpr auto per_byte = std::uint64_t{1024};
+      return baseline + (per_byte * file_size);
+    }
+
+    auto estimate_duration(std::uintmax_t file_size) -> std::chrono::milliseconds override {
+      constexpr auto baseline       = std::chrono::milliseconds{2000};
+      constexpr auto bytes_per_tick = std::uintmax_t{100};
+      return baseline + std::chrono::milliseconds{file_size / bytes_per_tick};
+    }
 
     void check(const runtime_context &context) override;
 
+    auto dump_result() -> nlohmann::json override;
+
+    auto dump_result(const std::string &file) -> nlohmann::json override;
+
+    void reset_result() override;
+
+    void load_result(const nlohmann::json &json) override;
+
+    /// The fixes exported by checks of all files, which may overlap each other
+    /// since a header is included by many units.
+    auto fixes(const runtime_context &context) -> replacements override;
+
     auto get_reporter() -> reporter_base_ptr override;
 
+    void use_history(const history &records) override;
+
+    /// Prepare the database for the collected files, or for a file about to be
+    /// checked when scanning: files are routed to databases, changed headers
+    /// are resolved to the units including them, then the database is sliced.
+    void prepare_database(const runtime_context &context, const std::vector<std::string> &files);
+
+    /// Open the index of each database, reused until the databases change.
+    void open_databases(const std::filesystem::path &root);
+
+    /// The database which has the command of path, or else the one having
+    /// commands in the nearest directory of path. The first one by default.
+    [[nodiscard]] auto route(const std::filesystem::path &path) const -> std::size_t;
+
+    /// Route each file to its database.
+    void route_files(const std::filesystem::path &root, const std::vector<std::string> &files);
+
+    /// Find the cheapest unit including each header, by the include graph
+    /// read from the dependency files under databases.
+    void resolve_headers(const std::filesystem::path &root, const std::vector<std::string> &files);
+
+    /// Write the commands of files into a temporary database which clang-tidy
+    /// loads instead of the whole one. Files without commands still use the
+    /// whole database to guess their commands.
+    void slice_database(const std::filesystem::path &root, const std::vector<std::string> &files);
+
+    /// The database which clang-tidy loads to check file.
+    [[nodiscard]] auto database_of(const std::string &file) const -> std::string;
+
+    /// The database which the command of file comes from, before slicing.
+    [[nodiscard]] auto source_database_of(const std::string &file) const -> std::string;
+
+    /// Same as source_database_of but the caller holds slice_mutex.
+    [[nodiscard]] auto routed_database_of(const std::string &file) const -> std::string;
+
+    /// The file which clang-tidy exports the fixes of file into.
+    [[nodiscard]] auto fixes_file_of(const std::string &file) const -> std::string;
+
+    /// The unit which a header is checked through. Empty if file is checked
+    /// by itself.
+    [[nodiscard]] auto unit_of(const std::string &file) const -> std::string;
+
+    /// A diagnostic which is stored once however many files report it, e.g.
+    /// one in a header included by many units.
+    struct held_diagnostic {
+      diagnostic diag;
+
+      /// The files whose results hold it. The least one owns it.
+      std::set<std::string> holders;
+    };
+
+    /// Move the diagnostics of checked into the stored ones, dropping the
+    /// repeated ones, and record file as a holder of them. Requires
+    /// result_mutex.
+    void collapse_duplicates(const std::string &file, per_file_result &checked);
+
+    /// The stored diagnostics which file holds, or only the ones it owns.
+    /// Requires result_mutex.
+    [[nodiscard]] auto diagnostics_of(const std::string &file, bool owned) const -> diagnostics;
+
+    /// The result where each file has the diagnostics it holds, or only the
+    /// ones it owns. Requires result_mutex.
+    [[nodiscard]] auto restored_result(bool owned) const -> result_t;
+
+    /// The result where a diagnostic reported by many files is only kept by
+    /// its owner. Requires result_mutex.
+    [[nodiscard]] auto collapsed_result() const -> result_t;
+
     option_t option;
     result_t result;
+
+    /// Protects result since files may be checked concurrently.
+    std::mutex result_mutex;
+
+    /// Each reported diagnostic with its holders, by fingerprint. Results of
+    /// files keep the fingerprints of their diagnostics instead.
+    std::unordered_map<std::uint64_t, held_diagnostic> held_diagnostics;
+
+    /// The fingerprints of diagnostics which each file holds, in reported order.
+    std::unordered_map<std::string, std::vector<std::uint64_t>> diagnostic_refs;
+
+    /// The index of each database, opened when files are collected.
+    std::vector<std::unique_ptr<compile_db>> database_indexes;
+
+    /// The root of repository which databases are opened in.
+    std::filesystem::path database_root;
+
+    /// The database which each file is routed to.
+    std::unordered_map<std::string, std::size_t> database_ids;
+
+    /// The directory of sliced database of each file.
+    std::unordered_map<std::string, std::string> sliced_databases;
+
+    /// The include graph, read when a header is resolved for the first time.
+    std::unique_ptr<include_graph> includes;
+
+    /// The unit which each changed header is checked through.
+    std::unordered_map<std::string, std::string> header_units;
+
+    /// The files whose database is prepared by collect_files but not checked yet.
+    std::unordered_set<std::string> collected_files;
+
+    /// The statistics of previous runs to find the cheapest unit.
+    const history *cost_records = nullptr;
+
+    /// The directory where sliced databases are written, removed on destruction.
+    std::string slice_root;
+
+    /// The directory where fixes are exported, removed on destruction.
+    std::string fixes_root;
+
+    /// Protects the state of database since files may be collected concurrently.
+    mutable std::mutex slice_mutex;
   };
 
 } // namespace lint::tool::clang_tidy
@@ -15,8 +15,11 @@
  */
 #include "tools/clang_tidy/general/option.h"
 
+#include <magic_enum/magic_enum.hpp>
 #include <spdlog/spdlog.h>
 
+#include "utils/std.h"
+
 namespace lint::tool::clang_tidy {
   void print_option(const option_t& option) {
     spdlog::debug("Clang-tidy Option: ");
@@ -31,9 +34,14 @@ namespace lint::tool::clang_tidy {
     spdlog::debug("checks: {}", option.checks);
     spdlog::debug("config: {}", option.config);
     spdlog::debug("config-file: {}", option.config_file);
-    spdlog::debug("database: {}", option.database);
+    spdlog::debug("databases: {}", concat(option.databases, ','));
+    spdlog::debug("slice-database: {}", option.slice_database);
+    spdlog::debug("strip-flags: {}", option.strip_flags);
+    spdlog::debug("resolve-headers: {}", option.resolve_headers);
     spdlog::debug("header-filter: {}", option.header_filter);
     spdlog::debug("line-filter: {}", option.line_filter);
+    spdlog::debug("backend: {}", magic_enum::enum_name(option.backend));
+    spdlog::debug("clangd-timeout: {}", option.clangd_timeout);
     spdlog::debug("");
   }
 
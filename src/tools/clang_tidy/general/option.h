@@ -15,18 +15,36 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "tools/base_option.h"
 
 namespace lint::tool::clang_tidy {
+  /// How files are checked.
+  enum class backend_t : std::uint8_t {
+    binary,  // Run clang-tidy executable for each file.
+    libtidy, // Call clang-tidy libraries in process. Requires ENABLE_LIBTIDY.
+    clangd,  // Send files to a long-lived clangd which reuses their preambles.
+  };
+
   struct option_t : option_base {
     bool allow_no_checks      = false;
     bool enable_check_profile = false;
+    bool slice_database       = true;
+    bool strip_flags          = false;
+    bool resolve_headers      = false;
     std::string checks;
     std::string config;
     std::string config_file;
-    std::string database;
     std::string header_filter;
     std::string line_filter;
+    std::vector<std::string> databases;
+    backend_t backend = backend_t::binary;
+
+    // How long clangd backend waits for the diagnostics of a file.
+    std::uint32_t clangd_timeout = 300; // seconds
   };
 
   void print_option(const option_t& option);
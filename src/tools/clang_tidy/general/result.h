@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "tools/base_result.h"
+#include "tools/fixes.h"
 
 namespace lint::tool::clang_tidy {
   /// Represents statistics outputed by clang-tidy. It's usually the stderr
@@ -55,7 +56,21 @@ namespace lint::tool::clang_tidy {
   struct per_file_result : per_file_result_base {
     statistic stat;
     diagnostics diags;
+
+    /// The fixes exported by clang-tidy if fix mode is enabled.
+    replacements fixes;
   };
 
   using result_t = multi_files_result_base<per_file_result>;
+
+  // clang-format off
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(statistic, warnings, errors, warnings_treated_as_errors,
+                                     total_suppressed_warnings, non_user_code_warnings,
+                                     no_lint_warnings)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(diagnostic_header, file_name, row_idx, col_idx, serverity,
+                                     brief, diagnostic_type)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(diagnostic, header, details)
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(per_file_result, passed, file_path, tool_stdout, tool_stderr,
+                                     file_option, peak_rss, stat, diags, fixes)
+  // clang-format on
 } // namespace lint::tool::clang_tidy
@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/clang_tidy/libtidy/impl.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#ifdef CPP_LINT_ACTION_WITH_LIBTIDY
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <clang-tidy/ClangTidy.h>
+#include <clang-tidy/ClangTidyDiagnosticConsumer.h>
+#include <clang-tidy/ClangTidyForceLinker.h> // Links all checks.
+#include <clang-tidy/ClangTidyOptions.h>
+#include <clang/Basic/Version.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/DependencyScanning/DependencyScanningFilesystem.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include "utils/error.h"
+#endif
+
+namespace lint::tool::clang_tidy {
+#ifdef CPP_LINT_ACTION_WITH_LIBTIDY
+  namespace {
+    namespace tidy     = clang::tidy;
+    namespace tooling  = clang::tooling;
+    namespace scanning = clang::tooling::dependencies;
+
+    // Same as clang-tidy executable, creates AST consumers of enabled checks
+    // and defines __clang_analyzer__.
+    class action_factory : public tooling::FrontendActionFactory {
+    public:
+      action_factory(tidy::ClangTidyContext &context,
+                     llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> fs)
+        : consumer_factory_(context, std::move(fs)) {
+      }
+
+      auto create() -> std::unique_ptr<clang::FrontendAction> override {
+        return std::make_unique<action>(consumer_factory_);
+      }
+
+      auto runInvocation(std::shared_ptr<clang::CompilerInvocation> invocation,
+                         clang::FileManager *files,
+                         std::shared_ptr<clang::PCHContainerOperations> pch,
+                         clang::DiagnosticConsumer *consumer) -> bool override {
+        invocation->getPreprocessorOpts().SetUpStaticAnalyzer = true;
+        return FrontendActionFactory::runInvocation(
+          std::move(invocation), files, std::move(pch), consumer);
+      }
+
+    private:
+      class action : public clang::ASTFrontendAction {
+      public:
+        explicit action(tidy::ClangTidyASTConsumerFactory &factory)
+          : factory_(factory) {
+        }
+
+        auto CreateASTConsumer(clang::CompilerInstance &compiler, llvm::StringRef file)
+          -> std::unique_ptr<clang::ASTConsumer> override {
+          return factory_.createASTConsumer(compiler, file);
+        }
+
+      private:
+        tidy::ClangTidyASTConsumerFactory &factory_;
+      };
+
+      tidy::ClangTidyASTConsumerFactory consumer_factory_;
+    };
+
+    auto read_file(const std::string &path) -> std::string {
+      auto file = std::ifstream{path};
+      throw_unless(file.is_open(), fmt::format("open file {} error", path));
+      return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+
+    // Same as the options of clang-tidy executable.
+    auto make_options_provider(const option_t &option,
+                               llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> fs)
+      -> std::unique_ptr<tidy::ClangTidyOptionsProvider> {
+      auto global = tidy::ClangTidyGlobalOptions{};
+      if (!option.line_filter.empty()) {
+        auto ec = tidy::parseLineFilter(option.line_filter, global);
+        throw_if(static_cast<bool>(ec), fmt::format("invalid line filter: {}", ec.message()));
+      }
+
+      auto defaults  = tidy::ClangTidyOptions::getDefaults();
+      auto overrides = tidy::ClangTidyOptions{};
+      if (!option.checks.empty()) {
+        overrides.Checks = option.checks;
+      }
+      if (!option.header_filter.empty()) {
+        overrides.HeaderFilterRegex = option.header_filter;
+      }
+
+      auto config = option.config_file.empty() ? option.config : read_file(option.config_file);
+      if (config.empty()) {
+        return std::make_unique<tidy::FileOptionsProvider>(
+          std::move(global), std::move(defaults), std::move(overrides), std::move(fs));
+      }
+      auto parsed = tidy::parseConfiguration(llvm::MemoryBufferRef{config, "config"});
+      throw_unless(static_cast<bool>(parsed),
+                   fmt::format("invalid clang-tidy config: {}", parsed.getError().message()));
+      return std::make_unique<tidy::ConfigOptionsProvider>(std::move(global),
+                                                           std::move(defaults),
+                                                           std::move(*parsed),
+                                                           std::move(overrides),
+                                                           std::move(fs));
+    }
+
+    // Files inside the repository bypass the cache shared by engines, since
+    // they may change between checks, e.g. in daemon and watch modes. Others
+    // such as system headers are read once for all engines.
+    class repository_bypass : public llvm::vfs::ProxyFileSystem {
+    public:
+      repository_bypass(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> cached,
+                        llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> physical,
+                        std::string root)
+        : ProxyFileSystem(std::move(cached))
+        , physical_(std::move(physical))
+        , root_(std::filesystem::path{std::move(root)}.lexically_normal().string()) {
+      }
+
+      auto status(const llvm::Twine &path) -> llvm::ErrorOr<llvm::vfs::Status> override {
+        return inside(path) ? physical_->status(path) : ProxyFileSystem::status(path);
+      }
+
+      auto exists(const llvm::Twine &path) -> bool override {
+        return inside(path) ? physical_->exists(path) : ProxyFileSystem::exists(path);
+      }
+
+      auto openFileForRead(const llvm::Twine &path)
+        -> llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>> override {
+        return inside(path) ? physical_->openFileForRead(path)
+                            : ProxyFileSystem::openFileForRead(path);
+      }
+
+      auto setCurrentWorkingDirectory(const llvm::Twine &path) -> std::error_code override {
+        if (auto ec = physical_->setCurrentWorkingDirectory(path)) {
+          return ec;
+        }
+        return ProxyFileSystem::setCurrentWorkingDirectory(path);
+      }
+
+    private:
+      auto inside(const llvm::Twine &path) -> bool {
+        auto absolute = llvm::SmallString<256>{};
+        path.toVector(absolute);
+        if (makeAbsolute(absolute)) {
+          return true;
+        }
+        auto file = std::filesystem::path{absolute.str().str()}.lexically_normal();
+        auto rel  = file.lexically_relative(root_);
+        return !rel.empty() && *rel.begin() != "..";
+      }
+
+      llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> physical_;
+      std::filesystem::path root_;
+    };
+
+    // A compilation database which is loaded again once its file changes.
+    struct loaded_database {
+      std::shared_ptr<tooling::CompilationDatabase> database;
+      std::uintmax_t size = 0;
+      std::filesystem::file_time_type mtime;
+    };
+
+    auto stat_of(const std::string &directory)
+      -> std::tuple<std::uintmax_t, std::filesystem::file_time_type> {
+      auto json  = std::filesystem::path{directory} / "compile_commands.json";
+      auto error = std::error_code{};
+      auto size  = std::filesystem::file_size(json, error);
+      auto mtime = std::filesystem::last_write_time(json, error);
+      return {error ? 0 : size, error ? std::filesystem::file_time_type{} : mtime};
+    }
+
+    auto severity(tidy::ClangTidyError::Level level) -> std::string_view {
+      if (level == tidy::ClangTidyError::Error) {
+        return "error";
+      }
+      return level == tidy::ClangTidyError::Warning ? "warning" : "info";
+    }
+
+    // Same as the fixes exported by clang-tidy executable, files inside the
+    // root are relative to it.
+    auto to_replacement(const std::filesystem::path &root, const tooling::Replacement &change)
+      -> replacement {
+      auto path = std::filesystem::path{change.getFilePath().str()}.lexically_normal();
+      auto rel  = path.lexically_relative(root);
+      auto file = !rel.empty() && *rel.begin() != ".." ? rel.string() : path.string();
+      return {.file   = std::move(file),
+              .offset = change.getOffset(),
+              .length = change.getLength(),
+              .text   = change.getReplacementText().str()};
+    }
+  } // namespace
+
+  /// The files shared by all engines. Engines are declared last, so they are
+  /// destroyed before the cache they use.
+  struct clang_tidy_libtidy::shared {
+    /// Loaded databases by their directories.
+    std::unordered_map<std::string, loaded_database> databases;
+    scanning::DependencyScanningFilesystemSharedCache cache;
+
+    std::mutex mutex;
+
+    /// Bumped whenever files of repository change, engines which have seen an
+    /// older one forget the stats of files in their FileManager.
+    std::uint64_t generation = 0;
+    std::vector<std::unique_ptr<engine>> idle;
+  };
+
+  /// Checks one file at a time. The FileManager of engine is reused by all
+  /// files checked by it.
+  struct clang_tidy_libtidy::engine {
+    engine(const option_t &option, shared &state, const std::string &root)
+      : physical(llvm::vfs::createPhysicalFileSystem().release())
+      , fs(new scanning::DependencyScanningWorkerFilesystem(state.cache, physical))
+      , overlay(new llvm::vfs::OverlayFileSystem(new repository_bypass(fs, physical, root)))
+      , files(new clang::FileManager(clang::FileSystemOptions{}, overlay))
+      , context(make_options_provider(option, overlay))
+      , consumer(context)
+      , diagnostics(new clang::DiagnosticIDs, new clang::DiagnosticOptions, &consumer, false)
+      , factory(context, overlay) {
+      context.setDiagnosticsEngine(&diagnostics);
+      context.setEnableProfiling(option.enable_check_profile);
+    }
+
+    auto run(const tooling::CompilationDatabase &database, const std::string &path)
+      -> std::tuple<int, std::vector<tidy::ClangTidyError>> {
+      auto tool = tooling::ClangTool{
+        database, {path}, std::make_shared<clang::PCHContainerOperations>(), overlay, files};
+      tool.setDiagnosticConsumer(&consumer);
+      auto status = tool.run(&factory);
+      return {status, consumer.take()};
+    }
+
+    // Get the row and column which start from 1 of offset in the file.
+    auto position(const std::string &path, unsigned offset) -> std::tuple<unsigned, unsigned> {
+      auto buffer = overlay->getBufferForFile(path);
+      if (!buffer) {
+        return {0, 0};
+      }
+      auto code = (*buffer)->getBuffer().take_front(offset);
+      auto row  = static_cast<unsigned>(code.count('\n')) + 1;
+      auto col  = offset - static_cast<unsigned>(code.rfind('\n') + 1) + 1;
+      return {row, col};
+    }
+
+    // Files of repository may have changed since the FileManager saw them.
+    void refresh(std::uint64_t latest) {
+      if (generation != latest) {
+        files      = new clang::FileManager(clang::FileSystemOptions{}, overlay);
+        generation = latest;
+      }
+    }
+
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> physical;
+    llvm::IntrusiveRefCntPtr<scanning::DependencyScanningWorkerFilesystem> fs;
+    llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> overlay;
+    llvm::IntrusiveRefCntPtr<clang::FileManager> files;
+    std::uint64_t generation = 0;
+    tidy::ClangTidyContext context;
+    tidy::ClangTidyDiagnosticConsumer consumer;
+    clang::DiagnosticsEngine diagnostics;
+    action_factory factory;
+  };
+
+  clang_tidy_libtidy::clang_tidy_libtidy(option_t opt)
+    : clang_tidy_general(std::move(opt))
+    , shared_(std::make_unique<shared>()) {
+  }
+
+  clang_tidy_libtidy::~clang_tidy_libtidy() = default;
+
+  void clang_tidy_libtidy::drop_caches(const std::vector<std::string> &files) {
+    spdlog::trace("Enter clang_tidy_libtidy::drop_caches");
+    if (files.empty()) {
+      return;
+    }
+
+    // Files of repository bypass the shared cache, so only the stats kept by
+    // FileManagers of engines are stale. Each engine refreshes its own once
+    // it's borrowed, since busy ones couldn't be touched here. Databases are
+    // checked by themselves when they're used.
+    auto lock = std::lock_guard{shared_->mutex};
+    ++shared_->generation;
+  }
+
+  auto clang_tidy_libtidy::check_single_file(
+    const runtime_context &context,
+    const std::string &root_dir,
+    const std::string &file,
+    [[maybe_unused]] const std::stop_token &token) const -> per_file_result {
+    spdlog::trace("Enter clang_tidy_libtidy::check_single_file");
+    auto &state = shared_;
+
+    // Same as -p option of clang-tidy executable which is run in root_dir.
+    // Databases are loaded once and kept until their files are regenerated.
+    auto database = [&] {
+      auto directory     = (std::filesystem::path{root_dir} / database_of(file)).string();
+      auto [size, mtime] = stat_of(directory);
+      auto lock          = std::lock_guard{state->mutex};
+      auto &loaded       = state->databases[directory];
+      if (loaded.database == nullptr || loaded.size != size || loaded.mtime != mtime) {
+        auto error      = std::string{};
+        loaded.database = tooling::CompilationDatabase::autoDetectFromDirectory(directory, error);
+        throw_unless(loaded.database != nullptr,
+                     fmt::format("load compilation database failed: {}", error));
+        loaded.size  = size;
+        loaded.mtime = mtime;
+      }
+      return loaded.database;
+    }();
+
+    // Borrow an idle engine or create a new one if all are busy.
+    auto worker     = std::unique_ptr<engine>{};
+    auto generation = std::uint64_t{0};
+    {
+      auto lock = std::lock_guard{state->mutex};
+      if (!state->idle.empty()) {
+        worker = std::move(state->idle.back());
+        state->idle.pop_back();
+      }
+      generation = state->generation;
+    }
+    if (worker == nullptr) {
+      worker = std::make_unique<engine>(option, *state, root_dir);
+    }
+    worker->refresh(generation);
+
+    auto path             = fmt::format("{}/{}", root_dir, file);
+    auto [status, errors] = worker->run(*database, path);
+
+    auto result        = per_file_result{};
+    result.passed      = status == 0;
+    result.file_path   = file;
+    result.file_option = file;
+    for (const auto &error: errors) {
+      const auto &message = error.Message;
+      auto [row, col]     = worker->position(message.FilePath, message.FileOffset);
+      auto as_error       = worker->context.treatAsError(error.DiagnosticName);
+
+      auto diag                   = diagnostic{};
+      diag.header.file_name       = message.FilePath;
+      diag.header.row_idx         = std::to_string(row);
+      diag.header.col_idx         = std::to_string(col);
+      diag.header.serverity       = as_error ? "error" : severity(error.DiagLevel);
+      diag.header.brief           = fmt::format(" {} ", message.Message);
+      diag.header.diagnostic_type = fmt::format("[{}]", error.DiagnosticName);
+      for (const auto &note: error.Notes) {
+        auto [note_row, note_col] = worker->position(note.FilePath, note.FileOffset);
+        diag.details += fmt::format(
+          "{}:{}:{}: note: {}\n", note.FilePath, note_row, note_col, note.Message);
+      }
+      if (context.fix_mode != fix_mode_t::none) {
+        // Fixes of notes are alternatives, which aren't applied.
+        auto root = std::filesystem::path{root_dir}.lexically_normal();
+        for (const auto &entry: message.Fix) {
+          for (const auto &change: entry.getValue()) {
+            result.fixes.push_back(to_replacement(root, change));
+          }
+        }
+      }
+
+      // Keep the same output as clang-tidy executable for reporters.
+      result.tool_stdout += fmt::format("{}:{}:{}: {}:{}{}\n{}",
+                                        diag.header.file_name,
+                                        diag.header.row_idx,
+                                        diag.header.col_idx,
+                                        diag.header.serverity,
+                                        diag.header.brief,
+                                        diag.header.diagnostic_type,
+                                        diag.details);
+
+      if (error.DiagLevel == tidy::ClangTidyError::Error) {
+        ++result.stat.errors;
+        result.passed = false;
+      } else if (as_error) {
+        ++result.stat.warnings_treated_as_errors;
+        result.passed = false;
+      } else {
+        ++result.stat.warnings;
+      }
+      result.diags.push_back(std::move(diag));
+    }
+
+    auto lock = std::lock_guard{state->mutex};
+    state->idle.push_back(std::move(worker));
+    return result;
+  }
+
+  auto libtidy_version() -> std::string {
+    return CLANG_VERSION_STRING;
+  }
+
+  auto make_libtidy_tool(option_t option) -> tool_base_ptr {
+    return std::make_unique<clang_tidy_libtidy>(std::move(option));
+  }
+#else
+  namespace {
+    constexpr auto disabled = "cpp-lint-action isn't built with ENABLE_LIBTIDY";
+  } // namespace
+
+  auto libtidy_version() -> std::string {
+    throw std::runtime_error{disabled};
+  }
+
+  auto make_libtidy_tool([[maybe_unused]] option_t option) -> tool_base_ptr {
+    throw std::runtime_error{disabled};
+  }
+#endif
+} // namespace lint::tool::clang_tidy
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tools/clang_tidy/general/impl.h"
+
+namespace lint::tool::clang_tidy {
+  /// Runs clang-tidy checks in process rather than spawning clang-tidy for
+  /// each file. Files are still checked concurrently by worker threads, each
+  /// check borrows an idle engine which keeps its FileManager across files, so
+  /// headers are only looked up once per engine. The stats and contents of
+  /// files outside the repository, e.g. system headers, are cached once for
+  /// all engines. Diagnostics are written into result directly without
+  /// parsing the output.
+  struct clang_tidy_libtidy : clang_tidy_general {
+    explicit clang_tidy_libtidy(option_t opt);
+    ~clang_tidy_libtidy() override;
+
+    clang_tidy_libtidy(const clang_tidy_libtidy &)            = delete;
+    clang_tidy_libtidy &operator=(const clang_tidy_libtidy &) = delete;
+    clang_tidy_libtidy(clang_tidy_libtidy &&)                 = delete;
+    clang_tidy_libtidy &operator=(clang_tidy_libtidy &&)      = delete;
+
+    auto check_single_file(const runtime_context &context,
+                           const std::string &root_dir,
+                           const std::string &file,
+                           const std::stop_token &token = {}) const -> per_file_result override;
+
+    void drop_caches(const std::vector<std::string> &files) override;
+
+  private:
+    struct engine;
+    struct shared;
+
+    std::unique_ptr<shared> shared_;
+  };
+
+  /// The version of clang which clang-tidy libraries come from. Throws if
+  /// cpp-lint-action isn't built with ENABLE_LIBTIDY.
+  auto libtidy_version() -> std::string;
+
+  /// Create clang-tidy which uses clang-tidy libraries. Throws if
+  /// cpp-lint-action isn't built with ENABLE_LIBTIDY.
+  auto make_libtidy_tool(option_t option) -> tool_base_ptr;
+} // namespace lint::tool::clang_tidy
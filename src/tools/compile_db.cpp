@@ -0,0 +1,719 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/compile_db.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+#include <range/v3/algorithm/contains.hpp>
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+#include "utils/hash.h"
+
+namespace lint::tool {
+  using namespace std::string_view_literals;
+
+  namespace {
+    constexpr auto index_magic   = std::array<char, 8>{'C', 'P', 'P', 'L', 'C', 'D', 'B', 'I'};
+    constexpr auto index_version = std::uint32_t{1};
+
+    struct index_header {
+      std::array<char, 8> magic;
+      std::uint32_t version;
+      std::uint32_t string_count;
+      std::uint64_t command_count;
+      std::uint64_t argument_count;
+      std::uint64_t json_size;
+      std::int64_t json_mtime;
+      std::uint64_t json_hash;
+    };
+
+    struct string_ref {
+      std::uint64_t offset;
+      std::uint64_t size;
+    };
+
+    struct command_ref {
+      std::uint32_t file;
+      std::uint32_t directory;
+      std::uint32_t first_argument;
+      std::uint32_t argument_count;
+    };
+
+    // The offsets of sections in index.
+    struct index_layout {
+      std::size_t strings;
+      std::size_t commands;
+      std::size_t arguments;
+      std::size_t characters;
+    };
+
+    auto layout_of(const index_header &header) -> index_layout {
+      auto layout       = index_layout{};
+      layout.strings    = sizeof(index_header);
+      layout.commands   = layout.strings + (header.string_count * sizeof(string_ref));
+      layout.arguments  = layout.commands + (header.command_count * sizeof(command_ref));
+      layout.characters = layout.arguments + (header.argument_count * sizeof(std::uint32_t));
+      return layout;
+    }
+
+    // The index is only guaranteed to be aligned by page, so it's read by copy.
+    template <typename T>
+    auto read_at(std::string_view data, std::size_t offset) -> T {
+      auto value = T{};
+      std::memcpy(&value, data.data() + offset, sizeof(T));
+      return value;
+    }
+
+    template <typename T>
+    void append(std::string &data, const T &value) {
+      data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    auto string_at(std::string_view data, std::uint32_t id) -> std::string_view {
+      auto header = read_at<index_header>(data, 0);
+      auto layout = layout_of(header);
+      auto ref    = read_at<string_ref>(data, layout.strings + (id * sizeof(string_ref)));
+      return data.substr(layout.characters + ref.offset, ref.size);
+    }
+
+    auto command_at(std::string_view data, std::size_t idx) -> command_ref {
+      auto header = read_at<index_header>(data, 0);
+      return read_at<command_ref>(data, layout_of(header).commands + (idx * sizeof(command_ref)));
+    }
+
+    auto is_valid(std::string_view data) -> bool {
+      if (data.size() < sizeof(index_header)) {
+        return false;
+      }
+      auto header = read_at<index_header>(data, 0);
+      if (header.magic != index_magic || header.version != index_version) {
+        return false;
+      }
+      if (header.command_count > data.size() || header.argument_count > data.size()) {
+        return false;
+      }
+      auto layout = layout_of(header);
+      if (layout.characters > data.size()) {
+        return false;
+      }
+      auto characters = data.size() - layout.characters;
+      for (auto id = std::uint32_t{0}; id < header.string_count; ++id) {
+        auto ref = read_at<string_ref>(data, layout.strings + (id * sizeof(string_ref)));
+        if (ref.offset > characters || ref.size > characters - ref.offset) {
+          return false;
+        }
+      }
+      for (auto idx = std::size_t{0}; idx < header.command_count; ++idx) {
+        auto command = command_at(data, idx);
+        if (command.file >= header.string_count || command.directory >= header.string_count
+            || command.first_argument > header.argument_count
+            || command.argument_count > header.argument_count - command.first_argument) {
+          return false;
+        }
+      }
+      for (auto idx = std::size_t{0}; idx < header.argument_count; ++idx) {
+        auto id = read_at<std::uint32_t>(data, layout.arguments + (idx * sizeof(std::uint32_t)));
+        if (id >= header.string_count) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    struct json_stamp {
+      std::uint64_t size = 0;
+      std::int64_t mtime = 0;
+    };
+
+    auto stamp_of(const std::string &json_file) -> json_stamp {
+      auto error = std::error_code{};
+      auto size  = std::filesystem::file_size(json_file, error);
+      throw_if(
+        static_cast<bool>(error),
+        fmt::format("failed to read compilation database {}: {}", json_file, error.message()));
+      auto mtime = std::filesystem::last_write_time(json_file, error);
+      return {.size = size, .mtime = error ? 0 : mtime.time_since_epoch().count()};
+    }
+
+    auto read_file(const std::string &path) -> std::string {
+      auto file = std::ifstream{path, std::ios::binary};
+      throw_unless(file.is_open(), fmt::format("failed to open compilation database {}", path));
+      return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+
+    // Interns strings and collects commands in the layout of index.
+    class index_builder {
+    public:
+      void add(const std::string &directory,
+               const std::string &file,
+               const std::vector<std::string> &arguments) {
+        auto command = command_ref{.file           = intern(file),
+                                   .directory      = intern(directory),
+                                   .first_argument = static_cast<std::uint32_t>(arguments_.size()),
+                                   .argument_count = static_cast<std::uint32_t>(arguments.size())};
+        for (const auto &argument: arguments) {
+          arguments_.push_back(intern(argument));
+        }
+        commands_.push_back(command);
+      }
+
+      auto build(index_header header) -> std::string {
+        // Commands are sorted by file for binary search, and only the first
+        // one of a file is kept.
+        std::ranges::stable_sort(commands_, {}, [&](const auto &command) {
+          return strings_[command.file];
+        });
+        auto duplicated = std::ranges::unique(commands_, {}, [&](const auto &command) {
+          return strings_[command.file];
+        });
+        commands_.erase(duplicated.begin(), duplicated.end());
+
+        auto arguments = std::vector<std::uint32_t>{};
+        for (auto &command: commands_) {
+          auto first = arguments_.begin() + command.first_argument;
+          command.first_argument = static_cast<std::uint32_t>(arguments.size());
+          arguments.insert(arguments.end(), first, first + command.argument_count);
+        }
+
+        header.magic          = index_magic;
+        header.version        = index_version;
+        header.string_count   = static_cast<std::uint32_t>(strings_.size());
+        header.command_count  = commands_.size();
+        header.argument_count = arguments.size();
+
+        auto data = std::string{};
+        append(data, header);
+        auto offset = std::uint64_t{0};
+        for (const auto &str: strings_) {
+          append(data, string_ref{.offset = offset, .size = str.size()});
+          offset += str.size();
+        }
+        for (const auto &command: commands_) {
+          append(data, command);
+        }
+        for (auto id: arguments) {
+          append(data, id);
+        }
+        for (const auto &str: strings_) {
+          data += str;
+        }
+        return data;
+      }
+
+    private:
+      auto intern(const std::string &str) -> std::uint32_t {
+        auto [iter, inserted] = ids_.try_emplace(str, static_cast<std::uint32_t>(strings_.size()));
+        if (inserted) {
+          // Keys of node based map are never moved.
+          strings_.emplace_back(iter->first);
+        }
+        return iter->second;
+      }
+
+      std::unordered_map<std::string, std::uint32_t> ids_;
+      std::vector<std::string_view> strings_;
+      std::vector<command_ref> commands_;
+      std::vector<std::uint32_t> arguments_;
+    };
+
+    // Collects commands while parsing, so that the huge json is never held
+    // as a whole document.
+    class command_collector : public nlohmann::json_sax<nlohmann::json> {
+    public:
+      explicit command_collector(index_builder &builder)
+        : builder_(builder) {
+      }
+
+      auto null() -> bool override {
+        return true;
+      }
+
+      auto boolean(bool /*value*/) -> bool override {
+        return true;
+      }
+
+      auto number_integer(number_integer_t /*value*/) -> bool override {
+        return true;
+      }
+
+      auto number_unsigned(number_unsigned_t /*value*/) -> bool override {
+        return true;
+      }
+
+      auto number_float(number_float_t /*value*/, const string_t & /*raw*/) -> bool override {
+        return true;
+      }
+
+      auto binary(binary_t & /*value*/) -> bool override {
+        return true;
+      }
+
+      auto string(string_t &value) -> bool override {
+        if (depth_ == command_depth) {
+          if (key_ == "directory") {
+            directory_ = std::move(value);
+          } else if (key_ == "file") {
+            file_ = std::move(value);
+          } else if (key_ == "command") {
+            command_ = std::move(value);
+          }
+        } else if (depth_ == command_depth + 1 && key_ == "arguments") {
+          arguments_.push_back(std::move(value));
+        }
+        return true;
+      }
+
+      auto start_object(std::size_t /*size*/) -> bool override {
+        if (++depth_ == command_depth) {
+          key_.clear();
+          directory_.clear();
+          file_.clear();
+          command_.clear();
+          arguments_.clear();
+        }
+        return true;
+      }
+
+      auto key(string_t &value) -> bool override {
+        if (depth_ == command_depth) {
+          key_ = value;
+        }
+        return true;
+      }
+
+      auto end_object() -> bool override {
+        if (depth_-- == command_depth && !file_.empty()) {
+          if (arguments_.empty()) {
+            arguments_ = split_command_line(command_);
+          }
+          auto file = (std::filesystem::path{directory_} / file_).lexically_normal();
+          builder_.add(directory_, file.string(), arguments_);
+        }
+        return true;
+      }
+
+      auto start_array(std::size_t /*size*/) -> bool override {
+        ++depth_;
+        return true;
+      }
+
+      auto end_array() -> bool override {
+        --depth_;
+        return true;
+      }
+
+      auto parse_error(std::size_t /*position*/,
+                       const std::string & /*token*/,
+                       const nlohmann::detail::exception &err) -> bool override {
+        error = err.what();
+        return false;
+      }
+
+      std::string error;
+
+    private:
+      // Commands are the objects in the top level array.
+      static constexpr auto command_depth = 2;
+
+      index_builder &builder_;
+      int depth_ = 0;
+      std::string key_;
+      std::string directory_;
+      std::string file_;
+      std::string command_;
+      std::vector<std::string> arguments_;
+    };
+
+    auto build_index(const std::string &json_file, const std::string &content, index_header header)
+      -> std::string {
+      auto builder   = index_builder{};
+      auto collector = command_collector{builder};
+      auto parsed    = nlohmann::json::sax_parse(content, &collector);
+      throw_unless(parsed,
+                   fmt::format("failed to parse compilation database {}: {}",
+                               json_file,
+                               collector.error));
+      return builder.build(header);
+    }
+
+    auto save_file(const std::string &path, const std::string &data) -> bool {
+      // Each process writes its own temporary file, and rename is atomic so
+      // that concurrent readers never see a partial file.
+      auto temp  = std::filesystem::path{path};
+      temp      += fmt::format(".{}.tmp", ::getpid());
+      {
+        auto file = std::ofstream{temp, std::ios::binary | std::ios::trunc};
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+          spdlog::warn("Failed to write {}", temp.string());
+          return false;
+        }
+      }
+
+      auto error = std::error_code{};
+      std::filesystem::rename(temp, path, error);
+      if (error) {
+        spdlog::warn("Failed to save {}: {}", path, error.message());
+        std::filesystem::remove(temp, error);
+        return false;
+      }
+      return true;
+    }
+
+    // Flags whose value is the next argument, which is kept as it is.
+    constexpr auto flags_with_value = {"-D"sv,
+                                       "-U"sv,
+                                       "-I"sv,
+                                       "-include"sv,
+                                       "-imacros"sv,
+                                       "-isystem"sv,
+                                       "-iquote"sv,
+                                       "-idirafter"sv,
+                                       "-isysroot"sv,
+                                       "-target"sv,
+                                       "-x"sv,
+                                       "-o"sv,
+                                       "-Xclang"sv,
+                                       "-Xpreprocessor"sv,
+                                       "-arch"sv,
+                                       "--sysroot"sv};
+
+    // Flags which only affect code generation, instrumentation or linking.
+    constexpr auto irrelevant_prefixes = {"-flto"sv,
+                                          "-fno-lto"sv,
+                                          "-fsanitize"sv,
+                                          "-fno-sanitize"sv,
+                                          "-fprofile-"sv,
+                                          "-fno-profile-"sv,
+                                          "-fcoverage-"sv,
+                                          "-fdebug-"sv,
+                                          "-ffunction-sections"sv,
+                                          "-fdata-sections"sv,
+                                          "-fstack-protector"sv,
+                                          "-fno-stack-protector"sv,
+                                          "-fcf-protection"sv,
+                                          "-fuse-ld="sv,
+                                          "-Wl,"sv,
+                                          "-ftime-trace"sv};
+
+    constexpr auto irrelevant_flags = {"--coverage"sv,
+                                       "-ftest-coverage"sv,
+                                       "-pipe"sv,
+                                       "-save-temps"sv,
+                                       "-fomit-frame-pointer"sv,
+                                       "-fno-omit-frame-pointer"sv};
+
+    auto is_irrelevant(std::string_view flag) -> bool {
+      if (ranges::contains(irrelevant_flags, flag)) {
+        return true;
+      }
+      if (std::ranges::any_of(irrelevant_prefixes,
+                              [&](auto prefix) { return flag.starts_with(prefix); })) {
+        return true;
+      }
+      // -ObjC selects the language, and -gcc-toolchain isn't debug info.
+      if (flag.starts_with("-O")) {
+        return !flag.starts_with("-ObjC");
+      }
+      if (flag.starts_with("-g")) {
+        return !flag.starts_with("-gcc-");
+      }
+      return false;
+    }
+
+    void save_header(const std::string &path, const index_header &header) {
+      auto file = std::fstream{path, std::ios::binary | std::ios::in | std::ios::out};
+      if (!file.write(reinterpret_cast<const char *>(&header), sizeof(header))) {
+        spdlog::debug("Failed to refresh the header of index {}", path);
+      }
+    }
+  } // namespace
+
+  compile_db::compile_db(const std::string &json_file)
+    : json_file_(json_file) {
+    spdlog::trace("Enter compile_db::compile_db");
+    auto index_file = compile_db_index_file(json_file);
+    auto stamp      = stamp_of(json_file);
+    if (map(index_file)) {
+      auto header = read_at<index_header>(data_, 0);
+      if (header.json_size == stamp.size && header.json_mtime == stamp.mtime) {
+        spdlog::debug("Use index {} with {} commands", index_file, size());
+        json_size_  = header.json_size;
+        json_mtime_ = header.json_mtime;
+        json_hash_  = header.json_hash;
+        return;
+      }
+    }
+
+    // The json may be only touched, e.g. by a rerun of cmake, so the index is
+    // rebuilt only if the content is changed.
+    auto content = read_file(json_file);
+    auto hash    = stable_hash(content);
+    json_size_   = content.size();
+    json_mtime_  = stamp.mtime;
+    json_hash_   = hash;
+    if (mapped_ != nullptr) {
+      auto header = read_at<index_header>(data_, 0);
+      if (header.json_size == content.size() && header.json_hash == hash) {
+        spdlog::debug("Use index {} since content of {} isn't changed", index_file, json_file);
+        header.json_mtime = stamp.mtime;
+        save_header(index_file, header);
+        return;
+      }
+      unmap();
+    }
+
+    auto header       = index_header{};
+    header.json_size  = content.size();
+    header.json_mtime = stamp.mtime;
+    header.json_hash  = hash;
+    owned_            = build_index(json_file, content, header);
+    if (save_file(index_file, owned_) && map(index_file)) {
+      owned_ = std::string{};
+    } else {
+      data_ = owned_;
+    }
+    spdlog::info("Built index of compilation database {} with {} commands", json_file, size());
+  }
+
+  compile_db::~compile_db() {
+    unmap();
+  }
+
+  auto compile_db::map(const std::string &path) -> bool {
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat info {};
+    auto size  = ::fstat(fd, &info) == 0 ? static_cast<std::size_t>(info.st_size) : 0;
+    auto *addr = size >= sizeof(index_header)
+                 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                 : MAP_FAILED;
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      return false;
+    }
+
+    mapped_      = addr;
+    mapped_size_ = size;
+    data_        = std::string_view{static_cast<const char *>(addr), size};
+    if (!is_valid(data_)) {
+      spdlog::debug("Ignore broken index {}", path);
+      unmap();
+      return false;
+    }
+    return true;
+  }
+
+  void compile_db::unmap() {
+    if (mapped_ != nullptr) {
+      ::munmap(mapped_, mapped_size_);
+    }
+    mapped_      = nullptr;
+    mapped_size_ = 0;
+    data_        = {};
+  }
+
+  auto compile_db::lower_bound(std::string_view key) const -> std::size_t {
+    auto first = std::size_t{0};
+    auto count = size();
+    while (count > 0) {
+      auto step = count / 2;
+      if (string_at(data_, command_at(data_, first + step).file) < key) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    return first;
+  }
+
+  auto compile_db::find(std::string_view file) const -> std::optional<compile_command> {
+    auto path  = std::filesystem::absolute(std::filesystem::path{file}).lexically_normal();
+    auto key   = path.string();
+    auto first = lower_bound(key);
+    if (first == size() || string_at(data_, command_at(data_, first).file) != key) {
+      return std::nullopt;
+    }
+
+    auto ref       = command_at(data_, first);
+    auto arguments = layout_of(read_at<index_header>(data_, 0)).arguments;
+    auto command   = compile_command{.directory = std::string{string_at(data_, ref.directory)},
+                                     .file      = std::move(key),
+                                     .arguments = {}};
+    command.arguments.reserve(ref.argument_count);
+    for (auto idx = std::size_t{0}; idx < ref.argument_count; ++idx) {
+      auto offset = arguments + ((ref.first_argument + idx) * sizeof(std::uint32_t));
+      command.arguments.emplace_back(string_at(data_, read_at<std::uint32_t>(data_, offset)));
+    }
+    return command;
+  }
+
+  auto compile_db::contains(std::string_view file) const -> bool {
+    return find(file).has_value();
+  }
+
+  auto compile_db::contains_directory(std::string_view directory) const -> bool {
+    // Files under directory are adjacent since commands are sorted by file.
+    auto path   = std::filesystem::absolute(std::filesystem::path{directory}).lexically_normal();
+    auto prefix = (path / "").string();
+    auto first  = lower_bound(prefix);
+    return first != size() && string_at(data_, command_at(data_, first).file).starts_with(prefix);
+  }
+
+  auto compile_db::size() const -> std::size_t {
+    return read_at<index_header>(data_, 0).command_count;
+  }
+
+  auto compile_db::json_file() const -> const std::string & {
+    return json_file_;
+  }
+
+  auto compile_db::stale() -> bool {
+    auto stamp = stamp_of(json_file_);
+    if (stamp.size == json_size_ && stamp.mtime == json_mtime_) {
+      return false;
+    }
+    auto content = read_file(json_file_);
+    if (content.size() != json_size_ || stable_hash(content) != json_hash_) {
+      return true;
+    }
+    json_mtime_ = stamp.mtime;
+    return false;
+  }
+
+  auto compile_db_index_file(const std::string &json_file) -> std::string {
+    return json_file + ".index";
+  }
+
+  void write_compile_db(const std::string &directory,
+                        const std::vector<compile_command> &commands) {
+    spdlog::trace("Enter write_compile_db");
+    auto json = nlohmann::json::array();
+    for (const auto &command: commands) {
+      auto entry         = nlohmann::json::object();
+      entry["directory"] = command.directory;
+      entry["file"]      = command.file;
+      entry["arguments"] = command.arguments;
+      json.push_back(std::move(entry));
+    }
+
+    auto error = std::error_code{};
+    std::filesystem::create_directories(directory, error);
+    throw_if(static_cast<bool>(error),
+             fmt::format("failed to create directory {}: {}", directory, error.message()));
+
+    auto target = std::filesystem::path{directory} / "compile_commands.json";
+    auto data   = json.dump();
+    throw_unless(save_file(target.string(), data),
+                 fmt::format("failed to write compilation database {}", target.string()));
+  }
+
+  auto strip_irrelevant_flags(const std::vector<std::string> &arguments)
+    -> std::vector<std::string> {
+    auto stripped = std::vector<std::string>{};
+    stripped.reserve(arguments.size());
+    for (auto idx = std::size_t{0}; idx < arguments.size(); ++idx) {
+      const auto &argument = arguments[idx];
+      auto has_value       = idx + 1 < arguments.size();
+      if (idx == 0) {
+        // The compiler.
+        stripped.push_back(argument);
+      } else if (argument == "-Xlinker") {
+        ++idx;
+      } else if (ranges::contains(flags_with_value, argument) && has_value) {
+        stripped.push_back(argument);
+        stripped.push_back(arguments[++idx]);
+      } else if (!is_irrelevant(argument)) {
+        stripped.push_back(argument);
+      }
+    }
+    return stripped;
+  }
+
+  auto split_command_line(std::string_view command) -> std::vector<std::string> {
+    auto arguments = std::vector<std::string>{};
+    auto current   = std::string{};
+    auto started   = false;
+    auto quote     = '\0';
+    for (auto idx = std::size_t{0}; idx < command.size(); ++idx) {
+      auto c = command[idx];
+      if (quote == '\'') {
+        // Nothing is escaped in single quotes.
+        if (c == '\'') {
+          quote = '\0';
+        } else {
+          current += c;
+        }
+        continue;
+      }
+      if (c == '\\' && idx + 1 < command.size()) {
+        // In double quotes, backslash only escapes a few characters.
+        auto next = command[idx + 1];
+        if (quote == '"' && std::string_view{"\"\\$`"}.find(next) == std::string_view::npos) {
+          current += c;
+          continue;
+        }
+        current += next;
+        started  = true;
+        ++idx;
+        continue;
+      }
+      if (quote == '"') {
+        if (c == '"') {
+          quote = '\0';
+        } else {
+          current += c;
+        }
+        continue;
+      }
+      if (c == '\'' || c == '"') {
+        quote   = c;
+        started = true;
+      } else if (std::isspace(static_cast<unsigned char>(c)) != 0) {
+        if (started) {
+          arguments.push_back(std::move(current));
+          current = std::string{};
+          started = false;
+        }
+      } else {
+        current += c;
+        started  = true;
+      }
+    }
+    if (started) {
+      arguments.push_back(std::move(current));
+    }
+    return arguments;
+  }
+} // namespace lint::tool
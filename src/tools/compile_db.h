@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lint::tool {
+  /// The compile command of a translation unit.
+  struct compile_command {
+    /// The working directory of compiler.
+    std::string directory;
+
+    /// The absolute and normalized path of the translation unit.
+    std::string file;
+
+    /// The command line, beginning with the compiler.
+    std::vector<std::string> arguments;
+  };
+
+  /// A compact binary index of compile_commands.json. The json is parsed once
+  /// and the index is saved next to it, later runs only map the index into
+  /// memory until the size, mtime or content of json changes. Arguments are
+  /// interned since most of them are shared by translation units.
+  ///
+  /// The index file is laid out in the byte order of host:
+  ///   header    : magic, version, counts and the size, mtime and hash of json
+  ///   strings   : (offset, size) of each string
+  ///   commands  : (file, directory, first argument, argument count), sorted by file
+  ///   arguments : the string id of each argument
+  ///   characters: the characters of all strings
+  class compile_db {
+  public:
+    /// Open the index of the given compile_commands.json, building it if it's
+    /// missing or stale. The index is kept in memory if it can't be saved.
+    explicit compile_db(const std::string &json_file);
+
+    compile_db(const compile_db &)                     = delete;
+    auto operator=(const compile_db &) -> compile_db & = delete;
+    ~compile_db();
+
+    /// Find the command of file. A relative file is resolved against the
+    /// current directory. Only the first command is kept if a file has many.
+    [[nodiscard]] auto find(std::string_view file) const -> std::optional<compile_command>;
+
+    /// Whether the database has a command of file.
+    [[nodiscard]] auto contains(std::string_view file) const -> bool;
+
+    /// Whether the database has a command of any file under directory.
+    [[nodiscard]] auto contains_directory(std::string_view directory) const -> bool;
+
+    /// The number of translation units.
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /// The compile_commands.json which the index is built from.
+    [[nodiscard]] auto json_file() const -> const std::string &;
+
+    /// Whether the content of json has changed since it's opened. The content
+    /// is only compared once its size or mtime changes. Throws if the json
+    /// can't be read.
+    [[nodiscard]] auto stale() -> bool;
+
+  private:
+    /// The first command whose file isn't less than key.
+    [[nodiscard]] auto lower_bound(std::string_view key) const -> std::size_t;
+
+    auto map(const std::string &path) -> bool;
+    void unmap();
+
+    std::string json_file_;
+    std::uint64_t json_size_ = 0;
+    std::int64_t json_mtime_ = 0;
+    std::uint64_t json_hash_ = 0;
+    std::string owned_;
+    void *mapped_            = nullptr;
+    std::size_t mapped_size_ = 0;
+    std::string_view data_;
+  };
+
+  /// The index file of the given compile_commands.json.
+  auto compile_db_index_file(const std::string &json_file) -> std::string;
+
+  /// Write the commands as compile_commands.json in the given directory. The
+  /// file is replaced atomically, so it could be read while being written.
+  void write_compile_db(const std::string &directory, const std::vector<compile_command> &commands);
+
+  /// Drop the flags which don't affect analysis, such as optimization, debug
+  /// info, LTO, sanitizers and profiling. Macros and include paths are kept,
+  /// although predefined macros such as __OPTIMIZE__ are changed.
+  auto strip_irrelevant_flags(const std::vector<std::string> &arguments)
+    -> std::vector<std::string>;
+
+  /// Split the "command" field of compile_commands.json into arguments in the
+  /// way of shell: blanks separate arguments, quotes and backslashes escape.
+  auto split_command_line(std::string_view command) -> std::vector<std::string>;
+} // namespace lint::tool
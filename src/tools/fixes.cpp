@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/fixes.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+#include "utils/git_utils.h"
+
+namespace lint::tool {
+  namespace {
+    auto read_file(const std::filesystem::path &path) -> std::string {
+      auto file = std::ifstream{path, std::ios::binary};
+      throw_unless(file.is_open(), fmt::format("failed to open {} to fix", path.string()));
+      return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+
+    void write_file(const std::filesystem::path &path, const std::string &content) {
+      auto file = std::ofstream{path, std::ios::binary | std::ios::trunc};
+      throw_unless(file.is_open(), fmt::format("failed to open {} to fix", path.string()));
+      file << content;
+    }
+
+    auto order_of(const replacement &fix) {
+      return std::tie(fix.file, fix.offset, fix.length, fix.text);
+    }
+
+    // Whether fix overlaps with the last one, which isn't after it.
+    auto overlaps(const replacement &last, const replacement &fix) -> bool {
+      if (last.file != fix.file) {
+        return false;
+      }
+      // Two insertions at the same place are ambiguous in order.
+      if (last.length == 0) {
+        return fix.offset == last.offset && fix.length == 0;
+      }
+      return fix.offset < last.offset + last.length;
+    }
+
+    /// A line of the block style YAML written by clang-tidy: a key with a
+    /// scalar value, or with a nested block if the value is empty.
+    struct yaml_line {
+      std::size_t indent = 0;
+      bool item          = false;
+      std::string key;
+      std::string value;
+    };
+
+    /// Reads the lines of YAML. Quoted scalars may span many lines.
+    class yaml_reader {
+    public:
+      explicit yaml_reader(std::string_view yaml)
+        : yaml_(yaml) {
+      }
+
+      auto next() -> std::optional<yaml_line> {
+        while (pos_ < yaml_.size()) {
+          auto line   = yaml_line{};
+          line.indent = skip_blanks();
+          if (peek() == '-' && (peek(1) == ' ' || peek(1) == '\n')) {
+            ++pos_;
+            line.item    = true;
+            line.indent += 1 + skip_blanks();
+          }
+
+          auto end = yaml_.find_first_of(":\n", pos_);
+          if (end == std::string_view::npos || yaml_[end] == '\n') {
+            // Document markers, comments and blank lines.
+            skip_line();
+            continue;
+          }
+          line.key = std::string{yaml_.substr(pos_, end - pos_)};
+          pos_     = end + 1;
+          skip_blanks();
+          line.value = scalar();
+          skip_line();
+          return line;
+        }
+        return std::nullopt;
+      }
+
+    private:
+      [[nodiscard]] auto peek(std::size_t ahead = 0) const -> char {
+        return pos_ + ahead < yaml_.size() ? yaml_[pos_ + ahead] : '\0';
+      }
+
+      auto skip_blanks() -> std::size_t {
+        auto start = pos_;
+        while (peek() == ' ' || peek() == '\t') {
+          ++pos_;
+        }
+        return pos_ - start;
+      }
+
+      void skip_line() {
+        auto end = yaml_.find('\n', pos_);
+        pos_     = end == std::string_view::npos ? yaml_.size() : end + 1;
+      }
+
+      auto scalar() -> std::string {
+        if (peek() == '\'' || peek() == '"') {
+          return quoted(peek());
+        }
+        auto end   = yaml_.find('\n', pos_);
+        auto value = yaml_.substr(pos_, end == std::string_view::npos ? end : end - pos_);
+        pos_      += value.size();
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\r')) {
+          value.remove_suffix(1);
+        }
+        return std::string{value};
+      }
+
+      // Line breaks in quoted scalars are folded: a single one becomes a space
+      // and each of more ones becomes a newline.
+      void fold(std::string &value) {
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+          value.pop_back();
+        }
+        auto breaks = 0;
+        while (peek() == '\n' || peek() == '\r' || peek() == ' ' || peek() == '\t') {
+          breaks += peek() == '\n' ? 1 : 0;
+          ++pos_;
+        }
+        value.append(breaks > 1 ? breaks - 1 : 1, breaks > 1 ? '\n' : ' ');
+      }
+
+      auto quoted(char quote) -> std::string {
+        auto value = std::string{};
+        ++pos_;
+        while (pos_ < yaml_.size()) {
+          auto c = yaml_[pos_];
+          if (c == quote) {
+            if (quote == '\'' && peek(1) == '\'') {
+              value += '\'';
+              pos_  += 2;
+              continue;
+            }
+            ++pos_;
+            break;
+          }
+          if (c == '\n') {
+            fold(value);
+            continue;
+          }
+          if (c == '\\' && quote == '"') {
+            escape(value);
+            continue;
+          }
+          value += c;
+          ++pos_;
+        }
+        return value;
+      }
+
+      void escape(std::string &value) {
+        auto c = peek(1);
+        pos_  += 2;
+        switch (c) {
+        case 'n': value += '\n'; break;
+        case 't': value += '\t'; break;
+        case 'r': value += '\r'; break;
+        case '0': value += '\0'; break;
+        case 'x': value += static_cast<char>(hex(2)); break;
+        case 'u': append_utf8(value, hex(4)); break;
+        case '\n':
+          // An escaped line break joins lines without a space.
+          skip_blanks();
+          break;
+        default: value += c; break;
+        }
+      }
+
+      auto hex(std::size_t digits) -> std::uint32_t {
+        auto code = std::uint32_t{0};
+        auto end  = std::min(pos_ + digits, yaml_.size());
+        std::from_chars(yaml_.data() + pos_, yaml_.data() + end, code, 16);
+        pos_ = end;
+        return code;
+      }
+
+      static void append_utf8(std::string &value, std::uint32_t code) {
+        if (code < 0x80U) {
+          value += static_cast<char>(code);
+        } else if (code < 0x800U) {
+          value += static_cast<char>(0xC0U | (code >> 6U));
+          value += static_cast<char>(0x80U | (code & 0x3FU));
+        } else {
+          value += static_cast<char>(0xE0U | (code >> 12U));
+          value += static_cast<char>(0x80U | ((code >> 6U) & 0x3FU));
+          value += static_cast<char>(0x80U | (code & 0x3FU));
+        }
+      }
+
+      std::string_view yaml_;
+      std::size_t pos_ = 0;
+    };
+
+    auto to_size(const std::string &value) -> std::size_t {
+      auto size = std::size_t{0};
+      std::from_chars(value.data(), value.data() + value.size(), size);
+      return size;
+    }
+  } // namespace
+
+  auto merge_fixes(replacements fixes) -> merged_fixes {
+    spdlog::trace("Enter merge_fixes");
+    std::ranges::sort(fixes, [](const auto &lhs, const auto &rhs) {
+      return order_of(lhs) < order_of(rhs);
+    });
+
+    auto merged = merged_fixes{};
+    auto *last  = static_cast<const replacement *>(nullptr);
+    for (auto &fix: fixes) {
+      if (last != nullptr && *last == fix) {
+        ++merged.duplicates;
+      } else if (last != nullptr && overlaps(*last, fix)) {
+        merged.conflicts.push_back(std::move(fix));
+      } else {
+        auto &kept = merged.files[fix.file];
+        kept.push_back(std::move(fix));
+        last = &kept.back();
+      }
+    }
+    return merged;
+  }
+
+  auto apply_replacements(std::string_view content, const replacements &fixes) -> std::string {
+    auto fixed = std::string{};
+    auto pos   = std::size_t{0};
+    for (const auto &fix: fixes) {
+      throw_if(fix.offset < pos || fix.offset + fix.length > content.size(),
+               fmt::format("fix of {} at offset {} is out of range", fix.file, fix.offset));
+      fixed += content.substr(pos, fix.offset - pos);
+      fixed += fix.text;
+      pos    = fix.offset + fix.length;
+    }
+    fixed += content.substr(pos);
+    return fixed;
+  }
+
+  auto parse_exported_fixes(std::string_view yaml) -> replacements {
+    // The replacements of a diagnostic are under its DiagnosticMessage, or
+    // directly under it in the format before clang-tidy 9.
+    auto fixes  = replacements{};
+    auto keys   = std::vector<std::pair<std::size_t, std::string>>{};
+    auto reader = yaml_reader{yaml};
+    while (auto line = reader.next()) {
+      while (!keys.empty() && keys.back().first >= line->indent) {
+        keys.pop_back();
+      }
+
+      auto parent   = keys.size() < 2 ? std::string_view{} : keys[keys.size() - 2].second;
+      auto replaced = !keys.empty() && keys.back().second == "Replacements"
+                   && (parent == "DiagnosticMessage" || parent == "Diagnostics");
+      if (replaced && line->item) {
+        fixes.emplace_back();
+      }
+      if (replaced && !fixes.empty()) {
+        auto &fix = fixes.back();
+        if (line->key == "FilePath") {
+          fix.file = line->value;
+        } else if (line->key == "Offset") {
+          fix.offset = to_size(line->value);
+        } else if (line->key == "Length") {
+          fix.length = to_size(line->value);
+        } else if (line->key == "ReplacementText") {
+          fix.text = line->value;
+        }
+      }
+
+      if (line->value.empty()) {
+        keys.emplace_back(line->indent, line->key);
+      }
+    }
+    return fixes;
+  }
+
+  void write_fixes(const runtime_context &context, const merged_fixes &fixes) {
+    spdlog::trace("Enter write_fixes");
+    for (const auto &fix: fixes.conflicts) {
+      spdlog::warn("Drop the fix of {} at offset {} which conflicts with others",
+                   fix.file,
+                   fix.offset);
+    }
+    spdlog::info("Merged fixes of {} files, {} duplicated and {} conflicting fixes are dropped",
+                 fixes.files.size(),
+                 fixes.duplicates,
+                 fixes.conflicts.size());
+
+    auto root    = std::filesystem::path{context.repo_path};
+    auto patches = std::string{};
+    auto fixed   = std::vector<std::string>{};
+    auto blobs   = std::vector<std::pair<std::string, git_oid>>{};
+    for (const auto &[file, file_fixes]: fixes.files) {
+      if (std::filesystem::path{file}.is_absolute()) {
+        spdlog::warn("Skip the fixes of {} which is outside of repository", file);
+        continue;
+      }
+      auto content = read_file(root / file);
+      auto applied = apply_replacements(content, file_fixes);
+      if (applied == content) {
+        continue;
+      }
+      if (context.fix_mode == fix_mode_t::patch) {
+        auto patch = git::patch::create_from_buffers(
+          content, file, applied, file, git::diff::init_option());
+        patches += git::patch::to_str(*patch);
+      } else {
+        write_file(root / file, applied);
+        blobs.emplace_back(file, git::blob::create_from_buffer(*context.repo, applied));
+      }
+      fixed.push_back(file);
+    }
+
+    if (context.fix_mode == fix_mode_t::patch) {
+      write_file(context.fix_patch, patches);
+      spdlog::info("Fixes of {} files are written into {}", fixed.size(), context.fix_patch);
+      return;
+    }
+    if (fixed.empty()) {
+      spdlog::info("Nothing is fixed");
+      return;
+    }
+
+    // The fixed files are committed onto HEAD like `git commit <files>` does.
+    // The tree is built from HEAD in memory, so that changes the user staged
+    // aren't committed along with the fixes.
+    auto index = git::index::create();
+    if (auto head = git::repo::head_commit(*context.repo); head != nullptr) {
+      git::index::read_tree(*index, *git::commit::tree(*head));
+    }
+    for (const auto &[file, blob]: blobs) {
+      git::index::add_blob(*index, file, blob);
+    }
+    auto tree = git::tree::lookup(*context.repo, git::index::write_tree_to(*index, *context.repo));
+    auto id   = git::commit::create_head(*context.repo, "Apply fixes of cpp-lint-action", *tree);
+    spdlog::info("Fixes of {} files are committed as {}", fixed.size(), git::oid::to_str(id));
+
+    // Otherwise the index would revert the fixes in the next commit. Entries
+    // of other files are kept as staged.
+    auto staged = git::repo::index(*context.repo);
+    for (const auto &file: fixed) {
+      git::index::add_by_path(*staged, file);
+    }
+    git::index::write(*staged);
+  }
+} // namespace lint::tool
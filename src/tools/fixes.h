@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "context.h"
+
+namespace lint::tool {
+  /// Replace a range of a file with the text, like clang::tooling::Replacement.
+  struct replacement {
+    /// Relative to the root of repository, or absolute if it's outside.
+    std::string file;
+
+    /// The range in bytes of the content when the file is checked.
+    std::size_t offset = 0;
+    std::size_t length = 0;
+
+    std::string text;
+
+    auto operator==(const replacement &) const -> bool = default;
+  };
+
+  using replacements = std::vector<replacement>;
+
+  /// The fixes of all tools merged into one set of replacements.
+  struct merged_fixes {
+    /// Sorted and non-overlapping replacements of each file.
+    std::map<std::string, replacements> files;
+
+    /// The number of replacements made by more than one check.
+    std::size_t duplicates = 0;
+
+    /// The replacements overlapping with others which are dropped.
+    replacements conflicts;
+  };
+
+  /// Merge the fixes gathered from all tools. The same replacement made twice
+  /// is applied once, and of overlapping ones the first in order of file,
+  /// offset, length and text is kept, so that the result doesn't depend on
+  /// the order in which checks finish.
+  auto merge_fixes(replacements fixes) -> merged_fixes;
+
+  /// Apply sorted and non-overlapping replacements to the content.
+  auto apply_replacements(std::string_view content, const replacements &fixes) -> std::string;
+
+  /// Parse the replacements of diagnostics in the YAML file written by
+  /// clang-tidy --export-fixes. The alternative fixes of notes are ignored
+  /// like clang-apply-replacements does.
+  auto parse_exported_fixes(std::string_view yaml) -> replacements;
+
+  /// Apply merged fixes to the files of repository once. They are written
+  /// into a patch or committed onto HEAD by the fix mode of context.
+  void write_fixes(const runtime_context &context, const merged_fixes &fixes);
+
+  // clang-format off
+  NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(replacement, file, offset, length, text)
+  // clang-format on
+} // namespace lint::tool
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/history.h"
+
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/git_utils.h"
+
+namespace lint::tool {
+  namespace {
+    constexpr auto separator    = '\t';
+    constexpr auto peak_rss_key = std::string_view{"rss"};
+    constexpr auto duration_key = std::string_view{"ms"};
+    constexpr auto failed_key   = std::string_view{"fail"};
+
+    auto split(std::string_view line) -> std::vector<std::string_view> {
+      auto parts = std::vector<std::string_view>{};
+      while (true) {
+        auto idx = line.find(separator);
+        parts.push_back(line.substr(0, idx));
+        if (idx == std::string_view::npos) {
+          break;
+        }
+        line.remove_prefix(idx + 1);
+      }
+      return parts;
+    }
+
+    auto to_uint64(std::string_view value) -> std::uint64_t {
+      try {
+        return std::stoull(std::string{value});
+      } catch (const std::exception &) {
+        return 0;
+      }
+    }
+  } // namespace
+
+  auto history::make_key(std::string_view tool, std::string_view file) -> std::string {
+    auto key  = std::string{tool};
+    key      += separator;
+    key      += file;
+    return key;
+  }
+
+  void history::load(const std::string &path) {
+    spdlog::trace("Enter history::load");
+    auto file = std::ifstream{path};
+    if (!file.is_open()) {
+      spdlog::debug("No history file found at {}", path);
+      return;
+    }
+
+    auto lock = std::lock_guard{mutex_};
+    auto line = std::string{};
+    while (std::getline(file, line)) {
+      auto parts = split(line);
+      if (parts.size() < 2) {
+        continue;
+      }
+      auto &entry = entries_[make_key(parts[0], parts[1])];
+      for (auto iter = parts.begin() + 2; iter != parts.end(); ++iter) {
+        auto idx = iter->find('=');
+        if (idx == std::string_view::npos) {
+          continue;
+        }
+        auto key   = iter->substr(0, idx);
+        auto value = iter->substr(idx + 1);
+        if (key == peak_rss_key) {
+          entry.peak_rss = to_uint64(value);
+        } else if (key == duration_key) {
+          entry.duration = std::chrono::milliseconds{to_uint64(value)};
+        } else if (key == failed_key) {
+          entry.failed = to_uint64(value) != 0;
+        }
+      }
+    }
+    spdlog::debug("Loaded {} history entries from {}", entries_.size(), path);
+  }
+
+  void history::save(const std::string &path) const {
+    spdlog::trace("Enter history::save");
+    auto target = std::filesystem::path{path};
+    auto error  = std::error_code{};
+    if (target.has_parent_path()) {
+      std::filesystem::create_directories(target.parent_path(), error);
+    }
+
+    // Shards sharing a cached history, the daemon and parallel pre-commit
+    // runs may save at the same time, so each process writes its own
+    // temporary file and rename is atomic.
+    auto temp  = target;
+    temp      += fmt::format(".{}.tmp", ::getpid());
+    {
+      auto file = std::ofstream{temp, std::ios::trunc};
+      if (!file.is_open()) {
+        spdlog::warn("Failed to open history file {} to write", temp.string());
+        return;
+      }
+      auto lock = std::lock_guard{mutex_};
+      for (const auto &[key, entry]: entries_) {
+        file << key;
+        file << separator << peak_rss_key << '=' << entry.peak_rss;
+        file << separator << duration_key << '=' << entry.duration.count();
+        file << separator << failed_key << '=' << (entry.failed ? 1 : 0);
+        file << '\n';
+      }
+    }
+
+    // Rename is atomic so that concurrent readers never see a partial file.
+    std::filesystem::rename(temp, target, error);
+    if (error) {
+      spdlog::warn("Failed to save history file {}: {}", path, error.message());
+      std::filesystem::remove(temp, error);
+    }
+  }
+
+  auto history::find(std::string_view tool, std::string_view file) const
+    -> std::optional<history_entry> {
+    auto lock = std::lock_guard{mutex_};
+    auto iter = entries_.find(make_key(tool, file));
+    if (iter == entries_.end()) {
+      return std::nullopt;
+    }
+    return iter->second;
+  }
+
+  void history::update(std::string_view tool, std::string_view file, const history_entry &entry) {
+    auto lock                      = std::lock_guard{mutex_};
+    entries_[make_key(tool, file)] = entry;
+  }
+
+  auto history::size() const -> std::size_t {
+    auto lock = std::lock_guard{mutex_};
+    return entries_.size();
+  }
+
+  auto default_history_file(git_repository &repo) -> std::string {
+    auto path = std::filesystem::path{git::repo::path(repo)} / "cpp-lint-action" / "history";
+    return path.string();
+  }
+} // namespace lint::tool
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <git2/repository.h>
+
+namespace lint::tool {
+  /// The statistics of a file checked by a tool in previous runs.
+  struct history_entry {
+    /// The peak resident set size of the tool process in bytes.
+    std::uint64_t peak_rss = 0;
+
+    /// The wall time of checking the file.
+    std::chrono::milliseconds duration{0};
+
+    /// Whether the file didn't pass the check.
+    bool failed = false;
+  };
+
+  /// A small local store which records the statistics of previous runs. It's
+  /// persisted as one line per tool and file:
+  ///   <tool>\t<file>\t<key>=<value>\t<key>=<value>...
+  /// Unknown keys are ignored so that the format could be extended.
+  class history {
+  public:
+    /// Load history from the given file. A missing or broken file results in
+    /// an empty history since history is only used as a hint.
+    void load(const std::string &path);
+
+    /// Atomically save history to the given file. Failures are only logged.
+    void save(const std::string &path) const;
+
+    /// Find the entry of given tool and file.
+    [[nodiscard]] auto find(std::string_view tool, std::string_view file) const
+      -> std::optional<history_entry>;
+
+    /// Record the statistics of the latest run.
+    void update(std::string_view tool, std::string_view file, const history_entry &entry);
+
+    [[nodiscard]] auto size() const -> std::size_t;
+
+  private:
+    static auto make_key(std::string_view tool, std::string_view file) -> std::string;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, history_entry> entries_;
+  };
+
+  /// The default history file which lives in the git directory of repository.
+  auto default_history_file(git_repository &repo) -> std::string;
+} // namespace lint::tool
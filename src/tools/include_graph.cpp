@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/include_graph.h"
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#include <spdlog/spdlog.h>
+
+namespace lint::tool {
+  namespace {
+    auto resolve(const std::filesystem::path &directory, const std::string &path) -> std::string {
+      return (directory / path).lexically_normal().string();
+    }
+  } // namespace
+
+  void include_graph::load(const std::string &directory) {
+    spdlog::trace("Enter include_graph::load");
+    auto root  = std::filesystem::path{directory};
+    auto error = std::error_code{};
+    auto iter  = std::filesystem::recursive_directory_iterator{
+      root, std::filesystem::directory_options::skip_permission_denied, error};
+    auto end   = std::filesystem::recursive_directory_iterator{};
+    auto files = std::size_t{0};
+    for (; !error && iter != end; iter.increment(error)) {
+      if (iter->path().extension() != ".d" || !iter->is_regular_file(error)) {
+        continue;
+      }
+      auto file    = std::ifstream{iter->path()};
+      auto content = std::string{std::istreambuf_iterator<char>{file}, {}};
+      auto paths   = parse_dependency_file(content);
+      if (paths.empty()) {
+        continue;
+      }
+
+      auto headers = std::vector<std::string>{};
+      headers.reserve(paths.size() - 1);
+      for (auto idx = std::size_t{1}; idx < paths.size(); ++idx) {
+        headers.push_back(resolve(root, paths[idx]));
+      }
+      add(resolve(root, paths[0]), headers);
+      ++files;
+    }
+    if (error) {
+      spdlog::warn("Failed to read dependency files under {}: {}", directory, error.message());
+    }
+    spdlog::info("Read {} dependency files of {} translation units under {}",
+                 files,
+                 units_.size(),
+                 directory);
+  }
+
+  void include_graph::add(const std::string &unit, const std::vector<std::string> &headers) {
+    auto [iter, inserted] = ids_.try_emplace(unit, static_cast<std::uint32_t>(units_.size()));
+    if (inserted) {
+      units_.push_back(unit);
+    }
+    auto id = iter->second;
+    for (const auto &header: headers) {
+      auto &includers = includers_[header];
+      if (includers.empty() || includers.back() != id) {
+        includers.push_back(id);
+      }
+    }
+  }
+
+  auto include_graph::units_of(const std::string &header) const -> std::vector<std::string> {
+    auto units = std::vector<std::string>{};
+    auto iter  = includers_.find(header);
+    if (iter == includers_.end()) {
+      return units;
+    }
+    for (auto id: iter->second) {
+      units.push_back(units_[id]);
+    }
+    return units;
+  }
+
+  auto include_graph::size() const -> std::size_t {
+    return units_.size();
+  }
+
+  auto parse_dependency_file(std::string_view content) -> std::vector<std::string> {
+    auto prerequisites = std::vector<std::string>{};
+    auto current       = std::string{};
+    auto in_target     = true;
+    auto flush         = [&] {
+      if (!in_target && !current.empty()) {
+        prerequisites.push_back(std::move(current));
+      }
+      current = std::string{};
+    };
+
+    for (auto idx = std::size_t{0}; idx < content.size(); ++idx) {
+      auto c    = content[idx];
+      auto next = idx + 1 < content.size() ? content[idx + 1] : '\0';
+      if (c == '\\' && (next == '\n' || next == '\r')) {
+        // A continued line.
+        idx += (next == '\r' && idx + 2 < content.size() && content[idx + 2] == '\n') ? 2 : 1;
+        flush();
+        continue;
+      }
+      if (c == '\\' && (next == ' ' || next == '#')) {
+        current += next;
+        ++idx;
+        continue;
+      }
+      if (c == '$' && next == '$') {
+        current += '$';
+        ++idx;
+        continue;
+      }
+      if (in_target) {
+        // The target ends with a colon followed by a blank, so that the drive
+        // letter of Windows paths isn't mistaken.
+        if (c == ':' && std::isspace(static_cast<unsigned char>(next)) != 0) {
+          in_target = false;
+          current.clear();
+        } else if (c == '\n') {
+          current.clear();
+        }
+        continue;
+      }
+      if (c == '\n') {
+        break;
+      }
+      if (std::isspace(static_cast<unsigned char>(c)) != 0) {
+        flush();
+        continue;
+      }
+      current += c;
+    }
+    flush();
+    return prerequisites;
+  }
+} // namespace lint::tool
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lint::tool {
+  /// Which translation units include a header, read from the make-style
+  /// dependency files written by compilers with -MD. A dependency file lists
+  /// every header included by its source, directly or not.
+  class include_graph {
+  public:
+    /// Read the dependency files (*.d) under the directory recursively.
+    /// Relative paths in them are resolved against the directory.
+    void load(const std::string &directory);
+
+    /// Record that the translation unit includes the headers.
+    void add(const std::string &unit, const std::vector<std::string> &headers);
+
+    /// The translation units which include the header.
+    [[nodiscard]] auto units_of(const std::string &header) const -> std::vector<std::string>;
+
+    /// The number of translation units.
+    [[nodiscard]] auto size() const -> std::size_t;
+
+  private:
+    std::vector<std::string> units_;
+    std::unordered_map<std::string, std::uint32_t> ids_;
+    std::unordered_map<std::string, std::vector<std::uint32_t>> includers_;
+  };
+
+  /// Parse the prerequisites of the first rule of a make-style dependency
+  /// file, the first one of which is the source.
+  auto parse_dependency_file(std::string_view content) -> std::vector<std::string>;
+} // namespace lint::tool
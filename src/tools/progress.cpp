@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/progress.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace lint::tool {
+  progress_reporter::progress_reporter(const std::vector<tool_base_ptr> &tools,
+                                       option_t option,
+                                       progress_sink comment,
+                                       progress_sink review)
+    : tools_(tools)
+    , option_(option)
+    , comment_(std::move(comment))
+    , review_(std::move(review)) {
+    spdlog::trace("Enter progress_reporter::progress_reporter");
+    worker_ = std::thread{[this] { run(); }};
+  }
+
+  progress_reporter::~progress_reporter() {
+    stop();
+  }
+
+  void progress_reporter::finished(const task & /*finished_task*/, const file_outcome &outcome) {
+    {
+      auto lock = std::lock_guard{mutex_};
+      ++finished_;
+      if (!outcome.passed) {
+        ++failed_;
+      }
+    }
+    changed_.notify_one();
+  }
+
+  auto progress_reporter::callback() -> task_callback {
+    return [this](const task &finished_task, const file_outcome &outcome) {
+      finished(finished_task, outcome);
+    };
+  }
+
+  void progress_reporter::stop() {
+    {
+      auto lock = std::lock_guard{mutex_};
+      stopping_ = true;
+    }
+    changed_.notify_one();
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  auto progress_reporter::comment_pending() const -> bool {
+    return comment_ && finished_ != commented_;
+  }
+
+  auto progress_reporter::review_pending() const -> bool {
+    return review_ && failed_ != reviewed_;
+  }
+
+  void progress_reporter::run() {
+    auto lock = std::unique_lock{mutex_};
+    while (true) {
+      // Sleep until something finished, then until the earliest interval of
+      // pending updates passed. Checks finished meanwhile are published
+      // together.
+      changed_.wait(lock, [this] { return stopping_ || comment_pending() || review_pending(); });
+      auto due = clock::time_point::max();
+      if (comment_pending()) {
+        due = std::min(due, comment_due_);
+      }
+      if (review_pending()) {
+        due = std::min(due, review_due_);
+      }
+      changed_.wait_until(lock, due, [this] { return stopping_; });
+      if (stopping_) {
+        break;
+      }
+
+      auto now     = clock::now();
+      auto comment = comment_pending() && now >= comment_due_;
+      auto review  = review_pending() && now >= review_due_;
+      if (comment) {
+        commented_   = finished_;
+        comment_due_ = now + option_.comment_interval;
+      }
+      if (review) {
+        reviewed_   = failed_;
+        review_due_ = now + option_.review_interval;
+      }
+      auto progress = fmt::format("{} checks finished, {} failed so far", finished_, failed_);
+
+      lock.unlock();
+      publish(comment, review, progress);
+      lock.lock();
+    }
+  }
+
+  void progress_reporter::publish(bool comment, bool review, const std::string &progress) {
+    spdlog::trace("Enter progress_reporter::publish");
+    // Reporters copy the results under the lock of tools, so they're
+    // consistent snapshots while workers keep checking.
+    auto reporters = std::vector<reporter_base_ptr>{};
+    for (const auto &tool: tools_) {
+      reporters.push_back(tool->get_reporter());
+    }
+
+    // Progress is only a preview of the final report, so a failure doesn't
+    // stop the checks.
+    try {
+      if (comment) {
+        comment_(reporters, progress);
+      }
+      if (review) {
+        review_(reporters, progress);
+      }
+    } catch (const std::exception &err) {
+      spdlog::warn("Failed to report progress: {}", err.what());
+    }
+  }
+} // namespace lint::tool
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tools/base_reporter.h"
+#include "tools/base_tool.h"
+#include "tools/scheduler.h"
+
+namespace lint::tool {
+  using namespace std::chrono_literals;
+
+  /// Publish the reporters of the results checked so far. `progress` tells how
+  /// many checks have finished.
+  using progress_sink =
+    std::function<void(const std::vector<reporter_base_ptr> &, const std::string &progress)>;
+
+  /// Report the results of tools while they're still running. Workers only
+  /// count the finished checks, and a background thread publishes snapshots of
+  /// results at throttled intervals, so that workers never wait for Github.
+  /// The final results are left to the caller once checks are done.
+  class progress_reporter {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    struct option_t {
+      /// The minimal interval between two updates of the running comment.
+      std::chrono::milliseconds comment_interval = 30s;
+
+      /// The minimal interval between two batches of review comments.
+      std::chrono::milliseconds review_interval = 30s;
+    };
+
+    /// Empty sinks are never published to. The comment sink is published once
+    /// any check finished, while the review sink only once any check failed.
+    progress_reporter(const std::vector<tool_base_ptr> &tools,
+                      option_t option,
+                      progress_sink comment,
+                      progress_sink review);
+
+    progress_reporter(const progress_reporter &)                    = delete;
+    auto operator=(const progress_reporter &) -> progress_reporter & = delete;
+
+    ~progress_reporter();
+
+    /// Count a finished check. It's called from worker threads.
+    void finished(const task &finished_task, const file_outcome &outcome);
+
+    /// Return a callback of run_tools() which counts finished checks.
+    auto callback() -> task_callback;
+
+    /// Stop publishing and wait for the ongoing one.
+    void stop();
+
+  private:
+    void run();
+
+    /// Whether there is something which hasn't been published. Requires mutex_.
+    auto comment_pending() const -> bool;
+    auto review_pending() const -> bool;
+
+    void publish(bool comment, bool review, const std::string &progress);
+
+    const std::vector<tool_base_ptr> &tools_;
+    option_t option_;
+    progress_sink comment_;
+    progress_sink review_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool stopping_ = false;
+
+    std::size_t finished_  = 0;
+    std::size_t failed_    = 0;
+    std::size_t commented_ = 0;
+    std::size_t reviewed_  = 0;
+
+    // The first update is published once anything finished.
+    clock::time_point comment_due_;
+    clock::time_point review_due_;
+
+    std::thread worker_;
+  };
+} // namespace lint::tool
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stop_token>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+#include "utils/hash.h"
+
+namespace lint::tool {
+  namespace {
+    // Submits tasks to pool and records their outcomes into history. Each tool
+    // could be cancelled by itself when it fastly exits. All tools are
+    // cancelled together when fail fast is enabled.
+    class task_runner {
+    public:
+      task_runner(const std::vector<tool_base_ptr> &tools,
+                  const runtime_context &context,
+                  worker::pool &pool,
+                  history &records,
+                  const task_callback &on_finished)
+        : context_(context)
+        , pool_(pool)
+        , records_(records)
+        , on_finished_(on_finished) {
+        for (const auto &tool: tools) {
+          cancels_.emplace(tool.get(), std::stop_source{});
+        }
+      }
+
+      /// Submit the task. on_done is called once the task returns, even if
+      /// it's skipped or throws.
+      void submit(task job, std::function<void()> on_done = {}) {
+        spdlog::debug("Predicted {} on {}: {} bytes, {} ms",
+                      job.tool->name(),
+                      job.file,
+                      job.memory,
+                      job.duration.count());
+        auto memory = job.memory;
+        auto *tool  = job.tool;
+        auto run    = [this, job = std::move(job), on_done = std::move(on_done)] {
+          try {
+            run_task(job);
+          } catch (...) {
+            if (on_done) {
+              on_done();
+            }
+            throw;
+          }
+          if (on_done) {
+            on_done();
+          }
+        };
+        if (tool->runs_remotely(context_)) {
+          pool_.submit_remote(std::move(run), memory);
+        } else {
+          pool_.submit(std::move(run), memory);
+        }
+      }
+
+      /// Whether all tools are cancelled, so that submitted tasks are skipped.
+      [[nodiscard]] auto all_cancelled() const -> bool {
+        return std::ranges::all_of(cancels_,
+                                   [](const auto &pair) { return pair.second.stop_requested(); });
+      }
+
+    private:
+      void run_task(const task &job) {
+        auto start   = std::chrono::steady_clock::now();
+        auto outcome = job.tool->check_file(context_, job.file, cancels_.at(job.tool));
+        if (outcome.skipped) {
+          return;
+        }
+        if (!outcome.passed && context_.enable_fail_fast) {
+          spdlog::info("Cancel all tasks since {} failed on {}", job.tool->name(), job.file);
+          for (auto &[_, cancel]: cancels_) {
+            cancel.request_stop();
+          }
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        auto entry   = history_entry{
+            .peak_rss = outcome.peak_rss,
+            .duration = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed),
+            .failed   = !outcome.passed};
+        records_.update(job.tool->name(), job.file, entry);
+        if (on_finished_) {
+          on_finished_(job, outcome);
+        }
+      }
+
+      const runtime_context &context_;
+      worker::pool &pool_;
+      history &records_;
+      const task_callback &on_finished_;
+      std::unordered_map<const tool_base *, std::stop_source> cancels_;
+    };
+
+    // Wait for the pool once leaving the scope, even if submitting throws, so
+    // that queued tasks never use the locals of a returned function. Errors of
+    // tasks are only rethrown by an explicit wait().
+    class pool_guard {
+    public:
+      explicit pool_guard(worker::pool &pool)
+        : pool_(pool) {
+      }
+
+      ~pool_guard() {
+        if (waited_) {
+          return;
+        }
+        try {
+          pool_.wait();
+        } catch (const std::exception &err) {
+          spdlog::error("task failed while leaving: {}", err.what());
+        }
+      }
+
+      pool_guard(const pool_guard &)            = delete;
+      pool_guard &operator=(const pool_guard &) = delete;
+      pool_guard(pool_guard &&)                 = delete;
+      pool_guard &operator=(pool_guard &&)      = delete;
+
+      void wait() {
+        waited_ = true;
+        pool_.wait();
+      }
+
+    private:
+      worker::pool &pool_;
+      bool waited_ = false;
+    };
+
+    auto shard_key(const task &job) -> std::string {
+      return fmt::format("{}\t{}", job.tool->name(), job.file);
+    }
+  } // namespace
+
+  auto predict(tool_base &tool,
+               const std::string &file,
+               const runtime_context &context,
+               const history &records) -> history_entry {
+    auto entry = records.find(tool.name(), file).value_or(history_entry{});
+    if (entry.peak_rss != 0 && entry.duration.count() != 0) {
+      return entry;
+    }
+
+    auto error = std::error_code{};
+    auto size  = std::filesystem::file_size(std::filesystem::path{context.repo_path} / file, error);
+    if (error) {
+      size = 0;
+    }
+    if (entry.peak_rss == 0) {
+      entry.peak_rss = tool.estimate_memory(size);
+    }
+    if (entry.duration.count() == 0) {
+      entry.duration = tool.estimate_duration(size);
+    }
+    return entry;
+  }
+
+  void order_for_fail_fast(std::vector<task> &tasks) {
+    spdlog::trace("Enter order_for_fail_fast");
+    // The cheapest tool is the one with the smallest average wall time.
+    auto totals = std::unordered_map<const tool_base *, std::pair<double, std::size_t>>{};
+    for (const auto &job: tasks) {
+      auto &[sum, count]  = totals[job.tool];
+      sum                += static_cast<double>(job.duration.count());
+      ++count;
+    }
+    auto average = [&](const tool_base *tool) {
+      const auto &[sum, count] = totals.at(tool);
+      return sum / static_cast<double>(count);
+    };
+
+    std::ranges::stable_sort(tasks, [&](const task &lhs, const task &rhs) {
+      if (lhs.tool != rhs.tool) {
+        return average(lhs.tool) < average(rhs.tool);
+      }
+      if (lhs.failed_before != rhs.failed_before) {
+        return lhs.failed_before;
+      }
+      return lhs.duration < rhs.duration;
+    });
+  }
+
+  auto plan_tasks(const std::vector<tool_base_ptr> &tools,
+                  const runtime_context &context,
+                  const history &records) -> std::vector<task> {
+    spdlog::trace("Enter plan_tasks");
+    auto tasks = std::vector<task>{};
+    for (const auto &tool: tools) {
+      tool->use_history(records);
+      for (auto &file: tool->collect_files(context)) {
+        auto entry = predict(*tool, file, context, records);
+        tasks.push_back({.tool          = tool.get(),
+                         .file          = std::move(file),
+                         .memory        = entry.peak_rss,
+                         .duration      = entry.duration,
+                         .failed_before = entry.failed});
+      }
+    }
+
+    if (context.enable_fail_fast) {
+      order_for_fail_fast(tasks);
+    } else {
+      std::ranges::stable_sort(tasks, std::ranges::greater{}, &task::duration);
+    }
+    return tasks;
+  }
+
+  auto select_shard(std::vector<task> tasks,
+                    std::size_t index,
+                    std::size_t count,
+                    shard_strategy_t strategy) -> std::vector<task> {
+    spdlog::trace("Enter select_shard");
+    if (count <= 1) {
+      return tasks;
+    }
+
+    auto shards = std::vector<std::size_t>(tasks.size());
+    if (strategy == shard_strategy_t::hash) {
+      for (std::size_t i = 0; i < tasks.size(); ++i) {
+        shards[i] = stable_hash(shard_key(tasks[i])) % count;
+      }
+    } else {
+      // Greedily put the longest remaining task into the least loaded shard.
+      // Ties are broken by names so that all shards get the same assignment.
+      auto order = std::vector<std::size_t>(tasks.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::ranges::sort(order, [&](std::size_t lhs, std::size_t rhs) {
+        const auto &left  = tasks[lhs];
+        const auto &right = tasks[rhs];
+        return std::tuple{right.duration, left.tool->name(), left.file}
+             < std::tuple{left.duration, right.tool->name(), right.file};
+      });
+      auto loads = std::vector<std::chrono::milliseconds>(count);
+      for (auto idx: order) {
+        auto lightest = std::ranges::min_element(loads) - loads.begin();
+        shards[idx]   = static_cast<std::size_t>(lightest);
+        loads[shards[idx]] += tasks[idx].duration;
+      }
+    }
+
+    auto selected = std::vector<task>{};
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+      if (shards[i] == index) {
+        selected.push_back(std::move(tasks[i]));
+      }
+    }
+    spdlog::info("Shard {}/{} selects {} of {} tasks", index, count, selected.size(), tasks.size());
+    return selected;
+  }
+
+  auto run_tools(const std::vector<tool_base_ptr> &tools,
+                 const runtime_context &context,
+                 worker::pool &pool,
+                 history &records,
+                 const task_callback &on_finished) -> std::vector<reporter_base_ptr> {
+    spdlog::trace("Enter run_tools");
+    auto tasks = plan_tasks(tools, context, records);
+    tasks      = select_shard(
+      std::move(tasks), context.shard_index, context.shard_count, context.shard_strategy);
+    spdlog::info("Run {} tasks with {} concurrent jobs", tasks.size(), pool.concurrency());
+
+    auto runner = task_runner{tools, context, pool, records, on_finished};
+    auto guard  = pool_guard{pool};
+    for (auto &job: tasks) {
+      runner.submit(std::move(job));
+    }
+    guard.wait();
+
+    auto ret = std::vector<reporter_base_ptr>{};
+    for (const auto &tool: tools) {
+      ret.emplace_back(tool->get_reporter());
+    }
+    return ret;
+  }
+
+  auto scan_tools(const std::vector<tool_base_ptr> &tools,
+                  const runtime_context &context,
+                  worker::pool &pool,
+                  history &records,
+                  const file_source &files,
+                  const task_callback &on_finished) -> std::vector<reporter_base_ptr> {
+    spdlog::trace("Enter scan_tools");
+    throw_if(context.shard_count > 1 && context.shard_strategy != shard_strategy_t::hash,
+             "only hash strategy could shard the tasks of scanning");
+
+    // Tools prepare their results while collecting files, and there are no
+    // changed files when scanning.
+    for (const auto &tool: tools) {
+      tool->use_history(records);
+      tool->collect_files(context);
+    }
+
+    // Only a window of tasks are queued in pool, so that the memory doesn't
+    // grow with the number of files.
+    auto window  = (pool.workers() + pool.remote_workers()) * 2;
+    auto mutex   = std::mutex{};
+    auto done    = std::condition_variable{};
+    auto pending = std::size_t{0};
+    auto release = [&] {
+      {
+        auto lock = std::lock_guard{mutex};
+        --pending;
+      }
+      done.notify_one();
+    };
+
+    auto runner = task_runner{tools, context, pool, records, on_finished};
+    auto guard  = pool_guard{pool};
+    auto number = std::size_t{0};
+    files([&](const std::string &file) {
+      if (runner.all_cancelled()) {
+        return;
+      }
+      for (const auto &tool: tools) {
+        if (!tool->accepts(file)) {
+          continue;
+        }
+        auto entry = predict(*tool, file, context, records);
+        auto job   = task{.tool          = tool.get(),
+                          .file          = file,
+                          .memory        = entry.peak_rss,
+                          .duration      = entry.duration,
+                          .failed_before = entry.failed};
+        if (context.shard_count > 1
+            && stable_hash(shard_key(job)) % context.shard_count != context.shard_index) {
+          continue;
+        }
+
+        {
+          auto lock = std::unique_lock{mutex};
+          done.wait(lock, [&] { return pending < window; });
+          ++pending;
+        }
+        runner.submit(std::move(job), release);
+        ++number;
+      }
+    });
+    guard.wait();
+    spdlog::info("Ran {} tasks of scanning with {} concurrent jobs", number, pool.concurrency());
+
+    auto ret = std::vector<reporter_base_ptr>{};
+    for (const auto &tool: tools) {
+      ret.emplace_back(tool->get_reporter());
+    }
+    return ret;
+  }
+} // namespace lint::tool
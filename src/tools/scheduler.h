@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "context.h"
+#include "tools/base_reporter.h"
+#include "tools/base_tool.h"
+#include "tools/history.h"
+#include "utils/worker_pool.h"
+
+namespace lint::tool {
+  /// The smallest unit of work: apply one tool to one file.
+  struct task {
+    tool_base *tool = nullptr;
+    std::string file;
+
+    /// The predicted peak memory in bytes of this task.
+    std::uint64_t memory = 0;
+
+    /// The predicted wall time of this task.
+    std::chrono::milliseconds duration{0};
+
+    /// Whether the file failed this tool in the previous run.
+    bool failed_before = false;
+  };
+
+  /// Predict the peak memory and wall time of applying the tool to the file.
+  /// The statistics of previous runs are preferred, otherwise they're
+  /// estimated by file size.
+  auto predict(tool_base &tool,
+               const std::string &file,
+               const runtime_context &context,
+               const history &records) -> history_entry;
+
+  /// Order tasks so that a failure is found as early as possible: the cheapest
+  /// tool goes first, and within a tool the files which failed in the previous
+  /// run go first, then the shortest ones.
+  void order_for_fail_fast(std::vector<task> &tasks);
+
+  /// Plan the tasks of all given tools. Tasks are ordered longest first so that
+  /// the slowest files don't start last and extend the whole run, unless fail
+  /// fast is enabled.
+  auto plan_tasks(const std::vector<tool_base_ptr> &tools,
+                  const runtime_context &context,
+                  const history &records) -> std::vector<task>;
+
+  /// Select the tasks of the given shard. All shards must be given the same
+  /// tasks so that every task is selected by exactly one shard. The planned
+  /// order is kept.
+  auto select_shard(std::vector<task> tasks,
+                    std::size_t index,
+                    std::size_t count,
+                    shard_strategy_t strategy) -> std::vector<task>;
+
+  /// Called from worker threads once a task finished without being skipped.
+  using task_callback = std::function<void(const task &, const file_outcome &)>;
+
+  /// Run the given tools on the worker pool and return the reporter of each
+  /// tool in order. The measured peak memory and wall time of each task are
+  /// recorded into history.
+  auto run_tools(const std::vector<tool_base_ptr> &tools,
+                 const runtime_context &context,
+                 worker::pool &pool,
+                 history &records,
+                 const task_callback &on_finished = {}) -> std::vector<reporter_base_ptr>;
+
+  /// Enumerates files by calling the given visitor for each of them.
+  using file_source = std::function<void(const std::function<void(const std::string &)> &)>;
+
+  /// Like run_tools(), but apply the tools to every file they accept from the
+  /// given source instead of the changed files. Tasks are submitted while files
+  /// are being enumerated, and at most twice the workers of pool are waiting,
+  /// so the memory doesn't grow with the number of files. Tasks are run in the
+  /// order of files and can only be sharded by hash.
+  auto scan_tools(const std::vector<tool_base_ptr> &tools,
+                  const runtime_context &context,
+                  worker::pool &pool,
+                  history &records,
+                  const file_source &files,
+                  const task_callback &on_finished = {}) -> std::vector<reporter_base_ptr>;
+} // namespace lint::tool
@@ -25,8 +25,8 @@
 namespace lint::tool {
   // Find the full executable path of clang tools with specific version.
   inline auto find_clang_tool(std::string_view tool, std::string_view version) -> std::string {
-    auto command                = fmt::format("{}-{}", tool, version);
-    auto [ec, std_out, std_err] = shell::which(command);
+    auto command                                  = fmt::format("{}-{}", tool, version);
+    auto [ec, std_out, std_err, peak_rss, killed] = shell::which(command);
     throw_if(ec != 0, fmt::format("find {}-{} failed, error message: {}", tool, version, std_err));
     auto trimmed = trim(std_out);
     throw_if(trimmed.empty(), "got empty clang tool path");
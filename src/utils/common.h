@@ -25,17 +25,14 @@
 
 namespace lint {
   constexpr auto trim_left(std::string_view str) -> std::string_view {
-    if (auto idx = str.find_first_not_of(" \n"); idx < str.size()) {
-      str.remove_prefix(idx);
-    }
+    auto idx = str.find_first_not_of(" \n");
+    str.remove_prefix(idx < str.size() ? idx : str.size());
     return str;
   }
 
   constexpr auto trim_right(std::string_view str) -> std::string_view {
     auto idx = str.find_last_not_of(" \n");
-    if (idx < str.size()) {
-      str.remove_suffix(str.size() - idx - 1);
-    }
+    str.remove_suffix(idx < str.size() ? str.size() - idx - 1 : str.size());
     return str;
   }
 
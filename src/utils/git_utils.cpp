@@ -17,6 +17,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <exception>
 #include <filesystem>
 #include <git2/buffer.h>
 #include <git2/diff.h>
@@ -189,6 +190,13 @@ namespace lint::git {
       return {repo, ::git_repository_free};
     }
 
+    auto discover(const std::string &start_path) -> repo_ptr {
+      auto *repo = static_cast<git_repository *>(nullptr);
+      auto ret   = ::git_repository_open_ext(&repo, start_path.c_str(), 0, nullptr);
+      throw_if(ret);
+      return {repo, ::git_repository_free};
+    }
+
     auto state(git_repository &repo) -> int {
       return ::git_repository_state(&repo);
     }
@@ -199,6 +207,13 @@ namespace lint::git {
       return ret;
     }
 
+    auto is_ignored(git_repository &repo, const std::string &path) -> bool {
+      auto ignored = 0;
+      auto ret     = ::git_ignore_path_is_ignored(&ignored, &repo, path.c_str());
+      throw_if(ret);
+      return ignored == 1;
+    }
+
     bool is_empty(git_repository &repo) {
       auto ret = ::git_repository_is_empty(&repo);
       throw_if(ret);
@@ -491,6 +506,17 @@ namespace lint::git {
       return {ptr, ::git_diff_free};
     }
 
+    auto tree_to_index(
+      git_repository &repo,
+      git_tree *old_tree,
+      git_index &index,
+      const git_diff_options &opts) -> diff_ptr {
+      auto *ptr = static_cast<git_diff *>(nullptr);
+      auto ret  = ::git_diff_tree_to_index(&ptr, &repo, old_tree, &index, &opts);
+      throw_if(ret);
+      return {ptr, ::git_diff_free};
+    }
+
     auto commit_to_commit(git_repository &repo, git_commit &commit1, git_commit &commit2)
       -> diff_ptr {
       auto tree1 = commit::tree(commit1);
@@ -722,6 +748,38 @@ namespace lint::git {
   } // namespace sig
 
   namespace index {
+    auto create() -> index_ptr {
+      auto *idx = static_cast<git_index *>(nullptr);
+      auto ret  = ::git_index_new(&idx);
+      throw_if(ret);
+      return {idx, ::git_index_free};
+    }
+
+    void read_tree(git_index &index, const git_tree &tree) {
+      auto ret = ::git_index_read_tree(&index, &tree);
+      throw_if(ret);
+    }
+
+    void add_blob(git_index &index, const std::string &path, const git_oid &id) {
+      auto entry = git_index_entry{};
+      if (const auto *existing = ::git_index_get_bypath(&index, path.c_str(), 0); existing) {
+        entry = *existing;
+      } else {
+        entry.mode = GIT_FILEMODE_BLOB;
+      }
+      entry.path = path.c_str();
+      entry.id   = id;
+      auto ret   = ::git_index_add(&index, &entry);
+      throw_if(ret);
+    }
+
+    auto write_tree_to(git_index &index, git_repository &repo) -> git_oid {
+      auto oid = git_oid{};
+      auto ret = ::git_index_write_tree_to(&oid, &index, &repo);
+      throw_if(ret);
+      return oid;
+    }
+
     void write(git_index &index) {
       auto ret = ::git_index_write(&index);
       throw_if(ret);
@@ -792,6 +850,35 @@ namespace lint::git {
       return {*oid, entry};
     }
 
+    void walk_files(const git_tree &tree, const std::function<void(const std::string &)> &visit) {
+      struct walker {
+        const std::function<void(const std::string &)> &visit;
+        std::exception_ptr error;
+      };
+      auto callback = [](const char *root, const git_tree_entry *entry, void *payload) -> int {
+        auto &state = *static_cast<walker *>(payload);
+        auto mode   = ::git_tree_entry_filemode(entry);
+        if (mode != GIT_FILEMODE_BLOB && mode != GIT_FILEMODE_BLOB_EXECUTABLE) {
+          return 0;
+        }
+        try {
+          state.visit(fmt::format("{}{}", root, ::git_tree_entry_name(entry)));
+          return 0;
+        } catch (...) {
+          // Exceptions can't be thrown across libgit2.
+          state.error = std::current_exception();
+          return -1;
+        }
+      };
+
+      auto state = walker{.visit = visit, .error = nullptr};
+      auto ret   = ::git_tree_walk(&tree, GIT_TREEWALK_PRE, callback, &state);
+      if (state.error) {
+        std::rethrow_exception(state.error);
+      }
+      throw_if(ret);
+    }
+
   } // namespace tree
 
   namespace status {
@@ -989,7 +1076,15 @@ namespace lint::git {
     auto get_raw_content(const git_blob &blob) -> std::string {
       const auto *ret = ::git_blob_rawcontent(&blob);
       throw_if(ret == nullptr, "get raw content by blob error");
-      return static_cast<const char *>(ret);
+      // Blobs may contain null characters.
+      return {static_cast<const char *>(ret), static_cast<std::size_t>(::git_blob_rawsize(&blob))};
+    }
+
+    auto create_from_buffer(git_repository &repo, const std::string &content) -> git_oid {
+      auto oid = git_oid{};
+      auto ret = ::git_blob_create_from_buffer(&oid, &repo, content.data(), content.size());
+      throw_if(ret);
+      return oid;
     }
 
     auto get_raw_content(git_repository &repo, const git_tree &tree, const std::string &file_name)
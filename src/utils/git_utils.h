@@ -17,6 +17,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <git2/types.h>
 #include <memory>
 #include <optional>
@@ -103,6 +104,10 @@ namespace lint::git {
     /// Open a git repository.
     auto open(const std::string &repo_path) -> repo_ptr;
 
+    /// Open the git repository containing the given path, which is looked up
+    /// from the path to its parents. Linked worktrees are supported as well.
+    auto discover(const std::string &start_path) -> repo_ptr;
+
     /// Determines the status of a git repository - ie, whether an operation
     /// (merge, cherry-pick, etc) is in progress.
     auto state(git_repository &repo) -> int;
@@ -111,6 +116,10 @@ namespace lint::git {
     /// for normal repositories, or of the repository itself for bare repositories.
     auto path(git_repository &repo) -> std::string;
 
+    /// Test whether the ignore rules of repository apply to the given path,
+    /// which is relative to the working directory.
+    auto is_ignored(git_repository &repo, const std::string &path) -> bool;
+
     /// Check if a repository is empty
     auto is_empty(git_repository &repo) -> bool;
 
@@ -323,6 +332,14 @@ namespace lint::git {
       git_tree &new_tree,
       const git_diff_options &opts) -> diff_ptr;
 
+    /// Create a diff between a tree and the repository index. A null tree is
+    /// treated as the empty one, e.g. when HEAD is unborn.
+    auto tree_to_index(
+      git_repository &repo,
+      git_tree *old_tree,
+      git_index &index,
+      const git_diff_options &opts) -> diff_ptr;
+
     /// Create a diff with the difference between two commits.
     auto commit_to_commit(git_repository &repo, git_commit &commit1, git_commit &commit2)
       -> diff_ptr;
@@ -519,6 +536,21 @@ namespace lint::git {
   } // namespace sig
 
   namespace index {
+    /// Create an in-memory index which isn't backed by any file, e.g. to build
+    /// a tree without touching the index of repository.
+    auto create() -> index_ptr;
+
+    /// Replace the entries of index by the ones of tree.
+    void read_tree(git_index &index, const git_tree &tree);
+
+    /// Add or update the entry of path to the given blob. The mode of entry is
+    /// kept if it exists, or else it's a regular file.
+    void add_blob(git_index &index, const std::string &path, const git_oid &id);
+
+    /// Same as write_tree but the tree is written into the given repository,
+    /// which works for in-memory indexes as well.
+    [[nodiscard]] auto write_tree_to(git_index &index, git_repository &repo) -> git_oid;
+
     ///  Write an existing index object from memory back to disk using an atomic
     ///  file lock.
     void write(git_index &index);
@@ -575,6 +607,11 @@ namespace lint::git {
     auto entry_byname(const git_tree &tree, const std::string &filename)
       -> std::tuple<git_oid, const git_tree_entry *>;
 
+    /// Visit the paths of regular files in the tree recursively. Subtrees are
+    /// loaded one by one while walking, so the whole tree is never held in
+    /// memory. Exceptions thrown by visit stop the walk and are rethrown.
+    void walk_files(const git_tree &tree, const std::function<void(const std::string &)> &visit);
+
   } // namespace tree
 
   namespace status {
@@ -674,6 +711,9 @@ namespace lint::git {
     /// Get a buffer with the raw content of a blob.
     auto get_raw_content(const git_blob &blob) -> std::string;
 
+    /// Write the content into the repository as a blob.
+    auto create_from_buffer(git_repository &repo, const std::string &content) -> git_oid;
+
     /// A utility to get raw content by file name. Return empty if file not found.
     auto get_raw_content(git_repository &repo, const git_tree &tree, const std::string &file_name)
       -> std::string;
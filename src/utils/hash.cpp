@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/hash.h"
+
+namespace lint {
+  // FNV-1a
+  auto stable_hash(std::string_view data) -> std::uint64_t {
+    constexpr auto offset_basis = std::uint64_t{14695981039346656037U};
+    constexpr auto prime        = std::uint64_t{1099511628211U};
+    auto hash                   = offset_basis;
+    for (auto chr: data) {
+      hash ^= static_cast<unsigned char>(chr);
+      hash *= prime;
+    }
+    return hash;
+  }
+} // namespace lint
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/resource.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <sched.h>
+
+#include <spdlog/spdlog.h>
+
+namespace lint::resource {
+  namespace {
+    constexpr auto cgroup_root = "/sys/fs/cgroup";
+
+    auto read_file(const std::filesystem::path &path) -> std::optional<std::string> {
+      auto file = std::ifstream{path};
+      if (!file.is_open()) {
+        return std::nullopt;
+      }
+      auto buffer = std::stringstream{};
+      buffer << file.rdbuf();
+      return buffer.str();
+    }
+
+    // Visit the cgroup directory of current process and all of its ancestors
+    // up to the cgroup root. Limits of ancestors also apply to us.
+    template <class Func>
+    void for_each_cgroup_level(Func &&func) {
+      auto dir = cgroup_dir();
+      if (dir.empty()) {
+        return;
+      }
+      auto path = std::filesystem::path{dir};
+      auto root = std::filesystem::path{cgroup_root};
+      while (true) {
+        func(path);
+        if (path == root || !path.has_parent_path() || path == path.parent_path()) {
+          break;
+        }
+        path = path.parent_path();
+      }
+    }
+  } // namespace
+
+  auto parse_cpu_max(std::string_view content) -> double {
+    auto stream = std::istringstream{std::string{content}};
+    auto quota  = std::string{};
+    auto period = std::uint64_t{100000};
+    stream >> quota >> period;
+    if (quota.empty() || quota == "max" || period == 0) {
+      return 0;
+    }
+    try {
+      return static_cast<double>(std::stoull(quota)) / static_cast<double>(period);
+    } catch (const std::exception &) {
+      return 0;
+    }
+  }
+
+  auto parse_memory_max(std::string_view content) -> std::uint64_t {
+    auto stream = std::istringstream{std::string{content}};
+    auto value  = std::string{};
+    stream >> value;
+    if (value.empty() || value == "max") {
+      return 0;
+    }
+    try {
+      return std::stoull(value);
+    } catch (const std::exception &) {
+      return 0;
+    }
+  }
+
+  // Example:
+  // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  auto parse_pressure(std::string_view content) -> std::optional<pressure> {
+    auto res    = pressure{};
+    auto found  = false;
+    auto stream = std::istringstream{std::string{content}};
+    auto line   = std::string{};
+    while (std::getline(stream, line)) {
+      auto words = std::istringstream{line};
+      auto kind  = std::string{};
+      auto field = std::string{};
+      words >> kind >> field;
+      constexpr auto avg10 = std::string_view{"avg10="};
+      if (!field.starts_with(avg10)) {
+        continue;
+      }
+      auto value = std::strtod(field.c_str() + avg10.size(), nullptr);
+      if (kind == "some") {
+        res.some_avg10 = value;
+        found          = true;
+      } else if (kind == "full") {
+        res.full_avg10 = value;
+        found          = true;
+      }
+    }
+    if (!found) {
+      return std::nullopt;
+    }
+    return res;
+  }
+
+  // The cgroup v2 entry of /proc/self/cgroup looks like: 0::/user.slice/xxx
+  auto cgroup_dir() -> std::string {
+    if (!std::filesystem::exists(std::filesystem::path{cgroup_root} / "cgroup.controllers")) {
+      return "";
+    }
+    auto content = read_file("/proc/self/cgroup");
+    if (!content) {
+      return "";
+    }
+    auto stream = std::istringstream{*content};
+    auto line   = std::string{};
+    while (std::getline(stream, line)) {
+      if (!line.starts_with("0::")) {
+        continue;
+      }
+      auto relative = line.substr(3);
+      if (relative.empty() || relative == "/") {
+        break;
+      }
+      auto dir = std::filesystem::path{std::string{cgroup_root} + relative}.lexically_normal();
+      if (std::filesystem::exists(dir)) {
+        return dir.string();
+      }
+      break;
+    }
+    return cgroup_root;
+  }
+
+  auto read_cgroup_limits() -> cgroup_limits {
+    spdlog::trace("Enter resource::read_cgroup_limits");
+    auto limits = cgroup_limits{};
+    for_each_cgroup_level([&](const std::filesystem::path &dir) {
+      if (auto cpu = read_file(dir / "cpu.max"); cpu) {
+        auto quota = parse_cpu_max(*cpu);
+        if (quota > 0 && (limits.cpu_quota == 0 || quota < limits.cpu_quota)) {
+          limits.cpu_quota = quota;
+        }
+      }
+      if (auto memory = read_file(dir / "memory.max"); memory) {
+        auto max = parse_memory_max(*memory);
+        if (max > 0 && (limits.memory_max == 0 || max < limits.memory_max)) {
+          limits.memory_max = max;
+        }
+      }
+    });
+    return limits;
+  }
+
+  auto read_pressure(const std::string &name) -> std::optional<pressure> {
+    if (auto dir = cgroup_dir(); !dir.empty()) {
+      auto content = read_file(std::filesystem::path{dir} / (name + ".pressure"));
+      if (content) {
+        if (auto res = parse_pressure(*content); res) {
+          return res;
+        }
+      }
+    }
+    auto content = read_file(std::filesystem::path{"/proc/pressure"} / name);
+    if (!content) {
+      return std::nullopt;
+    }
+    return parse_pressure(*content);
+  }
+
+  auto load_average() -> std::optional<double> {
+    auto loads = std::array<double, 3>{};
+    if (::getloadavg(loads.data(), 1) != 1) {
+      return std::nullopt;
+    }
+    return loads[0];
+  }
+
+  auto online_cpus() -> std::size_t {
+    auto set = cpu_set_t{};
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+      auto count = CPU_COUNT(&set);
+      if (count > 0) {
+        return static_cast<std::size_t>(count);
+      }
+    }
+    return std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  auto available_cpus(const cgroup_limits &limits) -> std::size_t {
+    auto cpus = online_cpus();
+    if (limits.cpu_quota > 0) {
+      auto quota = static_cast<std::size_t>(std::ceil(limits.cpu_quota));
+      cpus       = std::clamp<std::size_t>(quota, 1, cpus);
+    }
+    return cpus;
+  }
+
+  // Example:
+  // MemTotal:       32768000 kB
+  // MemAvailable:   16384000 kB
+  auto parse_meminfo_available(std::string_view content) -> std::uint64_t {
+    auto stream = std::istringstream{std::string{content}};
+    auto line   = std::string{};
+    while (std::getline(stream, line)) {
+      auto words = std::istringstream{line};
+      auto key   = std::string{};
+      auto value = std::uint64_t{0};
+      words >> key >> value;
+      if (key == "MemAvailable:") {
+        return value * 1024;
+      }
+    }
+    return 0;
+  }
+
+  auto available_memory() -> std::uint64_t {
+    auto content = read_file("/proc/meminfo");
+    if (!content) {
+      return 0;
+    }
+    return parse_meminfo_available(*content);
+  }
+
+  auto default_memory_budget(const cgroup_limits &limits, std::uint64_t available)
+    -> std::uint64_t {
+    // Leave some headroom for ourselves and the page cache.
+    constexpr auto usable_percent = std::uint64_t{90};
+
+    auto memory = available;
+    if (limits.memory_max != 0 && (memory == 0 || limits.memory_max < memory)) {
+      memory = limits.memory_max;
+    }
+    return memory / 100 * usable_percent;
+  }
+} // namespace lint::resource
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// Utilities to query the resources this process is allowed to use. Only
+/// cgroup v2 and Linux PSI are supported, other systems fall back to the
+/// number of online CPUs, the load average and /proc/meminfo.
+namespace lint::resource {
+  /// The limits set by the cgroup v2 controllers of current process.
+  struct cgroup_limits {
+    /// The CPU quota in number of CPUs. 0 means unlimited.
+    double cpu_quota = 0;
+
+    /// The memory limit in bytes. 0 means unlimited.
+    std::uint64_t memory_max = 0;
+  };
+
+  /// The pressure stall information of a resource. Values are percentages.
+  struct pressure {
+    double some_avg10 = 0;
+    double full_avg10 = 0;
+  };
+
+  /// Parse the content of cgroup v2 cpu.max file, e.g. "200000 100000".
+  /// Return the quota in number of CPUs or 0 if unlimited.
+  auto parse_cpu_max(std::string_view content) -> double;
+
+  /// Parse the content of cgroup v2 memory.max file. Return 0 if unlimited.
+  auto parse_memory_max(std::string_view content) -> std::uint64_t;
+
+  /// Parse the content of a PSI file, e.g. /proc/pressure/cpu.
+  auto parse_pressure(std::string_view content) -> std::optional<pressure>;
+
+  /// Get the cgroup v2 directory of current process. Return empty if cgroup v2
+  /// isn't mounted.
+  auto cgroup_dir() -> std::string;
+
+  /// Read the cgroup v2 limits of current process.
+  auto read_cgroup_limits() -> cgroup_limits;
+
+  /// Read the pressure of given resource. The resource could be cpu, memory or
+  /// io. The pressure of current cgroup is preferred over the system one.
+  auto read_pressure(const std::string &name) -> std::optional<pressure>;
+
+  /// Get the 1-minute load average of system.
+  auto load_average() -> std::optional<double>;
+
+  /// Get the number of CPUs current process is allowed to run on.
+  auto online_cpus() -> std::size_t;
+
+  /// Get the number of CPUs could be used by taking cgroup quota into account.
+  auto available_cpus(const cgroup_limits &limits) -> std::size_t;
+
+  /// Parse the content of /proc/meminfo. Return MemAvailable in bytes or 0 if
+  /// not found.
+  auto parse_meminfo_available(std::string_view content) -> std::uint64_t;
+
+  /// Get the memory available for starting new processes without swapping.
+  /// Return 0 if unknown.
+  auto available_memory() -> std::uint64_t;
+
+  /// Get the total memory in bytes that concurrently running jobs are allowed
+  /// to use. It's a fraction of the cgroup memory limit or the available
+  /// memory, whichever is smaller. Return 0 if both are unknown.
+  auto default_memory_budget(const cgroup_limits &limits, std::uint64_t available) -> std::uint64_t;
+} // namespace lint::resource
@@ -15,9 +15,18 @@
  */
 #include "shell.h"
 
-#include <spdlog/spdlog.h>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <spdlog/spdlog.h>
 
 #define BOOST_PROCESS_V2_SEPARATE_COMPILATION
 #include <boost/asio/error.hpp>
@@ -33,6 +42,58 @@
 namespace lint::shell {
   namespace bp = boost::process::v2;
 
+  namespace {
+    // Reap the child by ourselves rather than bp::process::wait() since we
+    // need its resource usage.
+    auto wait(bp::process &proc) -> std::tuple<int, std::uint64_t> {
+      auto status = 0;
+      auto usage  = rusage{};
+      while (::wait4(proc.id(), &status, 0, &usage) == -1) {
+        if (errno != EINTR) {
+          return {proc.wait(), 0};
+        }
+      }
+      proc.detach();
+
+      // ru_maxrss is in kilobytes on Linux.
+      constexpr auto kilobyte = std::uint64_t{1024};
+      auto peak_rss           = static_cast<std::uint64_t>(usage.ru_maxrss) * kilobyte;
+      return {bp::evaluate_exit_code(status), peak_rss};
+    }
+
+    auto collect(std::string_view command,
+                 bp::process &proc,
+                 boost::asio::readable_pipe &rp_out,
+                 boost::asio::readable_pipe &rp_err,
+                 const std::stop_token &token = {}) -> result {
+      // The child isn't reaped until wait() below and the callback is
+      // unregistered before that, so we never signal a recycled pid.
+      auto killed    = std::atomic<bool>{false};
+      auto terminate = [pid = proc.id(), &killed] {
+        killed = true;
+        ::kill(pid, SIGTERM);
+      };
+      auto terminator = std::optional<std::stop_callback<decltype(terminate)>>{};
+      terminator.emplace(token, terminate);
+
+      auto ec  = boost::system::error_code{};
+      auto res = result{};
+      boost::asio::read(rp_out, boost::asio::dynamic_buffer(res.std_out), ec);
+      throw_if(ec && ec != boost::asio::error::eof,
+               fmt::format("Read stdout message of {} faild since {}", command, ec.message()));
+      ec.clear();
+
+      boost::asio::read(rp_err, boost::asio::dynamic_buffer(res.std_err), ec);
+      throw_if(ec && ec != boost::asio::error::eof,
+               fmt::format("Read stderr message of {} faild since {}", command, ec.message()));
+
+      terminator.reset();
+      std::tie(res.exit_code, res.peak_rss) = wait(proc);
+      res.killed                            = killed;
+      return res;
+    }
+  } // namespace
+
   auto execute(std::string_view command, const options &opts) -> result {
     auto context = boost::asio::io_context{};
     auto rp_out  = boost::asio::readable_pipe{context};
@@ -43,23 +104,13 @@ namespace lint::shell {
       command,
       opts,
       bp::process_stdio{.in = {}, .out = rp_out, .err = rp_err});
-    auto ec  = boost::system::error_code{};
-    auto res = result{};
-    boost::asio::read(rp_out, boost::asio::dynamic_buffer(res.std_out), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stdout message of {} faild since {}", command, ec.message()));
-    ec.clear();
-
-    boost::asio::read(rp_err, boost::asio::dynamic_buffer(res.std_err), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stderr message of {} faild since {}", command, ec.message()));
-
-    res.exit_code = proc.wait();
-    return res;
+    return collect(command, proc, rp_out, rp_err);
   }
 
-  auto execute(std::string_view command, const options &opts, std::string_view start_dir)
-    -> result {
+  auto execute(std::string_view command,
+               const options &opts,
+               std::string_view start_dir,
+               const std::stop_token &token) -> result {
     auto context = boost::asio::io_context{};
     auto rp_out  = boost::asio::readable_pipe{context};
     auto rp_err  = boost::asio::readable_pipe{context};
@@ -70,19 +121,7 @@ namespace lint::shell {
       opts,
       bp::process_stdio{.in = {}, .out = rp_out, .err = rp_err},
       bp::process_start_dir{start_dir});
-    auto ec  = boost::system::error_code{};
-    auto res = result{};
-    boost::asio::read(rp_out, boost::asio::dynamic_buffer(res.std_out), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stdout message of {} faild since {}", command, ec.message()));
-    ec.clear();
-
-    boost::asio::read(rp_err, boost::asio::dynamic_buffer(res.std_err), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stderr message of {} faild since {}", command, ec.message()));
-
-    res.exit_code = proc.wait();
-    return res;
+    return collect(command, proc, rp_out, rp_err, token);
   }
 
   auto execute(std::string_view command, const options &opts, const envrionment &env) -> result {
@@ -96,19 +135,7 @@ namespace lint::shell {
       opts,
       bp::process_stdio{.in = {}, .out = rp_out, .err = rp_err},
       bp::process_environment{env});
-    auto ec  = boost::system::error_code{};
-    auto res = result{};
-    boost::asio::read(rp_out, boost::asio::dynamic_buffer(res.std_out), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stdout message of {} faild since {}", command, ec.message()));
-    ec.clear();
-
-    boost::asio::read(rp_err, boost::asio::dynamic_buffer(res.std_err), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stderr message of {} faild since {}", command, ec.message()));
-
-    res.exit_code = proc.wait();
-    return res;
+    return collect(command, proc, rp_out, rp_err);
   }
 
   auto execute(std::string_view command,
@@ -126,19 +153,7 @@ namespace lint::shell {
       bp::process_stdio{.in = {}, .out = rp_out, .err = rp_err},
       bp::process_environment{env},
       bp::process_start_dir(start_dir));
-    auto ec  = boost::system::error_code{};
-    auto res = result{};
-    boost::asio::read(rp_out, boost::asio::dynamic_buffer(res.std_out), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stdout message of {} faild since {}", command, ec.message()));
-    ec.clear();
-
-    boost::asio::read(rp_err, boost::asio::dynamic_buffer(res.std_err), ec);
-    throw_if(ec && ec != boost::asio::error::eof,
-             fmt::format("Read stderr message of {} faild since {}", command, ec.message()));
-
-    res.exit_code = proc.wait();
-    return res;
+    return collect(command, proc, rp_out, rp_err);
   }
 
   auto which(std::string command) -> result {
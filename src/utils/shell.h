@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <stop_token>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -24,13 +26,19 @@ namespace lint::shell {
     int exit_code;
     std::string std_out;
     std::string std_err;
+    std::uint64_t peak_rss = 0; // The peak resident set size of the process in bytes.
+    bool killed            = false; // Whether the process is terminated by a stop request.
   };
 
   using envrionment = std::unordered_map<std::string, std::string>;
   using options     = std::vector<std::string>;
 
   auto execute(std::string_view command, const options &opts) -> result;
-  auto execute(std::string_view command, const options &opts, std::string_view start_dir) -> result;
+  /// Once a stop is requested on the token, the running process is terminated.
+  auto execute(std::string_view command,
+               const options &opts,
+               std::string_view start_dir,
+               const std::stop_token &token = {}) -> result;
   auto execute(std::string_view command, const options &opts, const envrionment &env) -> result;
   auto execute(std::string_view command,
                const options &opts,
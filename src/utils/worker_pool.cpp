@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/worker_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace lint::worker {
+  namespace {
+    // PSI thresholds in percentage of time some tasks stalled in last 10s.
+    constexpr auto memory_full_thrashing = 1.0;
+    constexpr auto memory_some_thrashing = 10.0;
+    constexpr auto cpu_some_overloaded   = 40.0;
+    constexpr auto cpu_some_idle         = 10.0;
+    constexpr auto memory_some_idle      = 1.0;
+
+    // Load average thresholds relative to the number of CPUs.
+    constexpr auto load_overloaded = 1.2;
+    constexpr auto load_idle       = 0.8;
+
+    // The pool and memory of the remote task running on current thread.
+    thread_local pool *remote_pool           = nullptr;
+    thread_local std::uint64_t remote_memory = 0;
+  } // namespace
+
+  pool::pool(std::size_t workers, std::size_t remote_workers)
+    : workers_(std::max<std::size_t>(workers, 1))
+    , limit_(workers_) {
+    threads_.reserve(workers_ + remote_workers);
+    for (std::size_t i = 0; i < workers_; ++i) {
+      threads_.emplace_back([this] { work(); });
+    }
+    for (std::size_t i = 0; i < remote_workers; ++i) {
+      threads_.emplace_back([this] { work_remotely(); });
+    }
+  }
+
+  pool::~pool() {
+    {
+      auto lock = std::lock_guard{mutex_};
+      stopping_ = true;
+    }
+    work_cv_.notify_all();
+    remote_cv_.notify_all();
+    for (auto &thread: threads_) {
+      thread.join();
+    }
+  }
+
+  void pool::submit(task job) {
+    submit(std::move(job), 0);
+  }
+
+  void pool::submit(task job, std::uint64_t memory) {
+    {
+      auto lock = std::lock_guard{mutex_};
+      tasks_.push_back({.job = std::move(job), .memory = memory});
+    }
+    work_cv_.notify_one();
+  }
+
+  void pool::submit_remote(task job, std::uint64_t memory) {
+    if (remote_workers() == 0) {
+      submit(std::move(job), memory);
+      return;
+    }
+    {
+      auto lock = std::lock_guard{mutex_};
+      remote_tasks_.push_back({.job = std::move(job), .memory = memory});
+    }
+    remote_cv_.notify_one();
+  }
+
+  void pool::wait() {
+    auto lock = std::unique_lock{mutex_};
+    idle_cv_.wait(lock, [this] {
+      return tasks_.empty() && remote_tasks_.empty() && running_ == 0 && remote_running_ == 0;
+    });
+    if (error_) {
+      auto error = std::exchange(error_, nullptr);
+      std::rethrow_exception(error);
+    }
+  }
+
+  void pool::set_concurrency(std::size_t limit) {
+    {
+      auto lock = std::lock_guard{mutex_};
+      limit_    = std::clamp<std::size_t>(limit, 1, workers_);
+    }
+    work_cv_.notify_all();
+    admit_cv_.notify_all();
+  }
+
+  auto pool::concurrency() const -> std::size_t {
+    auto lock = std::lock_guard{mutex_};
+    return limit_;
+  }
+
+  void pool::set_memory_budget(std::uint64_t bytes) {
+    {
+      auto lock      = std::lock_guard{mutex_};
+      memory_budget_ = bytes;
+    }
+    work_cv_.notify_all();
+    admit_cv_.notify_all();
+  }
+
+  auto pool::memory_budget() const -> std::uint64_t {
+    auto lock = std::lock_guard{mutex_};
+    return memory_budget_;
+  }
+
+  auto pool::memory_in_use() const -> std::uint64_t {
+    auto lock = std::lock_guard{mutex_};
+    return memory_in_use_;
+  }
+
+  auto pool::workers() const -> std::size_t {
+    return workers_;
+  }
+
+  auto pool::remote_workers() const -> std::size_t {
+    return threads_.size() - workers_;
+  }
+
+  auto pool::running() const -> std::size_t {
+    auto lock = std::lock_guard{mutex_};
+    return running_;
+  }
+
+  auto pool::pending() const -> std::size_t {
+    auto lock = std::lock_guard{mutex_};
+    return tasks_.size();
+  }
+
+  auto pool::admissible(std::uint64_t memory) const -> bool {
+    return running_ < limit_
+        && (memory_budget_ == 0 || running_ == 0 || memory_in_use_ + memory <= memory_budget_);
+  }
+
+  auto pool::next_admissible() -> std::deque<pending_task>::iterator {
+    if (running_ >= limit_) {
+      return tasks_.end();
+    }
+    if (memory_budget_ == 0 || running_ == 0) {
+      return tasks_.begin();
+    }
+    return std::ranges::find_if(tasks_, [this](const pending_task &pending) {
+      return memory_in_use_ + pending.memory <= memory_budget_;
+    });
+  }
+
+  void pool::admit(std::uint64_t memory) {
+    auto lock = std::unique_lock{mutex_};
+    admit_cv_.wait(lock, [&] { return admissible(memory); });
+    ++running_;
+    memory_in_use_ += memory;
+  }
+
+  void pool::leave(std::uint64_t memory) {
+    {
+      auto lock = std::lock_guard{mutex_};
+      --running_;
+      memory_in_use_ -= memory;
+    }
+    work_cv_.notify_all();
+    admit_cv_.notify_all();
+  }
+
+  void pool::work() {
+    while (true) {
+      auto current = pending_task{};
+      {
+        auto lock = std::unique_lock{mutex_};
+        auto iter = tasks_.end();
+        work_cv_.wait(lock, [&] {
+          if (stopping_) {
+            return true;
+          }
+          iter = next_admissible();
+          return iter != tasks_.end();
+        });
+        if (stopping_) {
+          return;
+        }
+        current = std::move(*iter);
+        tasks_.erase(iter);
+        ++running_;
+        memory_in_use_ += current.memory;
+      }
+
+      auto error = std::exception_ptr{};
+      try {
+        current.job();
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      {
+        auto lock = std::lock_guard{mutex_};
+        --running_;
+        memory_in_use_ -= current.memory;
+        if (error && !error_) {
+          error_ = error;
+        }
+      }
+      // Released memory may admit several small tasks at once.
+      work_cv_.notify_all();
+      admit_cv_.notify_all();
+      idle_cv_.notify_all();
+    }
+  }
+
+  void pool::work_remotely() {
+    while (true) {
+      auto current = pending_task{};
+      {
+        auto lock = std::unique_lock{mutex_};
+        remote_cv_.wait(lock, [this] { return stopping_ || !remote_tasks_.empty(); });
+        if (stopping_) {
+          return;
+        }
+        current = std::move(remote_tasks_.front());
+        remote_tasks_.pop_front();
+        ++remote_running_;
+      }
+
+      remote_pool   = this;
+      remote_memory = current.memory;
+      auto error    = std::exception_ptr{};
+      try {
+        current.job();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      remote_pool = nullptr;
+
+      {
+        auto lock = std::lock_guard{mutex_};
+        --remote_running_;
+        if (error && !error_) {
+          error_ = error;
+        }
+      }
+      idle_cv_.notify_all();
+    }
+  }
+
+  local_admission::local_admission()
+    : pool_(remote_pool)
+    , memory_(remote_memory) {
+    if (pool_ != nullptr) {
+      pool_->admit(memory_);
+    }
+  }
+
+  local_admission::~local_admission() {
+    if (pool_ != nullptr) {
+      pool_->leave(memory_);
+    }
+  }
+
+  auto take_sample(const pool &workers) -> load_sample {
+    auto sample         = load_sample{};
+    sample.cpu          = resource::read_pressure("cpu");
+    sample.memory       = resource::read_pressure("memory");
+    sample.load_average = resource::load_average();
+    sample.cpus         = resource::available_cpus(resource::read_cgroup_limits());
+    sample.saturated    = workers.running() >= workers.concurrency() && workers.pending() > 0;
+    return sample;
+  }
+
+  auto next_concurrency(std::size_t current, std::size_t ceiling, const load_sample &sample)
+    -> std::size_t {
+    ceiling = std::max<std::size_t>(ceiling, 1);
+    current = std::clamp<std::size_t>(current, 1, ceiling);
+
+    // Memory thrashing is the most expensive situation, back off quickly.
+    if (sample.memory) {
+      if (sample.memory->full_avg10 > memory_full_thrashing
+          || sample.memory->some_avg10 > memory_some_thrashing) {
+        return std::max<std::size_t>(current / 2, 1);
+      }
+    }
+
+    if (sample.cpu) {
+      if (sample.cpu->some_avg10 > cpu_some_overloaded) {
+        return std::max<std::size_t>(current - 1, 1);
+      }
+      auto memory_idle = !sample.memory || sample.memory->some_avg10 < memory_some_idle;
+      if (sample.saturated && memory_idle && sample.cpu->some_avg10 < cpu_some_idle) {
+        return std::min(current + 1, ceiling);
+      }
+      return current;
+    }
+
+    if (sample.load_average) {
+      auto cpus = static_cast<double>(std::max<std::size_t>(sample.cpus, 1));
+      if (*sample.load_average > cpus * load_overloaded) {
+        return std::max<std::size_t>(current - 1, 1);
+      }
+      if (sample.saturated && *sample.load_average < cpus * load_idle) {
+        return std::min(current + 1, ceiling);
+      }
+    }
+    return current;
+  }
+
+  controller::controller(pool &workers, std::size_t ceiling, std::chrono::milliseconds interval)
+    : pool_(workers)
+    , ceiling_(std::clamp<std::size_t>(ceiling, 1, workers.workers()))
+    , interval_(interval)
+    , thread_([this](const std::stop_token &token) { run(token); }) {
+  }
+
+  controller::~controller() {
+    thread_.request_stop();
+  }
+
+  void controller::run(const std::stop_token &token) {
+    while (!token.stop_requested()) {
+      {
+        auto lock = std::unique_lock{mutex_};
+        cv_.wait_for(lock, token, interval_, [] { return false; });
+      }
+      if (token.stop_requested()) {
+        return;
+      }
+
+      auto current = pool_.concurrency();
+      auto next    = next_concurrency(current, ceiling_, take_sample(pool_));
+      if (next != current) {
+        spdlog::debug("Adjust the number of concurrent jobs from {} to {}", current, next);
+        pool_.set_concurrency(next);
+      }
+    }
+  }
+} // namespace lint::worker
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "utils/resource.h"
+
+namespace lint::worker {
+  using namespace std::chrono_literals;
+
+  using task = std::function<void()>;
+
+  /// A fixed number of worker threads whose number of concurrently running
+  /// tasks could be adjusted at any time. Tasks are started in submission order
+  /// unless a memory budget is set, then a task whose predicted memory doesn't
+  /// fit the remaining budget is held back and later tasks that fit may start
+  /// first. A task is always admitted when nothing is running so that a task
+  /// larger than the whole budget still makes progress.
+  ///
+  /// Tasks run by remote workers have a thread for each remote slot. They only
+  /// wait for the remote workers, so they are admitted by neither the
+  /// concurrency nor the memory budget, unless they fall back to run locally,
+  /// see local_admission.
+  class pool {
+  public:
+    explicit pool(std::size_t workers, std::size_t remote_workers = 0);
+    ~pool();
+
+    pool(const pool &)            = delete;
+    pool &operator=(const pool &) = delete;
+    pool(pool &&)                 = delete;
+    pool &operator=(pool &&)      = delete;
+
+    /// Submit a task to pool.
+    void submit(task job);
+
+    /// Submit a task which is predicted to take the given bytes of memory.
+    void submit(task job, std::uint64_t memory);
+
+    /// Submit a task which is run by remote workers. The memory is only taken
+    /// once it's admitted to run locally.
+    void submit_remote(task job, std::uint64_t memory);
+
+    /// Block until all submitted tasks finished. The first exception thrown by
+    /// tasks will be rethrown here.
+    void wait();
+
+    /// Set the maximum number of concurrently running local tasks. The value is
+    /// clamped into [1, workers()].
+    void set_concurrency(std::size_t limit);
+
+    [[nodiscard]] auto concurrency() const -> std::size_t;
+
+    /// Set the total bytes of memory that running tasks are allowed to use.
+    /// 0 means unlimited.
+    void set_memory_budget(std::uint64_t bytes);
+
+    [[nodiscard]] auto memory_budget() const -> std::uint64_t;
+
+    /// The sum of predicted memory of running tasks.
+    [[nodiscard]] auto memory_in_use() const -> std::uint64_t;
+
+    /// The number of local workers.
+    [[nodiscard]] auto workers() const -> std::size_t;
+
+    [[nodiscard]] auto remote_workers() const -> std::size_t;
+
+    /// The number of tasks running locally.
+    [[nodiscard]] auto running() const -> std::size_t;
+
+    [[nodiscard]] auto pending() const -> std::size_t;
+
+  private:
+    friend class local_admission;
+
+    struct pending_task {
+      task job;
+      std::uint64_t memory = 0;
+    };
+
+    void work();
+
+    void work_remotely();
+
+    /// Whether a local task of the given memory could be started now. Must be
+    /// called with mutex_ held.
+    [[nodiscard]] auto admissible(std::uint64_t memory) const -> bool;
+
+    /// Take a local slot and the memory for a remote task running locally.
+    void admit(std::uint64_t memory);
+
+    void leave(std::uint64_t memory);
+
+    /// Find the first task which could be started now. Must be called with
+    /// mutex_ held.
+    auto next_admissible() -> std::deque<pending_task>::iterator;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable remote_cv_;
+    std::condition_variable admit_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<pending_task> tasks_;
+    std::deque<pending_task> remote_tasks_;
+    std::vector<std::thread> threads_;
+    std::size_t workers_         = 1;
+    std::size_t limit_           = 1;
+    std::size_t running_         = 0;
+    std::size_t remote_running_  = 0;
+    std::uint64_t memory_budget_ = 0;
+    std::uint64_t memory_in_use_ = 0;
+    bool stopping_               = false;
+    std::exception_ptr error_;
+  };
+
+  /// Admit the remote task running on current thread to run locally, e.g. when
+  /// no remote worker is able to run it. It holds a local slot and the memory
+  /// of the task until destroyed. It does nothing on other threads.
+  class local_admission {
+  public:
+    local_admission();
+    ~local_admission();
+
+    local_admission(const local_admission &)            = delete;
+    local_admission &operator=(const local_admission &) = delete;
+    local_admission(local_admission &&)                 = delete;
+    local_admission &operator=(local_admission &&)      = delete;
+
+  private:
+    pool *pool_           = nullptr;
+    std::uint64_t memory_ = 0;
+  };
+
+  /// A snapshot of system load which is used to adjust concurrency.
+  struct load_sample {
+    std::optional<resource::pressure> cpu;
+    std::optional<resource::pressure> memory;
+    std::optional<double> load_average;
+    std::size_t cpus = 1;
+
+    /// Whether all permitted tasks are running and there are still tasks waiting.
+    bool saturated = false;
+  };
+
+  /// Take a load sample of current system.
+  auto take_sample(const pool &workers) -> load_sample;
+
+  /// Compute the next concurrency from the current one. PSI is preferred and
+  /// the load average is used when PSI is unavailable. The result is in
+  /// [1, ceiling].
+  auto next_concurrency(std::size_t current, std::size_t ceiling, const load_sample &sample)
+    -> std::size_t;
+
+  /// Periodically adjust the concurrency of a pool so that we neither thrash
+  /// nor leave cores idle.
+  class controller {
+  public:
+    controller(pool &workers, std::size_t ceiling, std::chrono::milliseconds interval = 1s);
+    ~controller();
+
+    controller(const controller &)            = delete;
+    controller &operator=(const controller &) = delete;
+    controller(controller &&)                 = delete;
+    controller &operator=(controller &&)      = delete;
+
+  private:
+    void run(const std::stop_token &token);
+
+    pool &pool_;
+    std::size_t ceiling_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::jthread thread_;
+  };
+} // namespace lint::worker
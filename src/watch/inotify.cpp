@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "watch/inotify.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/error.h"
+
+namespace lint::watch {
+  namespace {
+    using namespace std::chrono_literals;
+
+    // How often the stop token is checked while waiting.
+    constexpr auto poll_interval = 100ms;
+
+    // Editors either write files in place or rename a temporary file to them.
+    constexpr auto file_events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+    constexpr auto dir_events  = IN_CREATE | IN_MOVED_TO;
+
+    auto join(const std::string &dir, std::string_view name) -> std::string {
+      return dir.empty() ? std::string{name} : fmt::format("{}/{}", dir, name);
+    }
+  } // namespace
+
+  inotify_watcher::inotify_watcher(std::string root, filter skip)
+    : fd_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , root_(std::move(root))
+    , skip_(std::move(skip)) {
+    throw_if(fd_ == -1, fmt::format("inotify_init1 failed: {}", std::strerror(errno)));
+    auto ignored = std::set<std::string>{};
+    watch_tree("", ignored);
+    spdlog::debug("watching {} directories under {}", dirs_.size(), root_);
+  }
+
+  inotify_watcher::~inotify_watcher() {
+    ::close(fd_);
+  }
+
+  auto inotify_watcher::skipped(const std::string &path) const -> bool {
+    return skip_ && skip_(path);
+  }
+
+  void inotify_watcher::watch_tree(const std::string &dir, std::set<std::string> &files) {
+    auto path = std::filesystem::path{root_} / dir;
+    auto wd   = ::inotify_add_watch(fd_, path.c_str(), file_events | dir_events | IN_ONLYDIR);
+    if (wd == -1) {
+      // The directory may be removed already or we run out of watches.
+      spdlog::warn("can't watch {}: {}", path.string(), std::strerror(errno));
+      return;
+    }
+    dirs_[wd] = dir;
+
+    auto ec = std::error_code{};
+    for (const auto &entry: std::filesystem::directory_iterator{path, ec}) {
+      auto child = join(dir, entry.path().filename().string());
+      if (skipped(child)) {
+        continue;
+      }
+      if (entry.is_directory(ec)) {
+        watch_tree(child, files);
+      } else if (entry.is_regular_file(ec)) {
+        files.insert(child);
+      }
+    }
+  }
+
+  auto inotify_watcher::read_events(std::set<std::string> &files) -> bool {
+    alignas(inotify_event) auto buffer = std::array<char, 4096>{};
+    auto any                           = false;
+    while (true) {
+      auto size = ::read(fd_, buffer.data(), buffer.size());
+      if (size <= 0) {
+        throw_if(size == -1 && errno != EAGAIN && errno != EINTR,
+                 fmt::format("read inotify events failed: {}", std::strerror(errno)));
+        return any;
+      }
+
+      for (auto offset = ssize_t{0}; offset < size;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(buffer.data() + offset);
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        any     = true;
+
+        if ((event->mask & IN_Q_OVERFLOW) != 0U) {
+          spdlog::warn("too many changes, some of them are lost");
+          continue;
+        }
+        if ((event->mask & IN_IGNORED) != 0U) {
+          dirs_.erase(event->wd);
+          continue;
+        }
+        if (event->len == 0 || !dirs_.contains(event->wd)) {
+          continue;
+        }
+
+        auto path = join(dirs_.at(event->wd), event->name);
+        if (skipped(path)) {
+          continue;
+        }
+        if ((event->mask & IN_ISDIR) != 0U) {
+          if ((event->mask & dir_events) != 0U) {
+            watch_tree(path, files);
+          }
+          continue;
+        }
+        if ((event->mask & file_events) != 0U) {
+          files.insert(std::move(path));
+        }
+      }
+    }
+  }
+
+  auto inotify_watcher::wait(std::chrono::milliseconds quiet, const std::stop_token &token)
+    -> std::vector<std::string> {
+    auto files    = std::set<std::string>{};
+    auto deadline = std::chrono::steady_clock::now();
+    while (!token.stop_requested()) {
+      auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(poll_interval);
+      if (!files.empty()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+        timeout   = std::clamp(left, 0ms, timeout);
+      }
+
+      auto fds = pollfd{.fd = fd_, .events = POLLIN, .revents = 0};
+      auto ret = ::poll(&fds, 1, static_cast<int>(timeout.count()));
+      throw_if(ret == -1 && errno != EINTR, fmt::format("poll failed: {}", std::strerror(errno)));
+      if (ret > 0 && read_events(files)) {
+        deadline = std::chrono::steady_clock::now() + quiet;
+      }
+      if (!files.empty() && std::chrono::steady_clock::now() >= deadline) {
+        return {files.begin(), files.end()};
+      }
+    }
+    return {};
+  }
+} // namespace lint::watch
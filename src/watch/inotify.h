@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <set>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lint::watch {
+  /// Watches all directories under root by inotify, including the ones created
+  /// later. Paths passed to the filter and returned are relative to root.
+  class inotify_watcher {
+  public:
+    /// Returns true for the directories which shouldn't be watched and the
+    /// files which shouldn't be reported.
+    using filter = std::function<bool(const std::string &)>;
+
+    explicit inotify_watcher(std::string root, filter skip = {});
+    ~inotify_watcher();
+
+    inotify_watcher(const inotify_watcher &)            = delete;
+    inotify_watcher &operator=(const inotify_watcher &) = delete;
+    inotify_watcher(inotify_watcher &&)                 = delete;
+    inotify_watcher &operator=(inotify_watcher &&)      = delete;
+
+    /// Wait until some files are changed and then nothing is changed within
+    /// quiet, so that a burst of saves is returned at once. Files are sorted.
+    /// Returns nothing once a stop is requested.
+    auto wait(std::chrono::milliseconds quiet, const std::stop_token &token = {})
+      -> std::vector<std::string>;
+
+  private:
+    /// Watch the given directory and its subdirectories. Files found in them
+    /// are added into files, since they may be created before being watched.
+    void watch_tree(const std::string &dir, std::set<std::string> &files);
+
+    /// Read all pending events and add changed files into files. Returns
+    /// whether there were any events.
+    auto read_events(std::set<std::string> &files) -> bool;
+
+    auto skipped(const std::string &path) const -> bool;
+
+    int fd_ = -1;
+    std::string root_;
+    filter skip_;
+    std::unordered_map<int, std::string> dirs_;
+  };
+} // namespace lint::watch
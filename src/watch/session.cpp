@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "watch/session.h"
+
+#include <exception>
+#include <filesystem>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace lint::watch {
+  session::session(const std::vector<tool::tool_base_ptr> &tools,
+                   const runtime_context &context,
+                   worker::pool &pool,
+                   std::ostream &out)
+    : tools_(tools)
+    , context_(context)
+    , pool_(pool)
+    , out_(out) {
+  }
+
+  void session::changed(const std::vector<std::string> &files) {
+    spdlog::trace("Enter session::changed");
+    for (const auto &tool: tools_) {
+      tool->drop_caches(files);
+    }
+
+    auto lock = std::lock_guard{mutex_};
+    for (const auto &file: files) {
+      auto &state = files_[file];
+      if (state.running) {
+        // The running check is linting an outdated content.
+        spdlog::debug("cancel the check of {} since it's changed again", file);
+        state.cancel.request_stop();
+        state.dirty = true;
+        continue;
+      }
+      start(file, state);
+    }
+  }
+
+  void session::wait() {
+    pool_.wait();
+  }
+
+  void session::start(const std::string &file, file_state &state) {
+    state.running = true;
+    state.dirty   = false;
+    state.cancel  = std::stop_source{};
+    pool_.submit([this, file, cancel = state.cancel] {
+      // A failed check shouldn't stop watching other files.
+      try {
+        check(file, cancel);
+      } catch (const std::exception &err) {
+        spdlog::error("failed to check {}: {}", file, err.what());
+      }
+
+      // Check the file again if it's changed while being checked.
+      auto lock   = std::lock_guard{mutex_};
+      auto &state = files_.at(file);
+      if (state.dirty) {
+        start(file, state);
+      } else {
+        state.running = false;
+      }
+    });
+  }
+
+  void session::check(const std::string &file, const std::stop_source &cancel) {
+    spdlog::trace("Enter session::check");
+    auto exists = std::filesystem::exists(std::filesystem::path{context_.repo_path} / file);
+    for (const auto &tool: tools_) {
+      if (cancel.stop_requested()) {
+        return;
+      }
+      if (!exists || !tool->accepts(file)) {
+        print(*tool, file, false);
+        continue;
+      }
+      auto outcome = tool->check_file(context_, file, cancel);
+      if (!outcome.skipped) {
+        print(*tool, file, true);
+      }
+    }
+  }
+
+  void session::print(tool::tool_base &tool, const std::string &file, bool checked) {
+    auto key  = fmt::format("{}:{}", tool.name(), file);
+    auto lock = std::lock_guard{print_mutex_};
+    if (!checked) {
+      if (printed_.erase(key) != 0) {
+        out_ << fmt::format("{}: {} isn't checked any more\n", tool.name(), file) << std::flush;
+      }
+      return;
+    }
+
+    auto result = tool.dump_result(file);
+    if (result.is_null()) {
+      return;
+    }
+    auto now = outcome{.passed = result.value("passed", false),
+                       .output = result.value("tool_stdout", std::string{})};
+
+    // Only the changes since the last check are printed.
+    auto last = printed_.find(key);
+    if (last != printed_.end() && last->second.passed == now.passed
+        && last->second.output == now.output) {
+      spdlog::debug("{}: {} is unchanged", tool.name(), file);
+      return;
+    }
+    if (now.passed) {
+      out_ << fmt::format("{}: {} {}\n",
+                          tool.name(),
+                          file,
+                          last != printed_.end() && !last->second.passed ? "passes now" : "passes");
+    } else {
+      out_ << fmt::format("{}: {} fails\n{}", tool.name(), file, now.output);
+    }
+    out_ << std::flush;
+    printed_[key] = std::move(now);
+  }
+} // namespace lint::watch
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <mutex>
+#include <ostream>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "context.h"
+#include "tools/base_tool.h"
+#include "utils/worker_pool.h"
+
+namespace lint::watch {
+  /// Lints files again once they're changed and prints how their diagnostics
+  /// differ from the last check. Tools keep their processes and caches between
+  /// checks, e.g. clangd keeps the preambles of opened files.
+  class session {
+  public:
+    session(const std::vector<tool::tool_base_ptr> &tools,
+            const runtime_context &context,
+            worker::pool &pool,
+            std::ostream &out);
+
+    session(const session &)            = delete;
+    session &operator=(const session &) = delete;
+    session(session &&)                 = delete;
+    session &operator=(session &&)      = delete;
+
+    /// Lint the given files which are relative to the repository. A file which
+    /// is still being checked is cancelled and checked again once its running
+    /// check returns, so a file is never checked twice at the same time.
+    void changed(const std::vector<std::string> &files);
+
+    /// Block until all checks finished.
+    void wait();
+
+  private:
+    struct file_state {
+      std::stop_source cancel;
+      bool running = false;
+      bool dirty   = false;
+    };
+
+    /// The last printed outcome of a tool on a file.
+    struct outcome {
+      bool passed = false;
+      std::string output;
+    };
+
+    /// Submit a check of the file. Must be called with mutex_ held.
+    void start(const std::string &file, file_state &state);
+
+    void check(const std::string &file, const std::stop_source &cancel);
+
+    /// Print the result of the tool on the file if it differs from the last one.
+    /// A file which isn't checked by the tool any more is forgotten.
+    void print(tool::tool_base &tool, const std::string &file, bool checked);
+
+    const std::vector<tool::tool_base_ptr> &tools_;
+    const runtime_context &context_;
+    worker::pool &pool_;
+    std::ostream &out_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, file_state> files_;
+
+    std::mutex print_mutex_;
+    std::unordered_map<std::string, outcome> printed_;
+  };
+} // namespace lint::watch
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/bundle.h"
+#include "tools/clang_format/general/result.h"
+#include "tools/clang_tidy/general/result.h"
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::tool;
+
+TEST_CASE("Test serialize results", "[CppLintAction][tool][bundle]") {
+  SECTION("clang-tidy result should survive a round trip") {
+    auto diag                   = clang_tidy::diagnostic{};
+    diag.header.file_name       = "a.cpp";
+    diag.header.row_idx         = "1";
+    diag.header.col_idx         = "2";
+    diag.header.serverity       = "warning";
+    diag.header.brief           = "brief";
+    diag.header.diagnostic_type = "[misc]";
+    diag.details                = "details";
+
+    auto file          = clang_tidy::per_file_result{};
+    file.passed        = false;
+    file.file_path     = "a.cpp";
+    file.peak_rss      = 1024;
+    file.stat.warnings = 1;
+    file.diags.push_back(diag);
+
+    auto result           = clang_tidy::result_t{};
+    result.fails["a.cpp"] = file;
+    result.ignored.emplace_back("b.cpp");
+    result.failed_commands.emplace_back("clang-tidy a.cpp");
+    result.cancelled.emplace_back("c.cpp");
+
+    auto loaded = nlohmann::json(result).get<clang_tidy::result_t>();
+    REQUIRE(loaded.final_passed == false);
+    REQUIRE(loaded.ignored == result.ignored);
+    REQUIRE(loaded.failed_commands == result.failed_commands);
+    REQUIRE(loaded.cancelled == result.cancelled);
+    REQUIRE(loaded.fails.at("a.cpp").peak_rss == 1024);
+    REQUIRE(loaded.fails.at("a.cpp").stat.warnings == 1);
+    REQUIRE(loaded.fails.at("a.cpp").diags.at(0).header.diagnostic_type == "[misc]");
+    REQUIRE(loaded.fails.at("a.cpp").diags.at(0).details == "details");
+  }
+
+  SECTION("clang-format result should survive a round trip") {
+    auto file      = clang_format::per_file_result{};
+    file.file_path = "a.cpp";
+    file.replacements[3].push_back({.offset = 1, .length = 2, .data = " ", .row = 3, .col = 4});
+
+    auto result            = clang_format::result_t{};
+    result.final_passed    = true;
+    result.passes["a.cpp"] = file;
+
+    auto loaded = nlohmann::json(result).get<clang_format::result_t>();
+    REQUIRE(loaded.final_passed == true);
+    REQUIRE(loaded.passes.at("a.cpp").replacements.at(3).at(0).col == 4);
+  }
+}
+
+TEST_CASE("Test merge results", "[CppLintAction][tool][bundle]") {
+  auto lhs         = clang_format::result_t{};
+  lhs.final_passed = true;
+  lhs.ignored      = {"x.cpp"};
+  lhs.passes["a.cpp"];
+
+  auto rhs          = clang_format::result_t{};
+  rhs.final_passed  = false;
+  rhs.fastly_exited = true;
+  rhs.ignored       = {"x.cpp", "y.cpp"};
+  rhs.fails["b.cpp"];
+  rhs.failed_commands = {"clang-format b.cpp"};
+  rhs.cancelled       = {"c.cpp"};
+
+  merge_result(lhs, std::move(rhs));
+  REQUIRE(lhs.final_passed == false);
+  REQUIRE(lhs.fastly_exited == true);
+  REQUIRE(lhs.ignored == std::vector<std::string>{"x.cpp", "y.cpp"});
+  REQUIRE(lhs.passes.contains("a.cpp"));
+  REQUIRE(lhs.fails.contains("b.cpp"));
+  REQUIRE(lhs.failed_commands.size() == 1);
+  REQUIRE(lhs.cancelled == std::vector<std::string>{"c.cpp"});
+}
+
+TEST_CASE("Test check shards of bundles", "[CppLintAction][tool][bundle]") {
+  auto shard = [](std::size_t index, std::size_t count) {
+    return bundle_summary{.shard_index = index, .shard_count = count};
+  };
+
+  SECTION("bundles of all shards should be accepted in any order") {
+    REQUIRE_NOTHROW(check_shards({shard(0, 1)}));
+    REQUIRE_NOTHROW(check_shards({shard(2, 3), shard(0, 3), shard(1, 3)}));
+  }
+
+  SECTION("missing, duplicated or mismatched bundles should be rejected") {
+    REQUIRE_THROWS(check_shards({}));
+    REQUIRE_THROWS(check_shards({shard(0, 2)}));
+    REQUIRE_THROWS(check_shards({shard(0, 2), shard(0, 2)}));
+    REQUIRE_THROWS(check_shards({shard(0, 2), shard(1, 3)}));
+    REQUIRE_THROWS(check_shards({shard(0, 2), shard(2, 2)}));
+  }
+}
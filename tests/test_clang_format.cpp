@@ -21,6 +21,7 @@
 #include "tools/clang_format/clang_format.h"
 #include "tools/clang_format/general/impl.h"
 #include "tools/clang_format/general/reporter.h"
+#include "tools/clang_format/libformat/impl.h"
 #include "tools/util.h"
 #include "utils/shell.h"
 
@@ -51,7 +52,7 @@ namespace {
   // Check whether local environment contains clang-format otherwise some checks
   // will be failed.
   bool has_clang_format() {
-    auto [ec, std_out, std_err] = shell::which("clang-format");
+    auto [ec, std_out, std_err, peak_rss, killed] = shell::which("clang-format");
     return ec == 0;
   }
 
@@ -150,6 +151,39 @@ TEST_CASE("Test register and create clang-format option",
   }
 }
 
+TEST_CASE("Test select clang-format backend", "[CppLintAction][tool][clang_format][creator]") {
+  auto creator = std::make_unique<clang_format::creator>();
+  auto desc    = create_then_register_tool_desc(*creator);
+
+  SECTION("Receive an unsupported backend should throw exception") {
+    auto opts = parse_opt(desc, "--target-revision=main", "--clang-format-backend=unknown");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+
+  SECTION("libformat backend mustn't be specified with binary") {
+    auto opts = parse_opt(desc,
+                          "--target-revision=main",
+                          "--clang-format-backend=libformat",
+                          "--clang-format-binary=/usr/bin/clang-format");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+
+#ifdef CPP_LINT_ACTION_WITH_LIBFORMAT
+  SECTION("libformat backend doesn't need clang-format executable") {
+    auto opts = parse_opt(desc, "--target-revision=main", "--clang-format-backend=libformat");
+    auto tool = creator->create_tool(opts);
+    REQUIRE(creator->get_option().backend == clang_format::backend_t::libformat);
+    REQUIRE(tool->binary() == "libFormat");
+    REQUIRE_FALSE(tool->version().empty());
+  }
+#else
+  SECTION("libformat backend requires building with it") {
+    auto opts = parse_opt(desc, "--target-revision=main", "--clang-format-backend=libformat");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+#endif
+}
+
 TEST_CASE("Test clang-format should get full version even though user input a "
           "simplified version",
           "[CppLintAction][tool][clang_format][creator]") {
@@ -468,6 +502,32 @@ TEST_CASE("Test clang-format could correctly check basic unformatted error",
   }
 }
 
+#ifdef CPP_LINT_ACTION_WITH_LIBFORMAT
+TEST_CASE("Test libformat backend gets same result as executable",
+          "[CppLintAction][tool][clang_format][libformat]") {
+  SKIP_IF_NO_CLANG_FORMAT
+  auto option    = clang_format::option_t{};
+  option.enabled = true;
+  option.binary  = "libFormat";
+  option.backend = clang_format::backend_t::libformat;
+  auto libformat = clang_format::clang_format_libformat{option};
+  auto binary    = create_clang_format();
+
+  auto repo = repo_t{};
+  repo.commit_clang_format();
+  repo.add_file("test1.cpp", "int n = 1;\n");
+  auto target = repo.commit_changes();
+  repo.add_file("test2.cpp", "#include <vector>\n#include <string>\nint n    = 1;\n");
+  auto source = repo.commit_changes();
+
+  auto context  = create_runtime_context(target, source);
+  auto expected = binary.check_single_file(context, context.repo_path, "test2.cpp");
+  auto actual   = libformat.check_single_file(context, context.repo_path, "test2.cpp");
+  REQUIRE(actual.passed == expected.passed);
+  REQUIRE(nlohmann::json(actual.replacements) == nlohmann::json(expected.replacements));
+}
+#endif
+
 TEST_CASE("Test parse replacements", "[CppLintAction][tool][clang_format][general_version]") {
   SKIP_IF_NO_CLANG_FORMAT
 
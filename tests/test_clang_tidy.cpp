@@ -19,13 +19,19 @@
 #include "test_common.h"
 #include "tools/base_tool.h"
 #include "tools/clang_tidy/clang_tidy.h"
+#include "tools/clang_tidy/clangd/impl.h"
+#include "tools/clang_tidy/clangd/session.h"
 #include "tools/clang_tidy/general/impl.h"
 #include "tools/clang_tidy/general/reporter.h"
+#include "tools/clang_tidy/libtidy/impl.h"
+#include "tools/compile_db.h"
 #include "tools/util.h"
 #include "utils/shell.h"
 
 #include <catch2/catch_all.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
 #include <stdexcept>
 
 using namespace lint;
@@ -51,7 +57,7 @@ namespace {
   // Check whether local environment contains clang-tidy otherwise some checks
   // will be failed.
   bool has_clang_tidy() {
-    auto [ec, std_out, std_err] = shell::which("clang-tidy");
+    auto [ec, std_out, std_err, peak_rss, killed] = shell::which("clang-tidy");
     return ec == 0;
   }
 
@@ -66,6 +72,11 @@ namespace {
     }
   }
 
+  bool has_clangd() {
+    auto [ec, std_out, std_err, peak_rss, killed] = shell::which("clangd");
+    return ec == 0;
+  }
+
   auto create_then_register_tool_desc(const clang_tidy::creator &creator)
     -> program_options::options_description {
     auto desc = program_options::create_desc();
@@ -147,6 +158,68 @@ TEST_CASE("Test register and create clang-tidy option",
     REQUIRE(option.enabled_fastly_exit == true);
     REQUIRE(option.file_filter_iregex == "*.cpp");
   }
+
+  SECTION("Stripping flags requires slicing database") {
+    auto opts = parse_opt(desc,
+                          "--target-revision=main",
+                          "--clang-tidy-strip-flags=true",
+                          "--clang-tidy-slice-database=false");
+    REQUIRE_THROWS(creator->create_option(opts));
+
+    auto sliced = parse_opt(desc, "--target-revision=main", "--clang-tidy-strip-flags=true");
+    creator->create_option(sliced);
+    REQUIRE(creator->get_option().strip_flags);
+    REQUIRE(creator->get_option().slice_database);
+  }
+}
+
+TEST_CASE("Test select clang-tidy backend", "[CppLintAction][tool][clang_tidy][creator]") {
+  auto creator = std::make_unique<clang_tidy::creator>();
+  auto desc    = create_then_register_tool_desc(*creator);
+
+  SECTION("Receive an unsupported backend should throw exception") {
+    auto opts = parse_opt(desc, "--target-revision=main", "--clang-tidy-backend=unknown");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+
+  SECTION("libtidy backend mustn't be specified with binary") {
+    auto opts = parse_opt(desc,
+                          "--target-revision=main",
+                          "--clang-tidy-backend=libtidy",
+                          "--clang-tidy-binary=/usr/bin/clang-tidy");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+
+  SECTION("clangd backend doesn't support check options") {
+    auto opts = parse_opt(desc,
+                          "--target-revision=main",
+                          "--clang-tidy-backend=clangd",
+                          "--clang-tidy-checks=-*,readability-*");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+
+  SECTION("Only binary backend resolves headers") {
+    auto opts = parse_opt(desc,
+                          "--target-revision=main",
+                          "--clang-tidy-backend=clangd",
+                          "--clang-tidy-resolve-headers=true");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+
+#ifdef CPP_LINT_ACTION_WITH_LIBTIDY
+  SECTION("libtidy backend doesn't need clang-tidy executable") {
+    auto opts = parse_opt(desc, "--target-revision=main", "--clang-tidy-backend=libtidy");
+    auto tool = creator->create_tool(opts);
+    REQUIRE(creator->get_option().backend == clang_tidy::backend_t::libtidy);
+    REQUIRE(tool->binary() == "libclang-tidy");
+    REQUIRE_FALSE(tool->version().empty());
+  }
+#else
+  SECTION("libtidy backend requires building with it") {
+    auto opts = parse_opt(desc, "--target-revision=main", "--clang-tidy-backend=libtidy");
+    REQUIRE_THROWS(creator->create_option(opts));
+  }
+#endif
 }
 
 TEST_CASE("Test clang-tidy should get full version even though user input a "
@@ -466,7 +539,327 @@ TEST_CASE("Test clang-tidy could correctly check basic error",
   }
 }
 
+TEST_CASE("Test clang-tidy slices compilation database",
+          "[CppLintAction][tool][clang_tidy][general_version]") {
+  SKIP_IF_NO_CLANG_TIDY
+  auto clang_tidy             = create_clang_tidy();
+  clang_tidy.option.databases = {"build"};
+
+  auto repo = repo_t{};
+  repo.commit_clang_tidy();
+  repo.add_file("file1.cpp", "const int n = 0;\n");
+  repo.add_file("file2.cpp", "const int m = 0;\n");
+  auto target_id = repo.commit_changes();
+
+  repo.rewrite_file("file1.cpp", "const int n = 1;\n");
+  repo.rewrite_file("file2.cpp", "const int m = 1;\n");
+  auto source_id = repo.commit_changes();
+
+  // Only file1.cpp and the unchanged file3.cpp have commands.
+  auto root     = std::filesystem::path{get_temp_repo_dir()};
+  auto commands = std::vector<compile_command>{};
+  for (const auto *file: {"file1.cpp", "file3.cpp"}) {
+    commands.push_back(
+      {.directory = root.string(), .file = (root / file).string(), .arguments = {"c++", file}});
+  }
+  write_compile_db((root / "build").string(), commands);
+
+  auto context = create_runtime_context(target_id, source_id);
+  clang_tidy.collect_files(context);
+  auto sliced = clang_tidy.database_of("file1.cpp");
+  REQUIRE(sliced != "build");
+  REQUIRE(clang_tidy.database_of("file2.cpp") == "build");
+
+  auto database = compile_db{(std::filesystem::path{sliced} / "compile_commands.json").string()};
+  REQUIRE(database.size() == 1);
+  REQUIRE(database.contains((root / "file1.cpp").string()));
+
+  clang_tidy.check(context);
+  check_result(clang_tidy, true, 2, 0, 0);
+
+  // A regenerated database is opened again, and the changed command gets a
+  // new slice.
+  commands[0].arguments = {"c++", "-DN", "file1.cpp"};
+  write_compile_db((root / "build").string(), commands);
+  clang_tidy.collect_files(context);
+  auto resliced = clang_tidy.database_of("file1.cpp");
+  REQUIRE(resliced != sliced);
+
+  auto json        = std::filesystem::path{resliced} / "compile_commands.json";
+  auto regenerated = compile_db{json.string()};
+  REQUIRE(regenerated.find((root / "file1.cpp").string())->arguments == commands[0].arguments);
+}
+
+TEST_CASE("Test clang-tidy routes files to multiple databases",
+          "[CppLintAction][tool][clang_tidy][general_version]") {
+  SKIP_IF_NO_CLANG_TIDY
+  auto clang_tidy                  = create_clang_tidy();
+  clang_tidy.option.databases      = {"comp1/build", "comp2/build"};
+  clang_tidy.option.slice_database = false;
+
+  auto repo = repo_t{};
+  auto root = std::filesystem::path{get_temp_repo_dir()};
+  repo.commit_clang_tidy();
+  std::filesystem::create_directories(root / "comp1" / "include");
+  std::filesystem::create_directories(root / "comp2");
+  repo.add_file("comp1/file1.cpp", "const int n = 0;\n");
+  repo.add_file("comp1/include/file1.h", "const int m = 0;\n");
+  repo.add_file("comp2/file2.cpp", "const int k = 0;\n");
+  auto target_id = repo.commit_changes();
+
+  repo.rewrite_file("comp1/file1.cpp", "const int n = 1;\n");
+  repo.rewrite_file("comp1/include/file1.h", "const int m = 1;\n");
+  repo.rewrite_file("comp2/file2.cpp", "const int k = 1;\n");
+  auto source_id = repo.commit_changes();
+
+  // Each component has its own build tree.
+  for (const auto *file: {"comp1/file1.cpp", "comp2/file2.cpp"}) {
+    auto path      = root / file;
+    auto directory = path.parent_path();
+    write_compile_db((directory / "build").string(),
+                     {{.directory = directory.string(),
+                       .file      = path.string(),
+                       .arguments = {"c++", path.filename().string()}}});
+  }
+
+  auto context = create_runtime_context(target_id, source_id);
+  clang_tidy.collect_files(context);
+  REQUIRE(clang_tidy.database_of("comp1/file1.cpp") == "comp1/build");
+  REQUIRE(clang_tidy.database_of("comp1/include/file1.h") == "comp1/build");
+  REQUIRE(clang_tidy.database_of("comp2/file2.cpp") == "comp2/build");
+  REQUIRE(clang_tidy.database_of("file3.cpp") == "comp1/build");
+
+  clang_tidy.check(context);
+  check_result(clang_tidy, true, 3, 0, 0);
+
+  // Files aren't collected when scanning, but they are still routed. Nothing
+  // is sliced for them.
+  auto scanner                  = create_clang_tidy();
+  scanner.option.databases      = clang_tidy.option.databases;
+  scanner.option.slice_database = true;
+  context.scan_all              = true;
+  scanner.check_file(context, "comp2/file2.cpp", std::stop_source{});
+  REQUIRE(scanner.database_of("comp2/file2.cpp") == "comp2/build");
+  REQUIRE(scanner.database_of("comp1/file1.cpp") == "comp1/build");
+}
+
+TEST_CASE("Test clang-tidy checks headers through including units",
+          "[CppLintAction][tool][clang_tidy][general_version]") {
+  SKIP_IF_NO_CLANG_TIDY
+  auto clang_tidy                   = create_clang_tidy();
+  clang_tidy.option.databases       = {"build"};
+  clang_tidy.option.resolve_headers = true;
+
+  auto repo = repo_t{};
+  repo.commit_clang_tidy();
+  repo.add_file("file.h", "const int n = 0;\n");
+  repo.add_file("file1.cpp", "#include \"file.h\"\n");
+  repo.add_file("file2.cpp", "#include \"file.h\"\n");
+  auto target_id = repo.commit_changes();
+
+  repo.rewrite_file("file.h", "const int n = 1;\n");
+  auto source_id = repo.commit_changes();
+
+  auto root     = std::filesystem::path{get_temp_repo_dir()};
+  auto commands = std::vector<compile_command>{};
+  for (const auto *file: {"file1.cpp", "file2.cpp"}) {
+    commands.push_back(
+      {.directory = root.string(), .file = (root / file).string(), .arguments = {"c++", file}});
+  }
+  write_compile_db((root / "build").string(), commands);
+  for (const auto *file: {"file1.cpp", "file2.cpp"}) {
+    auto depends = std::ofstream{root / "build" / fmt::format("{}.d", file)};
+    depends << fmt::format("{}.o: ../{} ../file.h\n", file, file);
+  }
+
+  // file2.cpp was checked faster than file1.cpp.
+  auto records = history{};
+  records.update(clang_tidy.name(), "file1.cpp", {.duration = std::chrono::seconds{2}});
+  records.update(clang_tidy.name(), "file2.cpp", {.duration = std::chrono::seconds{1}});
+  clang_tidy.use_history(records);
+
+  auto context = create_runtime_context(target_id, source_id);
+  REQUIRE(clang_tidy.collect_files(context) == std::vector<std::string>{"file.h"});
+  REQUIRE(clang_tidy.unit_of("file.h") == "file2.cpp");
+  REQUIRE(clang_tidy.unit_of("file2.cpp").empty());
+
+  auto database = compile_db{
+    (std::filesystem::path{clang_tidy.database_of("file.h")} / "compile_commands.json").string()};
+  REQUIRE(database.size() == 1);
+  REQUIRE(database.contains((root / "file2.cpp").string()));
+
+  clang_tidy.check(context);
+  check_result(clang_tidy, true, 1, 0, 0);
+}
+
+TEST_CASE("Test clang-tidy collapses diagnostics reported by many files",
+          "[CppLintAction][tool][clang_tidy][general_version]") {
+  auto clang_tidy = create_clang_tidy();
+  auto in_header  = [](const std::string &file_name) {
+    auto diag                   = clang_tidy::diagnostic{};
+    diag.header.file_name       = file_name;
+    diag.header.row_idx         = "1";
+    diag.header.col_idx         = "11";
+    diag.header.serverity       = "warning";
+    diag.header.brief           = "variable 'n' is non-const";
+    diag.header.diagnostic_type = "cppcoreguidelines-avoid-non-const-global-variables";
+    return diag;
+  };
+  auto failed_with = [](const std::string &file, clang_tidy::diagnostics diags) {
+    auto shard       = clang_tidy::result_t{};
+    auto &failed     = shard.fails[file];
+    failed.diags     = std::move(diags);
+    failed.file_path = file;
+    return nlohmann::json(shard);
+  };
+
+  auto collapsed_diags = [&](const std::string &file) {
+    return clang_tidy.collapsed_result().fails.at(file).diags.size();
+  };
+
+  // The least file owns a diagnostic whichever result comes first.
+  clang_tidy.load_result(failed_with("file2.cpp", {in_header("/repo/src/../file.h")}));
+  clang_tidy.load_result(
+    failed_with("file1.cpp", {in_header("/repo/file.h"), in_header("/repo/file.h")}));
+  REQUIRE(clang_tidy.held_diagnostics.size() == 1);
+  REQUIRE(clang_tidy.result.fails.at("file1.cpp").diags.empty());
+  REQUIRE(clang_tidy.dump_result("file1.cpp")["diags"].size() == 1);
+  REQUIRE(clang_tidy.dump_result("file2.cpp")["diags"].size() == 1);
+  REQUIRE(collapsed_diags("file1.cpp") == 1);
+  REQUIRE(collapsed_diags("file2.cpp") == 0);
+
+  // The next holder reports it once the owner is checked again without it.
+  clang_tidy.load_result(failed_with("file1.cpp", {}));
+  REQUIRE(collapsed_diags("file1.cpp") == 0);
+  REQUIRE(collapsed_diags("file2.cpp") == 1);
+
+  clang_tidy.load_result(failed_with("file1.cpp", {in_header("/repo/file.h")}));
+  REQUIRE(collapsed_diags("file1.cpp") == 1);
+  REQUIRE(collapsed_diags("file2.cpp") == 0);
+
+  // A diagnostic without holders isn't kept.
+  clang_tidy.load_result(failed_with("file1.cpp", {}));
+  clang_tidy.load_result(failed_with("file2.cpp", {}));
+  REQUIRE(clang_tidy.held_diagnostics.empty());
+
+  clang_tidy.reset_result();
+  clang_tidy.load_result(failed_with("file2.cpp", {in_header("/repo/file.h")}));
+  REQUIRE(collapsed_diags("file2.cpp") == 1);
+}
+
 TEST_CASE("Test reporter", "[CppLintAction][tool][clang_tidy][general_version]") {
   auto option = clang_tidy::option_t{};
   auto result = clang_tidy::result_t{};
 }
+
+#ifdef CPP_LINT_ACTION_WITH_LIBTIDY
+TEST_CASE("Test libtidy backend gets same diagnostics as executable",
+          "[CppLintAction][tool][clang_tidy][libtidy]") {
+  SKIP_IF_NO_CLANG_TIDY
+  auto option    = clang_tidy::option_t{};
+  option.enabled = true;
+  option.binary  = "libclang-tidy";
+  option.backend = clang_tidy::backend_t::libtidy;
+  auto libtidy   = clang_tidy::clang_tidy_libtidy{option};
+  auto binary    = create_clang_tidy();
+
+  auto repo = repo_t{};
+  repo.commit_clang_tidy();
+  repo.add_file("file.cpp", "int n = 0;\n");
+  auto target_id = repo.commit_changes();
+  repo.rewrite_file("file.cpp", "int n = 0;\nint m = 2;\n");
+  auto source_id = repo.commit_changes();
+
+  auto context  = create_runtime_context(target_id, source_id);
+  auto expected = binary.check_single_file(context, context.repo_path, "file.cpp");
+  auto actual   = libtidy.check_single_file(context, context.repo_path, "file.cpp");
+  REQUIRE(actual.passed == expected.passed);
+  REQUIRE(actual.diags.size() == expected.diags.size());
+  for (std::size_t i = 0; i < actual.diags.size(); ++i) {
+    REQUIRE(actual.diags[i].header.row_idx == expected.diags[i].header.row_idx);
+    REQUIRE(actual.diags[i].header.col_idx == expected.diags[i].header.col_idx);
+    REQUIRE(actual.diags[i].header.diagnostic_type == expected.diags[i].header.diagnostic_type);
+  }
+
+  // Engines are reused by later files.
+  auto again = libtidy.check_single_file(context, context.repo_path, "file.cpp");
+  REQUIRE(again.diags.size() == actual.diags.size());
+}
+#endif
+
+TEST_CASE("Test LSP messages framing", "[CppLintAction][tool][clang_tidy][clangd]") {
+  auto message = nlohmann::json{
+    {"id", 1}
+  };
+  REQUIRE(clang_tidy::frame(message) == "Content-Length: 8\r\n\r\n{\"id\":1}");
+  REQUIRE(clang_tidy::content_length("Content-Length: 8\r\n\r\n") == 8);
+  REQUIRE(clang_tidy::content_length("Content-Type: utf-8\r\nContent-Length:12\r\n\r\n") == 12);
+  REQUIRE(clang_tidy::content_length("Content-Type: utf-8\r\n\r\n") == 0);
+  REQUIRE(clang_tidy::to_uri("/tmp/a b/c++.cpp") == "file:///tmp/a%20b/c++.cpp");
+}
+
+TEST_CASE("Test clangd diagnostics are converted into result",
+          "[CppLintAction][tool][clang_tidy][clangd]") {
+  auto diagnostics = nlohmann::json::parse(R"([
+    {"range": {"start": {"line": 0, "character": 4}, "end": {"line": 0, "character": 5}},
+     "severity": 2, "code": "readability-identifier-length", "source": "clang-tidy",
+     "message": "variable name 'n' is too short"},
+    {"range": {"start": {"line": 2, "character": 0}, "end": {"line": 2, "character": 3}},
+     "severity": 1, "code": "undeclared_var_use", "source": "clang",
+     "message": "use of undeclared identifier 'foo'\nfile.cpp:1:5: note: did you mean 'n'?"},
+    {"range": {"start": {"line": 3, "character": 2}, "end": {"line": 3, "character": 3}},
+     "severity": 2, "code": "-Wunused-variable", "source": "clang",
+     "message": "unused variable 'm'"}
+  ])");
+
+  auto result = clang_tidy::make_result("file.cpp", diagnostics);
+  REQUIRE_FALSE(result.passed);
+  REQUIRE(result.file_path == "file.cpp");
+  REQUIRE(result.stat.errors == 1);
+  REQUIRE(result.stat.warnings == 2);
+  REQUIRE(result.diags.size() == 3);
+
+  const auto &first = result.diags[0].header;
+  REQUIRE(first.row_idx == "1");
+  REQUIRE(first.col_idx == "5");
+  REQUIRE(first.serverity == "warning");
+  REQUIRE(first.brief == " variable name 'n' is too short ");
+  REQUIRE(first.diagnostic_type == "[readability-identifier-length]");
+
+  REQUIRE(result.diags[1].header.serverity == "error");
+  REQUIRE(result.diags[1].header.brief == " use of undeclared identifier 'foo' ");
+  REQUIRE(result.diags[1].details == "file.cpp:1:5: note: did you mean 'n'?\n");
+  REQUIRE(result.diags[2].header.diagnostic_type == "[clang-diagnostic-unused-variable]");
+  REQUIRE(result.tool_stdout.starts_with("file.cpp:1:5: warning: variable name 'n' is too short "
+                                         "[readability-identifier-length]\n"));
+
+  REQUIRE(clang_tidy::make_result("file.cpp", nlohmann::json::array()).passed);
+}
+
+TEST_CASE("Test clangd backend checks files again after editing",
+          "[CppLintAction][tool][clang_tidy][clangd]") {
+  if (!has_clangd()) {
+    SKIP("Local environment doesn't have clangd. So skip clangd unit tests.");
+  }
+  auto option    = clang_tidy::option_t{};
+  option.enabled = true;
+  option.binary  = "clangd";
+  option.backend = clang_tidy::backend_t::clangd;
+  auto clangd    = clang_tidy::clang_tidy_clangd{option};
+
+  auto repo = repo_t{};
+  repo.commit_clang_tidy();
+  repo.add_file("file.cpp", "int n = 0;\n");
+  auto target_id = repo.commit_changes();
+  repo.rewrite_file("file.cpp", "int n = 0;\nint m = undeclared;\n");
+  auto source_id = repo.commit_changes();
+
+  auto context = create_runtime_context(target_id, source_id);
+  auto failed  = clangd.check_single_file(context, context.repo_path, "file.cpp");
+  REQUIRE_FALSE(failed.passed);
+
+  // The same clangd sees the new content of file.
+  repo.rewrite_file("file.cpp", "int n = 0;\n");
+  auto fixed = clangd.check_single_file(context, context.repo_path, "file.cpp");
+  REQUIRE(fixed.stat.errors == 0);
+}
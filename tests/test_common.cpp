@@ -74,6 +74,14 @@ void append_content_to_file(const std::string &file, const std::string &content)
   fstream.close();
 }
 
+void write_file(const std::filesystem::path &path, const std::string &content) {
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path());
+  }
+  auto file = std::ofstream{path};
+  file << content;
+}
+
 auto init_basic_repo() -> git::repo_ptr {
   auto repo = git::repo::init(temp_repo_dir, false);
   REQUIRE(git::repo::is_empty(*repo));
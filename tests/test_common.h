@@ -14,15 +14,24 @@
  * limitations under the License.
  */
 
+#include <atomic>
 #include <cctype>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <catch2/catch_all.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <git2/diff.h>
+#include <range/v3/algorithm/contains.hpp>
 #include <spdlog/spdlog.h>
 
+#include "tools/base_tool.h"
 #include "utils/git_utils.h"
 
 using namespace lint; // NOLINT
@@ -170,6 +179,141 @@ void append_content_to_file(const std::string &file, const std::string &content)
 // Initialize a basic repo for futhure test.
 auto init_basic_repo() -> lint::git::repo_ptr;
 
+// Write the file, creating its parent directories.
+void write_file(const std::filesystem::path &path, const std::string &content);
+
+// A tool which checks files without running any binary. It checks the given
+// files, or the changed ones of context if none is given. A file fails if it's
+// one of failures or its first line contains "bad", and a file whose first
+// line contains "slow" is checked until being cancelled.
+struct fake_tool : lint::tool::tool_base {
+  explicit fake_tool(std::vector<std::string> files      = {},
+                     std::string tool_name               = "fake",
+                     std::chrono::milliseconds cost      = std::chrono::milliseconds{1},
+                     std::vector<std::string> failures = {})
+    : files(std::move(files))
+    , tool_name(std::move(tool_name))
+    , cost(cost)
+    , failures(std::move(failures)) {
+  }
+
+  bool is_supported(lint::operating_system_t /*system*/, lint::arch_t /*arch*/) override {
+    return true;
+  }
+
+  auto name() -> std::string_view override {
+    return tool_name;
+  }
+
+  auto version() -> std::string_view override {
+    return "0";
+  }
+
+  auto binary() -> std::string_view override {
+    return "fake";
+  }
+
+  auto collect_files(const lint::runtime_context &context) -> std::vector<std::string> override {
+    if (!files.empty()) {
+      return files;
+    }
+    auto changed = std::vector<std::string>{};
+    for (const auto &file: context.changed_files) {
+      if (context.deltas.at(file).status != GIT_DELTA_DELETED) {
+        changed.push_back(file);
+      }
+    }
+    return changed;
+  }
+
+  auto accepts(const std::string &file) -> bool override {
+    return files.empty() || ranges::contains(files, file);
+  }
+
+  auto check_file(const lint::runtime_context &context,
+                  const std::string &file,
+                  std::stop_source cancel) -> lint::tool::file_outcome override {
+    if (cancel.stop_requested()) {
+      return {.skipped = true};
+    }
+    auto content = std::ifstream{std::filesystem::path{context.repo_path} / file};
+    auto line    = std::string{};
+    std::getline(content, line);
+
+    ++checks;
+    if (line.find("slow") != std::string::npos) {
+      slow_started = true;
+      while (!cancel.stop_requested()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+      return {.skipped = true};
+    }
+
+    auto passed = !ranges::contains(failures, file) && line.find("bad") == std::string::npos;
+    auto lock   = std::lock_guard{mutex};
+    checked.push_back(file);
+    outputs[file] = {passed, passed ? "" : fmt::format("{}:1:1: error: bad\n", file)};
+    return {.passed = passed, .peak_rss = 1};
+  }
+
+  auto estimate_memory(std::uintmax_t file_size) -> std::uint64_t override {
+    return file_size;
+  }
+
+  auto estimate_duration(std::uintmax_t /*file_size*/) -> std::chrono::milliseconds override {
+    return cost;
+  }
+
+  void check(const lint::runtime_context & /*context*/) override {
+  }
+
+  auto dump_result() -> nlohmann::json override {
+    return {};
+  }
+
+  auto dump_result(const std::string &file) -> nlohmann::json override {
+    auto lock = std::lock_guard{mutex};
+    if (!outputs.contains(file)) {
+      return nullptr;
+    }
+    auto result           = nlohmann::json::object();
+    result["passed"]      = outputs.at(file).first;
+    result["tool_stdout"] = outputs.at(file).second;
+    return result;
+  }
+
+  void reset_result() override {
+    auto lock = std::lock_guard{mutex};
+    outputs.clear();
+    ++resets;
+  }
+
+  void drop_caches(const std::vector<std::string> &changed) override {
+    auto lock = std::lock_guard{mutex};
+    dropped.insert(dropped.end(), changed.begin(), changed.end());
+  }
+
+  void load_result(const nlohmann::json & /*json*/) override {
+  }
+
+  auto get_reporter() -> lint::tool::reporter_base_ptr override {
+    return nullptr;
+  }
+
+  std::vector<std::string> files;
+  std::string tool_name;
+  std::chrono::milliseconds cost;
+  std::vector<std::string> failures;
+
+  std::mutex mutex;
+  std::vector<std::string> checked;
+  std::unordered_map<std::string, std::pair<bool, std::string>> outputs;
+  std::vector<std::string> dropped;
+  std::atomic<int> checks{0};
+  std::atomic<int> resets{0};
+  std::atomic<bool> slow_started{false};
+};
+
 class scope_guard {
 public:
   explicit scope_guard(std::function<void()> f)
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/compile_db.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <spdlog/spdlog.h>
+
+#include "test_common.h"
+
+using namespace lint;
+using namespace lint::tool;
+
+namespace {
+  auto make_root() -> std::filesystem::path {
+    auto root = std::filesystem::temp_directory_path() / "cpp-lint-action-compile-db";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    return root;
+  }
+} // namespace
+
+TEST_CASE("Test split command line", "[CppLintAction][tool][compile_db]") {
+  REQUIRE(split_command_line("  c++ -DA=1   -c a.cpp ")
+          == std::vector<std::string>{"c++", "-DA=1", "-c", "a.cpp"});
+  REQUIRE(split_command_line(R"(c++ -DNAME="\"x y\"" 'a b.cpp' a\ b.cpp "")")
+          == std::vector<std::string>{"c++", R"(-DNAME="x y")", "a b.cpp", "a b.cpp", ""});
+  REQUIRE(split_command_line(R"(c++ "C:\dir")") == std::vector<std::string>{"c++", R"(C:\dir)"});
+  REQUIRE(split_command_line("").empty());
+}
+
+TEST_CASE("Test strip irrelevant flags", "[CppLintAction][tool][compile_db]") {
+  auto arguments = std::vector<std::string>{"-O2-g++",
+                                            "-O2",
+                                            "-g3",
+                                            "-gcc-toolchain",
+                                            "/opt/gcc",
+                                            "-flto=thin",
+                                            "-DNDEBUG",
+                                            "-fsanitize=address",
+                                            "-I",
+                                            "-Os",
+                                            "-fprofile-instr-generate",
+                                            "-ObjC++",
+                                            "-Xlinker",
+                                            "--gc-sections",
+                                            "-Wl,-O1",
+                                            "-std=c++20",
+                                            "-Wall",
+                                            "-c",
+                                            "a.cpp",
+                                            "-o",
+                                            "-g.o"};
+  auto stripped = strip_irrelevant_flags(arguments);
+  REQUIRE(stripped
+          == std::vector<std::string>{"-O2-g++",
+                                      "-gcc-toolchain",
+                                      "/opt/gcc",
+                                      "-DNDEBUG",
+                                      "-I",
+                                      "-Os",
+                                      "-ObjC++",
+                                      "-std=c++20",
+                                      "-Wall",
+                                      "-c",
+                                      "a.cpp",
+                                      "-o",
+                                      "-g.o"});
+  REQUIRE(strip_irrelevant_flags({}).empty());
+}
+
+TEST_CASE("Test compile db index", "[CppLintAction][tool][compile_db]") {
+  auto root  = make_root();
+  auto json  = (root / "compile_commands.json").string();
+  auto index = compile_db_index_file(json);
+  auto dir   = root.string();
+  write_file(json, fmt::format(R"([
+    {{"directory": "{0}", "file": "a.cpp", "arguments": ["c++", "-DA", "-c", "a.cpp"]}},
+    {{"directory": "{0}/build", "file": "../b.cpp", "command": "c++ -DA -c ../b.cpp"}},
+    {{"directory": "{0}", "file": "{0}/a.cpp", "arguments": ["c++", "-DB", "-c", "a.cpp"]}}
+  ])", dir));
+
+  SECTION("commands should be found by absolute file") {
+    auto database = compile_db{json};
+    REQUIRE(database.size() == 2);
+    REQUIRE(std::filesystem::exists(index));
+
+    auto a = database.find((root / "a.cpp").string());
+    REQUIRE(a);
+    REQUIRE(a->directory == dir);
+    REQUIRE(a->arguments == std::vector<std::string>{"c++", "-DA", "-c", "a.cpp"});
+
+    auto b = database.find((root / "build" / ".." / "b.cpp").string());
+    REQUIRE(b);
+    REQUIRE(b->file == (root / "b.cpp").string());
+    REQUIRE(b->directory == dir + "/build");
+    REQUIRE(b->arguments == std::vector<std::string>{"c++", "-DA", "-c", "../b.cpp"});
+
+    REQUIRE_FALSE(database.contains((root / "c.cpp").string()));
+    REQUIRE_FALSE(database.contains("a.cpp"));
+
+    REQUIRE(database.contains_directory(dir));
+    REQUIRE(database.contains_directory(root.parent_path().string()));
+    REQUIRE_FALSE(database.contains_directory(dir + "/build"));
+    REQUIRE_FALSE(database.contains_directory(dir + "/a"));
+  }
+
+  SECTION("index should be reused until json is changed") {
+    { auto database = compile_db{json}; }
+    auto built = std::filesystem::last_write_time(index);
+
+    // Only touching json doesn't rebuild index.
+    std::filesystem::last_write_time(json, built + std::chrono::seconds{10});
+    REQUIRE(compile_db{json}.size() == 2);
+    REQUIRE(std::filesystem::last_write_time(index) != built);
+    auto refreshed = std::filesystem::file_size(index);
+    REQUIRE(compile_db{json}.size() == 2);
+    REQUIRE(std::filesystem::file_size(index) == refreshed);
+
+    constexpr auto changed = R"([{{"directory": "{}", "file": "c.cpp", "command": "cc c.cpp"}}])";
+    write_file(json, fmt::format(changed, dir));
+    auto database = compile_db{json};
+    REQUIRE(database.size() == 1);
+    REQUIRE(database.contains((root / "c.cpp").string()));
+  }
+
+  SECTION("opened database should be stale once json is changed") {
+    auto database = compile_db{json};
+    REQUIRE_FALSE(database.stale());
+
+    // Only touching json doesn't make it stale.
+    auto touched = std::filesystem::last_write_time(json) + std::chrono::seconds{10};
+    std::filesystem::last_write_time(json, touched);
+    REQUIRE_FALSE(database.stale());
+
+    write_file(json, "[]");
+    REQUIRE(database.stale());
+    std::filesystem::remove(json);
+    REQUIRE_THROWS(database.stale());
+  }
+
+  SECTION("written commands should be read back") {
+    auto sliced   = root / "sliced";
+    auto commands = std::vector<compile_command>{
+      {.directory = dir, .file = (root / "a.cpp").string(), .arguments = {"c++", "a.cpp"}}
+    };
+    write_compile_db(sliced.string(), commands);
+
+    auto database = compile_db{(sliced / "compile_commands.json").string()};
+    REQUIRE(database.size() == 1);
+    REQUIRE(database.find((root / "a.cpp").string())->arguments == commands[0].arguments);
+  }
+
+  SECTION("broken index should be rebuilt") {
+    write_file(index, "broken");
+    auto database = compile_db{json};
+    REQUIRE(database.size() == 2);
+  }
+
+  SECTION("broken json should throw") {
+    write_file(json, "[{");
+    REQUIRE_THROWS(compile_db{json});
+    REQUIRE_THROWS(compile_db{(root / "missing.json").string()});
+  }
+
+  std::filesystem::remove_all(root);
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "daemon/client.h"
+#include "daemon/server.h"
+#include "test_common.h"
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::daemon;
+
+namespace {
+  auto make_context(const std::filesystem::path &root) -> runtime_context {
+    auto context      = runtime_context{};
+    context.repo_path = root.string();
+    return context;
+  }
+
+  // A daemon running in a background thread of test.
+  struct local_daemon {
+    explicit local_daemon(const std::filesystem::path &root,
+                          std::vector<tool::tool_base_ptr> given = {})
+      : socket((root / ".git" / "daemon.sock").string())
+      , tools(std::move(given))
+      , context(make_context(root))
+      , server(socket, tools, context, pool, records, (root / ".git" / "history").string())
+      , thread([this] { server.run(); }) {
+    }
+
+    ~local_daemon() {
+      server.stop();
+      thread.join();
+    }
+
+    std::string socket;
+    std::vector<tool::tool_base_ptr> tools;
+    runtime_context context;
+    worker::pool pool{2};
+    tool::history records;
+    daemon::server server;
+    std::thread thread;
+  };
+} // namespace
+
+TEST_CASE("Test daemon lints files for clients", "[CppLintAction][daemon]") {
+  auto root = std::filesystem::temp_directory_path() / "cpp-lint-action-test-daemon";
+  std::filesystem::remove_all(root);
+  write_file(root / "good.cpp", "int good;\n");
+  write_file(root / "bad.cpp", "int bad;\n");
+
+  auto tools = std::vector<tool::tool_base_ptr>{};
+  tools.push_back(std::make_unique<fake_tool>());
+  auto *tool  = static_cast<fake_tool *>(tools.front().get());
+  auto daemon = std::make_unique<local_daemon>(root, std::move(tools));
+  auto socket = daemon->socket;
+
+  auto reports = std::vector<report>{};
+  auto collect = [&reports](const report &file) { reports.push_back(file); };
+
+  SECTION("reports of all files should be streamed") {
+    auto result = request_lint(socket, {.files = {"good.cpp", "./bad.cpp"}}, collect);
+    REQUIRE_FALSE(result.passed);
+    REQUIRE(result.checked == 2);
+    REQUIRE(result.error.empty());
+    REQUIRE(reports.size() == 2);
+    for (const auto &file: reports) {
+      REQUIRE(file.tool == "fake");
+      REQUIRE(file.passed == (file.file == "good.cpp"));
+      REQUIRE(file.result["tool_stdout"].get<std::string>().empty() == file.passed);
+    }
+  }
+
+  SECTION("each request should be checked from scratch") {
+    REQUIRE(request_lint(socket, {.files = {"good.cpp"}}, collect).passed);
+    write_file(root / "bad.cpp", "int fixed;\n");
+    REQUIRE(request_lint(socket, {.files = {"bad.cpp", "missing.cpp"}}, collect).passed);
+    REQUIRE(tool->resets == 2);
+    REQUIRE(reports.size() == 2);
+
+    // Only the caches of requested files are dropped.
+    REQUIRE(tool->dropped == std::vector<std::string>{"good.cpp", "bad.cpp", "missing.cpp"});
+  }
+
+  SECTION("finished sessions should be reaped") {
+    for (int i = 0; i < 8; ++i) {
+      REQUIRE(request_lint(socket, {.files = {"good.cpp"}}, collect).passed);
+    }
+
+    // Sessions of disconnected clients finish in the background.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (daemon->server.sessions() > 2 && std::chrono::steady_clock::now() < deadline) {
+      request_lint(socket, {.files = {"good.cpp"}}, collect);
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    REQUIRE(daemon->server.sessions() <= 2);
+  }
+
+  SECTION("files outside of repository should be refused") {
+    auto result = request_lint(socket, {.files = {"../good.cpp"}}, collect);
+    REQUIRE_FALSE(result.passed);
+    REQUIRE_FALSE(result.error.empty());
+    REQUIRE(reports.empty());
+  }
+
+  SECTION("another daemon shouldn't serve on the same socket") {
+    REQUIRE_THROWS(local_daemon{root});
+  }
+
+  daemon.reset();
+  REQUIRE_FALSE(std::filesystem::exists(socket));
+  REQUIRE_THROWS(request_lint(socket, {}, collect));
+  std::filesystem::remove_all(root);
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/fixes.h"
+
+#include <stdexcept>
+#include <string>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_common.h"
+#include "utils/git_utils.h"
+
+using namespace lint;
+using namespace lint::tool;
+
+TEST_CASE("Test parse exported fixes", "[CppLintAction][tool][fixes]") {
+  SECTION("replacements of diagnostics should be parsed") {
+    auto yaml = std::string{R"(---
+MainSourceFile:  '/repo/a.cpp'
+Diagnostics:
+  - DiagnosticName:  modernize-use-nullptr
+    DiagnosticMessage:
+      Message:         use nullptr
+      FilePath:        '/repo/a.cpp'
+      FileOffset:      10
+      Replacements:
+        - FilePath:        '/repo/a.cpp'
+          Offset:          10
+          Length:          1
+          ReplacementText: nullptr
+        - FilePath:        '/repo/a.h'
+          Offset:          0
+          Length:          0
+          ReplacementText: "#include <cstddef>\n"
+    Notes:
+      - Message:         alternative
+        FilePath:        '/repo/a.cpp'
+        Replacements:
+          - FilePath:        '/repo/a.cpp'
+            Offset:          20
+            Length:          2
+            ReplacementText: ''
+    Level:           Warning
+...
+)"};
+    auto fixes = parse_exported_fixes(yaml);
+    REQUIRE(fixes.size() == 2);
+    REQUIRE(fixes[0] == replacement{"/repo/a.cpp", 10, 1, "nullptr"});
+    REQUIRE(fixes[1] == replacement{"/repo/a.h", 0, 0, "#include <cstddef>\n"});
+  }
+
+  SECTION("replacements in the format before clang-tidy 9 should be parsed") {
+    auto yaml = std::string{R"(---
+Diagnostics:
+  - DiagnosticName:  readability-braces
+    Message:         add braces
+    Replacements:
+      - FilePath:        "/repo/b.cpp"
+        Offset:          3
+        Length:          0
+        ReplacementText: ' { ''x'' }'
+...
+)"};
+    auto fixes = parse_exported_fixes(yaml);
+    REQUIRE(fixes.size() == 1);
+    REQUIRE(fixes[0] == replacement{"/repo/b.cpp", 3, 0, " { 'x' }"});
+  }
+
+  SECTION("folded and escaped quoted scalars should be unfolded") {
+    auto yaml = std::string{"Diagnostics:\n"
+                            "  - DiagnosticMessage:\n"
+                            "      Replacements:\n"
+                            "        - FilePath: 'c.cpp'\n"
+                            "          ReplacementText: 'a\n"
+                            "\n"
+                            "            b\n"
+                            "            c'\n"
+                            "        - FilePath: 'c.cpp'\n"
+                            "          ReplacementText: \"\\tx\\x41\\u00e9\\\n"
+                            "            y\"\n"};
+    auto fixes = parse_exported_fixes(yaml);
+    REQUIRE(fixes.size() == 2);
+    REQUIRE(fixes[0].text == "a\nb c");
+    REQUIRE(fixes[1].text == "\txA\xC3\xA9y");
+  }
+
+  SECTION("nothing should be parsed if there is no diagnostic") {
+    REQUIRE(parse_exported_fixes("").empty());
+    REQUIRE(parse_exported_fixes("---\nMainSourceFile: a.cpp\nDiagnostics: []\n...\n").empty());
+  }
+}
+
+TEST_CASE("Test merge fixes", "[CppLintAction][tool][fixes]") {
+  SECTION("duplicated fixes should be applied once") {
+    auto merged = merge_fixes({
+      {"b.h", 4, 1, "y"},
+      {"a.h", 0, 1, "x"},
+      {"b.h", 4, 1, "y"},
+    });
+    REQUIRE(merged.duplicates == 1);
+    REQUIRE(merged.conflicts.empty());
+    REQUIRE(merged.files.size() == 2);
+    REQUIRE(merged.files["a.h"] == replacements{{"a.h", 0, 1, "x"}});
+    REQUIRE(merged.files["b.h"] == replacements{{"b.h", 4, 1, "y"}});
+  }
+
+  SECTION("overlapping fixes should be dropped regardless of their order") {
+    auto fixes = replacements{
+      {"a.h", 5, 2, "z"},
+      {"a.h", 0, 4, "x"},
+      {"a.h", 2, 2, "y"},
+      {"a.h", 4, 0, "w"},
+    };
+    auto merged   = merge_fixes(fixes);
+    auto reversed = merge_fixes({fixes.rbegin(), fixes.rend()});
+    REQUIRE(merged.files["a.h"] == reversed.files["a.h"]);
+    REQUIRE(merged.files["a.h"]
+            == replacements{{"a.h", 0, 4, "x"}, {"a.h", 4, 0, "w"}, {"a.h", 5, 2, "z"}});
+    REQUIRE(merged.conflicts == replacements{{"a.h", 2, 2, "y"}});
+  }
+
+  SECTION("different insertions at the same place should conflict") {
+    auto merged = merge_fixes({{"a.h", 3, 0, "x"}, {"a.h", 3, 0, "y"}, {"a.h", 3, 1, "z"}});
+    REQUIRE(merged.files["a.h"] == replacements{{"a.h", 3, 0, "x"}, {"a.h", 3, 1, "z"}});
+    REQUIRE(merged.conflicts == replacements{{"a.h", 3, 0, "y"}});
+  }
+}
+
+TEST_CASE("Test apply replacements", "[CppLintAction][tool][fixes]") {
+  REQUIRE(apply_replacements("int *p = 0;", {{"a.cpp", 9, 1, "nullptr"}}) == "int *p = nullptr;");
+  REQUIRE(apply_replacements("ab", {{"a.cpp", 0, 0, "x"}, {"a.cpp", 1, 1, "y"}}) == "xay");
+  REQUIRE(apply_replacements("ab", {}) == "ab");
+  REQUIRE_THROWS_AS(apply_replacements("ab", {{"a.cpp", 1, 2, ""}}), std::runtime_error);
+}
+
+TEST_CASE("Test commit fixes", "[CppLintAction][tool][fixes]") {
+  create_temp_repo_dir();
+  auto guard = scope_guard{remove_temp_repo_dir};
+
+  auto context      = runtime_context{};
+  context.repo_path = get_temp_repo_dir().string();
+  context.repo      = init_basic_repo();
+  context.fix_mode  = fix_mode_t::commit;
+  create_temp_files({"a.cpp", "b.cpp"}, "int *p = 0;\n");
+  auto [_, tree] = git::index::add_files(*context.repo, {"a.cpp", "b.cpp"});
+  git::commit::create_head(*context.repo, "Add two files", *tree);
+
+  // The change staged by the user isn't committed along with the fixes.
+  append_content_to_file("b.cpp", "int b;\n");
+  auto index = git::repo::index(*context.repo);
+  git::index::add_by_path(*index, "b.cpp");
+  git::index::write(*index);
+
+  write_fixes(context, merge_fixes({{"a.cpp", 9, 1, "nullptr"}}));
+  auto head = git::repo::head_commit(*context.repo);
+  REQUIRE(git::blob::get_raw_content(*context.repo, *head, "a.cpp") == "int *p = nullptr;\n");
+  REQUIRE(git::blob::get_raw_content(*context.repo, *head, "b.cpp") == "int *p = 0;\n");
+
+  // The staged change is kept in the index.
+  auto head_tree = git::commit::tree(*head);
+  auto diff      = git::diff::tree_to_index(
+    *context.repo, head_tree.get(), *git::repo::index(*context.repo), git::diff::init_option());
+  REQUIRE(git::diff::num_deltas(*diff) == 1);
+  REQUIRE(std::string{git::diff::get_delta(*diff, 0)->new_file.path} == "b.cpp");
+}
@@ -14,10 +14,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cctype>
 #include <filesystem>
+#include <fstream>
 #include <git2/diff.h>
 #include <iostream>
+#include <stdexcept>
 
 #include <catch2/catch_all.hpp>
 #include <catch2/catch_test_macros.hpp>
@@ -42,6 +45,19 @@ TEST_CASE("Create repo should work", "[CppLintAction][git2][repo]") {
   REQUIRE(git::repo::path(*repo) == temp_repo_dir_with_git);
 }
 
+TEST_CASE("Ignore rules should be applied", "[CppLintAction][git2][repo]") {
+  create_temp_repo_dir();
+  auto guard = scope_guard{remove_temp_repo_dir};
+
+  auto repo = git::repo::init(get_temp_repo_dir(), false);
+  auto file = std::ofstream{get_temp_repo_dir() / ".gitignore"};
+  file << "build/\n*.o\n";
+  file.close();
+  REQUIRE(git::repo::is_ignored(*repo, "build/a.cpp"));
+  REQUIRE(git::repo::is_ignored(*repo, "a.o"));
+  REQUIRE_FALSE(git::repo::is_ignored(*repo, "src/a.cpp"));
+}
+
 TEST_CASE("Set config should work", "[CppLintAction][git2][config]") {
   create_temp_repo_dir();
   auto guard = scope_guard{remove_temp_repo_dir};
@@ -264,6 +280,28 @@ TEST_CASE("Get file content from a specific commit", "[CppLintAction][git2][blob
   REQUIRE(content == "hello world");
 }
 
+TEST_CASE("Walk files of a tree recursively", "[CppLintAction][git2][tree]") {
+  create_temp_repo_dir();
+  auto guard = scope_guard{remove_temp_repo_dir};
+
+  std::filesystem::create_directories(get_temp_repo_dir() / "dir" / "sub");
+  const auto files = std::vector<std::string>{"a.cpp", "dir/b.cpp", "dir/sub/c.cpp"};
+  create_temp_files(files, "hello world");
+  auto repo               = init_basic_repo();
+  auto [index_oid, index] = git::index::add_files(*repo, files);
+  auto commit_oid         = git::commit::create_head(*repo, "Init", *index);
+  auto commit             = git::commit::lookup(*repo, commit_oid);
+  auto tree               = git::commit::tree(*commit);
+
+  auto visited = std::vector<std::string>{};
+  git::tree::walk_files(*tree, [&](const std::string &file) { visited.push_back(file); });
+  std::ranges::sort(visited);
+  REQUIRE(visited == files);
+
+  auto stop = [](const std::string & /*file*/) { throw std::runtime_error{"stop"}; };
+  REQUIRE_THROWS_WITH(git::tree::walk_files(*tree, stop), "stop");
+}
+
 TEST_CASE("Get lines in a hunk", "[CppLintAction][git2][patch]") {
   create_temp_repo_dir();
   auto guard = scope_guard{remove_temp_repo_dir};
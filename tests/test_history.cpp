@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/history.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace std::chrono_literals;
+
+TEST_CASE("Test history of previous runs", "[CppLintAction][tool][history]") {
+  auto dir  = std::filesystem::temp_directory_path() / "cpp-lint-action-test-history";
+  auto path = (dir / "history").string();
+  std::filesystem::remove_all(dir);
+
+  SECTION("missing history file results in empty history") {
+    auto records = tool::history{};
+    records.load(path);
+    REQUIRE(records.size() == 0);
+    REQUIRE_FALSE(records.find("clang-tidy", "a.cpp"));
+  }
+
+  SECTION("history should be saved and loaded") {
+    auto records = tool::history{};
+    records.update("clang-tidy", "a.cpp", {.peak_rss = 1024, .duration = 10ms});
+    records.update("clang-format", "a.cpp", {.peak_rss = 64, .duration = 1ms});
+    records.update("clang-tidy", "a.cpp", {.peak_rss = 2048, .duration = 20ms});
+    records.save(path);
+
+    auto loaded = tool::history{};
+    loaded.load(path);
+    REQUIRE(loaded.size() == 2);
+    REQUIRE(loaded.find("clang-tidy", "a.cpp")->peak_rss == 2048);
+    REQUIRE(loaded.find("clang-tidy", "a.cpp")->duration == 20ms);
+    REQUIRE(loaded.find("clang-format", "a.cpp")->peak_rss == 64);
+    REQUIRE_FALSE(loaded.find("clang-format", "b.cpp"));
+  }
+
+  SECTION("saving should leave no temporary file behind") {
+    auto records = tool::history{};
+    records.update("clang-tidy", "a.cpp", {.peak_rss = 1024, .duration = 10ms});
+    records.save(path);
+    records.save(path);
+    auto files = std::distance(std::filesystem::directory_iterator{dir},
+                               std::filesystem::directory_iterator{});
+    REQUIRE(files == 1);
+  }
+
+  SECTION("broken lines and unknown keys should be ignored") {
+    std::filesystem::create_directories(dir);
+    auto file  = std::ofstream{path};
+    file      << "broken\n";
+    file      << "clang-tidy\ta.cpp\tunknown=1\trss=10\tinvalid\tms=5\n";
+    file.close();
+
+    auto records = tool::history{};
+    records.load(path);
+    REQUIRE(records.size() == 1);
+    REQUIRE(records.find("clang-tidy", "a.cpp")->peak_rss == 10);
+    REQUIRE(records.find("clang-tidy", "a.cpp")->duration == 5ms);
+  }
+
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/include_graph.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::tool;
+
+TEST_CASE("Test parse dependency file", "[CppLintAction][tool][include_graph]") {
+  REQUIRE(parse_dependency_file("a.o: a.cpp a.h \\\n  b.h\n")
+          == std::vector<std::string>{"a.cpp", "a.h", "b.h"});
+  REQUIRE(parse_dependency_file("a.o: a.cpp \\\r\n dir\\ name/c$$.h\na.h:\n")
+          == std::vector<std::string>{"a.cpp", "dir name/c$.h"});
+  REQUIRE(parse_dependency_file(R"(C:\build\a.o: C:\src\a.cpp)")
+          == std::vector<std::string>{R"(C:\src\a.cpp)"});
+  REQUIRE(parse_dependency_file("a.o \\\n  b.o: a.cpp").front() == "a.cpp");
+  REQUIRE(parse_dependency_file("").empty());
+}
+
+TEST_CASE("Test include graph", "[CppLintAction][tool][include_graph]") {
+  SECTION("units including a header should be found") {
+    auto graph = include_graph{};
+    graph.add("/repo/a.cpp", {"/repo/a.h", "/repo/common.h", "/repo/a.h"});
+    graph.add("/repo/b.cpp", {"/repo/common.h"});
+    REQUIRE(graph.size() == 2);
+    REQUIRE(graph.units_of("/repo/a.h") == std::vector<std::string>{"/repo/a.cpp"});
+    REQUIRE(graph.units_of("/repo/common.h")
+            == std::vector<std::string>{"/repo/a.cpp", "/repo/b.cpp"});
+    REQUIRE(graph.units_of("/repo/c.h").empty());
+  }
+
+  SECTION("dependency files should be loaded recursively") {
+    auto root = std::filesystem::temp_directory_path() / "cpp-lint-action-include-graph";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "build" / "dir");
+    std::ofstream{root / "build" / "dir" / "a.cpp.d"} << "a.o: ../src/a.cpp /usr/include/a.h \\\n"
+                                                       << "  ../src/a.h\n";
+    std::ofstream{root / "build" / "a.txt"} << "b.o: ../src/b.cpp ../src/a.h\n";
+
+    auto graph = include_graph{};
+    graph.load((root / "build").string());
+    REQUIRE(graph.size() == 1);
+    REQUIRE(graph.units_of((root / "src" / "a.h").string())
+            == std::vector<std::string>{(root / "src" / "a.cpp").string()});
+    REQUIRE(graph.units_of("/usr/include/a.h").size() == 1);
+
+    std::filesystem::remove_all(root);
+  }
+}
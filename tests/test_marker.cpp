@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "github/marker.h"
+
+#include <string>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <nlohmann/json.hpp>
+
+#include "github/review_comment.h"
+
+using namespace lint;
+using namespace lint::github;
+
+TEST_CASE("Test hidden marker of bodies", "[CppLintAction][github][marker]") {
+  auto body   = std::string{"# Result\n| a | b |"};
+  auto marked = with_marker(body);
+  REQUIRE(marked.starts_with(body));
+  REQUIRE(marked.ends_with(" -->"));
+  REQUIRE(marker_of(marked) == content_hash(body));
+  REQUIRE(content_hash(body).size() == 16);
+  REQUIRE(content_hash(body) != content_hash(body + " "));
+
+  REQUIRE(marker_of(body).empty());
+  REQUIRE(marker_of("<!-- cpp-lint-action:abc").empty());
+  REQUIRE(marker_of(with_marker(marked)) == content_hash(marked));
+}
+
+TEST_CASE("Test review comments are marked", "[CppLintAction][github][marker]") {
+  auto comments = review_comments{
+    {.path = "a.cpp", .position = 3, .body = "use nullptr"}
+  };
+  auto review = nlohmann::json::parse(make_review_str(comments));
+  auto comment = review["comments"][0];
+  REQUIRE(!marker_of(review["body"].get<std::string>()).empty());
+  REQUIRE(marker_of(comment["body"].get<std::string>()) == review_comment_hash(comments[0]));
+  REQUIRE(comment["path"] == "a.cpp");
+
+  // The same suggestion on another line is another comment.
+  auto moved     = comments[0];
+  moved.position = 4;
+  REQUIRE(review_comment_hash(moved) != review_comment_hash(comments[0]));
+}
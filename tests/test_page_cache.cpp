@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "github/page_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::github;
+
+TEST_CASE("Test parse next link", "[CppLintAction][github][page_cache]") {
+  auto link = std::string{
+    R"(<https://api.github.com/repositories/1/issues/2/comments?per_page=100&page=2>; rel="next", )"
+    R"(<https://api.github.com/repositories/1/issues/2/comments?per_page=100&page=5>; rel="last")"};
+  REQUIRE(parse_next_link(link) == "/repositories/1/issues/2/comments?per_page=100&page=2");
+
+  auto last = std::string{R"(<https://api.github.com/x?page=1>; rel="prev", )"
+                          R"(<https://api.github.com/x?page=1>; rel="first")"};
+  REQUIRE(parse_next_link(last).empty());
+  REQUIRE(parse_next_link("").empty());
+}
+
+TEST_CASE("Test page cache", "[CppLintAction][github][page_cache]") {
+  auto root = std::filesystem::temp_directory_path() / "cpp-lint-action-page-cache";
+  std::filesystem::remove_all(root);
+  auto path = (root / "cache").string();
+
+  SECTION("pages should be persisted") {
+    auto cache = page_cache{};
+    cache.store("/a?page=1", {.etag = R"(W/"1")", .next = "/a?page=2", .body = "[]"});
+    REQUIRE(cache.find("/b") == nullptr);
+    cache.save(path);
+
+    auto loaded = page_cache{};
+    loaded.load(path);
+    const auto *page = loaded.find("/a?page=1");
+    REQUIRE(page != nullptr);
+    REQUIRE(page->etag == R"(W/"1")");
+    REQUIRE(page->next == "/a?page=2");
+    REQUIRE(page->body == "[]");
+  }
+
+  SECTION("least recently used pages should be evicted") {
+    auto cache = page_cache{};
+    for (auto i = 0; i < 100; ++i) {
+      cache.store(std::to_string(i), {.etag = "e"});
+    }
+    cache.find("0");
+    cache.save(path);
+
+    auto loaded = page_cache{};
+    loaded.load(path);
+    REQUIRE(loaded.size() == 64);
+    REQUIRE(loaded.find("0") != nullptr);
+    REQUIRE(loaded.find("1") == nullptr);
+    REQUIRE(loaded.find("99") != nullptr);
+  }
+
+  SECTION("saving should leave no temporary file behind") {
+    auto cache = page_cache{};
+    cache.store("/a?page=1", {.etag = "e"});
+    cache.save(path);
+    cache.save(path);
+    auto files = std::distance(std::filesystem::directory_iterator{root},
+                               std::filesystem::directory_iterator{});
+    REQUIRE(files == 1);
+  }
+
+  SECTION("missing or broken cache should be empty") {
+    auto cache = page_cache{};
+    cache.load(path);
+    REQUIRE(cache.size() == 0);
+
+    std::filesystem::create_directories(root);
+    std::ofstream{path} << "{broken";
+    cache.load(path);
+    REQUIRE(cache.size() == 0);
+  }
+
+  std::filesystem::remove_all(root);
+}
@@ -113,6 +113,128 @@ TEST_CASE("Test fill context by program options", "[CppLintAction][program_optio
     REQUIRE(context.enable_pull_request_review == true);
   }
 
+  SECTION("enable_fail_fast should be passed into context") {
+    auto opts         = make_opt("--target-revision=main", "--enable-fail-fast=true");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.enable_fail_fast == true);
+  }
+
+  SECTION("jobs should be passed into context") {
+    auto opts         = make_opt("--target-revision=main", "--jobs=4");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.jobs == 4);
+  }
+
+  SECTION("memory_budget and history_file should be passed into context") {
+    auto opts = make_opt("--target-revision=main", "--memory-budget=2048", "--history-file=a.txt");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.memory_budget == 2048);
+    REQUIRE(context.history_file == "a.txt");
+  }
+
+  SECTION("shard options should be passed into context") {
+    auto opts = make_opt(
+      "--target-revision=main", "--shard-index=1", "--shard-count=4", "--shard-strategy=cost");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.shard_index == 1);
+    REQUIRE(context.shard_count == 4);
+    REQUIRE(context.shard_strategy == shard_strategy_t::cost);
+    REQUIRE(context.shard_bundle == "cpp-lint-action-shard-1.json");
+  }
+
+  SECTION("invalid shard options should throw") {
+    auto opts         = make_opt("--target-revision=main", "--shard-index=4", "--shard-count=4");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_THROWS(fill_context(user_options, context));
+
+    auto strategy_opts    = make_opt("--target-revision=main", "--shard-strategy=unknown");
+    auto strategy_options = parse(strategy_opts.size(), strategy_opts.data(), desc);
+    REQUIRE_THROWS(fill_context(strategy_options, context));
+  }
+
+  SECTION("positional arguments should be treated as bundles") {
+    auto opts         = make_opt("--target-revision=main", "a.json", " ", "b.json");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.bundles == std::vector<std::string>{"a.json", "b.json"});
+  }
+
+  SECTION("remote workers should be split by comma") {
+    auto opts         = make_opt("--target-revision=main", "--remote-workers=a:1, b:2,,");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.remote_workers == std::vector<std::string>{"a:1", "b:2"});
+  }
+
+  SECTION("daemon socket should be passed into context") {
+    auto opts         = make_opt("--target-revision=main", "--daemon-socket=/tmp/lint.sock");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.daemon_socket == "/tmp/lint.sock");
+  }
+
+  SECTION("watch debounce should be passed into context") {
+    auto opts         = make_opt("--target-revision=main", "--watch-debounce=50");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.watch_debounce == std::chrono::milliseconds{50});
+  }
+
+  SECTION("progress interval should be passed into context") {
+    auto opts         = make_opt("--target-revision=main", "--progress-interval=0");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.progress_interval == std::chrono::seconds{0});
+  }
+
+  SECTION("fix options should be passed into context") {
+    auto opts         = make_opt("--target-revision=main", "--fix=patch");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.fix_mode == fix_mode_t::patch);
+    REQUIRE(context.fix_patch == "cpp-lint-action-fixes.patch");
+
+    auto mode_opts    = make_opt("--target-revision=main", "--fix=unknown");
+    auto mode_options = parse(mode_opts.size(), mode_opts.data(), desc);
+    REQUIRE_THROWS(fill_context(mode_options, context));
+
+    auto remote_opts    = make_opt("--target-revision=main", "--fix=commit", "--remote-workers=a:1");
+    auto remote_options = parse(remote_opts.size(), remote_opts.data(), desc);
+    REQUIRE_THROWS(fill_context(remote_options, context));
+  }
+
+  SECTION("target shouldn't be specified when linting staged changes") {
+    context.staged    = true;
+    auto opts         = make_opt();
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.target.empty());
+
+    auto target         = make_opt("--target-revision=main");
+    auto target_options = parse(target.size(), target.data(), desc);
+    REQUIRE_THROWS(fill_context(target_options, context));
+  }
+
+  SECTION("target shouldn't be specified when scanning all files") {
+    auto opts         = make_opt("--scan-all=true");
+    auto user_options = parse(opts.size(), opts.data(), desc);
+    REQUIRE_NOTHROW(fill_context(user_options, context));
+    REQUIRE(context.scan_all == true);
+    REQUIRE(context.target.empty());
+
+    auto target         = make_opt("--scan-all=true", "--target-revision=main");
+    auto target_options = parse(target.size(), target.data(), desc);
+    REQUIRE_THROWS(fill_context(target_options, context));
+
+    auto review         = make_opt("--scan-all=true", "--enable-pull-request-review=true");
+    auto review_options = parse(review.size(), review.data(), desc);
+    REQUIRE_THROWS(fill_context(review_options, context));
+  }
+
   SECTION("default values should be passed into context") {
     auto opts         = make_opt("--target-revision=main");
     auto user_options = parse(opts.size(), opts.data(), desc);
@@ -121,5 +243,15 @@ TEST_CASE("Test fill context by program options", "[CppLintAction][program_optio
     REQUIRE(context.enable_comment_on_issue == true);
     REQUIRE(context.enable_pull_request_review == false);
     REQUIRE(context.enable_action_output == true);
+    REQUIRE(context.enable_fail_fast == false);
+    REQUIRE(context.jobs == 0);
+    REQUIRE(context.memory_budget == 0);
+    REQUIRE(context.history_file.empty());
+    REQUIRE(context.shard_count == 1);
+    REQUIRE(context.bundles.empty());
+    REQUIRE(context.remote_workers.empty());
+    REQUIRE(context.daemon_socket.empty());
+    REQUIRE(context.watch_debounce == std::chrono::milliseconds{200});
+    REQUIRE(context.progress_interval == std::chrono::seconds{30});
   }
 }
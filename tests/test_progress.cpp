@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tools/progress.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::tool;
+using namespace std::chrono_literals;
+
+namespace {
+  // Records what is published to a sink.
+  struct fake_sink {
+    auto sink() -> progress_sink {
+      return [this](const std::vector<reporter_base_ptr> & /*reporters*/,
+                    const std::string &progress) {
+        auto lock = std::lock_guard{mutex};
+        published.push_back(progress);
+      };
+    }
+
+    auto count() -> std::size_t {
+      auto lock = std::lock_guard{mutex};
+      return published.size();
+    }
+
+    // Wait for the background thread to publish.
+    auto wait_for(std::size_t expected) -> bool {
+      auto deadline = std::chrono::steady_clock::now() + 5s;
+      while (count() < expected && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+      }
+      return count() == expected;
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> published;
+  };
+
+  const auto passed = file_outcome{.passed = true};
+  const auto failed = file_outcome{.passed = false};
+} // namespace
+
+TEST_CASE("Progress should be published while checks run", "[CppLintAction][tools][progress]") {
+  auto tools   = std::vector<tool_base_ptr>{};
+  auto comment = fake_sink{};
+  auto review  = fake_sink{};
+
+  SECTION("the first finished check is published at once and later ones are throttled") {
+    auto option   = progress_reporter::option_t{.comment_interval = 1h, .review_interval = 1h};
+    auto progress = progress_reporter{tools, option, comment.sink(), review.sink()};
+    progress.finished(task{}, passed);
+    progress.finished(task{}, passed);
+    progress.finished(task{}, passed);
+    REQUIRE(comment.wait_for(1));
+    progress.stop();
+    REQUIRE(comment.count() == 1);
+    REQUIRE(review.count() == 0);
+  }
+
+  SECTION("checks finished after the interval are published again") {
+    auto option   = progress_reporter::option_t{.comment_interval = 0ms, .review_interval = 0ms};
+    auto progress = progress_reporter{tools, option, comment.sink(), review.sink()};
+    progress.finished(task{}, passed);
+    REQUIRE(comment.wait_for(1));
+    progress.finished(task{}, passed);
+    REQUIRE(comment.wait_for(2));
+    progress.stop();
+    REQUIRE(comment.published.back() == "2 checks finished, 0 failed so far");
+  }
+
+  SECTION("review is only published once a check failed") {
+    auto option   = progress_reporter::option_t{.comment_interval = 1h, .review_interval = 0ms};
+    auto progress = progress_reporter{tools, option, {}, review.sink()};
+    progress.finished(task{}, passed);
+    progress.finished(task{}, failed);
+    REQUIRE(review.wait_for(1));
+    progress.stop();
+    REQUIRE(review.published.front() == "2 checks finished, 1 failed so far");
+  }
+
+  SECTION("nothing is published if no check finished") {
+    {
+      auto option   = progress_reporter::option_t{.comment_interval = 0ms, .review_interval = 0ms};
+      auto progress = progress_reporter{tools, option, comment.sink(), review.sink()};
+    }
+    REQUIRE(comment.count() == 0);
+    REQUIRE(review.count() == 0);
+  }
+}
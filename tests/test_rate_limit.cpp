@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "github/rate_limit.h"
+
+#include <chrono>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::github;
+using namespace std::chrono_literals;
+
+namespace {
+  // A clock which only moves when the scheduler sleeps.
+  struct fake_clock {
+    request_scheduler::clock::time_point now{std::chrono::seconds{1000}};
+    std::vector<request_scheduler::duration> sleeps;
+
+    // The epoch seconds after the duration, like x-ratelimit-reset.
+    [[nodiscard]] auto epoch_after(std::chrono::seconds time) const -> std::size_t {
+      auto epoch = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch() + time);
+      return static_cast<std::size_t>(epoch.count());
+    }
+
+    auto option() -> request_scheduler::option_t {
+      auto option  = request_scheduler::option_t{};
+      option.now   = [this] { return now; };
+      option.sleep = [this](request_scheduler::duration time) {
+        sleeps.push_back(time);
+        now += time;
+      };
+      return option;
+    }
+  };
+} // namespace
+
+TEST_CASE("Test parse rate limit headers", "[CppLintAction][github][rate_limit]") {
+  auto headers = parse_rate_limit("42", "1700000000", " 30");
+  REQUIRE(headers.remaining == 42);
+  REQUIRE(headers.reset == 1700000000);
+  REQUIRE(headers.retry == 30);
+
+  auto absent = parse_rate_limit("", "", "Wed, 21 Oct 2015 07:28:00 GMT");
+  REQUIRE(absent.remaining == 0);
+  REQUIRE(absent.reset == 0);
+  REQUIRE(absent.retry == 0);
+
+  REQUIRE(is_rate_limited(429, {}));
+  REQUIRE(is_rate_limited(403, {.reset = 1000, .remaining = 0}));
+  REQUIRE(is_rate_limited(403, {.retry = 60}));
+  REQUIRE_FALSE(is_rate_limited(403, {.reset = 1000, .remaining = 10}));
+  REQUIRE_FALSE(is_rate_limited(200, {.reset = 1000, .remaining = 0}));
+}
+
+TEST_CASE("Test request scheduler", "[CppLintAction][github][rate_limit]") {
+  auto clock = fake_clock{};
+
+  SECTION("bursts should be paced by the token bucket") {
+    auto option            = clock.option();
+    option.burst           = 2;
+    option.refill_interval = 500ms;
+    auto scheduler         = request_scheduler{option};
+    for (auto i = 0; i < 4; ++i) {
+      REQUIRE(scheduler.acquire(request_priority::critical));
+    }
+    REQUIRE(clock.sleeps == std::vector<request_scheduler::duration>{500ms, 500ms});
+  }
+
+  SECTION("optional requests should leave the reserve to critical ones") {
+    auto option    = clock.option();
+    option.reserve = 5;
+    auto scheduler = request_scheduler{option};
+    auto reset     = clock.epoch_after(60s);
+    auto budget    = rate_limit_headers{.reset = reset, .remaining = 5};
+    REQUIRE_FALSE(scheduler.settle(200, budget, 0).has_value());
+
+    REQUIRE(scheduler.acquire(request_priority::critical));
+    REQUIRE(clock.sleeps.empty());
+    REQUIRE(scheduler.acquire(request_priority::optional));
+    REQUIRE(clock.sleeps == std::vector<request_scheduler::duration>{60s});
+  }
+
+  SECTION("optional requests should be dropped if reset is too far away") {
+    auto option     = clock.option();
+    option.max_wait = 10s;
+    auto scheduler  = request_scheduler{option};
+    auto reset      = clock.epoch_after(60s);
+    auto budget     = rate_limit_headers{.reset = reset, .remaining = 0};
+    scheduler.settle(200, budget, 0);
+    REQUIRE_FALSE(scheduler.acquire(request_priority::optional));
+    REQUIRE(scheduler.acquire(request_priority::critical));
+    REQUIRE(clock.sleeps.empty());
+  }
+
+  SECTION("refused requests should be retried after the time given by Github") {
+    auto scheduler = request_scheduler{clock.option()};
+    REQUIRE(scheduler.settle(429, {.retry = 30}, 0) == 30s);
+    REQUIRE(scheduler.acquire(request_priority::critical));
+    REQUIRE(clock.sleeps == std::vector<request_scheduler::duration>{30s});
+
+    auto delay = scheduler.settle(403, {.reset = clock.epoch_after(20s), .remaining = 0}, 0);
+    REQUIRE(delay == 21s);
+  }
+
+  SECTION("failed requests should be retried with bounded backoff") {
+    auto option         = clock.option();
+    option.backoff_base = 100ms;
+    option.backoff_cap  = 1s;
+    option.max_retries  = 3;
+    auto scheduler      = request_scheduler{option};
+    for (auto retries = std::size_t{0}; retries < 3; ++retries) {
+      auto delay = scheduler.settle(502, {}, retries);
+      REQUIRE(delay.has_value());
+      REQUIRE(*delay <= std::min<request_scheduler::duration>(100ms * (1 << retries), 1s));
+    }
+    REQUIRE_FALSE(scheduler.settle(0, {}, 3).has_value());
+    REQUIRE_FALSE(scheduler.settle(404, {}, 0).has_value());
+    REQUIRE_FALSE(scheduler.settle(403, {}, 0).has_value());
+  }
+
+  SECTION("requests which aren't idempotent should only be retried when refused") {
+    auto scheduler = request_scheduler{clock.option()};
+    REQUIRE_FALSE(scheduler.settle(502, {}, 0, false).has_value());
+    REQUIRE_FALSE(scheduler.settle(0, {}, 0, false).has_value());
+    REQUIRE(scheduler.settle(429, {.retry = 30}, 0, false) == 30s);
+    auto delay = scheduler.settle(403, {.reset = clock.epoch_after(20s), .remaining = 0}, 0, false);
+    REQUIRE(delay == 21s);
+  }
+}
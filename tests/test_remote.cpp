@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "remote/coordinator.h"
+#include "remote/protocol.h"
+#include "remote/worker.h"
+#include "test_common.h"
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::remote;
+using namespace std::chrono_literals;
+
+namespace {
+  // A worker running in a background thread of test.
+  struct local_worker {
+    explicit local_worker(worker_options options)
+      : worker(std::move(options))
+      , thread([this] { worker.run(); }) {
+    }
+
+    ~local_worker() {
+      worker.stop();
+      thread.join();
+    }
+
+    [[nodiscard]] auto endpoint() const -> std::string {
+      return fmt::format("127.0.0.1:{}", worker.port());
+    }
+
+    server worker;
+    std::thread thread;
+  };
+
+  auto make_options(const std::filesystem::path &root, std::size_t slots) -> worker_options {
+    auto options   = worker_options{};
+    options.root   = root.string();
+    options.slots  = slots;
+    options.binary = "cat";
+    return options;
+  }
+} // namespace
+
+TEST_CASE("Test parse endpoint", "[CppLintAction][remote]") {
+  using endpoint = std::pair<std::string, std::uint16_t>;
+  REQUIRE(parse_endpoint("localhost:7800") == endpoint{"localhost", 7800});
+  REQUIRE(parse_endpoint("::1:80") == endpoint{"::1", 80});
+  REQUIRE_THROWS(parse_endpoint("localhost"));
+  REQUIRE_THROWS(parse_endpoint(":80"));
+  REQUIRE_THROWS(parse_endpoint("localhost:port"));
+  REQUIRE_THROWS(parse_endpoint("localhost:65536"));
+}
+
+TEST_CASE("Test run job", "[CppLintAction][remote]") {
+  auto root = std::filesystem::temp_directory_path() / "cpp-lint-action-test-remote-job";
+  write_file(root / "a.cpp", "int a;\n");
+  auto options = make_options(root, 1);
+
+  auto request    = job{.id = 1, .args = {"a.cpp"}, .file = "a.cpp"};
+  request.content = "int a;\n";
+
+  SECTION("job should be run by the binary of worker") {
+    auto answer = run_job(options, request);
+    REQUIRE(answer.id == 1);
+    REQUIRE(answer.error.empty());
+    REQUIRE(answer.exit_code == 0);
+    REQUIRE(answer.std_out == "int a;\n");
+  }
+
+  SECTION("flags out of allow-list should be refused") {
+    request.args = {"-p=build", "--header-filter=.*", "--allow-no-checks", "a.cpp"};
+    REQUIRE(run_job(options, request).error.empty());
+
+    request.args = {"--load=plugin.so", "a.cpp"};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+    request.args = {"--export-fixes=a.yaml", "a.cpp"};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+    request.args = {"--allow-no-checks-and-more", "a.cpp"};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+  }
+
+  SECTION("paths outside of checkout should be refused") {
+    request.args = {"-p=/tmp", "a.cpp"};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+    request.args = {"--config-file=../.clang-tidy", "a.cpp"};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+  }
+
+  SECTION("positional arguments other than the file should be refused") {
+    request.args = {"a.cpp", "/etc/passwd"};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+    request.args = {"-p", "/tmp", "a.cpp"};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+    request.args = {};
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+  }
+
+  SECTION("files outside of checkout should be refused") {
+    request.file = "../a.cpp";
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+    request.file = "/etc/passwd";
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+  }
+
+  SECTION("file differs from the coordinator's one should be refused") {
+    request.content = "int b;\n";
+    REQUIRE_FALSE(run_job(options, request).error.empty());
+  }
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Test farm out jobs to workers", "[CppLintAction][remote]") {
+  auto root = std::filesystem::temp_directory_path() / "cpp-lint-action-test-remote";
+  for (int i = 0; i < 16; ++i) {
+    write_file(root / fmt::format("{}.cpp", i), fmt::format("int a{};\n", i));
+  }
+
+  auto run_all = [&](coordinator &workers) {
+    auto futures = std::vector<std::future<std::optional<shell::result>>>{};
+    for (int i = 0; i < 16; ++i) {
+      auto file = fmt::format("{}.cpp", i);
+      futures.push_back(std::async(std::launch::async, [&workers, &root, file] {
+        return workers.execute({file}, root.string(), file);
+      }));
+    }
+    for (int i = 0; i < 16; ++i) {
+      auto res = futures[i].get();
+      REQUIRE(res.has_value());
+      REQUIRE(res->exit_code == 0);
+      REQUIRE(res->std_out == fmt::format("int a{};\n", i));
+    }
+  };
+
+  SECTION("jobs should be run by several workers") {
+    auto first   = local_worker{make_options(root, 2)};
+    auto second  = local_worker{make_options(root, 3)};
+    auto workers = coordinator{{first.endpoint(), second.endpoint()}};
+    REQUIRE(workers.slots() == 5);
+    run_all(workers);
+  }
+
+  SECTION("unreachable workers should be skipped") {
+    auto alive   = local_worker{make_options(root, 1)};
+    auto workers = coordinator{{alive.endpoint(), "127.0.0.1:1"}};
+    REQUIRE(workers.slots() == 1);
+    run_all(workers);
+  }
+
+  SECTION("jobs of a dead worker should be retried on others") {
+    // The worker dies once it receives a job.
+    auto io       = boost::asio::io_context{};
+    auto acceptor = tcp::acceptor{io, tcp::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+    auto dying    = std::thread{[&] {
+      try {
+        auto socket = acceptor.accept();
+        auto buffer = boost::asio::streambuf{};
+        read_message(socket, buffer);
+        write_message(socket, hello{.slots = 1});
+        read_message(socket, buffer);
+      } catch (const boost::system::system_error &) { // NOLINT
+        // All jobs are stolen by the other worker.
+      }
+    }};
+
+    {
+      auto alive   = local_worker{make_options(root, 1)};
+      auto workers = coordinator{
+        {fmt::format("127.0.0.1:{}", acceptor.local_endpoint().port()), alive.endpoint()}};
+      REQUIRE(workers.slots() == 2);
+      run_all(workers);
+    }
+    dying.join();
+  }
+
+  SECTION("workers should only accept coordinators with their secret") {
+    auto options   = make_options(root, 2);
+    options.secret = "secret";
+    auto secured   = local_worker{options};
+
+    auto strangers = coordinator{{secured.endpoint()}};
+    REQUIRE(strangers.slots() == 0);
+    auto wrong = coordinator{{secured.endpoint()}, "secrets"};
+    REQUIRE(wrong.slots() == 0);
+    auto workers = coordinator{{secured.endpoint()}, "secret"};
+    REQUIRE(workers.slots() == 2);
+    run_all(workers);
+  }
+
+  SECTION("finished sessions should be reaped") {
+    auto alive = local_worker{make_options(root, 1)};
+    for (int i = 0; i < 8; ++i) {
+      auto workers = coordinator{{alive.endpoint()}};
+      REQUIRE(workers.slots() == 1);
+    }
+
+    // Sessions of disconnected coordinators finish in the background.
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (alive.worker.sessions() > 2 && std::chrono::steady_clock::now() < deadline) {
+      auto workers = coordinator{{alive.endpoint()}};
+      std::this_thread::sleep_for(10ms);
+    }
+    REQUIRE(alive.worker.sessions() <= 2);
+  }
+
+  SECTION("workers should refuse to listen on other than loopback without secret") {
+    auto options = make_options(root, 1);
+    options.host = "0.0.0.0";
+    REQUIRE_THROWS(server{options});
+    options.secret = "secret";
+    REQUIRE_NOTHROW(server{options});
+  }
+
+  SECTION("jobs which no worker is able to run should be left to local") {
+    auto other = std::filesystem::temp_directory_path() / "cpp-lint-action-test-remote-other";
+    write_file(other / "0.cpp", "int b;\n");
+    auto stale   = local_worker{make_options(other, 1)};
+    auto workers = coordinator{{stale.endpoint()}};
+    REQUIRE_FALSE(workers.execute({"0.cpp"}, root.string(), "0.cpp").has_value());
+    std::filesystem::remove_all(other);
+
+    auto none = coordinator{{}};
+    REQUIRE(none.slots() == 0);
+    REQUIRE_FALSE(none.execute({"0.cpp"}, root.string(), "0.cpp").has_value());
+  }
+
+  std::filesystem::remove_all(root);
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_common.h"
+
+using namespace lint;
+using namespace lint::tool;
+using namespace std::chrono_literals;
+
+TEST_CASE("Test plan tasks", "[CppLintAction][tool][scheduler]") {
+  auto context      = runtime_context{};
+  context.repo_path = "/nonexistent";
+
+  auto tools = std::vector<tool_base_ptr>{};
+  tools.push_back(std::make_unique<fake_tool>(std::vector<std::string>{"a", "b", "c", "d"}));
+
+  auto records = history{};
+  records.update("fake", "b", {.peak_rss = 100, .duration = 30ms});
+  records.update("fake", "c", {.peak_rss = 200, .duration = 90ms});
+
+  SECTION("tasks should be ordered longest first") {
+    auto tasks = plan_tasks(tools, context, records);
+    REQUIRE(tasks.size() == 4);
+    REQUIRE(tasks[0].file == "c");
+    REQUIRE(tasks[1].file == "b");
+    REQUIRE(tasks[2].file == "a");
+    REQUIRE(tasks[3].file == "d");
+  }
+
+  SECTION("history should be preferred over estimation") {
+    auto tasks = plan_tasks(tools, context, records);
+    REQUIRE(tasks[0].memory == 200);
+    REQUIRE(tasks[0].duration == 90ms);
+    REQUIRE(tasks[2].memory == 0);
+    REQUIRE(tasks[2].duration == 1ms);
+  }
+
+  SECTION("statistics of checked files should be recorded") {
+    auto pool = worker::pool{2};
+    run_tools(tools, context, pool, records);
+    REQUIRE(static_cast<fake_tool &>(*tools[0]).checked.size() == 4);
+    REQUIRE(records.find("fake", "a")->peak_rss == 1);
+    REQUIRE(records.find("fake", "d"));
+  }
+}
+
+TEST_CASE("Test fail fast", "[CppLintAction][tool][scheduler]") {
+  auto context             = runtime_context{};
+  context.repo_path        = "/nonexistent";
+  context.enable_fail_fast = true;
+
+  auto tools = std::vector<tool_base_ptr>{};
+  tools.push_back(std::make_unique<fake_tool>(std::vector<std::string>{"a", "b"}, "slow", 100ms));
+  tools.push_back(std::make_unique<fake_tool>(
+    std::vector<std::string>{"a", "b", "c"}, "cheap", 1ms, std::vector<std::string>{"b"}));
+
+  auto records = history{};
+  records.update("cheap", "c", {.peak_rss = 1, .duration = 5ms, .failed = true});
+
+  SECTION("cheapest tool and previously failed files should go first") {
+    auto tasks = plan_tasks(tools, context, records);
+    REQUIRE(tasks.size() == 5);
+    REQUIRE(tasks[0].tool->name() == "cheap");
+    REQUIRE(tasks[0].file == "c");
+    REQUIRE(tasks[1].tool->name() == "cheap");
+    REQUIRE(tasks[2].tool->name() == "cheap");
+    REQUIRE(tasks[3].tool->name() == "slow");
+    REQUIRE(tasks[4].tool->name() == "slow");
+  }
+
+  SECTION("all tools should be cancelled once one fails") {
+    auto pool = worker::pool{1};
+    run_tools(tools, context, pool, records);
+    REQUIRE(static_cast<fake_tool &>(*tools[0]).checked.empty());
+    REQUIRE(static_cast<fake_tool &>(*tools[1]).checked.size() == 3);
+    REQUIRE(records.find("cheap", "b")->failed);
+    REQUIRE_FALSE(records.find("cheap", "c")->failed);
+  }
+}
+
+TEST_CASE("Test select shard", "[CppLintAction][tool][scheduler]") {
+  auto context      = runtime_context{};
+  context.repo_path = "/nonexistent";
+
+  auto files = std::vector<std::string>{};
+  for (int i = 0; i < 20; ++i) {
+    files.push_back(std::to_string(i));
+  }
+  auto tools = std::vector<tool_base_ptr>{};
+  tools.push_back(std::make_unique<fake_tool>(files));
+
+  auto records = history{};
+  for (int i = 0; i < 20; ++i) {
+    records.update("fake", files[i], {.peak_rss = 1, .duration = std::chrono::milliseconds{i + 1}});
+  }
+  auto tasks = plan_tasks(tools, context, records);
+
+  for (auto strategy: {shard_strategy_t::hash, shard_strategy_t::cost}) {
+    auto selected = std::vector<std::string>{};
+    auto loads    = std::vector<std::chrono::milliseconds>{};
+    for (std::size_t index = 0; index < 3; ++index) {
+      auto shard = select_shard(tasks, index, 3, strategy);
+      auto load  = std::chrono::milliseconds{0};
+      for (const auto &job: shard) {
+        selected.push_back(job.file);
+        load += job.duration;
+      }
+      loads.push_back(load);
+    }
+
+    // Every task is selected by exactly one shard.
+    std::ranges::sort(selected);
+    std::ranges::sort(files);
+    REQUIRE(selected == files);
+
+    if (strategy == shard_strategy_t::cost) {
+      auto [min, max] = std::ranges::minmax(loads);
+      REQUIRE(max - min <= 20ms);
+    }
+  }
+}
+
+TEST_CASE("Test scan tools", "[CppLintAction][tool][scheduler]") {
+  auto context      = runtime_context{};
+  context.repo_path = "/nonexistent";
+
+  auto files = std::vector<std::string>{};
+  for (int i = 0; i < 40; ++i) {
+    files.push_back(std::to_string(i));
+  }
+  auto tools = std::vector<tool_base_ptr>{};
+  tools.push_back(std::make_unique<fake_tool>(files));
+
+  auto records = history{};
+  auto pool    = worker::pool{2};
+  auto queued  = std::size_t{0};
+  auto source  = [&](const std::function<void(const std::string &)> &visit) {
+    for (int i = 0; i < 50; ++i) {
+      queued = std::max(queued, pool.pending() + pool.running());
+      visit(std::to_string(i));
+    }
+  };
+
+  SECTION("only accepted files should be checked with bounded queue") {
+    auto reporters = scan_tools(tools, context, pool, records, source);
+    auto checked   = static_cast<fake_tool &>(*tools[0]).checked;
+    std::ranges::sort(checked);
+    std::ranges::sort(files);
+    REQUIRE(checked == files);
+    REQUIRE(queued <= pool.workers() * 2);
+    REQUIRE(reporters.size() == 1);
+    REQUIRE(records.find("fake", "0"));
+  }
+
+  SECTION("files should be sharded by hash") {
+    context.shard_count = 2;
+    auto selected       = std::vector<std::string>{};
+    for (std::size_t index = 0; index < 2; ++index) {
+      context.shard_index = index;
+      scan_tools(tools, context, pool, records, source);
+      auto &tool = static_cast<fake_tool &>(*tools[0]);
+      REQUIRE(tool.checked.size() < files.size());
+      selected.insert(selected.end(), tool.checked.begin(), tool.checked.end());
+      tool.checked.clear();
+    }
+    std::ranges::sort(selected);
+    std::ranges::sort(files);
+    REQUIRE(selected == files);
+
+    context.shard_strategy = shard_strategy_t::cost;
+    REQUIRE_THROWS(scan_tools(tools, context, pool, records, source));
+  }
+
+  SECTION("queued tasks should be finished if enumerating files throws") {
+    auto broken = [&](const std::function<void(const std::string &)> &visit) {
+      for (int i = 0; i < 10; ++i) {
+        visit(std::to_string(i));
+      }
+      throw std::runtime_error{"broken tree"};
+    };
+    REQUIRE_THROWS(scan_tools(tools, context, pool, records, broken));
+    REQUIRE(pool.pending() == 0);
+    REQUIRE(pool.running() == 0);
+    REQUIRE(static_cast<fake_tool &>(*tools[0]).checked.size() == 10);
+  }
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/shell.h"
+
+#include <chrono>
+#include <stop_token>
+#include <thread>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace std::chrono_literals;
+
+TEST_CASE("Test terminating processes by stop requests", "[CppLintAction][utils][shell]") {
+  auto stop = std::stop_source{};
+
+  SECTION("a process stopped halfway should be killed") {
+    auto stopper = std::jthread{[&stop] {
+      std::this_thread::sleep_for(100ms);
+      stop.request_stop();
+    }};
+    auto res = shell::execute("/bin/sleep", {"10"}, ".", stop.get_token());
+    REQUIRE(res.killed);
+    REQUIRE(res.exit_code != 0);
+  }
+
+  SECTION("a process finished before the stop request shouldn't be killed") {
+    auto res = shell::execute("/bin/echo", {"done"}, ".", stop.get_token());
+    stop.request_stop();
+    REQUIRE_FALSE(res.killed);
+    REQUIRE(res.exit_code == 0);
+    REQUIRE(res.std_out == "done\n");
+  }
+}
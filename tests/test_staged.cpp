@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "context.h"
+#include "staged.h"
+#include "test_common.h"
+#include "utils/git_utils.h"
+
+using namespace lint;
+
+namespace {
+  auto read_file(const std::filesystem::path &path) -> std::string {
+    auto stream = std::ifstream{path};
+    return {std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+  }
+
+  auto read_temp_file(const std::string &file) -> std::string {
+    return read_file(get_temp_repo_dir() / file);
+  }
+
+  void stage_files(git_repository &repo, const std::vector<std::string> &files) {
+    git::index::add_files(repo, files);
+    git::index::write(*git::repo::index(repo));
+  }
+
+  auto make_staged_context() -> runtime_context {
+    auto context      = runtime_context{};
+    context.staged    = true;
+    context.repo_path = get_temp_repo_dir().string();
+    fill_staged_info(context);
+    return context;
+  }
+} // namespace
+
+TEST_CASE("Staged contents should be linted instead of worktree", "[CppLintAction][staged]") {
+  create_temp_repo_dir();
+  auto guard = scope_guard{remove_temp_repo_dir};
+
+  auto repo = init_basic_repo();
+  create_temp_files({"a.cpp", "b.cpp"}, "int a;\n");
+  auto [_, tree] = git::index::add_files(*repo, {"a.cpp", "b.cpp"});
+  git::commit::create_head(*repo, "Add two files", *tree);
+
+  // Stage a change of a.cpp and a new file, then change a.cpp again.
+  append_content_to_file("a.cpp", "int b;\n");
+  create_temp_file("c.cpp", "int c;\n");
+  stage_files(*repo, {"a.cpp", "c.cpp"});
+  append_content_to_file("a.cpp", "int unstaged;\n");
+
+  auto context = make_staged_context();
+  auto files   = context.changed_files;
+  ranges::sort(files);
+  REQUIRE(files == std::vector<std::string>{"a.cpp", "c.cpp"});
+  REQUIRE(context.target_commit != nullptr);
+  REQUIRE(context.source_commit == nullptr);
+
+  auto path  = get_temp_repo_dir() / "a.cpp";
+  auto mtime = std::filesystem::file_time_type{};
+  {
+    auto staged = staged_tree{context};
+    auto root   = staged.root();
+    REQUIRE(staged.files() == std::vector<std::string>{"a.cpp"});
+    REQUIRE(context.repo_path == root.string());
+    REQUIRE(read_file(root / "a.cpp") == "int a;\nint b;\n");
+    REQUIRE(read_file(root / "c.cpp") == "int c;\n");
+    REQUIRE_FALSE(std::filesystem::exists(root / ".git"));
+
+    // The worktree isn't touched, so edits made meanwhile are kept.
+    REQUIRE(read_temp_file("a.cpp") == "int a;\nint b;\nint unstaged;\n");
+    append_content_to_file("a.cpp", "int edited;\n");
+    mtime = std::filesystem::last_write_time(path);
+  }
+  REQUIRE(context.repo_path == get_temp_repo_dir().string());
+  REQUIRE(read_temp_file("a.cpp") == "int a;\nint b;\nint unstaged;\nint edited;\n");
+  REQUIRE(std::filesystem::last_write_time(path) == mtime);
+}
+
+TEST_CASE("Trees left by killed runs should be removed", "[CppLintAction][staged]") {
+  create_temp_repo_dir();
+  auto guard = scope_guard{remove_temp_repo_dir};
+
+  auto repo = init_basic_repo();
+  create_temp_file("a.cpp", "int a;\n");
+  stage_files(*repo, {"a.cpp"});
+
+  // The tree of a gone run is removed, while the one of a running run is kept.
+  auto parent  = std::filesystem::path{git::repo::path(*repo)} / "cpp-lint-action";
+  auto killed  = parent / "staged-2147483647";
+  auto running = parent / fmt::format("staged-{}", ::getppid());
+  std::filesystem::create_directories(killed);
+  std::filesystem::create_directories(running);
+
+  auto context = make_staged_context();
+  REQUIRE(context.target_commit == nullptr);
+  REQUIRE(context.changed_files == std::vector<std::string>{"a.cpp"});
+  {
+    // Nothing is written since the worktree has the staged contents.
+    auto staged = staged_tree{context};
+    REQUIRE(staged.files().empty());
+    REQUIRE(staged.root().empty());
+    REQUIRE(context.repo_path == get_temp_repo_dir().string());
+  }
+  REQUIRE_FALSE(std::filesystem::exists(killed));
+  REQUIRE(std::filesystem::exists(running));
+}
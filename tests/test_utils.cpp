@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "utils/common.h"
+#include "utils/hash.h"
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+
+TEST_CASE("Test trimming strings", "[CppLintAction][utils]") {
+  SECTION("spaces and newlines around content should be trimmed") {
+    REQUIRE(trim_left(" \n a b ") == "a b ");
+    REQUIRE(trim_right(" a b \n ") == " a b");
+    REQUIRE(trim("\n a b \n") == "a b");
+  }
+
+  SECTION("strings without spaces should be kept") {
+    REQUIRE(trim_left("a") == "a");
+    REQUIRE(trim_right("a") == "a");
+    REQUIRE(trim("a") == "a");
+  }
+
+  SECTION("blank strings should be trimmed to empty") {
+    REQUIRE(trim_left("  \n ").empty());
+    REQUIRE(trim_right("  \n ").empty());
+    REQUIRE(trim("   ").empty());
+    REQUIRE(trim("").empty());
+  }
+}
+
+TEST_CASE("Test stable hash", "[CppLintAction][utils]") {
+  REQUIRE(stable_hash("clang-tidy\ta.cpp") == stable_hash("clang-tidy\ta.cpp"));
+  REQUIRE(stable_hash("clang-tidy\ta.cpp") != stable_hash("clang-tidy\tb.cpp"));
+  REQUIRE(stable_hash("") == 14695981039346656037U);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "test_common.h"
+#include "utils/worker_pool.h"
+#include "watch/inotify.h"
+#include "watch/session.h"
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+using namespace lint::watch;
+using namespace std::chrono_literals;
+
+namespace {
+  auto make_root(const std::string &name) -> std::filesystem::path {
+    auto root = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    return root;
+  }
+
+  // Session with a fake tool on a temporary root.
+  struct fake_session {
+    explicit fake_session(const std::filesystem::path &root)
+      : tool(new fake_tool{}) {
+      tools.emplace_back(tool);
+      context.repo_path = root.string();
+    }
+
+    auto lint(const std::vector<std::string> &files) -> std::string {
+      auto before = out.str().size();
+      checks.changed(files);
+      checks.wait();
+      return out.str().substr(before);
+    }
+
+    fake_tool *tool;
+    std::vector<tool::tool_base_ptr> tools;
+    runtime_context context;
+    worker::pool pool{2};
+    std::ostringstream out;
+    session checks{tools, context, pool, out};
+  };
+} // namespace
+
+TEST_CASE("Watcher should return a burst of saves at once", "[CppLintAction][watch]") {
+  auto root    = make_root("cpp-lint-action-watch");
+  auto watcher = inotify_watcher{root.string()};
+
+  auto writer = std::jthread{[&root] {
+    write_file(root / "a.cpp", "int a;");
+    std::this_thread::sleep_for(20ms);
+    write_file(root / "b.cpp", "int b;");
+    write_file(root / "sub" / "c.cpp", "int c;");
+  }};
+  auto files = watcher.wait(200ms);
+  REQUIRE(files == std::vector<std::string>{"a.cpp", "b.cpp", "sub/c.cpp"});
+
+  // Files in the directory created above are watched as well.
+  write_file(root / "sub" / "c.cpp", "int c = 1;");
+  REQUIRE(watcher.wait(50ms) == std::vector<std::string>{"sub/c.cpp"});
+
+  std::filesystem::remove(root / "a.cpp");
+  REQUIRE(watcher.wait(50ms) == std::vector<std::string>{"a.cpp"});
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Watcher should skip filtered paths", "[CppLintAction][watch]") {
+  auto root    = make_root("cpp-lint-action-watch-skip");
+  auto skip    = [](const std::string &path) { return path == "build" || path.ends_with(".o"); };
+  auto watcher = inotify_watcher{root.string(), skip};
+
+  write_file(root / "build" / "a.cpp", "int a;");
+  write_file(root / "a.o", "");
+  write_file(root / "b.cpp", "int b;");
+  REQUIRE(watcher.wait(50ms) == std::vector<std::string>{"b.cpp"});
+
+  auto stop = std::stop_source{};
+  stop.request_stop();
+  write_file(root / "b.cpp", "int b = 1;");
+  REQUIRE(watcher.wait(50ms, stop.get_token()).empty());
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Session should only print changed results", "[CppLintAction][watch]") {
+  auto root   = make_root("cpp-lint-action-watch-session");
+  auto checks = fake_session{root};
+
+  write_file(root / "a.cpp", "bad");
+  REQUIRE(checks.lint({"a.cpp"}) == "fake: a.cpp fails\na.cpp:1:1: error: bad\n");
+  REQUIRE(checks.lint({"a.cpp"}).empty());
+
+  write_file(root / "a.cpp", "good");
+  REQUIRE(checks.lint({"a.cpp"}) == "fake: a.cpp passes now\n");
+  REQUIRE(checks.lint({"a.cpp"}).empty());
+
+  std::filesystem::remove(root / "a.cpp");
+  REQUIRE(checks.lint({"a.cpp"}) == "fake: a.cpp isn't checked any more\n");
+  REQUIRE(checks.tool->checks == 4);
+  REQUIRE(checks.tool->dropped == std::vector<std::string>(5, "a.cpp"));
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Session should cancel the check of a file changed again", "[CppLintAction][watch]") {
+  auto root   = make_root("cpp-lint-action-watch-cancel");
+  auto checks = fake_session{root};
+
+  write_file(root / "a.cpp", "slow");
+  checks.checks.changed({"a.cpp"});
+  while (!checks.tool->slow_started) {
+    std::this_thread::sleep_for(1ms);
+  }
+
+  // The cancelled check prints nothing and the file is checked again.
+  write_file(root / "a.cpp", "bad");
+  REQUIRE(checks.lint({"a.cpp"}) == "fake: a.cpp fails\na.cpp:1:1: error: bad\n");
+  REQUIRE(checks.tool->checks == 2);
+  std::filesystem::remove_all(root);
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2024 Emmett Zhang
+ *
+ * Licensed under the Apache License Version 2.0 with LLVM Exceptions
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *   https://llvm.org/LICENSE.txt
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utils/resource.h"
+#include "utils/worker_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+#include <catch2/catch_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace lint;
+
+TEST_CASE("Test parse cgroup v2 files", "[CppLintAction][utils][resource]") {
+  SECTION("cpu.max") {
+    REQUIRE(resource::parse_cpu_max("max 100000\n") == 0);
+    REQUIRE(resource::parse_cpu_max("200000 100000\n") == 2);
+    REQUIRE(resource::parse_cpu_max("50000 100000\n") == 0.5);
+    REQUIRE(resource::parse_cpu_max("") == 0);
+  }
+
+  SECTION("memory.max") {
+    REQUIRE(resource::parse_memory_max("max\n") == 0);
+    REQUIRE(resource::parse_memory_max("4294967296\n") == 4294967296);
+  }
+
+  SECTION("pressure") {
+    auto content = "some avg10=12.50 avg60=1.00 avg300=0.00 total=10\n"
+                   "full avg10=3.25 avg60=0.00 avg300=0.00 total=2\n";
+    auto res     = resource::parse_pressure(content);
+    REQUIRE(res);
+    REQUIRE(res->some_avg10 == 12.5);
+    REQUIRE(res->full_avg10 == 3.25);
+    REQUIRE_FALSE(resource::parse_pressure("invalid"));
+  }
+
+  SECTION("meminfo") {
+    auto content = "MemTotal:       32768000 kB\n"
+                   "MemFree:         1024000 kB\n"
+                   "MemAvailable:   16000000 kB\n";
+    REQUIRE(resource::parse_meminfo_available(content) == std::uint64_t{16000000} * 1024);
+    REQUIRE(resource::parse_meminfo_available("invalid") == 0);
+  }
+
+  SECTION("default memory budget") {
+    auto limits       = resource::cgroup_limits{};
+    limits.memory_max = 1000;
+    REQUIRE(resource::default_memory_budget(limits, 2000) == 900);
+    REQUIRE(resource::default_memory_budget(limits, 500) == 450);
+    REQUIRE(resource::default_memory_budget(limits, 0) == 900);
+    REQUIRE(resource::default_memory_budget({}, 2000) == 1800);
+    REQUIRE(resource::default_memory_budget({}, 0) == 0);
+  }
+}
+
+TEST_CASE("Test worker pool", "[CppLintAction][utils][worker_pool]") {
+  auto pool = worker::pool{4};
+
+  SECTION("all tasks should be run") {
+    auto count = std::atomic<int>{0};
+    for (int i = 0; i < 100; ++i) {
+      pool.submit([&] { ++count; });
+    }
+    pool.wait();
+    REQUIRE(count == 100);
+  }
+
+  SECTION("concurrency limit should be respected") {
+    pool.set_concurrency(2);
+    auto running     = std::atomic<int>{0};
+    auto max_running = std::atomic<int>{0};
+    for (int i = 0; i < 20; ++i) {
+      pool.submit([&] {
+        auto now  = ++running;
+        auto prev = max_running.load();
+        while (now > prev && !max_running.compare_exchange_weak(prev, now)) { }
+        std::this_thread::sleep_for(std::chrono::milliseconds{2});
+        --running;
+      });
+    }
+    pool.wait();
+    REQUIRE(max_running <= 2);
+  }
+
+  SECTION("concurrency should be clamped") {
+    pool.set_concurrency(0);
+    REQUIRE(pool.concurrency() == 1);
+    pool.set_concurrency(100);
+    REQUIRE(pool.concurrency() == 4);
+  }
+
+  SECTION("memory budget should be respected") {
+    pool.set_memory_budget(100);
+    auto in_use     = std::atomic<std::uint64_t>{0};
+    auto max_in_use = std::atomic<std::uint64_t>{0};
+    for (int i = 0; i < 20; ++i) {
+      auto memory = std::uint64_t{i % 2 == 0 ? 60U : 30U};
+      pool.submit(
+        [&, memory] {
+          auto now  = in_use += memory;
+          auto prev = max_in_use.load();
+          while (now > prev && !max_in_use.compare_exchange_weak(prev, now)) { }
+          std::this_thread::sleep_for(std::chrono::milliseconds{2});
+          in_use -= memory;
+        },
+        memory);
+    }
+    pool.wait();
+    REQUIRE(max_in_use <= 100);
+    REQUIRE(pool.memory_in_use() == 0);
+  }
+
+  SECTION("task larger than budget should still be run") {
+    pool.set_memory_budget(100);
+    auto count = std::atomic<int>{0};
+    pool.submit([&] { ++count; }, 1000);
+    pool.wait();
+    REQUIRE(count == 1);
+  }
+
+  SECTION("exception thrown by task should be rethrown by wait") {
+    pool.submit([] { throw std::runtime_error{"error"}; });
+    REQUIRE_THROWS(pool.wait());
+    REQUIRE_NOTHROW(pool.wait());
+  }
+}
+
+TEST_CASE("Test remote tasks of worker pool", "[CppLintAction][utils][worker_pool]") {
+  auto pool = worker::pool{2, 4};
+  pool.set_concurrency(1);
+  pool.set_memory_budget(100);
+  REQUIRE(pool.workers() == 2);
+  REQUIRE(pool.remote_workers() == 4);
+
+  auto track = [](std::atomic<int> &running, std::atomic<int> &max_running) {
+    auto now  = ++running;
+    auto prev = max_running.load();
+    while (now > prev && !max_running.compare_exchange_weak(prev, now)) { }
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    --running;
+  };
+
+  SECTION("remote tasks should be admitted by neither concurrency nor memory budget") {
+    auto running     = std::atomic<int>{0};
+    auto max_running = std::atomic<int>{0};
+    for (int i = 0; i < 8; ++i) {
+      pool.submit_remote([&] { track(running, max_running); }, 100);
+    }
+    pool.wait();
+    REQUIRE(max_running > 1);
+    REQUIRE(pool.memory_in_use() == 0);
+  }
+
+  SECTION("remote tasks running locally should be admitted with local tasks") {
+    auto running     = std::atomic<int>{0};
+    auto max_running = std::atomic<int>{0};
+    for (int i = 0; i < 4; ++i) {
+      pool.submit([&] { track(running, max_running); });
+      pool.submit_remote(
+        [&] {
+          auto admission = worker::local_admission{};
+          track(running, max_running);
+        },
+        60);
+    }
+    pool.wait();
+    REQUIRE(max_running == 1);
+    REQUIRE(pool.running() == 0);
+    REQUIRE(pool.memory_in_use() == 0);
+  }
+
+  SECTION("local admission should do nothing out of remote tasks") {
+    auto admission = worker::local_admission{};
+    REQUIRE(pool.running() == 0);
+  }
+
+  SECTION("remote tasks should be run locally without remote workers") {
+    auto local = worker::pool{1};
+    auto count = std::atomic<int>{0};
+    local.submit_remote([&] { ++count; }, 0);
+    local.wait();
+    REQUIRE(count == 1);
+  }
+}
+
+TEST_CASE("Test adjust concurrency by load sample", "[CppLintAction][utils][worker_pool]") {
+  auto sample      = worker::load_sample{};
+  sample.cpus      = 8;
+  sample.saturated = true;
+
+  SECTION("memory thrashing should halve concurrency") {
+    sample.memory = resource::pressure{.some_avg10 = 30, .full_avg10 = 5};
+    REQUIRE(worker::next_concurrency(8, 8, sample) == 4);
+    REQUIRE(worker::next_concurrency(1, 8, sample) == 1);
+  }
+
+  SECTION("cpu pressure should decrease concurrency") {
+    sample.cpu = resource::pressure{.some_avg10 = 80};
+    REQUIRE(worker::next_concurrency(4, 8, sample) == 3);
+  }
+
+  SECTION("idle system should increase concurrency up to ceiling") {
+    sample.cpu    = resource::pressure{};
+    sample.memory = resource::pressure{};
+    REQUIRE(worker::next_concurrency(4, 8, sample) == 5);
+    REQUIRE(worker::next_concurrency(8, 8, sample) == 8);
+    sample.saturated = false;
+    REQUIRE(worker::next_concurrency(4, 8, sample) == 4);
+  }
+
+  SECTION("load average is used when PSI is unavailable") {
+    sample.load_average = 16;
+    REQUIRE(worker::next_concurrency(4, 8, sample) == 3);
+    sample.load_average = 2;
+    REQUIRE(worker::next_concurrency(4, 8, sample) == 5);
+  }
+}